@@ -0,0 +1,746 @@
+// 파일 시스템 핵심 함수 마이크로벤치마크 (make bench).
+// kernel/6dir.c의 함수를 대화형 루프 없이 직접 불러, 합성 트리를 만든 뒤 연산별로
+// 초당 연산 수, p50/p99 지연 시간, 최대 RSS를 재고 결과를 CSV 파일에 덧붙인다.
+// 블록 내용을 데이터 파일로 옮긴 뒤 내용의 1/4 크기 버퍼 캐시(kernel/bcache.c)를 거친 읽기도 잰다.
+// 이어서 모든 파일을 압축(kernel/compress.c)하고 같은 무작위 읽기를 다시 재 압축을 푸는 비용을 본다.
+// 끝으로 kernel/process.c 스케줄러의 문맥 전환 비용과 --tasks개 작업 중에서 고르는 스케줄 결정 지연을 잰다.
+//
+// 사용법: fsbench [--nodes N] [--shape wide|deep|balanced] [--content fixed:N|uniform:A:B|exp:MEAN]
+//                 [--ops N] [--seed N] [--threads N] [--tasks N] [--out 파일]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/resource.h>
+#include "fs.h"
+#include "bcache.h"
+#include "compress.h"
+#include "openfile.h"
+#include "workpool.h"
+#include "system.h"
+
+typedef enum { SHAPE_WIDE, SHAPE_DEEP, SHAPE_BALANCED } Shape;
+typedef enum { CONTENT_FIXED, CONTENT_UNIFORM, CONTENT_EXP } ContentKind;
+
+typedef struct BenchConfig {
+    long nodes;
+    Shape shape;
+    const char* shapeName;
+    ContentKind contentKind;
+    const char* contentSpec;
+    long contentA, contentB;
+    long ops;
+    unsigned long long seed;
+    int threads; // 병렬 탐색 벤치마크의 스레드 수
+    long tasks; // 스케줄 결정 벤치마크의 실행 가능 작업 수
+    const char* outPath;
+} BenchConfig;
+
+typedef struct NodeList {
+    Node** items;
+    long count, capacity;
+} NodeList;
+
+static BenchConfig config = {100000, SHAPE_BALANCED, "balanced", CONTENT_FIXED, "fixed:64", 64, 64,
+                             100000, 1, 4, 100000, "bench_results.csv"};
+static FILE* report; // 결과는 여기에 쓰고, 벤치마크 대상 함수의 출력은 stdout(/dev/null)로 버린다
+static FILE* results;
+static NodeList dirs, files;
+static unsigned long long rngState;
+static long long* samples;
+static char* text; // 내용 생성용 단어 나열
+static long textLength;
+
+static unsigned long long nextRandom(void) {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 7;
+    rngState ^= rngState << 17;
+    return rngState;
+}
+
+static long randomBelow(long bound) {
+    return bound <= 0 ? 0 : (long)(nextRandom() % (unsigned long long)bound);
+}
+
+static long long nowNanoseconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+static long peakRssKb(void) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+static void listPush(NodeList* list, Node* node) {
+    if (list->count == list->capacity) {
+        list->capacity = list->capacity == 0 ? 1024 : list->capacity * 2;
+        list->items = (Node**)realloc(list->items, list->capacity * sizeof(Node*));
+    }
+    list->items[list->count++] = node;
+}
+
+static int compareSamples(const void* a, const void* b) {
+    long long x = *(const long long*)a, y = *(const long long*)b;
+    return (x > y) - (x < y);
+}
+
+// 측정한 지연 시간으로 한 줄을 보고하고 결과 파일에 덧붙인다.
+// 지연 분포는 앞쪽 config.ops개 표본으로, 처리량은 전체 ops로 계산한다.
+static void reportBench(const char* name, long ops, long long totalNs) {
+    long sampleCount = ops < config.ops ? ops : config.ops;
+    qsort(samples, sampleCount, sizeof(long long), compareSamples);
+    long long p50 = sampleCount > 0 ? samples[(sampleCount - 1) / 2] : 0;
+    long long p99 = sampleCount > 0 ? samples[(long)((sampleCount - 1) * 0.99)] : 0;
+    double opsPerSec = totalNs > 0 ? ops * 1e9 / totalNs : 0.0;
+    long rss = peakRssKb();
+    fprintf(report, "%-22s %10ld %14.0f %12lld %12lld %12ld\n", name, ops, opsPerSec, p50, p99, rss);
+    fprintf(results, "%ld,%s,%ld,%s,%llu,%s,%ld,%.0f,%lld,%lld,%ld\n", (long)time(NULL), config.shapeName,
+            config.nodes, config.contentSpec, config.seed, name, ops, opsPerSec, p50, p99, rss);
+    fflush(report);
+}
+
+#define TIMED(index, total, statement)              \
+    do {                                            \
+        long long startNs = nowNanoseconds();       \
+        statement;                                  \
+        long long elapsed = nowNanoseconds() - startNs; \
+        if ((index) < config.ops) {                 \
+            samples[index] = elapsed;               \
+        }                                           \
+        total += elapsed;                           \
+    } while (0)
+
+static long contentSize(void) {
+    switch (config.contentKind) {
+    case CONTENT_UNIFORM:
+        return config.contentA + randomBelow(config.contentB - config.contentA + 1);
+    case CONTENT_EXP: {
+        double u = (nextRandom() >> 11) * (1.0 / 9007199254740992.0);
+        return (long)(-config.contentA * log(1.0 - u));
+    }
+    default:
+        return config.contentA;
+    }
+}
+
+// 짧은 단어를 무작위로 이어 붙인 텍스트. 파일 내용은 이 텍스트의 임의 구간이다.
+static void buildText(void) {
+    static const char letters[] = "abcdefghijklmnopqrstuvwxyz";
+    textLength = 1 << 22;
+    text = (char*)malloc(textLength + 1);
+    char words[512][12];
+    for (int w = 0; w < 512; w++) {
+        int length = 3 + (int)randomBelow(7);
+        for (int i = 0; i < length; i++) {
+            words[w][i] = letters[randomBelow(26)];
+        }
+        words[w][length] = '\0';
+    }
+    long position = 0;
+    while (position < textLength) {
+        const char* word = words[randomBelow(512)];
+        for (int i = 0; word[i] != '\0' && position < textLength; i++) {
+            text[position++] = word[i];
+        }
+        if (position < textLength) {
+            text[position++] = ' ';
+        }
+    }
+    text[textLength] = '\0';
+}
+
+static void fillContent(char* buffer, long size) {
+    if (size > textLength) {
+        size = textLength;
+    }
+    long offset = randomBelow(textLength - size + 1);
+    memcpy(buffer, text + offset, size);
+    buffer[size] = '\0';
+}
+
+// 너비 우선으로 디렉터리를 펼치며 노드 수가 config.nodes가 될 때까지 채운다.
+// 디렉터리마다 subdirs개의 하위 디렉터리와 filesPerDir개의 파일을 둔다.
+static void buildTree(Node* root) {
+    long subdirs, filesPerDir;
+    switch (config.shape) {
+    case SHAPE_WIDE:
+        subdirs = 8;
+        filesPerDir = 1024;
+        break;
+    case SHAPE_DEEP: {
+        long depth = config.nodes / 8 < 4096 ? (config.nodes / 8 > 0 ? config.nodes / 8 : 1) : 4096;
+        subdirs = 1;
+        filesPerDir = config.nodes / depth;
+        break;
+    }
+    default:
+        subdirs = 4;
+        filesPerDir = 8;
+        break;
+    }
+
+    long maxContent = config.contentKind == CONTENT_FIXED ? config.contentA : config.contentB;
+    if (config.contentKind == CONTENT_EXP) {
+        maxContent = config.contentA * 20;
+    }
+    char* content = (char*)malloc(maxContent + 1 > textLength + 1 ? textLength + 1 : maxContent + 1);
+    char name[32];
+    long created = 1, serial = 0, queueHead = 0;
+    long long totalNs = 0;
+    listPush(&dirs, root);
+
+    while (created < config.nodes && queueHead < dirs.count) {
+        Node* dir = dirs.items[queueHead++];
+        for (long i = 0; i < filesPerDir && created < config.nodes; i++, created++) {
+            snprintf(name, sizeof(name), "f%ld", serial++);
+            long size = contentSize();
+            if (size > maxContent) {
+                size = maxContent;
+            }
+            fillContent(content, size);
+            Node* file;
+            TIMED(created - 1, totalNs, {
+                file = createNode(name, FILE_TYPE, dir);
+                addChild(dir, file);
+                updateFileContent(file, content);
+            });
+            listPush(&files, file);
+        }
+        for (long i = 0; i < subdirs && created < config.nodes; i++, created++) {
+            snprintf(name, sizeof(name), "d%ld", serial++);
+            Node* child;
+            TIMED(created - 1, totalNs, {
+                child = createNode(name, DIR_TYPE, dir);
+                addChild(dir, child);
+            });
+            listPush(&dirs, child);
+        }
+    }
+    free(content);
+    reportBench("createNode+addChild", created - 1, totalNs);
+}
+
+// 루트부터의 경로를 만든다. 버퍼보다 긴 경로는 잘린다 (찾지 못하는 탐색으로 측정된다).
+static void nodePath(Node* node, char* buffer, size_t size) {
+    Node* chain[4096];
+    int depth = 0;
+    for (Node* current = node; current->parent != NULL && depth < 4096; current = current->parent) {
+        chain[depth++] = current;
+    }
+    size_t length = 0;
+    buffer[0] = '\0';
+    for (int i = depth - 1; i >= 0; i--) {
+        const char* name = chain[i]->name;
+        size_t nameLength = strlen(name);
+        if (length + nameLength + 2 > size) {
+            break;
+        }
+        buffer[length++] = '/';
+        memcpy(buffer + length, name, nameLength + 1);
+        length += nameLength;
+    }
+    if (length == 0) {
+        snprintf(buffer, size, "/");
+    }
+}
+
+static long limitOps(long wanted) {
+    return wanted < config.ops ? wanted : config.ops;
+}
+
+static void benchHasChild(void) {
+    long ops = config.ops;
+    long long totalNs = 0;
+    volatile int sink = 0;
+    for (long i = 0; i < ops; i++) {
+        Node* file = files.items[randomBelow(files.count)];
+        bool miss = (i & 1) != 0;
+        const char* name = miss ? "no-such-entry" : file->name;
+        TIMED(i, totalNs, sink += hasChildWithName(file->parent, name, FILE_TYPE));
+    }
+    reportBench("hasChildWithName", ops, totalNs);
+}
+
+static void benchResolvePath(Node* root) {
+    long ops = config.ops;
+    long long totalNs = 0;
+    char path[4096];
+    for (long i = 0; i < ops; i++) {
+        Node* file = files.items[randomBelow(files.count)];
+        nodePath(file, path, sizeof(path));
+        TIMED(i, totalNs, resolvePath(root, path, FILE_TYPE));
+    }
+    reportBench("resolvePath", ops, totalNs);
+}
+
+typedef struct ResolveWorker {
+    pthread_t thread;
+    Node* root;
+    char** paths;
+    long begin, end; // paths와 samples에서 맡은 구간
+} ResolveWorker;
+
+static void* resolveWorker(void* argument) {
+    ResolveWorker* worker = (ResolveWorker*)argument;
+    long long totalNs = 0;
+    for (long i = worker->begin; i < worker->end; i++) {
+        fsEnterShared();
+        TIMED(i, totalNs, resolvePath(worker->root, worker->paths[i], FILE_TYPE));
+        fsExitShared();
+    }
+    releaseThreadInodes();
+    return NULL;
+}
+
+// 같은 경로 탐색을 여러 스레드로 나눠 돌린다. 초당 연산 수는 전체 경과 시간 기준이다.
+static void benchParallelResolve(Node* root) {
+    long ops = config.ops;
+    char** paths = (char**)malloc(ops * sizeof(char*));
+    char path[4096];
+    for (long i = 0; i < ops; i++) {
+        nodePath(files.items[randomBelow(files.count)], path, sizeof(path));
+        paths[i] = strdup(path);
+    }
+    ResolveWorker* workers = (ResolveWorker*)calloc(config.threads, sizeof(ResolveWorker));
+    long long startNs = nowNanoseconds();
+    for (int t = 0; t < config.threads; t++) {
+        workers[t] = (ResolveWorker){0, root, paths, ops * t / config.threads, ops * (t + 1) / config.threads};
+        pthread_create(&workers[t].thread, NULL, resolveWorker, &workers[t]);
+    }
+    for (int t = 0; t < config.threads; t++) {
+        pthread_join(workers[t].thread, NULL);
+    }
+    long long wallNs = nowNanoseconds() - startNs;
+
+    char name[32];
+    snprintf(name, sizeof(name), "resolvePath(%d threads)", config.threads);
+    reportBench(name, ops, wallNs);
+    for (long i = 0; i < ops; i++) {
+        free(paths[i]);
+    }
+    free(paths);
+    free(workers);
+}
+
+static void benchFindNode(Node* root) {
+    long ops = limitOps(100);
+    long long totalNs = 0;
+    for (long i = 0; i < ops; i++) {
+        Node* file = files.items[randomBelow(files.count)];
+        TIMED(i, totalNs, findNode(root, file->name, FILE_TYPE));
+    }
+    reportBench("findNode", ops, totalNs);
+}
+
+static void benchSearch(Node* root) {
+    long ops = limitOps(20);
+    long long totalNs = 0;
+    char keyword[16];
+    for (long i = 0; i < ops; i++) {
+        if (i & 1) {
+            snprintf(keyword, sizeof(keyword), "zq%lux", (unsigned long)nextRandom() % 100000); // 없는 단어
+        } else {
+            fillContent(keyword, 6); // 텍스트에 실제로 있는 구간
+        }
+        TIMED(i, totalNs, searchfile(root, keyword));
+    }
+    reportBench("searchfile", ops, totalNs);
+}
+
+// 메타데이터 색인으로 찾는다. 좁은 크기 범위와 이름 접두어를 번갈아 쓴다.
+static void benchFindFiles(Node* root) {
+    long ops = limitOps(100);
+    long long totalNs = 0;
+    char conditions[64];
+    for (long i = 0; i < ops; i++) {
+        Node* file = files.items[randomBelow(files.count)];
+        if (i & 1) {
+            snprintf(conditions, sizeof(conditions), "name=%.4s*", file->name);
+        } else {
+            long size = INODE_SIZE(file->inode);
+            snprintf(conditions, sizeof(conditions), "size>=%ld size<=%ld", size, size + 2);
+        }
+        TIMED(i, totalNs, findFiles(root, conditions));
+    }
+    reportBench("findFiles", ops, totalNs);
+}
+
+static void benchDirectorySize(Node* root) {
+    long ops = limitOps(20);
+    long long totalNs = 0;
+    for (long i = 0; i < ops; i++) {
+        Node* dir = (i == 0) ? root : dirs.items[randomBelow(dirs.count)];
+        long total = 0;
+        TIMED(i, totalNs, calculateDirectorySize(dir, &total));
+    }
+    reportBench("calculateDirectorySize", ops, totalNs);
+}
+
+// 루트에서 트리 전체를 훑는 calculateDirectorySize를 작업 스레드 1개와 --threads개로 각각 잰다.
+static void benchTreeScan(Node* root) {
+    int counts[2] = {1, config.threads};
+    for (int c = 0; c < (config.threads > 1 ? 2 : 1); c++) {
+        char value[16];
+        snprintf(value, sizeof(value), "%d", counts[c]);
+        setenv("MINIOS_THREADS", value, 1);
+        workPoolShutdown(); // 다음 실행이 새 스레드 수로 풀을 만든다
+        long ops = limitOps(10);
+        long long totalNs = 0;
+        for (long i = 0; i < ops; i++) {
+            long total = 0;
+            TIMED(i, totalNs, calculateDirectorySize(root, &total));
+        }
+        char name[32];
+        snprintf(name, sizeof(name), "treeScan(%d threads)", counts[c]);
+        reportBench(name, ops, totalNs);
+    }
+}
+
+// 작은 디렉터리(파일 1000개 이하)를 임시 디렉터리로 복사하고 다시 지운다.
+static void benchCopyDelete(Node* root) {
+    Node* scratch = createNode("bench_scratch", DIR_TYPE, root);
+    addChild(root, scratch);
+    long ops = limitOps(1000);
+    long long copyNs = 0, deleteNs = 0;
+    long done = 0;
+    char name[32];
+    long long* deleteSamples = (long long*)malloc((ops > 0 ? ops : 1) * sizeof(long long));
+    for (long attempt = 0; attempt < ops * 4 && done < ops; attempt++) {
+        Node* dir = dirs.items[1 + randomBelow(dirs.count - 1 > 0 ? dirs.count - 1 : 0)];
+        if (dir->parent == NULL || dir->dir->subtreeFiles > 1000) {
+            continue;
+        }
+        snprintf(name, sizeof(name), "c%ld", done);
+        TIMED(done, copyNs, copyNode(dir->parent, dir->name, name, DIR_TYPE, scratch));
+        long long startNs = nowNanoseconds();
+        deleteNode(scratch, name, DIR_TYPE);
+        deleteSamples[done] = nowNanoseconds() - startNs;
+        deleteNs += deleteSamples[done];
+        done++;
+    }
+    reportBench("copyNode(dir)", done, copyNs);
+    memcpy(samples, deleteSamples, done * sizeof(long long));
+    reportBench("deleteNode(dir)", done, deleteNs);
+    free(deleteSamples);
+}
+
+// 블록 내용을 임시 데이터 파일로 옮기고 내용 전체의 1/4 크기 캐시를 거쳐, 무작위로 고른 파일 읽기와
+// 모든 파일을 만든 순서대로 읽는 순차 훑기를 잰다. 이후 벤치마크도 캐시를 거친다.
+static void benchCachedRead(void) {
+    char path[] = "/tmp/fsbench_blocksXXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        return;
+    }
+    close(fd);
+    bool attached = blockStoreAttach(path, (size_t)superblock.usedBlocks * BLOCK_SIZE / 4);
+    unlink(path); // 캐시가 연 파일은 닫을 때까지 남는다
+    if (!attached) {
+        return;
+    }
+    long maxSize = 1;
+    for (long i = 0; i < files.count; i++) {
+        long size = INODE_SIZE(files.items[i]->inode);
+        maxSize = size > maxSize ? size : maxSize;
+    }
+    char* buffer = (char*)malloc(maxSize);
+
+    long ops = limitOps(files.count);
+    long long totalNs = 0;
+    for (long i = 0; i < ops; i++) {
+        int index = files.items[randomBelow(files.count)]->inode;
+        TIMED(i, totalNs, fileRead(getInode(index), 0, buffer, INODE_SIZE(index)));
+    }
+    reportBench("cachedRead(random)", ops, totalNs);
+
+    ops = limitOps(3);
+    totalNs = 0;
+    for (long i = 0; i < ops; i++) {
+        long long startNs = nowNanoseconds();
+        for (long f = 0; f < files.count; f++) {
+            int index = files.items[f]->inode;
+            fileRead(getInode(index), 0, buffer, INODE_SIZE(index));
+        }
+        samples[i] = nowNanoseconds() - startNs;
+        totalNs += samples[i];
+    }
+    reportBench("cachedScan", ops, totalNs);
+    CacheStats stats = cacheGetStats();
+    unsigned long lookups = stats.hits + stats.misses;
+    fprintf(report, "  (캐시 %zu페이지, 적중률 %.1f%%, 미리 읽기 %lu페이지)\n", stats.pages,
+            lookups > 0 ? 100.0 * stats.hits / lookups : 0.0, stats.readahead);
+    free(buffer);
+}
+
+// 모든 파일을 압축하고 (COMPRESS_MIN_SIZE보다 작은 파일은 그대로 남는다) 무작위로 고른 파일 읽기를 잰다.
+static void benchCompressedRead(void) {
+    long maxSize = 1;
+    for (long i = 0; i < files.count; i++) {
+        long size = INODE_SIZE(files.items[i]->inode);
+        maxSize = size > maxSize ? size : maxSize;
+    }
+    char* buffer = (char*)malloc(maxSize);
+    int blocksBefore = superblock.usedBlocks;
+    long long startNs = nowNanoseconds();
+    int compressed = compressColdFiles(0);
+    samples[0] = nowNanoseconds() - startNs;
+    reportBench("compressColdFiles", 1, samples[0]);
+
+    long ops = limitOps(files.count);
+    long long totalNs = 0;
+    for (long i = 0; i < ops; i++) {
+        int index = files.items[randomBelow(files.count)]->inode;
+        TIMED(i, totalNs, fileRead(getInode(index), 0, buffer, INODE_SIZE(index)));
+    }
+    reportBench("compressedRead(random)", ops, totalNs);
+    CompressStats stats = compressGetStats();
+    fprintf(report, "  (파일 %d개 압축, 블록 %d개 -> %d개, 푼 프레임 %lu개, 프레임 캐시 적중 %lu회)\n", compressed,
+            blocksBefore, superblock.usedBlocks, stats.frameMisses, stats.frameHits);
+    free(buffer);
+}
+
+// 1 MiB 파일에 조금씩 덧붙이고 고치는 비용을 내용 전체를 바꾸는 updateFileContent와 비교한다.
+static void benchFileRange(Node* root) {
+    size_t size = 1 << 20;
+    char* content = (char*)malloc(size + 1);
+    fillContent(content, textLength < (long)size ? textLength : (long)size);
+    for (size_t filled = strlen(content); filled < size; filled++) {
+        content[filled] = 'a' + (char)(filled % 26);
+    }
+    content[size] = '\0';
+    Node* file = makeChild(root, "range.bin", FILE_TYPE, content);
+    int fd = fs_open(root, "range.bin", FS_O_READ | FS_O_WRITE);
+    if (file == NULL || fd < 0) {
+        free(content);
+        return;
+    }
+    long ops = limitOps(1000);
+    long long totalNs = 0;
+    for (long i = 0; i < ops; i++) {
+        TIMED(i, totalNs, fs_append(fd, "0123456789abcdef", 16));
+    }
+    reportBench("fs_append(16B)", ops, totalNs);
+
+    ops = limitOps(1000);
+    totalNs = 0;
+    for (long i = 0; i < ops; i++) {
+        long offset = randomBelow((long)size - 64);
+        TIMED(i, totalNs, fs_pwrite(fd, content + offset, 64, offset));
+    }
+    reportBench("fs_pwrite(64B)", ops, totalNs);
+
+    ops = limitOps(20);
+    totalNs = 0;
+    for (long i = 0; i < ops; i++) {
+        content[randomBelow((long)size)] = 'z';
+        TIMED(i, totalNs, updateFileContent(file, content));
+    }
+    reportBench("updateFileContent(1MiB)", ops, totalNs);
+    fs_close(fd);
+    free(content);
+}
+
+static void benchDeleteFiles(void) {
+    long ops = limitOps(files.count);
+    long long totalNs = 0;
+    char name[100];
+    for (long i = 0; i < ops; i++) {
+        long pick = i + randomBelow(files.count - i);
+        Node* file = files.items[pick];
+        files.items[pick] = files.items[i];
+        files.items[i] = file;
+        strcpy(name, file->name);
+        Node* parent = file->parent;
+        TIMED(i, totalNs, deleteNode(parent, name, FILE_TYPE));
+    }
+    reportBench("deleteNode(file)", ops, totalNs);
+}
+
+static long pingPongOps;
+static long pingPongDone;
+static long long yieldStartNs;
+static long long pingPongTotalNs;
+
+// 두 작업이 번갈아 taskYield한다. 돌아온 쪽이 상대가 양보한 시각부터 잰다.
+// 한 번의 전환은 실행 큐에 넣고 다음 작업을 고른 뒤 swapcontext로 넘어가는 데까지다.
+static void pingPongTask(void* arg) {
+    (void)arg;
+    while (1) {
+        if (yieldStartNs != 0 && pingPongDone < pingPongOps) {
+            long long elapsed = nowNanoseconds() - yieldStartNs;
+            if (pingPongDone < config.ops) {
+                samples[pingPongDone] = elapsed;
+            }
+            pingPongTotalNs += elapsed;
+            pingPongDone++;
+        }
+        if (pingPongDone >= pingPongOps) {
+            return;
+        }
+        yieldStartNs = nowNanoseconds();
+        taskYield();
+    }
+}
+
+static void benchContextSwitch(SchedPolicy policy) {
+    Scheduler* scheduler = schedulerCreate(policy);
+    taskCreate(scheduler, "ping", 0, pingPongTask, NULL);
+    taskCreate(scheduler, "pong", 0, pingPongTask, NULL);
+    pingPongOps = config.ops;
+    pingPongDone = 0;
+    yieldStartNs = 0;
+    pingPongTotalNs = 0;
+    schedulerRun(scheduler, (unsigned long long)pingPongOps * 4);
+    char name[32];
+    snprintf(name, sizeof(name), "contextSwitch(%s)", schedPolicyName(policy));
+    reportBench(name, pingPongDone, pingPongTotalNs);
+    schedulerDestroy(scheduler);
+}
+
+// nice가 고르게 섞인 --tasks개 작업을 실행 큐에 두고, 한 틱을 쓴 작업을 되돌리고 다음 작업을 고르는
+// scheduleNext 한 번을 잰다. 작업은 실행하지 않으므로 스택을 잡지 않는다.
+static void benchSchedule(SchedPolicy policy) {
+    Scheduler* scheduler = schedulerCreate(policy);
+    for (long i = 0; i < config.tasks; i++) {
+        taskCreate(scheduler, "bench", MIN_NICE + (int)randomBelow(MAX_NICE - MIN_NICE + 1), NULL, NULL);
+    }
+    Task* prev = NULL;
+    for (long i = 0; i < config.tasks; i++) { // 한 바퀴 돌려 vruntime과 슬라이스를 흩어 놓는다
+        prev = scheduleNext(scheduler, prev);
+    }
+    long ops = config.ops;
+    long long totalNs = 0;
+    for (long i = 0; i < ops; i++) {
+        TIMED(i, totalNs, prev = scheduleNext(scheduler, prev));
+    }
+    char name[32];
+    snprintf(name, sizeof(name), "schedule(%s,%ld)", schedPolicyName(policy), config.tasks);
+    reportBench(name, ops, totalNs);
+    schedulerDestroy(scheduler);
+}
+
+static bool parseContent(const char* spec) {
+    config.contentSpec = spec;
+    if (sscanf(spec, "fixed:%ld", &config.contentA) == 1) {
+        config.contentKind = CONTENT_FIXED;
+        config.contentB = config.contentA;
+    } else if (sscanf(spec, "uniform:%ld:%ld", &config.contentA, &config.contentB) == 2 &&
+               config.contentB >= config.contentA) {
+        config.contentKind = CONTENT_UNIFORM;
+    } else if (sscanf(spec, "exp:%ld", &config.contentA) == 1) {
+        config.contentKind = CONTENT_EXP;
+    } else {
+        return false;
+    }
+    return config.contentA >= 0;
+}
+
+static void usage(void) {
+    fprintf(stderr, "사용법: fsbench [--nodes N] [--shape wide|deep|balanced] "
+                    "[--content fixed:N|uniform:A:B|exp:MEAN] [--ops N] [--seed N] [--threads N] [--tasks N] "
+                    "[--out 파일]\n");
+    exit(2);
+}
+
+int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (value == NULL) {
+            usage();
+        }
+        if (strcmp(argv[i], "--nodes") == 0) {
+            config.nodes = atol(value);
+        } else if (strcmp(argv[i], "--shape") == 0) {
+            config.shapeName = value;
+            if (strcmp(value, "wide") == 0) {
+                config.shape = SHAPE_WIDE;
+            } else if (strcmp(value, "deep") == 0) {
+                config.shape = SHAPE_DEEP;
+            } else if (strcmp(value, "balanced") == 0) {
+                config.shape = SHAPE_BALANCED;
+            } else {
+                usage();
+            }
+        } else if (strcmp(argv[i], "--content") == 0) {
+            if (!parseContent(value)) {
+                usage();
+            }
+        } else if (strcmp(argv[i], "--ops") == 0) {
+            config.ops = atol(value);
+        } else if (strcmp(argv[i], "--seed") == 0) {
+            config.seed = strtoull(value, NULL, 10);
+        } else if (strcmp(argv[i], "--threads") == 0) {
+            config.threads = atoi(value);
+        } else if (strcmp(argv[i], "--tasks") == 0) {
+            config.tasks = atol(value);
+        } else if (strcmp(argv[i], "--out") == 0) {
+            config.outPath = value;
+        } else {
+            usage();
+        }
+        i++;
+    }
+    if (config.nodes < 2 || config.ops < 1 || config.threads < 1 || config.tasks < 1) {
+        usage();
+    }
+    rngState = config.seed * 0x9E3779B97F4A7C15ULL + 1;
+
+    // 벤치마크 대상 함수가 찍는 출력은 버린다
+    report = fdopen(dup(fileno(stdout)), "w");
+    freopen("/dev/null", "w", stdout);
+    quietMode = true;
+
+    bool newFile = access(config.outPath, F_OK) != 0;
+    results = fopen(config.outPath, "a");
+    if (results == NULL) {
+        fprintf(stderr, "결과 파일 '%s'을(를) 열 수 없습니다.\n", config.outPath);
+        return 1;
+    }
+    if (newFile) {
+        fprintf(results, "timestamp,shape,nodes,content,seed,bench,ops,ops_per_sec,p50_ns,p99_ns,peak_rss_kb\n");
+    }
+
+    samples = (long long*)malloc(config.ops * sizeof(long long));
+    buildText();
+    initFileSystem();
+    Node* root = createNode("root", DIR_TYPE, NULL);
+
+    fprintf(report, "shape=%s nodes=%ld content=%s ops=%ld seed=%llu\n", config.shapeName, config.nodes,
+            config.contentSpec, config.ops, config.seed);
+    fprintf(report, "%-22s %10s %14s %12s %12s %12s\n", "bench", "ops", "ops/sec", "p50(ns)", "p99(ns)", "peakRSS(KB)");
+    buildTree(root);
+    benchHasChild();
+    benchResolvePath(root);
+    benchParallelResolve(root);
+    benchFindNode(root);
+    benchSearch(root);
+    benchFindFiles(root);
+    benchDirectorySize(root);
+    benchTreeScan(root);
+    benchCopyDelete(root);
+    benchCachedRead();
+    benchCompressedRead();
+    benchFileRange(root);
+    benchDeleteFiles();
+    benchContextSwitch(SCHED_O1);
+    benchContextSwitch(SCHED_CFS);
+    benchSchedule(SCHED_O1);
+    benchSchedule(SCHED_CFS);
+
+    destroyFileSystem(root);
+    fclose(results);
+    fprintf(report, "결과를 %s에 덧붙였습니다.\n", config.outPath);
+    fclose(report);
+    free(samples);
+    free(text);
+    free(dirs.items);
+    free(files.items);
+    return 0;
+}
@@ -0,0 +1,51 @@
+#ifndef BCACHE_H
+#define BCACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "block.h"
+
+// 블록 내용을 데이터 파일에 두고 정해진 메모리 안에서 페이지 단위로 캐시하는 버퍼 캐시.
+// 블록 저장소(block.c)가 이미지와 함께 쓸 때 이 캐시를 거친다. 데이터 파일에서 블록 b는 b * BLOCK_SIZE에 있다.
+//
+// 교체는 CLOCK을 LRU-2처럼 쓴다: 페이지마다 참조 카운터(최대 2)를 두고 시곗바늘이 지나가며 하나씩 줄여
+// 0인 페이지를 내보낸다. 한 번만 쓰인 페이지와 미리 읽고 아직 안 쓴 페이지(0에서 시작)가 먼저 나가므로
+// 큰 파일을 한 번 훑어도 자주 쓰는 페이지가 밀려나지 않는다.
+// 더러운 페이지를 내보낼 때는 바늘 앞쪽의 더러운 페이지들을 함께 모아 번호순으로 pwritev한다.
+// 앞 페이지에 이어 빠진 페이지를 읽으면 순차 읽기로 보고 미리 읽는 창을 두 배씩 (최대 CACHE_MAX_READAHEAD) 늘린다.
+//
+// 페이지를 쓰는 동안에는 고정(pin)해 두며, 고정된 페이지는 내보내지 않는다.
+// 캐시 잠금 하나가 표와 시곗바늘을 보호한다. 읽기는 잠금 밖에서 하고, 쓰기(writeback)는 잠금 안에서 한다.
+
+#define CACHE_PAGE_SHIFT 5
+#define CACHE_PAGE_BLOCKS (1 << CACHE_PAGE_SHIFT) // 페이지당 블록 수
+#define CACHE_PAGE_BYTES ((size_t)CACHE_PAGE_BLOCKS * BLOCK_SIZE) // 16 KiB
+#define CACHE_DEFAULT_MB 64
+#define CACHE_MIN_PAGES 64
+#define CACHE_MAX_READAHEAD 32 // 페이지
+#define CACHE_WRITEBACK_BATCH 64 // 한 번에 내려보내는 더러운 페이지 수
+
+typedef struct CacheStats {
+    unsigned long hits;
+    unsigned long misses; // 데이터 파일에서 읽어 온 페이지 (미리 읽기 제외)
+    unsigned long readahead; // 미리 읽어 온 페이지
+    unsigned long evictions;
+    unsigned long writebacks; // 데이터 파일에 쓴 페이지
+    unsigned long writeCalls; // pwritev 호출 수
+    size_t pages; // 캐시 크기 (페이지)
+    size_t dirty; // 지금 더러운 페이지
+} CacheStats;
+
+size_t cacheBudget(void); // MINIOS_CACHE_MB (MB), 없으면 CACHE_DEFAULT_MB. 0이면 캐시를 쓰지 않는다
+bool cacheOpen(const char* path, size_t budgetBytes, bool truncate);
+void cacheClose(void); // 더러운 페이지를 버린다. 보존하려면 먼저 cacheFlush
+bool cacheIsOpen(void);
+// 페이지를 고정하고 내용을 돌려준다. 빈 페이지가 없으면 wait일 때는 기다리고, 아니면 NULL.
+char* cachePin(long page, bool wait, int* pin);
+void cacheUnpin(int pin, bool dirty);
+bool cacheFlush(void); // 더러운 페이지를 모두 쓰고 fdatasync
+// 더러운 페이지를 데이터 파일에 쓰기 직전에 부른다 (저널을 먼저 내려보내게 한다)
+void cacheSetWritebackHook(void (*hook)(void));
+CacheStats cacheGetStats(void);
+
+#endif
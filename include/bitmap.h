@@ -0,0 +1,27 @@
+#ifndef BITMAP_H
+#define BITMAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// 64비트 워드 단위로 묶은 할당 비트맵. 비트가 1이면 사용 중이다.
+// 빈 비트 탐색은 마지막으로 할당한 워드(hint)부터 돌아가며 찾는다 (next-fit).
+
+typedef struct Bitmap {
+    unsigned long long* words;
+    size_t bitCount; // 유효한 비트 수
+    size_t wordCount; // bitCount를 담는 워드 수
+    size_t setCount; // 1인 비트 수
+    size_t hint; // 다음 탐색을 시작할 워드 위치
+} Bitmap;
+
+void bitmapInit(Bitmap* bitmap, size_t bitCount);
+void bitmapDestroy(Bitmap* bitmap);
+void bitmapGrow(Bitmap* bitmap, size_t bitCount); // 기존 비트는 그대로 두고 늘린다
+void bitmapClearAll(Bitmap* bitmap);
+long bitmapAllocate(Bitmap* bitmap); // 빈 비트 하나를 찾아 1로 만든다. 없으면 -1
+void bitmapSet(Bitmap* bitmap, size_t bit);
+void bitmapClear(Bitmap* bitmap, size_t bit);
+bool bitmapTest(const Bitmap* bitmap, size_t bit);
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef BLOCK_H
+#define BLOCK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// 파일 내용을 담는 고정 크기 블록 저장소. 블록은 청크 단위로 늘어나며,
+// 기존 청크는 옮기지 않으므로 블록 번호가 계속 유효하다.
+// 처음에는 내용을 메모리 청크에 두고, 이미지와 함께 쓰면 데이터 파일로 옮겨 버퍼 캐시(bcache.h)를 거친다.
+// 블록 내용은 file* 함수(fs.h)로만 읽고 쓴다.
+
+#define BLOCK_SIZE 512
+#define BLOCK_CHUNK_SHIFT 10
+#define BLOCK_CHUNK_SIZE (1 << BLOCK_CHUNK_SHIFT) // 청크당 블록 수
+#define BLOCK_CHUNK_BYTES ((size_t)BLOCK_CHUNK_SIZE * BLOCK_SIZE)
+#define MAX_BLOCK_CHUNKS 65536
+
+// 연속된 블록 구간 [start, start + count)
+typedef struct Extent {
+    int start;
+    int count;
+} Extent;
+
+typedef struct ExtentList {
+    Extent* extents;
+    int count;
+    int capacity;
+} ExtentList;
+
+void initBlockStore(void);
+int allocateBlock(void); // 블록 번호 (참조 수 1), 실패하면 -1
+void retainBlock(int block); // 참조 수를 늘린다
+void freeBlock(int block); // 참조 수를 줄이고 0이 되면 반납한다
+unsigned int blockRefCount(int block);
+
+bool blockStoreAttach(const char* path, size_t cacheBytes); // 내용을 데이터 파일로 옮기고 캐시를 거친다
+bool blockStoreBacked(void); // 데이터 파일을 쓰고 있으면 true
+bool blockStoreSync(void); // 캐시의 더러운 페이지를 데이터 파일에 내려보낸다
+
+// 이미지 저장/불러오기용
+struct Bitmap;
+int blockStoreChunkCount(void);
+const char* blockStoreChunk(int chunk); // 메모리에 있을 때만
+const unsigned int* blockStoreRefCounts(void);
+const struct Bitmap* blockStoreBitmap(void);
+void blockStoreAdopt(void* mapping, size_t mappingLength, char* data, int chunkCount,
+                     unsigned int* refCounts, const unsigned long long* bitmapWords, int usedBlocks);
+
+#endif
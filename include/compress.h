@@ -0,0 +1,41 @@
+#ifndef COMPRESS_H
+#define COMPRESS_H
+
+#include "fs.h"
+
+// 한동안 읽거나 쓰지 않은 파일의 내용을 LZ4(lz4.h)로 압축해 블록 저장소에 둔다.
+// 내용은 COMPRESS_FRAME 바이트씩 따로 압축한 프레임으로 나누고, 블록에는 [프레임별 크기 표][프레임...]을 쓴다.
+// inode의 storedSize가 블록에 든 길이다. 크기 표 항목에 COMPRESS_RAW_FRAME이 켜져 있으면 압축되지 않아 그대로 둔 프레임이다.
+//
+// 읽을 때는 필요한 프레임만 풀고, 푼 프레임은 작은 캐시(COMPRESS_CACHE_FRAMES개)에 두어 같은 파일을 이어 읽을 때
+// 다시 풀지 않는다. 캐시 키는 압축 내용의 첫 블록 번호와 프레임 번호다. 블록은 쓰인 뒤 바뀌지 않으므로
+// 파일이 압축된 블록을 반납할 때(fileRelease) 그 첫 블록의 프레임만 지우면 된다.
+//
+// 압축은 단독으로 들어온 상태에서 한다. 저널에 남지 않고 원래 블록을 반납하므로, 이미지를 쓰는 세션에서는
+// 압축한 뒤 곧바로 체크포인트한다 (6dir.c). 블록을 공유하는 파일은 압축하면 두 벌이 되므로 건너뛴다.
+
+#define COMPRESS_FRAME (64 * 1024)
+#define COMPRESS_RAW_FRAME 0x80000000u
+#define COMPRESS_CACHE_FRAMES 32 // 2 MiB
+#define COMPRESS_MIN_SIZE (2 * BLOCK_SIZE) // 이보다 작은 파일은 블록을 하나도 아끼지 못한다
+
+typedef struct CompressStats {
+    unsigned long sweeps; // 압축할 파일을 찾아본 횟수
+    unsigned long files; // 압축한 파일 (누적)
+    unsigned long long rawBytes; // 압축한 파일들의 원래 크기 (누적)
+    unsigned long long storedBytes; // 압축한 뒤 크기 (누적)
+    unsigned long frameHits; // 캐시에서 찾은 프레임
+    unsigned long frameMisses; // 새로 푼 프레임
+    unsigned long corrupt; // 풀지 못한 프레임
+} CompressStats;
+
+long compressAfter(void); // MINIOS_COMPRESS_AFTER (초). 없거나 잘못된 값이면 -1 (자동으로 압축하지 않는다)
+// 마지막으로 읽거나 쓴 지 after초가 지난 파일을 압축하고 압축한 파일 수를 돌려준다. 단독으로 들어와서 부른다.
+int compressColdFiles(long after);
+// 압축된 파일의 [offset, offset + length)를 풀어 buffer에 담는다. 범위는 fileRead가 잘라 넘긴다.
+size_t compressedRead(const Inode* inode, size_t offset, char* buffer, size_t length);
+void compressForget(int headBlock); // 압축 내용의 블록을 반납하기 전에 부른다
+void compressReset(void); // 블록 저장소를 비울 때 캐시를 비운다
+CompressStats compressGetStats(void);
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef DCACHE_H
+#define DCACHE_H
+
+// (부모 디렉터리, 이름, 타입) -> Node* 를 기억하는 크기 제한 LRU 덴트리 캐시.
+// 부모는 포인터 대신 노드 일련번호로 식별하므로, 해제된 노드의 메모리가
+// 재사용되어도 예전 항목이 잘못 맞는 일이 없다.
+// 여러 스레드에서 불러도 된다. 항목은 16개 조각으로 나뉘고 조각마다 잠금이 따로 있다.
+
+#define DCACHE_CAPACITY 4096 // 캐시 항목 최대 개수
+#define DCACHE_NAME_MAX 100
+
+struct Node;
+
+typedef enum {
+    DCACHE_MISS, // 캐시에 없음
+    DCACHE_HIT, // 존재하는 노드를 찾음
+    DCACHE_NEGATIVE // 존재하지 않는다는 것이 캐시되어 있음
+} DcacheResult;
+
+typedef struct DcacheStats {
+    unsigned long hits;
+    unsigned long negativeHits;
+    unsigned long misses;
+    unsigned long evictions;
+} DcacheStats;
+
+void dcacheInit(void);
+DcacheResult dcacheLookup(unsigned long parentSerial, const char* name, int type, struct Node** result);
+// node가 NULL이면 음성 항목. generation이 있으면 *generation이 찾기 전에 읽어 둔 observed와
+// 같을 때만 넣는다 (그 사이 디렉터리가 바뀌었으면 결과가 낡았을 수 있으므로).
+void dcacheInsert(unsigned long parentSerial, const char* name, int type, struct Node* node,
+                  const unsigned int* generation, unsigned int observed);
+void dcacheInvalidate(unsigned long parentSerial, const char* name, int type);
+void dcacheClear(void);
+DcacheStats dcacheGetStats(void);
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef DEDUP_H
+#define DEDUP_H
+
+#include <stdbool.h>
+#include "block.h"
+
+// 내용 주소 중복 제거 표. 파일 내용 전체의 xxHash64와 길이를 키로, 그 내용을 담은 블록 구간 목록(blob)을 찾는다.
+// 내용이 같은 파일은 blob의 블록을 함께 쓰고 (참조 수), 블록은 한 번 쓴 뒤 바뀌지 않으므로 (새 내용은 늘 새 블록)
+// blob은 첫 블록이 반납될 때까지 유효하다. 블록 저장소가 첫 블록을 반납하면서 dedupForgetLocked로 지운다.
+// 해시가 같아도 내용은 블록 저장소가 비교해 확인한다.
+//
+// 표는 블록 저장소의 잠금(block.c) 안에서만 쓴다. 이미지 저장/불러오기는 다른 스레드가 없을 때 부른다.
+
+typedef struct DedupStats {
+    unsigned long lookups; // 내용을 쓸 때 표를 찾아본 횟수
+    unsigned long hits; // 같은 내용을 찾아 블록을 함께 쓴 횟수
+    unsigned long mismatches; // 해시는 같았지만 내용이 달랐던 횟수
+    unsigned long long sharedBytes; // 함께 써서 새로 쓰지 않은 바이트 (누적)
+    long blobs; // 표에 있는 blob 수
+    size_t tableBytes; // 표가 쓰는 메모리
+} DedupStats;
+
+typedef void (*DedupVisitFn)(unsigned long long hash, long length, const ExtentList* extents, void* context);
+
+int dedupFindLocked(unsigned long long hash, long length); // blob 번호, 없으면 -1
+const ExtentList* dedupExtentsLocked(int blob);
+void dedupInsertLocked(unsigned long long hash, long length, const ExtentList* extents); // 같은 키가 있으면 그대로 둔다
+void dedupForgetLocked(int block); // block을 첫 블록으로 하는 blob이 있으면 지운다
+void dedupRecord(bool hit, bool mismatch, long length);
+void dedupForEach(DedupVisitFn visit, void* context);
+void dedupReset(void);
+DedupStats dedupGetStats(void);
+
+#endif
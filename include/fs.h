@@ -0,0 +1,191 @@
+#ifndef FS_H
+#define FS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <time.h>
+#include "bitmap.h"
+#include "block.h"
+#include "rwlock.h"
+
+#define INODE_CHUNK_SHIFT 10
+#define INODE_CHUNK_SIZE (1 << INODE_CHUNK_SHIFT) // inode 테이블은 1024개 단위로 늘어난다
+#define MAX_INODE_CHUNKS 65536 // 최대 64M개의 inode
+
+// 트리를 훑는 명령(dirsize, find, 집계 검사)이 읽는 필드는 열(column)마다 inode 번호로 인덱싱한 배열에 따로 둔다.
+// 크기만 더하는 훑기는 크기 배열만 읽으므로, 블록 구간 같은 나머지 필드가 캐시를 차지하지 않는다.
+// 한 열은 INODE_MODIFIED(index)처럼 이름으로 읽고 쓴다 (대입할 수 있는 식이다).
+typedef struct InodeColumns {
+    long size[INODE_CHUNK_SIZE]; // 파일 크기
+    time_t created[INODE_CHUNK_SIZE]; // 파일 생성 시간
+    time_t modified[INODE_CHUNK_SIZE]; // 파일 수정 시간
+    int links[INODE_CHUNK_SIZE]; // 링크 수
+    int parent[INODE_CHUNK_SIZE]; // 부모 디렉터리의 inode 번호 (노드의 parent와 같다), 루트면 -1
+    unsigned char type[INODE_CHUNK_SIZE]; // 노드 타입 (NodeType)
+} InodeColumns;
+
+// 훑기에서 읽지 않는 나머지 inode 정보
+typedef struct Inode {
+    int number; // inode 번호 (열 배열의 인덱스)
+    time_t accessed; // 내용을 마지막으로 읽거나 쓴 시간 (압축할 파일을 고를 때 쓴다, 이미지에는 저장하지 않는다)
+    long storedSize; // 압축해 두었으면 블록에 든 바이트 수 (compress.h), 아니면 0
+    ExtentList extents; // 파일 내용이 들어 있는 블록 구간들
+    struct Node* node; // 이 inode를 쓰는 노드 (색인 검색 결과를 노드로 되돌릴 때 사용)
+    // 여기에 더 많은 inode 관련 정보를 추가할 수 있습니다.
+} Inode;
+
+// inode는 고정 크기 청크에 나눠 담는다. 테이블이 커져도 기존 청크는 옮기지 않으므로
+// 이미 나눠준 inode 번호와 Inode 포인터가 그대로 유효하다. 열 배열도 같은 청크 단위로 늘어난다.
+typedef struct InodeTable {
+    Inode* chunks[MAX_INODE_CHUNKS];
+    InodeColumns* columns[MAX_INODE_CHUNKS];
+    int chunkCount;
+    Bitmap allocated; // 할당 여부 비트맵
+} InodeTable;
+extern InodeTable inodeTable;
+
+#define INODE_COLUMN(column, index) (inodeTable.columns[(index) >> INODE_CHUNK_SHIFT]->column[(index) & (INODE_CHUNK_SIZE - 1)])
+#define INODE_SIZE(index) INODE_COLUMN(size, index)
+#define INODE_CREATED(index) INODE_COLUMN(created, index)
+#define INODE_MODIFIED(index) INODE_COLUMN(modified, index)
+#define INODE_LINKS(index) INODE_COLUMN(links, index)
+#define INODE_PARENT(index) INODE_COLUMN(parent, index)
+#define INODE_TYPE(index) INODE_COLUMN(type, index)
+
+typedef struct Superblock {
+    int totalInodes;
+    int usedInodes;
+    int totalBlocks;
+    int usedBlocks;
+    long fileSystemSize;
+} Superblock;
+extern Superblock superblock;
+
+// 생성/삭제/할당 같은 작업별 안내 메시지. 결과 출력과 오류 메시지는 quietMode와 상관없이 나온다.
+extern bool quietMode;
+#define FS_NOTICE(...) do { if (!quietMode) printf(__VA_ARGS__); } while (0)
+
+struct Node;
+
+typedef struct ChildSlot {
+    unsigned int hash; // 이름+타입 해시 (재해시/이동 시 재계산을 피하기 위해 보관)
+    struct Node* node; // NULL이면 빈 슬롯
+} ChildSlot;
+
+typedef struct ChildIndex {
+    ChildSlot* slots; // 오픈 어드레싱(선형 탐사) 해시 테이블
+    int capacity; // 슬롯 수 (2의 거듭제곱, 0이면 아직 할당 전)
+    int count; // 사용 중인 슬롯 수
+} ChildIndex;
+
+#define NODE_NAME_SIZE 100 // 이름 길이 제한 (NUL 포함)
+
+// 디렉터리에만 있는 상태. 디렉터리 노드를 만들 때 따로 잡아 노드가 가리킨다 (파일 노드는 이 크기를 물지 않는다).
+typedef struct Directory {
+    DirLock lock; // 자식 목록, 인덱스, 자식 파일 내용을 보호한다
+    struct Node* firstChild; // 자식 노드 연결 리스트 (생성 순서 유지)
+    struct Node* lastChild;
+    ChildIndex index; // 이름+타입으로 자식 노드를 찾는 인덱스
+    int childCount; // 현재 자식 노드의 수
+    long subtreeBytes; // 하위 트리 전체 파일 크기 합 (생성/수정/삭제/복사 때 원자적으로 갱신)
+    long subtreeFiles; // 하위 트리 전체 파일 수
+} Directory;
+
+typedef enum { DIR_TYPE, FILE_TYPE } NodeType;
+
+// 노드는 트리 연결과 이름만 가진다. 크기와 시간은 inode에, 파일 내용은 inode의 블록 구간(extents)에 있다.
+// 이름은 이름 표(strpool.h)에 한 번씩만 담겨 같은 이름의 노드끼리 함께 쓴다.
+typedef struct Node {
+    NodeType type; // 노드 타입 (디렉터리 또는 파일)
+    int inode; // inode 번호
+    const char* name; // 이름 표에 든 이름 (길이는 stringPoolLength)
+    Directory* dir; // 디렉터리 상태, 파일이면 NULL
+    struct Node* parent; // 부모 노드 포인터
+    struct Node* prevSibling; // 같은 디렉터리 안의 이전/다음 노드
+    struct Node* nextSibling;
+    unsigned long serial; // 노드마다 유일한 일련번호 (덴트리 캐시 키로 사용, 재사용하지 않음)
+} Node;
+
+// 여러 스레드에서 쓰기
+//  - 트리를 쓰는 스레드는 fsEnterShared/fsExitShared 사이에서 경로를 찾고 명령을 실행한다. 노드 포인터는
+//    그 안에서만 유효하다. 노드를 해제하는 deleteNode, 디렉터리 copyNode, 이미지 저장과 전체 검사는
+//    fsEnterExclusive 안에서 부른다 (다른 스레드가 모두 나갈 때까지 기다린다).
+//  - 디렉터리 잠금은 자식 목록과 인덱스, 그리고 그 디렉터리에 든 파일의 내용을 보호한다.
+//    이름 하나를 찾을 때는 잠그지 않는다 (seqlock). 트리를 훑을 때는 디렉터리마다 읽기 잠금을 잡고 내려간다.
+//  - 잠금 순서: 전역 진입(fsEnter*) -> 디렉터리 잠금 -> 내부 잠금(inode, 블록, 3-gram 색인, 덴트리 캐시, slab, 저널).
+//    디렉터리 잠금을 둘 이상 잡을 때는 노드 일련번호가 작은 쪽부터 잡는다 (조상이 자손보다 먼저다).
+//    복사처럼 두 디렉터리를 함께 쓰면 원본은 읽기, 대상은 쓰기 잠금을 이 순서로 잡는다.
+//    내부 잠금을 쥔 채로 디렉터리 잠금을 잡지 않고, 같은 잠금을 두 번 잡지 않는다.
+//  - 디렉터리 크기 집계는 조상마다 원자적으로 더하므로 잠그지 않는다.
+//  - 트리 전체를 훑는 printTree, searchfile, calculateDirectorySize는 트리를 조각으로 나눠 작업 스레드(workpool.h)에서도
+//    훑는다 (walk.h). 작업 스레드는 따로 진입하지 않고 부른 스레드의 진입 안에서 디렉터리 읽기 잠금만 잡는다.
+void fsEnterShared();
+void fsExitShared();
+void fsEnterExclusive();
+void fsExitExclusive();
+
+// inode 테이블. 스레드마다 inode 번호를 몇 개씩 미리 받아 두고 쓴다.
+void initInodeTable();
+int allocateInode();
+void freeInode(int inodeIndex);
+Inode* getInode(int index);
+void releaseThreadInodes(); // 작업 스레드가 끝나기 전에 받아 두고 쓰지 않은 번호를 돌려준다
+
+// 파일 데이터 (kernel/block.c)
+bool fileWrite(Inode* inode, const char* data, size_t length); // 내용 전체를 바꾼다
+bool fileWriteAt(Inode* inode, size_t offset, const char* data, size_t length); // 닿는 블록만 고친다
+bool fileTruncate(Inode* inode, size_t size);
+bool fileReadFd(Inode* inode, int fd, size_t length); // 호스트 파일의 내용을 블록에 바로 읽어 들인다
+bool fileWriteFd(const Inode* inode, int fd); // 내용을 블록에서 바로 호스트 파일에 쓴다
+size_t fileRead(const Inode* inode, size_t offset, char* buffer, size_t length);
+void fileRelease(Inode* inode); // 파일의 모든 블록을 반납한다
+void fileShare(Inode* dst, const Inode* src); // 블록을 공유하는 사본 (copy-on-write)
+size_t fileReadStored(const Inode* inode, size_t offset, char* buffer, size_t length); // 블록에 든 그대로 읽는다
+bool fileStoreCompressed(Inode* inode, const char* stream, size_t length); // 블록을 압축한 내용으로 바꾼다
+
+// 트리
+Node* createNode(const char* name, NodeType type, Node* parent);
+Node* makeChild(Node* parent, const char* name, NodeType type, const char* content); // 같은 이름이 있으면 NULL
+bool adoptChild(Node* parent, Node* child); // createNode로 만들어 채운 노드를 붙인다. 같은 이름이 있으면 false
+void addChild(Node* parent, Node* child);
+void removeChild(Node* parent, Node* child);
+Node* findChild(Node* parent, const char* name, NodeType type);
+Node* lookupChild(Node* parent, const char* name, NodeType type);
+Node* resolvePath(Node* root, const char* path, NodeType type);
+Node* findNode(Node* node, const char* name, NodeType type);
+void printTree(Node* node, int level);
+void freeTree(Node* node);
+// 이미지 불러오기용: 주어진 inode 번호를 그대로 쓴다 (내용은 호출자가 채운다). 이미 쓰이는 번호면 NULL
+Node* restoreNode(const char* name, NodeType type, int inodeIndex);
+void attachRestoredChild(Node* parent, Node* child);
+void recomputeAggregates(Node* node);
+void markContentIndexStale();
+void markMetaIndexStale(); // 다음 find 때 메타데이터 색인을 다시 만든다
+void initFileSystem();
+void destroyFileSystem(Node* root);
+void printMemoryStats();
+void printDedupStats(); // 블록 공유(중복 제거) 비율과 아낀 메모리
+
+// 명령
+void updateFileContent(Node* fileNode, const char* newContent);
+char* loadFileContent(Node* fileNode); // NUL로 끝나는 사본 (호출자가 free)
+size_t readFileRange(Node* fileNode, size_t offset, char* buffer, size_t length);
+long writeFileRange(Node* fileNode, long offset, const char* data, size_t length, bool append); // 끝난 위치, 실패하면 -1
+bool truncateFile(Node* fileNode, size_t size);
+void readfile(Node* node, const char* name);
+void updatefile(Node* parent, const char* name, const char* newContent);
+void searchfile(Node* node, const char* keyword);
+void findFiles(Node* top, const char* conditions); // 크기/시간/이름 조건으로 찾는다 (metaindex.h)
+int hasChildWithName(Node* parent, const char* name, int type);
+void renameNode(Node* parent, const char* oldName, const char* newName, NodeType type);
+void deleteNode(Node* parent, const char* name, NodeType type);
+void deepCopyNode(Node* original, Node* copy);
+void copyNode(Node* parent, const char* name, const char* newName, NodeType targetType, Node* targetParent);
+void calculateDirectorySize(Node* node, long* totalSize);
+void printDirectorySize(Node* node);
+int checkDirectoryAggregates(Node* node);
+void dir_main();
+int dir_batch(FILE* input, bool quiet);
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include "fs.h"
+
+// 파일 시스템 전체를 하나의 이미지 파일로 저장하고, 다음 실행 때 mmap으로 불러온다.
+// 이미지 안의 위치는 모두 파일 시작으로부터의 오프셋이라 어느 주소에 매핑되어도 그대로 쓸 수 있다.
+//
+// 배치: [헤더 4096 bytes][블록 데이터 (청크 순서)][참조 수][할당 비트맵][노드 레코드][구간][이름][blob][압축된 파일]
+// 블록 데이터는 페이지 경계에서 시작하므로 실제로 읽는 블록의 페이지만 그때 읽혀 온다.
+// 블록 저장소가 데이터 파일을 쓰고 있으면 (dataExternal) 블록 데이터 구간은 비어 있고, 내용은 이미지 옆
+// <이미지>.blocks 파일에 제자리에서 쓰인다. 마지막 체크포인트 뒤에 반납된 블록만 다시 쓰이고
+// 그 블록을 쓰는 명령은 저널에 먼저 남으므로 (cacheSetWritebackHook), 이전 이미지와 저널로 되살릴 수 있다.
+
+#define IMAGE_MAGIC "MINIOSIM"
+#define IMAGE_VERSION 2 // 2: 헤더에 inodeCount 추가. 다른 버전의 이미지는 불러오지 않는다
+#define IMAGE_HEADER_SIZE 4096
+#define IMAGE_DATA_SUFFIX ".blocks"
+
+// 노드 레코드는 전위 순회 순서로 저장되므로 부모 레코드가 항상 자식보다 앞에 있다.
+typedef struct ImageNode {
+    int inode;
+    int parent; // 부모 레코드 번호, 루트는 -1
+    int type;
+    int linkCount;
+    unsigned int nameOffset; // 이름 영역 안의 오프셋 (NUL로 끝난다)
+    unsigned int extentCount;
+    unsigned long long extentStart; // 구간 영역 안의 첫 구간 번호
+    long long fileSize;
+    long long created;
+    long long modified;
+} ImageNode;
+
+// 중복 제거 표(dedup.h)의 blob. 구간은 노드의 구간 뒤에 이어서 저장한다.
+typedef struct ImageBlob {
+    unsigned long long hash;
+    long long length;
+    unsigned long long extentStart;
+    unsigned long long extentCount;
+} ImageBlob;
+
+// 압축해 둔 파일(compress.h)의 블록에 든 길이. 이 목록에 없는 파일은 압축되지 않은 것이다.
+typedef struct ImageCompressed {
+    unsigned long long record; // 노드 레코드 번호
+    long long storedSize;
+} ImageCompressed;
+
+typedef struct ImageHeader {
+    char magic[8];
+    unsigned int version;
+    unsigned int blockSize;
+    unsigned int blockChunkSize;
+    int chunkCount;
+    int usedBlocks;
+    int nodeCount;
+    unsigned long long dataOffset;
+    unsigned long long refCountsOffset;
+    unsigned long long bitmapOffset;
+    unsigned long long bitmapWords;
+    unsigned long long nodesOffset;
+    unsigned long long extentsOffset;
+    unsigned long long extentCount;
+    unsigned long long namesOffset;
+    unsigned long long namesLength;
+    long long savedAt;
+    unsigned long long journalSequence; // 이 이미지에 이미 반영된 마지막 저널 레코드 번호
+    unsigned int dataExternal; // 1이면 블록 데이터가 <이미지>.blocks에 있다 (이전 이미지는 0)
+    unsigned long long blobsOffset;
+    unsigned long long blobCount; // 이전 이미지는 0 (표는 다시 쓰는 내용부터 채워진다)
+    unsigned long long compressedOffset;
+    unsigned long long compressedCount; // 이전 이미지는 0
+    int inodeCount; // 저장할 때의 inode 테이블 크기. 노드 레코드의 inode 번호는 이보다 작다
+} ImageHeader;
+
+const char* imagePath(void); // MINIOS_IMAGE 환경 변수. 없거나 빈 문자열이면 NULL (메모리 전용)
+bool saveImage(Node* root, const char* path, unsigned long long journalSequence);
+// 이미지가 없거나 맞지 않으면 NULL (파일 시스템은 빈 상태로 남고 journalSequence는 0)
+Node* loadImage(const char* path, unsigned long long* journalSequence);
+// 블록 내용을 <이미지>.blocks로 옮기고 MINIOS_CACHE_MB 크기의 버퍼 캐시를 거치게 한다
+bool imageAttachData(const char* path);
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stdbool.h>
+#include <time.h>
+
+// 변경 명령을 먼저 로그 파일에 적는 write-ahead 저널.
+// 레코드는 메모리 버퍼에 모였다가 flush 스레드가 한 번의 write + fdatasync로 내려보낸다 (group commit).
+// 버퍼가 MINIOS_JOURNAL_BYTES를 넘거나 가장 오래된 레코드가 MINIOS_JOURNAL_DELAY_MS만큼 기다렸으면 내려보낸다.
+// 변경 명령은 journalEndWrite에서 자기 레코드가 디스크에 내려갈 때까지 기다린 뒤에 끝난다. 진행 중인 변경 명령이
+// 모두 기다리는 중이면 더 모일 레코드가 없으므로 지연 창을 채우지 않고 바로 내려보낸다.
+// 지연을 0으로 두면 레코드마다 바로 내려보낸다. MINIOS_JOURNAL_ASYNC=1이면 기다리지 않는다
+// (명령은 바로 끝나지만 마지막 지연 창 안의 변경은 비정상 종료 때 잃을 수 있다).
+//
+// 레코드: [magic][op][sequence][명령 시각][payload 길이][checksum] + 인자마다 [길이][바이트]
+// 다시 적용할 때는 레코드의 명령 시각을 생성/수정 시간으로 쓴다.
+// 레코드 번호는 이미지 체크포인트를 넘어 계속 증가하며, 이미지에는 반영된 마지막 번호가 기록된다.
+
+#define JOURNAL_MAX_ARGS 5
+#define JOURNAL_DEFAULT_BYTES (64 * 1024)
+#define JOURNAL_DEFAULT_DELAY_MS 10
+
+typedef enum {
+    JOURNAL_MAKEDIR = 1, // 부모 경로, 이름
+    JOURNAL_MAKEFILE, // 부모 경로, 이름, 내용
+    JOURNAL_UPDATEFILE, // 부모 경로, 이름, 내용
+    JOURNAL_RENAME, // 부모 경로, 이전 이름, 새 이름, 타입
+    JOURNAL_DELETE, // 부모 경로, 이름, 타입
+    JOURNAL_COPY, // 부모 경로, 이름, 타입, 대상 경로, 새 이름
+    JOURNAL_APPENDFILE, // 부모 경로, 이름, 덧붙일 내용
+    JOURNAL_WRITEFILE, // 부모 경로, 이름, 위치, 내용
+    JOURNAL_TRUNCATEFILE // 부모 경로, 이름, 크기
+} JournalOp;
+
+typedef struct JournalRecord {
+    JournalOp op;
+    unsigned long long sequence;
+    time_t time; // 명령을 실행한 시각
+    int argCount;
+    const char* args[JOURNAL_MAX_ARGS];
+} JournalRecord;
+
+typedef struct JournalStats {
+    unsigned long records; // 추가된 레코드 수
+    unsigned long flushes; // fdatasync 횟수
+    unsigned long bytes; // 내려보낸 바이트 수
+    unsigned long replayed; // 시작할 때 다시 적용한 레코드 수
+} JournalStats;
+
+typedef void (*JournalApplyFn)(const JournalRecord* record, void* context);
+
+// appliedSequence 이하의 레코드는 이미 이미지에 반영된 것으로 보고 건너뛴다.
+bool journalOpen(const char* path, unsigned long long appliedSequence);
+int journalReplay(JournalApplyFn apply, void* context); // 다시 적용한 레코드 수. 잘린 꼬리는 잘라낸다
+// 변경 명령 하나를 journalBeginWrite와 journalEndWrite로 감싼다. 레코드는 그 사이에 남긴다.
+void journalBeginWrite(void);
+// 레코드 번호를 돌려준다 (저널이 닫혀 있으면 0). time은 명령이 생성/수정 시간으로 쓴 시각이다.
+unsigned long long journalAppend(JournalOp op, time_t time, int argCount, const char* const* args);
+void journalEndWrite(unsigned long long sequence); // sequence가 0이 아니면 디스크에 내려갈 때까지 기다린다
+void journalSync(void); // 지금까지 추가한 레코드가 디스크에 내려갈 때까지 기다린다
+unsigned long long journalSequence(void); // 마지막으로 추가한 레코드 번호
+void journalCheckpoint(void); // 이미지를 저장한 뒤 호출한다. 로그를 비운다
+void journalClose(void);
+bool journalIsOpen(void);
+JournalStats journalGetStats(void);
+
+#endif
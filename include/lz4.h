@@ -0,0 +1,15 @@
+#ifndef LZ4_H
+#define LZ4_H
+
+// LZ4 블록 형식의 압축기/해제기. 토큰(리터럴 길이 4비트 + 일치 길이 4비트), 리터럴, 2바이트 거리, 추가 길이 바이트.
+// 압축기는 4바이트 해시 표 하나로 가장 최근 위치만 보는 탐욕적 방식이라 빠르고, 해제는 표 없이 복사만 한다.
+// 표준 LZ4 블록과 호환된다 (프레임 형식은 쓰지 않는다).
+
+#define LZ4_HASH_BITS 12
+
+// 압축한 크기. dstCapacity 안에 들어가지 않으면 0
+int lz4Compress(const char* src, int srcSize, char* dst, int dstCapacity);
+// 해제한 크기. 입력이 잘못되었거나 dstCapacity를 넘으면 -1
+int lz4Decompress(const char* src, int srcSize, char* dst, int dstCapacity);
+
+#endif
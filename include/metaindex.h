@@ -0,0 +1,49 @@
+#ifndef METAINDEX_H
+#define METAINDEX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// 파일 메타데이터의 정렬 색인. 크기, 수정 시간, 생성 시간, 이름마다 스킵 리스트 하나를 두고
+// (키, inode) 순서로 정렬한다. 범위 [low, high]나 이름 접두어로 찾는 비용은 O(log n + 결과 수)다.
+// 색인에 넣은 값은 inode별로도 보관하므로, 값이 바뀌면 예전 항목을 찾아 지우고 새로 넣는다.
+//
+// 이름은 노드의 이름 표(strpool.h) 포인터를 그대로 담는다. 그래서 이름을 바꾸거나 노드를 지울 때는
+// 예전 이름을 반납하기 전에 metaIndexPut/metaIndexRemove를 부른다.
+// 색인 잠금 하나가 모든 색인을 보호한다 (가장 안쪽 잠금). 방문 함수는 그 잠금 안에서 불리므로 다른 잠금을 잡지 않는다.
+
+#define META_MAX_LEVEL 20
+
+typedef enum { META_SIZE, META_MTIME, META_CTIME, META_NAME, META_KEY_COUNT } MetaKey;
+
+typedef struct MetaEntry {
+    long long size;
+    long long mtime;
+    long long ctime;
+    const char* name;
+    bool indexed;
+} MetaEntry;
+
+// 찾을 범위. key가 META_NAME이면 prefix로 시작하는 이름, 아니면 low <= 값 <= high
+typedef struct MetaRange {
+    MetaKey key;
+    long long low, high;
+    const char* prefix;
+} MetaRange;
+
+typedef struct MetaIndexStats {
+    long files; // 색인에 든 파일 수
+    size_t bytes; // 스킵 리스트와 inode별 값이 쓰는 메모리
+} MetaIndexStats;
+
+// 방문을 그만두려면 false
+typedef bool (*MetaVisitFn)(int inode, const MetaEntry* entry, void* context);
+
+void metaIndexPut(int inode, const char* name, long long size, long long mtime, long long ctime); // 넣거나 바꾼다
+void metaIndexRemove(int inode);
+void metaIndexReset(void);
+void metaIndexScan(const MetaRange* range, MetaVisitFn visit, void* context); // 키 순서로 방문한다
+long metaIndexCount(const MetaRange* range, long limit); // 범위의 항목 수. limit개에서 멈춘다
+MetaIndexStats metaIndexGetStats(void);
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef NGRAM_H
+#define NGRAM_H
+
+#include <stddef.h>
+
+// 파일 내용의 3-gram(연속된 3바이트) 역색인.
+// 정방향 색인(inode -> 3-gram별 등장 횟수)을 함께 두어, 내용이 바뀔 때
+// 이전 내용을 다시 읽지 않고 달라진 3-gram만 게시 목록(posting list)에 반영한다.
+// 모든 함수는 여러 스레드에서 불러도 된다 (검색은 함께 읽고, 갱신은 하나씩).
+
+#define NGRAM_SIZE 3
+
+void ngramIndexFile(int inode, const char* data, size_t length); // inode의 내용을 통째로 다시 색인한다
+void ngramRemoveFile(int inode);
+void ngramCloneFile(int sourceInode, int targetInode); // 내용이 같은 사본: 원본의 정방향 색인을 그대로 복제한다
+// keyword의 3-gram을 모두 가진 inode 번호를 오름차순으로 돌려준다 (호출자가 free).
+// keyword가 NGRAM_SIZE보다 짧아 색인으로 거를 수 없으면 -1을 돌려준다.
+int ngramQuery(const char* keyword, size_t length, int** candidates);
+void ngramReset(void);
+
+#endif
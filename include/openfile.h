@@ -0,0 +1,36 @@
+#ifndef OPENFILE_H
+#define OPENFILE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include "fs.h"
+
+// POSIX 식 파일 기술자(fd) API. 열린 파일 표가 fd마다 노드와 읽기/쓰기 위치를 들고 있다.
+// 쓰기는 닿는 바이트와 블록만 고치므로 (fileWriteAt) 큰 파일에 조금 덧붙이거나 고치는 비용은 바뀐 양에 비례한다.
+//
+// 실패하면 -1을 돌려주고 errno를 남긴다 (EBADF, ENOENT, EACCES, EINVAL, ENOSPC, EMFILE, ESTALE).
+// 트리에 들어온 동안(fsEnterShared 등) 부른다. 열린 파일이 지워지면 그 fd는 ESTALE만 돌려준다 (fs_close로 닫는다).
+// fd 하나를 여러 스레드가 함께 쓰면 위치는 표 잠금 안에서 읽고 옮기지만, 같은 위치에 겹쳐 쓸 수 있다.
+
+#define FS_OPEN_MAX 256
+
+#define FS_O_READ 0x1
+#define FS_O_WRITE 0x2
+#define FS_O_CREATE 0x4 // 없으면 빈 파일을 만든다
+#define FS_O_TRUNCATE 0x8 // 열면서 크기를 0으로
+#define FS_O_APPEND 0x10 // 쓰기는 항상 파일 끝에
+
+// start에서 path("a/b/c", "/"로 시작해도 된다)를 따라간 파일을 연다.
+int fs_open(Node* start, const char* path, int flags);
+ssize_t fs_read(int fd, void* buffer, size_t length); // 위치에서 읽고 위치를 옮긴다
+ssize_t fs_write(int fd, const void* data, size_t length);
+ssize_t fs_pread(int fd, void* buffer, size_t length, long offset); // 위치를 쓰지도 옮기지도 않는다
+ssize_t fs_pwrite(int fd, const void* data, size_t length, long offset);
+ssize_t fs_append(int fd, const void* data, size_t length); // 열 때의 플래그와 관계없이 끝에 쓴다
+long fs_lseek(int fd, long offset, int whence); // SEEK_SET, SEEK_CUR, SEEK_END
+int fs_truncate(int fd, long size);
+int fs_close(int fd);
+void fs_close_all(void); // 파일 시스템을 내릴 때
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef RWLOCK_H
+#define RWLOCK_H
+
+#include <stdbool.h>
+
+// 디렉터리마다 두는 작은 reader-writer 스핀락과 시퀀스 카운터 (8 bytes).
+// 자식 목록을 훑는 쪽은 읽기 잠금을, 자식 인덱스에서 이름 하나를 찾는 쪽은 잠그지 않고
+// 시퀀스 값을 전후로 비교하는 seqlock 방식으로 읽는다 (공유 캐시 라인에 쓰지 않는다).
+// 같은 스레드가 같은 잠금을 두 번 잡으면 안 된다 (기다리는 writer가 있으면 교착된다).
+typedef struct DirLock {
+    unsigned int state; // 하위 30비트: 읽는 스레드 수, DIR_LOCK_WRITER/DIR_LOCK_PENDING 비트
+    unsigned int sequence; // 쓰는 동안 홀수
+} DirLock;
+
+void dirLockInit(DirLock* lock);
+void dirReadLock(DirLock* lock);
+void dirReadUnlock(DirLock* lock);
+void dirWriteLock(DirLock* lock); // 시퀀스를 홀수로 만든다
+void dirWriteUnlock(DirLock* lock); // 시퀀스를 다시 짝수로 만든다
+
+// seqlock 읽기: 시작 값이 홀수면 쓰는 중이므로 잠그고 읽어야 한다.
+static inline unsigned int dirReadBegin(const DirLock* lock) {
+    return __atomic_load_n(&lock->sequence, __ATOMIC_ACQUIRE);
+}
+
+static inline bool dirReadRetry(const DirLock* lock, unsigned int start) {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return (start & 1) != 0 || __atomic_load_n(&lock->sequence, __ATOMIC_RELAXED) != start;
+}
+
+// 읽기가 압도적으로 많은 전역 잠금 (big-reader lock). 읽는 쪽은 스레드마다 다른 캐시 라인의
+// 카운터만 건드리므로 코어 수가 늘어도 서로 방해하지 않고, 쓰는 쪽은 모든 카운터가 0이 될 때까지 기다린다.
+#define BRLOCK_SLOTS 64
+
+typedef struct BrlockSlot {
+    unsigned int readers;
+    char padding[60];
+} __attribute__((aligned(64))) BrlockSlot;
+
+typedef struct BigReaderLock {
+    BrlockSlot slots[BRLOCK_SLOTS];
+    unsigned int writer; // 쓰는 쪽이 들어와 있거나 기다리는 중
+    unsigned int writerMutex; // 쓰는 쪽끼리의 순서
+} BigReaderLock;
+
+void brReadLock(BigReaderLock* lock);
+void brReadUnlock(BigReaderLock* lock);
+void brWriteLock(BigReaderLock* lock);
+void brWriteUnlock(BigReaderLock* lock);
+
+#endif
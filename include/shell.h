@@ -0,0 +1,20 @@
+#ifndef SHELL_H
+#define SHELL_H
+
+// 대화형 셸이 한 줄을 실행하는 곳.
+// 내장 명령은 이름 해시 표에 등록해 두고 해시 한 번으로 찾아 프로세스 안에서 실행한다.
+// 표에 없는 명령은 PATH에서 찾은 실행 파일을 posix_spawn(glibc에서는 vfork처럼 주소 공간을 나눠 쓰는 clone)으로
+// 셸을 거치지 않고 바로 실행한다. 찾은 경로는 PATH 값이 바뀌거나 실행에 실패할 때까지 캐시한다.
+// 파이프, 리다이렉션, 변수, 와일드카드처럼 셸 문법이 필요한 줄만 /bin/sh -c로 넘긴다.
+
+#define SHELL_MAX_ARGS 256
+#define SHELL_DEFER (-1) // 내장 명령이 지원하지 않는 옵션을 받았을 때 돌려준다. 같은 이름의 외부 명령을 대신 실행한다.
+#define SHELL_NOT_FOUND 127 // 명령을 찾지 못했을 때의 종료 상태 (sh와 같다)
+
+typedef int (*BuiltinFn)(int argc, char** argv); // 종료 상태를 돌려준다
+
+void shellRegister(const char* name, BuiltinFn fn); // name은 계속 유효한 문자열이어야 한다 (통계 이름으로도 쓴다)
+void shellInit(); // 기본 내장 명령 echo, cat, ls, pwd, cd, env, time을 등록한다
+int shellExecute(const char* line); // 한 줄을 실행하고 종료 상태를 돌려준다
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <stddef.h>
+#include <pthread.h>
+
+// 같은 크기의 객체를 큰 덩어리(slab)에서 잘라 나눠 주는 할당기.
+// 해제된 객체는 크기별 캐시의 free list로 돌아가 바로 재사용되고,
+// 서브트리 전체는 체인으로 한 번에 돌려주거나 캐시 전체를 통째로 비울 수 있다(arena).
+// 할당/해제는 캐시마다 하나인 mutex로 보호한다. slabReleaseAll은 다른 스레드가 쓰지 않을 때만 부른다.
+
+typedef struct SlabStats {
+    unsigned long allocations; // 누적 할당 횟수
+    unsigned long frees; // 누적 해제 횟수 (일괄 해제 포함)
+    unsigned long inUse; // 현재 사용 중인 객체 수
+    unsigned long peakInUse; // 최대 동시 사용 객체 수
+    unsigned long slabCount; // 현재 확보한 slab 수
+    unsigned long bytesReserved; // slab으로 확보한 총 바이트
+    unsigned long bulkReleases; // 일괄 해제/리셋 횟수
+} SlabStats;
+
+struct Slab;
+
+typedef struct SlabCache {
+    pthread_mutex_t lock;
+    const char* name;
+    size_t objectSize; // 16바이트 단위로 올림한 객체 크기
+    size_t objectsPerSlab;
+    void* freeList; // 해제된 객체 (첫 워드로 연결)
+    struct Slab* slabs; // 확보한 slab 목록 (가장 최근 것이 앞)
+    size_t carved; // 맨 앞 slab에서 이미 잘라 준 객체 수
+    SlabStats stats;
+} SlabCache;
+
+void slabCacheInit(SlabCache* cache, const char* name, size_t objectSize, size_t objectsPerSlab);
+void* slabAlloc(SlabCache* cache);
+void slabFree(SlabCache* cache, void* object);
+// head부터 첫 워드로 연결된 count개의 객체를 free list에 한 번에 붙인다.
+void slabFreeChain(SlabCache* cache, void* head, void* tail, unsigned long count);
+// 모든 객체를 한꺼번에 버리고 slab 메모리를 반납한다 (arena 리셋).
+void slabReleaseAll(SlabCache* cache);
+SlabStats slabGetStats(SlabCache* cache);
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdbool.h>
+
+// 명령별 호출 수와 지연 시간 히스토그램, 할당/탐색 카운터.
+// MINIOS_NO_STATS로 빌드하면 (make STATS=0) 모든 계측 매크로가 사라지고
+// statsPrint/statsDump는 아무 일도 하지 않는다. 카운터는 원자적으로 더하고, 히스토그램은 잠금 안에서 기록한다.
+
+#define STATS_MAX_COMMANDS 32
+#define STATS_SUB_BUCKET_BITS 4 // 2의 거듭제곱 구간마다 16칸 (상대 오차 약 6%)
+#define STATS_SUB_BUCKETS (1 << STATS_SUB_BUCKET_BITS)
+#define STATS_BUCKETS (64 * STATS_SUB_BUCKETS)
+#define STATS_MAX_DEPTH 64 // 이보다 깊은 경로는 마지막 칸에 모은다
+
+// HDR 방식 히스토그램: 값의 최상위 비트 위치와 그 아래 STATS_SUB_BUCKET_BITS 비트로 칸을 정한다.
+typedef struct StatsHistogram {
+    unsigned long long counts[STATS_BUCKETS];
+    unsigned long long total;
+    unsigned long long sum;
+    unsigned long long min;
+    unsigned long long max;
+} StatsHistogram;
+
+typedef struct FsCounters {
+    unsigned long long inodeAllocations;
+    unsigned long long inodeFrees;
+    unsigned long long blockAllocations;
+    unsigned long long blockFrees; // 참조 수가 0이 되어 실제로 반납된 블록
+    unsigned long long lookups; // resolvePath 호출 수
+    unsigned long long lookupComponents; // 경로 탐색에서 찾아본 구성 요소 수의 합
+    unsigned long long lookupDepths[STATS_MAX_DEPTH + 1];
+} FsCounters;
+
+#ifndef MINIOS_NO_STATS
+
+extern FsCounters fsCounters;
+
+unsigned long long statsNow(void); // 단조 시계, 나노초
+void statsRecordCommand(const char* name, unsigned long long nanoseconds); // name은 계속 유효한 문자열이어야 한다
+void statsRecordLookup(int depth);
+void statsPrint(void);
+bool statsDump(const char* path); // 확장자가 .csv면 CSV, 아니면 JSON
+void statsDumpOnExit(void); // MINIOS_STATS_FILE이 있으면 그 파일로 내보낸다
+
+#define STATS_COUNT(counter) __atomic_fetch_add(&fsCounters.counter, 1, __ATOMIC_RELAXED)
+#define STATS_TIMER_START(var) unsigned long long var = statsNow()
+#define STATS_RECORD_COMMAND(name, start) statsRecordCommand((name), statsNow() - (start))
+#define STATS_RECORD_LOOKUP(depth) statsRecordLookup(depth)
+
+#else
+
+#include <stdio.h>
+
+static inline void statsPrint(void) { printf("이 빌드에는 계측이 빠져 있습니다 (MINIOS_NO_STATS).\n"); }
+static inline bool statsDump(const char* path) { (void)path; return false; }
+static inline void statsDumpOnExit(void) {}
+
+#define STATS_COUNT(counter) ((void)0)
+#define STATS_TIMER_START(var) ((void)0)
+#define STATS_RECORD_COMMAND(name, start) ((void)0)
+#define STATS_RECORD_LOOKUP(depth) ((void)0)
+
+#endif
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef STRPOOL_H
+#define STRPOOL_H
+
+#include <stddef.h>
+#include <pthread.h>
+
+// 짧은 문자열을 한 번씩만 담아 두는 표 (intern). 같은 문자열은 같은 포인터로 돌려주고 참조 수로 함께 쓴다.
+// 문자열은 큰 청크에 [참조 수 4 bytes][길이 1 byte][글자...][NUL] 꼴로 8바이트 단위로 잘라 담는다.
+// 돌려주는 포인터는 글자의 시작이라 그대로 C 문자열로 쓸 수 있고, 길이는 바로 앞 바이트에 있다.
+// 참조가 모두 사라진 칸은 크기별 빈 칸 목록으로 돌아가 같은 크기의 문자열이 다시 쓴다.
+//
+// 청크는 reset 전까지 옮기거나 해제하지 않고, 끝에 STRPOOL_SLACK바이트의 0을 남겨 둔다. 그래서 잠그지 않고
+// 읽는 쪽이 그 사이 반납·재사용된 문자열을 길이 제한(STRPOOL_SLACK 이하)이 있는 strncmp로 읽어도 청크 밖으로 나가지 않는다.
+// 표와 빈 칸 목록은 풀마다 하나인 mutex가 보호한다.
+
+#define STRPOOL_MAX_LENGTH 255
+#define STRPOOL_CHUNK_BYTES (64 * 1024)
+#define STRPOOL_SLACK 256
+#define STRPOOL_CLASSES ((4 + 1 + STRPOOL_MAX_LENGTH + 1 + 7) / 8 + 1)
+
+typedef struct StringPoolStats {
+    unsigned long strings; // 지금 담긴 서로 다른 문자열
+    unsigned long references; // 지금 참조 수의 합
+    unsigned long hits; // 이미 있는 문자열을 다시 받은 횟수 (누적)
+    size_t bytesUsed; // 살아 있는 칸의 바이트
+    size_t bytesReserved; // 청크와 표로 확보한 바이트
+} StringPoolStats;
+
+typedef struct StringPool {
+    pthread_mutex_t lock;
+    char** chunks;
+    int chunkCount, chunkCapacity;
+    size_t carved; // 마지막 청크에서 잘라 준 바이트
+    char* freeLists[STRPOOL_CLASSES]; // 칸 크기(8바이트 단위)별 빈 칸 (칸의 첫 워드로 연결)
+    const char** table; // 문자열 포인터를 담는 오픈 어드레싱 표
+    size_t tableMask; // 칸 수 - 1, 아직 없으면 0
+    StringPoolStats stats;
+} StringPool;
+
+void stringPoolInit(StringPool* pool);
+// 길이가 STRPOOL_MAX_LENGTH를 넘으면 NULL
+const char* stringPoolIntern(StringPool* pool, const char* string);
+void stringPoolRelease(StringPool* pool, const char* string); // stringPoolIntern으로 받은 포인터
+void stringPoolReset(StringPool* pool); // 모든 문자열을 한꺼번에 버린다. 다른 스레드가 쓰지 않을 때만 부른다
+StringPoolStats stringPoolGetStats(StringPool* pool);
+
+static inline size_t stringPoolLength(const char* string) {
+    return ((const unsigned char*)string)[-1];
+}
+
+#endif
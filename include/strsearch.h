@@ -0,0 +1,17 @@
+#ifndef STRSEARCH_H
+#define STRSEARCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// 길이가 주어진 버퍼에서 부분 문자열을 찾는다 (NUL 종료가 필요 없다).
+// x86에서는 처음 호출할 때 cpuid로 AVX2/SSE2 구현을 고르고, 그 밖에는 스칼라 구현을 쓴다.
+
+// haystack에서 needle이 처음 나오는 위치, 없으면 NULL
+const char* memsearch(const char* haystack, size_t haystackLength, const char* needle, size_t needleLength);
+const char* memsearchScalar(const char* haystack, size_t haystackLength, const char* needle, size_t needleLength);
+const char* memsearchImplementation(void); // 선택된 구현 이름 ("avx2", "sse2", "scalar")
+// 구현을 이름으로 강제로 고른다 (테스트용). 이 CPU에서 쓸 수 없는 구현이면 false
+bool memsearchSelect(const char* name);
+
+#endif
@@ -1,5 +1,123 @@
-
-// include/linux/sched.h
-//SSU struct task_struct {
-
-void minisystem();
+#ifndef SYSTEM_H
+#define SYSTEM_H
+
+#include <stdbool.h>
+#include <ucontext.h>
+#include "slab.h"
+
+// include/linux/sched.h
+// 사용자 공간에서 도는 작업(task) 스케줄러. kernel/process.c
+//
+// 작업은 자기 스택을 가진 코루틴이다. 타이머 인터럽트 대신 작업이 taskTick()으로 한 틱(1ms)을 썼다고
+// 알리면 스케줄러가 선점 여부를 정하고, 선점되면 ucontext로 다음 작업에 바로 넘어간다.
+// 정책은 두 가지다.
+//   SCHED_O1:  리눅스 2.6의 O(1) 스케줄러. 우선순위마다 FIFO 큐를 둔 active/expired 배열 두 개와
+//              비어 있지 않은 큐의 비트맵으로 다음 작업을 상수 시간에 고른다. 타임 슬라이스를 다 쓰면 expired로 간다.
+//   SCHED_CFS: 가중치로 나눈 가상 실행 시간(vruntime)을 키로 하는 레드-블랙 트리에서 가장 왼쪽 작업을 고른다.
+
+#define MAX_NICE 19
+#define MIN_NICE (-20)
+#define MAX_PRIO 140 // 0..99는 실시간용으로 비워 두고 nice는 100..139에 놓는다
+#define NICE_TO_PRIO(nice) (120 + (nice))
+#define SCHED_TICK_NS 1000000ULL // 한 틱 = 1ms
+#define TASK_STACK_SIZE (64 * 1024)
+
+typedef enum { SCHED_O1, SCHED_CFS } SchedPolicy;
+
+typedef enum {
+    TASK_READY, // 실행 큐에 있다
+    TASK_RUNNING,
+    TASK_DEAD // 작업 함수가 끝났다. 스택은 이미 돌려주었다
+} TaskState;
+
+struct task_struct;
+typedef void (*TaskFn)(void* arg);
+
+typedef struct task_struct {
+    int pid;
+    char name[16];
+    TaskState state;
+    int nice;
+    int prio; // NICE_TO_PRIO(nice)
+    TaskFn fn; // NULL이면 실행하지 않는 작업 (벤치마크에서 스케줄 결정만 잴 때)
+    void* arg;
+    ucontext_t context;
+    void* stack; // 처음 실행할 때 잡는다
+
+    // 실행 통계
+    unsigned long long runTicks;
+    unsigned long long switches; // CPU를 받은 횟수
+    long long finishTick; // 끝난 틱, 아직이면 -1
+
+    // SCHED_O1
+    struct task_struct* runNext; // 우선순위 큐 안의 이중 연결
+    struct task_struct* runPrev;
+    int timeSlice; // 남은 틱
+    bool yielded; // taskYield로 CPU를 내놓았다. 슬라이스가 남아도 expired 배열로 간다
+
+    // SCHED_CFS
+    unsigned long long vruntime; // 나노초
+    unsigned long weight; // nice 0이 1024
+    unsigned long long sliceStart; // 이번에 CPU를 받았을 때의 runTicks
+    struct task_struct* rbParent;
+    struct task_struct* rbLeft;
+    struct task_struct* rbRight;
+    bool rbRed;
+} Task;
+
+typedef struct PrioArray {
+    unsigned long long bitmap[(MAX_PRIO + 63) / 64]; // 비어 있지 않은 큐
+    Task* queueHead[MAX_PRIO];
+    Task* queueTail[MAX_PRIO];
+    long count;
+} PrioArray;
+
+typedef struct Scheduler {
+    SchedPolicy policy;
+    SlabCache taskCache;
+    int nextPid;
+    long taskCount; // 끝나지 않은 작업 수
+    long readyCount; // 실행 큐에 있는 작업 수
+    unsigned long long ticks; // 지금까지 흐른 틱
+    unsigned long long tickLimit; // schedulerRun이 돌려받을 틱
+    unsigned long long contextSwitches;
+    Task* current;
+    ucontext_t mainContext; // schedulerRun을 부른 쪽
+    Task** allTasks; // 만든 순서대로, 통계 출력과 정리에 쓴다
+    long allCount;
+    long allCapacity;
+
+    // SCHED_O1
+    PrioArray arrays[2];
+    PrioArray* active;
+    PrioArray* expired;
+
+    // SCHED_CFS
+    Task* rbRoot;
+    Task* leftmost; // 가장 작은 vruntime (캐시)
+    unsigned long long minVruntime; // 큐의 가장 작은 vruntime, 줄어들지 않는다
+    unsigned long totalWeight; // 큐에 있는 작업과 실행 중인 작업의 가중치 합
+} Scheduler;
+
+Scheduler* schedulerCreate(SchedPolicy policy);
+void schedulerDestroy(Scheduler* scheduler); // 끝나지 않은 작업도 모두 버린다
+// 작업을 만들어 실행 큐에 넣는다. nice는 MIN_NICE..MAX_NICE로 자른다.
+// fn이 NULL인 작업은 실행하지 않고 scheduleNext로 스케줄 결정만 잴 때 쓴다 (schedulerRun은 바로 끝낸다).
+Task* taskCreate(Scheduler* scheduler, const char* name, int nice, TaskFn fn, void* arg);
+// 작업이 모두 끝나거나 maxTicks가 흐를 때까지 작업을 돌린다. 흐른 틱 수를 돌려준다.
+unsigned long long schedulerRun(Scheduler* scheduler, unsigned long long maxTicks);
+
+// 스케줄 결정 한 번: prev(NULL이 아니면)에 한 틱을 매겨 실행 큐에 되돌리고 다음 작업을 꺼낸다.
+// 선점할 때 schedulerRun이 거치는 것과 같은 경로이며, 작업을 실행하지 않고 결정 비용만 잴 때 쓴다.
+Task* scheduleNext(Scheduler* scheduler, Task* prev);
+
+// 실행 중인 작업 안에서만 부른다.
+void taskTick(); // 한 틱을 썼다. 선점되면 다른 작업이 돈 뒤에 돌아온다
+void taskYield(); // 남은 슬라이스를 포기하고 다른 작업에 넘긴다 (한 틱으로 친다)
+
+const char* schedPolicyName(SchedPolicy policy);
+bool parseSchedPolicy(const char* text, SchedPolicy* policy);
+
+int minisystem(int argc, char** argv);
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef TEXTBUF_H
+#define TEXTBUF_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+// 출력할 글을 모아 두는 버퍼. 여러 스레드가 나눠 만든 출력을 정해진 순서대로 내보낼 때 쓴다.
+
+typedef struct TextBuffer {
+    char* data;
+    size_t length;
+    size_t capacity;
+} TextBuffer;
+
+void textInit(TextBuffer* text);
+void textFree(TextBuffer* text);
+void textAppend(TextBuffer* text, const char* data, size_t length);
+void textPrintf(TextBuffer* text, const char* format, ...) __attribute__((format(printf, 2, 3)));
+void textFlush(TextBuffer* text, FILE* out); // 모은 내용을 쓰고 비운다
+
+#endif
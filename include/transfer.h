@@ -0,0 +1,25 @@
+#ifndef TRANSFER_H
+#define TRANSFER_H
+
+#include <stdbool.h>
+#include "fs.h"
+
+// 호스트 파일 시스템과 트리 사이의 대량 가져오기/내보내기 (import, export 명령).
+//
+// 가져오기는 두 단계다. 먼저 호스트 디렉터리를 깊이별로 훑으면서 같은 깊이의 디렉터리들을 작업 스레드
+// (workpool.h)에서 나눠 readdir하고 디렉터리 노드를 만든다. 다음으로 모은 파일들을 작업 스레드에서 나눠
+// 열고, 블록을 먼저 잡은 뒤 preadv로 블록에 바로 읽어 들여 부모에 붙인다 (fileReadFd, adoptChild).
+// 파일마다 open, fstat, preadv, close만 하므로 큰 트리도 디스크 읽기 속도에 묶인다.
+// 가져온 내용은 3-gram 색인에 넣지 않고 색인을 낡은 것으로 표시해 두어 다음 검색 때 한 번에 만든다.
+//
+// 내보내기는 트리를 훑으며 호스트 디렉터리를 만들고, 파일들은 작업 스레드에서 나눠 블록에서 바로
+// writev로 쓴다 (fileWriteFd). 수정 시간도 옮긴다.
+//
+// 이미 있는 디렉터리는 합치고, 같은 이름의 파일은 건너뛴다(가져오기) 또는 덮어쓴다(내보내기).
+// 심볼릭 링크와 특수 파일, 이름이 99바이트를 넘는 항목은 건너뛴다. 가져오기는 fsEnterExclusive, 내보내기는
+// fsEnterShared 안에서 부른다.
+
+bool importTree(Node* target, const char* hostDir); // 무엇이든 가져왔으면 true
+bool exportTree(Node* source, const char* hostDir); // 모두 썼으면 true
+
+#endif
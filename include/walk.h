@@ -0,0 +1,43 @@
+#ifndef WALK_H
+#define WALK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "fs.h"
+
+// 재귀 없이 트리를 훑는다. 내려간 디렉터리마다 (디렉터리, 다음에 볼 자식) 프레임을 명시적 스택에 쌓으므로
+// 깊이가 아무리 깊어도 C 스택을 쓰지 않는다.
+//
+// enter는 전위 순서로 노드마다 한 번 불린다 (시작 노드의 depth가 0). 디렉터리에서 WALK_SKIP을 돌려주면
+// 그 아래로 내려가지 않고, WALK_STOP이면 바로 끝낸다. leave는 디렉터리의 자식을 모두 본 뒤에 불린다 (후위).
+// 다음 형제는 enter를 부르기 전에 읽어 두므로, enter에서 파일 노드를, leave에서 디렉터리 노드를 해제해도 된다.
+//
+// WALK_LOCKED를 주면 자식을 보는 동안 그 디렉터리의 읽기 잠금을 쥔다 (enter는 부모 잠금 안에서 불린다).
+// leave는 잠금을 놓은 뒤에 불린다. 시작 노드는 호출자가 보호한다.
+
+typedef enum { WALK_CONTINUE, WALK_SKIP, WALK_STOP } WalkAction;
+
+#define WALK_LOCKED 1
+
+typedef WalkAction (*WalkEnter)(Node* node, int depth, void* state);
+typedef void (*WalkLeave)(Node* dir, int depth, void* state);
+
+// 끝까지 훑었으면 true, WALK_STOP으로 멈췄으면 false
+bool walkTree(Node* top, int flags, WalkEnter enter, WalkLeave leave, void* state);
+
+// 트리를 전위 순서상 연속된 조각들로 나눠 스레드 풀(workpool.h)에서 함께 훑는다. 항상 WALK_LOCKED로 훑는다.
+// 조각마다 stateSize 크기의 상태를 따로 두고 initState로 초기화한 뒤 enter에 넘긴다.
+// mergeState는 부른 스레드에서 조각 순서(= 전위 순서)대로 불리므로, 조각마다 모은 결과를 차례로
+// 합치면 혼자 훑었을 때와 같은 결과가 된다. enter는 WALK_STOP을 쓰지 않으며 leave는 없다.
+// 디렉터리의 자식 수와 하위 파일 수(집계값)로 조각의 크기를 어림한다.
+typedef struct ParallelWalk {
+    WalkEnter enter;
+    size_t stateSize;
+    void (*initState)(void* state, void* context);
+    void (*mergeState)(void* state, void* context); // 상태가 가진 메모리도 여기서 정리한다
+    void* context;
+} ParallelWalk;
+
+void walkTreeParallel(Node* top, const ParallelWalk* walk);
+
+#endif
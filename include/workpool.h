@@ -0,0 +1,24 @@
+#ifndef WORKPOOL_H
+#define WORKPOOL_H
+
+// 작업 훔치기(work-stealing) 스레드 풀. 프로세스 전체가 하나를 같이 쓰며 처음 쓸 때 만든다.
+// 스레드 수는 MINIOS_THREADS (없으면 온라인 CPU 수)이고, 부른 스레드도 작업자 하나로 같이 일한다.
+//
+// 한 번의 실행은 0..count-1 번 작업을 모두 끝내는 parallel-for다. 작업 번호를 작업자마다
+// 연속 구간으로 나눠 각자의 덱(Chase-Lev)에 넣고, 자기 덱은 뒤에서 꺼내며 비면 다른 작업자의 덱 앞에서 훔친다.
+// 작업이 끝나는 순서는 정해져 있지 않으므로, 결과는 작업 번호별 자리에 쓰고 부른 쪽에서 순서대로 합친다.
+//
+// 다른 스레드가 이미 풀을 쓰고 있으면 기다리지 않고 부른 스레드 혼자 순서대로 실행한다.
+// 작업 안에서 workPoolRun을 다시 부르면 역시 혼자 실행된다.
+
+#define WORKPOOL_MAX_THREADS 64
+
+typedef void (*WorkFn)(void* context, long index);
+
+void workPoolRun(long count, WorkFn fn, void* context);
+int workPoolThreads(); // 부른 스레드를 포함한 작업자 수
+void workPoolShutdown(); // 작업 스레드를 모두 끝낸다. 다음 workPoolRun이 다시 만든다.
+// 작업 스레드가 끝나기 직전에 부를 함수 (스레드마다 받아 둔 자원을 돌려줄 때 쓴다). 풀을 만들기 전에 정한다.
+void workPoolSetThreadExit(void (*hook)(void));
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef XXHASH_H
+#define XXHASH_H
+
+#include <stddef.h>
+
+// xxHash64. 내용 주소 중복 제거(dedup.h)에서 파일 내용 전체의 키로 쓴다.
+// 내용이 여러 조각에 나뉘어 있으면 Init/Update/Digest로 이어서 해시한다.
+
+typedef struct Xxh64State {
+    unsigned long long total; // 지금까지 넣은 바이트 수
+    unsigned long long lanes[4];
+    unsigned char buffer[32]; // 아직 32바이트가 안 된 나머지
+    size_t buffered;
+    unsigned long long seed;
+} Xxh64State;
+
+void xxh64Init(Xxh64State* state, unsigned long long seed);
+void xxh64Update(Xxh64State* state, const void* data, size_t length);
+unsigned long long xxh64Digest(const Xxh64State* state);
+unsigned long long xxh64(const void* data, size_t length, unsigned long long seed);
+
+#endif
@@ -2,625 +2,2477 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
+#include <limits.h>
 #include <time.h> // 파일 시간 정보를 위해 추가
-#define MAX_INODES 100
-
-typedef struct Inode {
-    int fileSize; // 파일 크기
-    time_t created; // 파일 생성 시간
-    time_t modified; // 파일 수정 시간
-    int linkCount; // 링크 수
-    // 여기에 더 많은 inode 관련 정보를 추가할 수 있습니다.
-} Inode;
-
-typedef struct InodeTable {
-    Inode inodes[MAX_INODES];
-    bool isAllocated[MAX_INODES];
-} InodeTable;
-InodeTable inodeTable;
+#include <fnmatch.h>
+#include <pthread.h>
+#include "rwlock.h"
+#include "dcache.h"
+#include "slab.h"
+#include "strpool.h"
+#include "ngram.h"
+#include "metaindex.h"
+#include "openfile.h"
+#include "strsearch.h"
+#include "fs.h"
+#include "image.h"
+#include "journal.h"
+#include "stats.h"
+#include "textbuf.h"
+#include "walk.h"
+#include "workpool.h"
+#include "transfer.h"
+#include "bcache.h"
+#include "dedup.h"
+#include "compress.h"
+
+#define NODES_PER_SLAB 256
+#define INODE_CACHE_SIZE 32 // 스레드마다 미리 받아 두는 inode 수
+#define OPTIMISTIC_ATTEMPTS 4 // 자식 찾기를 잠그지 않고 다시 해 보는 횟수
 
-typedef struct Superblock {
-    int totalInodes;
-    int usedInodes;
-    int totalBlocks;
-    int usedBlocks;
-    int fileSystemSize;
-} Superblock;
+InodeTable inodeTable;
 Superblock superblock;
+bool quietMode = false; // 배치 모드 -q: 작업마다 나오는 안내 메시지를 끈다
+static SlabCache nodeCache; // Node 전용 slab 캐시
+static SlabCache dirCache; // Directory 전용 slab 캐시
+static StringPool namePool; // 노드 이름 표. 같은 이름은 한 번만 담는다
+// 색인을 다시 만들어야 하는지. 명령 처리부가 잠금 없이 먼저 보므로 __atomic으로만 읽고 쓴다.
+// 참으로 바꾸는 쪽(불러오기, 가져오기)과 다시 만드는 쪽 모두 단독으로 들어와 있다.
+static bool contentIndexStale = false; // 3-gram 색인
+static bool metaIndexStale = false; // 메타데이터 색인
+// 일부만 고쳐 3-gram 색인을 다시 만들어야 하는 파일 (inode 번호). 목록과 중복을 거르는 비트맵을 함께 둔다
+static struct {
+    Bitmap marked;
+    int* inodes;
+    int count, capacity;
+    pthread_mutex_t lock;
+} contentDirty = { .lock = PTHREAD_MUTEX_INITIALIZER };
+static void clearContentDirty();
+
+static unsigned long nextNodeSerial = 1;
+
+// 노드를 해제하는 명령(삭제, 디렉터리 복사)만 단독으로 들어오고 나머지는 함께 들어온다 (fs.h 참고).
+static BigReaderLock namespaceLock;
+
+// inode 비트맵과 테이블 청크 목록을 보호한다. 스레드는 INODE_CACHE_SIZE개씩 한 번에 받아 두므로
+// 할당할 때마다 잡지는 않는다. initInodeTable이 세대를 올리면 받아 둔 번호는 버린다.
+static pthread_mutex_t inodeLock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned int inodeGeneration = 1;
+
+typedef struct InodeCache {
+    int inodes[INODE_CACHE_SIZE]; // 뒤에서부터 꺼낸다
+    int count;
+    unsigned int generation;
+} InodeCache;
+static __thread InodeCache threadInodes;
 
-typedef struct Directory {
-    char name[100]; // 디렉터리 이름
-    void* children[30]; // 자식 노드 포인터 배열 (디렉터리 또는 파일), 최대 30개로 제한
-    int childCount; // 현재 자식 노드의 수
-    int inodeIndex;
-    Inode inode; // 디렉터리의 inode 정보
-} Directory;
-
-typedef struct File {
-    char name[100]; // 파일 이름
-    char content[1024]; // 파일 내용
-    int inodeIndex;
-    Inode inode; // 파일의 inode 정보
-} File;
-
-typedef enum { DIR_TYPE, FILE_TYPE } NodeType;
-
-typedef struct Node {
-    NodeType type; // 노드 타입 (디렉터리 또는 파일)
-    int inode; // 새로운 멤버 추가
-    union {
-        Directory dir;
-        File file;
-    };
-    struct Node* parent; // 부모 노드 포인터
-} Node;
-
-void dir_main();
-int allocateInode();
-void freeInode(int inodeIndex);
+// 변경 명령이 생성/수정 시간으로 쓰는 시각. runCommand가 명령마다 한 번 정해 저널 레코드에도 같은 값을 남기고,
+// 저널을 다시 적용할 때는 레코드에 남은 원래 시각을 쓴다. 명령 밖(가져오기 작업 스레드, 벤치마크)에서는 지금 시각이다.
+static __thread time_t commandClock;
+static __thread time_t replayClock;
+
+static time_t commandTime() {
+    return commandClock != 0 ? commandClock : time(NULL);
+}
+
+// 자식 인덱스를 늘릴 때 예전 슬롯 배열은 잠그지 않고 읽는 스레드가 아직 보고 있을 수 있으므로
+// 바로 해제하지 않고 모아 두었다가, 아무도 트리에 들어와 있지 않을 때(단독 진입, 종료) 해제한다.
+typedef struct RetiredSlots {
+    struct RetiredSlots* next;
+    ChildSlot* slots;
+} RetiredSlots;
+static RetiredSlots* retiredSlots;
+static pthread_mutex_t retiredLock = PTHREAD_MUTEX_INITIALIZER;
+
+Inode* getInode(int index) {
+    return &inodeTable.chunks[index >> INODE_CHUNK_SHIFT][index & (INODE_CHUNK_SIZE - 1)];
+}
+
+static bool growInodeTable() {
+    if (inodeTable.chunkCount == MAX_INODE_CHUNKS) {
+        return false;
+    }
+    Inode* chunk = (Inode*)calloc(INODE_CHUNK_SIZE, sizeof(Inode));
+    InodeColumns* columns = (InodeColumns*)calloc(1, sizeof(InodeColumns));
+    if (chunk == NULL || columns == NULL) {
+        free(chunk);
+        free(columns);
+        return false;
+    }
+    int base = inodeTable.chunkCount * INODE_CHUNK_SIZE;
+    for (int i = 0; i < INODE_CHUNK_SIZE; i++) {
+        chunk[i].number = base + i;
+    }
+    inodeTable.chunks[inodeTable.chunkCount] = chunk;
+    inodeTable.columns[inodeTable.chunkCount] = columns;
+    inodeTable.chunkCount++;
+    bitmapGrow(&inodeTable.allocated, (size_t)inodeTable.chunkCount * INODE_CHUNK_SIZE);
+    superblock.totalInodes = inodeTable.chunkCount * INODE_CHUNK_SIZE;
+    return true;
+}
+
+// 모든 inode를 미사용 상태로 되돌린다. 이미 만든 청크는 재사용한다.
+void initInodeTable() {
+    pthread_mutex_lock(&inodeLock);
+    if (inodeTable.chunkCount == 0) {
+        bitmapInit(&inodeTable.allocated, 0);
+        growInodeTable();
+    }
+    bitmapClearAll(&inodeTable.allocated);
+    superblock.totalInodes = inodeTable.chunkCount * INODE_CHUNK_SIZE;
+    superblock.usedInodes = 0;
+    __atomic_add_fetch(&inodeGeneration, 1, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&inodeLock);
+}
+
+// 비트맵에서 inode를 한 묶음 받아 온다. 작은 번호부터 나가도록 거꾸로 쌓는다.
+static void refillInodeCache(InodeCache* cache) {
+    int batch[INODE_CACHE_SIZE];
+    int count = 0;
+    pthread_mutex_lock(&inodeLock);
+    cache->generation = __atomic_load_n(&inodeGeneration, __ATOMIC_RELAXED);
+    while (count < INODE_CACHE_SIZE) {
+        long index = bitmapAllocate(&inodeTable.allocated);
+        if (index < 0) {
+            size_t oldCount = inodeTable.allocated.bitCount;
+            if (!growInodeTable()) {
+                break;
+            }
+            inodeTable.allocated.hint = oldCount / 64; // 새로 늘린 영역부터 찾는다
+            continue;
+        }
+        // 이전 세션에서 쓰던 번호면 해제된 노드를 가리키고 있다. 받아 두기만 하고 쓰지 않는 동안에도
+        // 비트맵에는 할당된 것으로 보이므로, 훑는 쪽이 파일로 보지 않도록 노드와 타입을 지운다.
+        getInode((int)index)->node = NULL;
+        INODE_TYPE(index) = DIR_TYPE;
+        batch[count++] = (int)index;
+    }
+    pthread_mutex_unlock(&inodeLock);
+    for (int i = 0; i < count; i++) {
+        cache->inodes[i] = batch[count - 1 - i];
+    }
+    cache->count = count;
+}
 
 int allocateInode() {
-    for (int i = 0; i < MAX_INODES; i++) {
-        if (!inodeTable.isAllocated[i]) {
-            inodeTable.isAllocated[i] = true;
-            superblock.usedInodes++;
-            printf("Inode %d 가 할당되었습니다.\n", i);
-            return i;
+    InodeCache* cache = &threadInodes;
+    if (cache->generation != __atomic_load_n(&inodeGeneration, __ATOMIC_ACQUIRE)) {
+        cache->count = 0; // 파일 시스템을 다시 초기화하기 전에 받아 둔 번호
+    }
+    if (cache->count == 0) {
+        refillInodeCache(cache);
+        if (cache->count == 0) {
+            printf("더 이상 할당 가능한 inode가 없습니다.\n");
+            return -1;
         }
     }
-    printf("더 이상 할당 가능한 inode가 없습니다.\n");
-    return -1;
+    int index = cache->inodes[--cache->count];
+    __atomic_add_fetch(&superblock.usedInodes, 1, __ATOMIC_RELAXED);
+    STATS_COUNT(inodeAllocations);
+    FS_NOTICE("Inode %d 가 할당되었습니다.\n", index);
+    return index;
 }
 
-Node* createNode(const char* name, NodeType type, Node* parent) {
-    Node* newNode = (Node*)malloc(sizeof(Node));
+// 스레드가 받아 두고 쓰지 않은 inode를 돌려준다. 작업 스레드는 끝나기 전에 부른다.
+void releaseThreadInodes() {
+    InodeCache* cache = &threadInodes;
+    pthread_mutex_lock(&inodeLock);
+    if (cache->generation == inodeGeneration) {
+        for (int i = 0; i < cache->count; i++) {
+            bitmapClear(&inodeTable.allocated, cache->inodes[i]);
+        }
+    }
+    pthread_mutex_unlock(&inodeLock);
+    cache->count = 0;
+}
+
+// 이미 할당된 inode로 노드 객체를 만든다. inode 내용은 건드리지 않는다.
+static Node* newNodeObject(const char* name, NodeType type, Node* parent, int inodeIndex) {
+    Node* newNode = (Node*)slabAlloc(&nodeCache);
     newNode->type = type;
     newNode->parent = parent;
+    newNode->prevSibling = NULL;
+    newNode->nextSibling = NULL;
+    newNode->serial = __atomic_fetch_add(&nextNodeSerial, 1, __ATOMIC_RELAXED);
+    newNode->inode = inodeIndex;
+    newNode->name = stringPoolIntern(&namePool, name);
+    newNode->dir = NULL;
+    getInode(inodeIndex)->node = newNode;
+    INODE_PARENT(inodeIndex) = parent != NULL ? parent->inode : -1;
+    INODE_TYPE(inodeIndex) = (unsigned char)type;
+
+    if (type == DIR_TYPE) {
+        Directory* dir = (Directory*)slabAlloc(&dirCache);
+        dirLockInit(&dir->lock);
+        dir->firstChild = NULL;
+        dir->lastChild = NULL;
+        dir->index.slots = NULL;
+        dir->index.capacity = 0;
+        dir->index.count = 0;
+        dir->childCount = 0;
+        dir->subtreeBytes = 0;
+        dir->subtreeFiles = 0;
+        newNode->dir = dir;
+    }
+    return newNode;
+}
 
+Node* createNode(const char* name, NodeType type, Node* parent) {
     int inodeIndex = allocateInode();
     if (inodeIndex == -1) {
         printf("더 이상 할당 가능한 inode가 없습니다.\n");
-        free(newNode);
         return NULL;
     }
-    time_t currentTime = time(NULL);
+    Node* newNode = newNodeObject(name, type, parent, inodeIndex);
+    time_t currentTime = commandTime();
     
     if (type == DIR_TYPE) {
-        strcpy(newNode->dir.name, name);
-        newNode->dir.childCount = 0;
-        newNode->dir.inodeIndex = inodeIndex;
-        inodeTable.inodes[inodeIndex].fileSize = 0; 
-        inodeTable.inodes[inodeIndex].created = currentTime;
-        inodeTable.inodes[inodeIndex].modified = currentTime;
-        inodeTable.inodes[inodeIndex].linkCount = 0; 
-
-        newNode->dir.inode = inodeTable.inodes[inodeIndex];
+        INODE_SIZE(inodeIndex) = 0; 
+        INODE_CREATED(inodeIndex) = currentTime;
+        INODE_MODIFIED(inodeIndex) = currentTime;
+        INODE_LINKS(inodeIndex) = 0; 
+    } else {
+        INODE_SIZE(inodeIndex) = 0; // 빈 파일, 블록은 내용을 쓸 때 할당한다
+        INODE_CREATED(inodeIndex) = currentTime;
+        INODE_MODIFIED(inodeIndex) = currentTime;
+        INODE_LINKS(inodeIndex) = 1; 
+    }
+
+    return newNode;
+}
+
+// 지정한 번호의 inode를 사용 중으로 표시한다 (이미지 불러오기용). 필요하면 테이블을 늘린다.
+// 이미 쓰이는 번호면 (이미지에 같은 inode가 두 번 나오면) false다.
+static bool reserveInode(int index) {
+    while ((size_t)index >= inodeTable.allocated.bitCount) {
+        if (!growInodeTable()) {
+            return false;
+        }
+    }
+    if (bitmapTest(&inodeTable.allocated, index)) {
+        return false;
+    }
+    bitmapSet(&inodeTable.allocated, index);
+    superblock.usedInodes++;
+    return true;
+}
+
+// 저장된 inode 번호를 그대로 써서 노드를 되살린다. inode 내용은 호출자가 채운다.
+Node* restoreNode(const char* name, NodeType type, int inodeIndex) {
+    pthread_mutex_lock(&inodeLock);
+    bool reserved = reserveInode(inodeIndex);
+    pthread_mutex_unlock(&inodeLock);
+    if (!reserved) {
+        return NULL;
+    }
+    return newNodeObject(name, type, NULL, inodeIndex);
+}
+
+void freeInode(int index) {
+    pthread_mutex_lock(&inodeLock);
+    bool allocated = index >= 0 && bitmapTest(&inodeTable.allocated, index);
+    pthread_mutex_unlock(&inodeLock);
+    if (!allocated) {
+        return;
+    }
+    fileRelease(getInode(index)); // inode가 가진 데이터 블록도 함께 반납
+    ngramRemoveFile(index);
+    metaIndexRemove(index); // 이름을 반납하기 전에 뺀다
+    getInode(index)->node = NULL;
+    pthread_mutex_lock(&inodeLock);
+    bitmapClear(&inodeTable.allocated, index);
+    pthread_mutex_unlock(&inodeLock);
+    __atomic_sub_fetch(&superblock.usedInodes, 1, __ATOMIC_RELAXED);
+    STATS_COUNT(inodeFrees);
+    FS_NOTICE("Inode %d 가 해제되었습니다.\n", index);
+}
+
+static Inode* nodeInode(const Node* node) {
+    return getInode(node->inode);
+}
+
+// FNV-1a 해시에 타입을 섞어서, 같은 이름의 파일과 디렉터리가 서로 다른 키가 되도록 한다.
+static unsigned int hashChildKey(const char* name, NodeType type) {
+    unsigned int hash = 2166136261u;
+    for (const unsigned char* p = (const unsigned char*)name; *p; p++) {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+    hash ^= (unsigned int)type + 1;
+    hash *= 16777619u;
+    return hash;
+}
+
+static void indexPut(ChildIndex* index, unsigned int hash, Node* child) {
+    int mask = index->capacity - 1;
+    int slot = hash & mask;
+    while (index->slots[slot].node != NULL) {
+        slot = (slot + 1) & mask;
+    }
+    // 잠그지 않고 읽는 쪽(indexFindOptimistic)과 겹칠 수 있는 슬롯 쓰기는 원자적으로 한다
+    __atomic_store_n(&index->slots[slot].hash, hash, __ATOMIC_RELAXED);
+    __atomic_store_n(&index->slots[slot].node, child, __ATOMIC_RELAXED);
+    index->count++;
+}
+
+// 예전 배열은 retireSlots로 넘긴다. 잠그지 않고 읽는 쪽이 (새 배열, 예전 용량)을 볼 수는 있어도
+// (예전 배열, 새 용량)을 보지는 않도록 배열을 먼저, 용량을 나중에 바꾼다.
+static void retireSlots(ChildSlot* slots);
+
+static void indexGrow(ChildIndex* index) {
+    ChildSlot* oldSlots = index->slots;
+    int oldCapacity = index->capacity;
+    ChildIndex grown = {NULL, oldCapacity == 0 ? 8 : oldCapacity * 2, 0};
+
+    grown.slots = (ChildSlot*)calloc(grown.capacity, sizeof(ChildSlot));
+    for (int i = 0; i < oldCapacity; i++) {
+        if (oldSlots[i].node != NULL) {
+            indexPut(&grown, oldSlots[i].hash, oldSlots[i].node);
+        }
+    }
+    __atomic_store_n(&index->slots, grown.slots, __ATOMIC_RELEASE);
+    __atomic_store_n(&index->capacity, grown.capacity, __ATOMIC_RELEASE);
+    if (oldSlots != NULL) {
+        retireSlots(oldSlots);
+    }
+}
+
+// 부하율을 3/4 이하로 유지한다.
+static void indexInsert(ChildIndex* index, Node* child) {
+    if ((index->count + 1) * 4 > index->capacity * 3) {
+        indexGrow(index);
+    }
+    indexPut(index, hashChildKey(child->name, child->type), child);
+}
+
+static int indexFind(const ChildIndex* index, const char* name, NodeType type) {
+    if (index->count == 0) {
+        return -1;
+    }
+    unsigned int hash = hashChildKey(name, type);
+    int mask = index->capacity - 1;
+    for (int slot = hash & mask; index->slots[slot].node != NULL; slot = (slot + 1) & mask) {
+        Node* child = index->slots[slot].node;
+        if (index->slots[slot].hash == hash && child->type == type && strcmp(child->name, name) == 0) {
+            return slot;
+        }
+    }
+    return -1;
+}
+
+// 디렉터리 잠금 없이 찾는다. 쓰는 쪽과 겹치면 엉뚱한 값을 볼 수 있으므로 결과는 호출자가
+// 시퀀스로 확인한다. 그래도 배열 밖을 읽거나 끝없이 돌지는 않도록 용량 안에서만 탐사한다.
+static Node* indexFindOptimistic(const ChildIndex* index, const char* name, NodeType type) {
+    int capacity = __atomic_load_n(&index->capacity, __ATOMIC_ACQUIRE);
+    ChildSlot* slots = __atomic_load_n(&index->slots, __ATOMIC_ACQUIRE);
+    if (capacity == 0) {
+        return NULL;
+    }
+    unsigned int hash = hashChildKey(name, type);
+    int mask = capacity - 1;
+    int slot = hash & mask;
+    for (int probes = 0; probes < capacity; probes++, slot = (slot + 1) & mask) {
+        Node* child = __atomic_load_n(&slots[slot].node, __ATOMIC_RELAXED);
+        if (child == NULL) {
+            break;
+        }
+        if (__atomic_load_n(&slots[slot].hash, __ATOMIC_RELAXED) == hash && child->type == type && strncmp(__atomic_load_n(&child->name, __ATOMIC_RELAXED), name, NODE_NAME_SIZE) == 0) {
+            return child;
+        }
+    }
+    return NULL;
+}
+
+// 툼스톤 없이 삭제: 빈 슬롯 뒤에 이어지는 항목 중 원래 자리(hash)로 보아
+// 빈 슬롯보다 앞에 있어야 하는 항목을 당겨 와서 탐사 체인이 끊어지지 않게 한다.
+static void indexRemoveSlot(ChildIndex* index, int hole) {
+    int mask = index->capacity - 1;
+    int slot = hole;
+    while (1) {
+        slot = (slot + 1) & mask;
+        if (index->slots[slot].node == NULL) {
+            break;
+        }
+        int home = index->slots[slot].hash & mask;
+        // home이 (hole, slot] 구간 밖에 있으면 hole 자리로 옮겨도 탐사 경로에 포함된다.
+        bool movable = hole <= slot ? (home <= hole || home > slot) : (home <= hole && home > slot);
+        if (movable) {
+            __atomic_store_n(&index->slots[hole].hash, index->slots[slot].hash, __ATOMIC_RELAXED);
+            __atomic_store_n(&index->slots[hole].node, index->slots[slot].node, __ATOMIC_RELAXED);
+            hole = slot;
+        }
+    }
+    __atomic_store_n(&index->slots[hole].node, NULL, __ATOMIC_RELAXED);
+    index->count--;
+}
+
+// 디렉터리 잠금(읽기든 쓰기든)을 쥔 쪽이 쓴다.
+static Node* findChildLocked(Node* parent, const char* name, NodeType type) {
+    int slot = indexFind(&parent->dir->index, name, type);
+    return slot < 0 ? NULL : parent->dir->index.slots[slot].node;
+}
+
+// 먼저 잠그지 않고 찾아 보고(seqlock), 그동안 디렉터리가 바뀌었으면 다시 한다.
+// 쓰는 쪽이 오래 잡고 있으면 읽기 잠금을 잡고 찾는다.
+Node* findChild(Node* parent, const char* name, NodeType type) {
+    if (parent->type != DIR_TYPE) {
+        return NULL;
+    }
+    DirLock* lock = &parent->dir->lock;
+    for (int attempt = 0; attempt < OPTIMISTIC_ATTEMPTS; attempt++) {
+        unsigned int start = dirReadBegin(lock);
+        if (start & 1) {
+            continue;
+        }
+        Node* found = indexFindOptimistic(&parent->dir->index, name, type);
+        if (!dirReadRetry(lock, start)) {
+            return found;
+        }
+    }
+    dirReadLock(lock);
+    Node* found = findChildLocked(parent, name, type);
+    dirReadUnlock(lock);
+    return found;
+}
+
+static bool isLinked(Node* node);
+
+// 파일 크기/개수 변화를 부모 디렉터리를 따라 올라가며 반영한다. 아직 트리에 붙지 않은
+// 디렉터리(복사 중인 사본 등)에서 멈추고, 나머지는 그 디렉터리를 붙일 때 addChild가 반영한다.
+// 다른 디렉터리를 바꾸는 스레드들도 같은 조상을 갱신하므로 원자적으로 더한다 (잠그지 않는다).
+static void propagateSize(Node* dir, long bytesDelta, long filesDelta) {
+    while (dir != NULL) {
+        __atomic_add_fetch(&dir->dir->subtreeBytes, bytesDelta, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&dir->dir->subtreeFiles, filesDelta, __ATOMIC_RELAXED);
+        if (!isLinked(dir)) {
+            break;
+        }
+        dir = dir->parent;
+    }
+}
+
+// 노드가 들고 있는 크기/파일 수 (파일은 자기 크기와 1, 디렉터리는 집계값)
+static void subtreeTotals(Node* node, long* bytes, long* files) {
+    if (node->type == FILE_TYPE) {
+        *bytes = INODE_SIZE(node->inode);
+        *files = 1;
     } else {
-        strcpy(newNode->file.name, name);
-        memset(newNode->file.content, 0, sizeof(newNode->file.content));
-        newNode->file.inodeIndex = inodeIndex;
-        inodeTable.inodes[inodeIndex].fileSize = strlen(newNode->file.content);
-        inodeTable.inodes[inodeIndex].created = currentTime;
-        inodeTable.inodes[inodeIndex].modified = currentTime;
-        inodeTable.inodes[inodeIndex].linkCount = 1; 
+        *bytes = node->dir->subtreeBytes;
+        *files = node->dir->subtreeFiles;
+    }
+}
+
+// 부모의 자식 목록에 실제로 연결되어 있는지 (createNode 직후, addChild 전이면 false)
+static bool isLinked(Node* node) {
+    return node->parent != NULL && (node->prevSibling != NULL || node->parent->dir->firstChild == node);
+}
 
-        newNode->file.inode = inodeTable.inodes[inodeIndex];
+// 부모 쓰기 잠금을 쥔 채로 부른다. 크기 집계는 호출자가 잠금을 놓은 뒤 반영한다.
+static void linkChild(Node* parent, Node* child) {
+    indexInsert(&parent->dir->index, child);
+    dcacheInvalidate(parent->serial, child->name, child->type); // 음성 캐시 항목 제거
+
+    child->parent = parent;
+    INODE_PARENT(child->inode) = parent->inode;
+    child->prevSibling = parent->dir->lastChild;
+    child->nextSibling = NULL;
+    if (parent->dir->lastChild != NULL) {
+        parent->dir->lastChild->nextSibling = child;
+    } else {
+        parent->dir->firstChild = child;
+    }
+    parent->dir->lastChild = child;
+    __atomic_store_n(&parent->dir->childCount, parent->dir->childCount + 1, __ATOMIC_RELAXED); // 병렬 탐색이 잠그지 않고 읽는다
+}
+
+// 집계에 더할 값은 연결하기 전에 읽는다. 연결된 뒤에 다른 스레드가 바꾼 크기는 그쪽이 반영한다.
+void addChild(Node* parent, Node* child) {
+    long bytes, files;
+    subtreeTotals(child, &bytes, &files);
+    dirWriteLock(&parent->dir->lock);
+    linkChild(parent, child);
+    dirWriteUnlock(&parent->dir->lock);
+    propagateSize(parent, bytes, files);
+}
+
+// 불러온 노드를 연결한다. 집계값은 다 붙인 뒤 recomputeAggregates로 한 번에 계산한다.
+void attachRestoredChild(Node* parent, Node* child) {
+    indexInsert(&parent->dir->index, child);
+    child->parent = parent;
+    INODE_PARENT(child->inode) = parent->inode;
+    child->prevSibling = parent->dir->lastChild;
+    child->nextSibling = NULL;
+    if (parent->dir->lastChild != NULL) {
+        parent->dir->lastChild->nextSibling = child;
+    } else {
+        parent->dir->firstChild = child;
+    }
+    parent->dir->lastChild = child;
+    parent->dir->childCount++;
+}
+
+static WalkAction enterAny(Node* node, int depth, void* state) {
+    return WALK_CONTINUE;
+}
+
+// 후위 순서로 불리므로 하위 디렉터리의 집계는 이미 끝나 있다.
+static void sumChildren(Node* dir, int depth, void* state) {
+    dir->dir->subtreeBytes = 0;
+    dir->dir->subtreeFiles = 0;
+    for (Node* child = dir->dir->firstChild; child != NULL; child = child->nextSibling) {
+        long bytes, files;
+        subtreeTotals(child, &bytes, &files);
+        dir->dir->subtreeBytes += bytes;
+        dir->dir->subtreeFiles += files;
+    }
+}
+
+// 이미지를 불러온 직후 혼자 쓰는 동안 부르므로 잠그지 않는다.
+void recomputeAggregates(Node* node) {
+    walkTree(node, 0, enterAny, sumChildren, NULL);
+}
+
+// 자식 노드를 인덱스와 연결 리스트에서 떼어낸다. 노드 자체는 해제하지 않는다.
+void removeChild(Node* parent, Node* child) {
+    dirWriteLock(&parent->dir->lock);
+    int slot = indexFind(&parent->dir->index, child->name, child->type);
+    if (slot >= 0) {
+        indexRemoveSlot(&parent->dir->index, slot);
+    }
+    dcacheInvalidate(parent->serial, child->name, child->type);
+
+    long bytes, files;
+    subtreeTotals(child, &bytes, &files);
+    propagateSize(parent, -bytes, -files);
+
+    if (child->prevSibling != NULL) {
+        child->prevSibling->nextSibling = child->nextSibling;
+    } else {
+        parent->dir->firstChild = child->nextSibling;
+    }
+    if (child->nextSibling != NULL) {
+        child->nextSibling->prevSibling = child->prevSibling;
+    } else {
+        parent->dir->lastChild = child->prevSibling;
+    }
+    child->prevSibling = NULL;
+    child->nextSibling = NULL;
+    __atomic_store_n(&parent->dir->childCount, parent->dir->childCount - 1, __ATOMIC_RELAXED);
+    dirWriteUnlock(&parent->dir->lock);
+}
+
+
+typedef struct PrintState {
+    TextBuffer text;
+    int level;
+} PrintState;
+
+static void initPrintState(void* state, void* context) {
+    PrintState* print = (PrintState*)state;
+    textInit(&print->text);
+    print->level = *(int*)context;
+}
+
+static void flushPrintState(void* state, void* context) {
+    PrintState* print = (PrintState*)state;
+    textFlush(&print->text, stdout);
+    textFree(&print->text);
+}
+
+static WalkAction printNode(Node* node, int depth, void* state) {
+    PrintState* print = (PrintState*)state;
+    int indent = (print->level + depth) * 2;
+    if (node->type == DIR_TYPE) {
+        textPrintf(&print->text, "%*s%s/\n", indent, "", node->name);
+    } else {
+        textPrintf(&print->text, "%*s%s\n", indent, "", node->name);
+    }
+    return WALK_CONTINUE;
+}
+
+// 조각마다 글을 모아 두었다가 트리 순서대로 내보낸다.
+void printTree(Node* node, int level) {
+    ParallelWalk walk = {printNode, sizeof(PrintState), initPrintState, flushPrintState, &level};
+    walkTreeParallel(node, &walk);
+}
+
+// 해제한 객체는 첫 워드로 이어 붙여 하나의 체인으로 모은다.
+typedef struct NodeChain {
+    void* head;
+    void* tail;
+    unsigned long count;
+} NodeChain;
+
+typedef struct ReleaseChains {
+    NodeChain nodes;
+    NodeChain dirs; // 디렉터리 상태 (Directory)
+} ReleaseChains;
+
+static void chainObject(NodeChain* chain, void* object) {
+    *(void**)object = chain->head; // 이 시점부터 객체 내용은 쓰지 않는다
+    chain->head = object;
+    if (chain->tail == NULL) {
+        chain->tail = object;
+    }
+    chain->count++;
+}
+
+static void chainNode(ReleaseChains* chains, Node* node) {
+    freeInode(node->inode);
+    stringPoolRelease(&namePool, node->name);
+    if (node->dir != NULL) {
+        chainObject(&chains->dirs, node->dir);
+    }
+    chainObject(&chains->nodes, node);
+}
+
+static WalkAction releaseFile(Node* node, int depth, void* state) {
+    if (node->type == FILE_TYPE) {
+        chainNode((ReleaseChains*)state, node);
+    }
+    return WALK_CONTINUE;
+}
+
+static void releaseDirectory(Node* dir, int depth, void* state) {
+    free(dir->dir->index.slots);
+    chainNode((ReleaseChains*)state, dir);
+}
+
+// 노드 메모리는 하나씩 free하지 않고 서브트리 전체를 slab에 한 번에 돌려준다.
+// 단독으로 들어온 상태에서 부르므로 잠그지 않는다. 반납은 inode/slab 잠금에서 어차피 한 줄로 서므로
+// 나눠 돌리지 않고 한 스레드에서 명시적 스택으로 훑는다 (깊은 트리에서도 C 스택을 쓰지 않는다).
+void freeTree(Node* node) {
+    ReleaseChains chains = {{NULL, NULL, 0}, {NULL, NULL, 0}};
+    walkTree(node, 0, releaseFile, releaseDirectory, &chains);
+    slabFreeChain(&nodeCache, chains.nodes.head, chains.nodes.tail, chains.nodes.count);
+    slabFreeChain(&dirCache, chains.dirs.head, chains.dirs.tail, chains.dirs.count);
+}
+
+// 노드가 따로 malloc한 메모리(자식 인덱스, extent 목록)만 정리한다.
+static WalkAction discardNodeMemory(Node* node, int depth, void* state) {
+    if (node->type == DIR_TYPE) {
+        free(node->dir->index.slots); // 훑기는 형제 목록을 따라가므로 인덱스는 먼저 해제해도 된다
+    } else {
+        ExtentList* extents = &getInode(node->inode)->extents;
+        free(extents->extents);
+        extents->extents = NULL;
+        extents->count = extents->capacity = 0;
+    }
+    return WALK_CONTINUE;
+}
+
+// 늦게 읽는 쪽이 아직 볼 수 있으므로 예전 배열의 내용은 건드리지 않는다.
+static void retireSlots(ChildSlot* slots) {
+    RetiredSlots* retired = (RetiredSlots*)malloc(sizeof(RetiredSlots));
+    retired->slots = slots;
+    pthread_mutex_lock(&retiredLock);
+    retired->next = retiredSlots;
+    retiredSlots = retired;
+    pthread_mutex_unlock(&retiredLock);
+}
+
+static void freeRetiredSlots() {
+    pthread_mutex_lock(&retiredLock);
+    RetiredSlots* retired = retiredSlots;
+    retiredSlots = NULL;
+    pthread_mutex_unlock(&retiredLock);
+    while (retired != NULL) {
+        RetiredSlots* next = retired->next;
+        free(retired->slots);
+        free(retired);
+        retired = next;
+    }
+}
+
+void fsEnterShared() {
+    brReadLock(&namespaceLock);
+}
+
+void fsExitShared() {
+    brReadUnlock(&namespaceLock);
+}
+
+// 들어와 있는 스레드가 모두 나간 뒤에 돌아오므로, 모아 둔 슬롯 배열도 이때 해제한다.
+void fsEnterExclusive() {
+    brWriteLock(&namespaceLock);
+    freeRetiredSlots();
+}
+
+void fsExitExclusive() {
+    brWriteUnlock(&namespaceLock);
+}
+
+void initFileSystem() {
+    if (nodeCache.objectSize == 0) {
+        slabCacheInit(&nodeCache, "node", sizeof(Node), NODES_PER_SLAB);
+        slabCacheInit(&dirCache, "directory", sizeof(Directory), NODES_PER_SLAB);
+        stringPoolInit(&namePool);
+        workPoolSetThreadExit(releaseThreadInodes); // 작업 스레드가 받아 두고 쓰지 않은 inode 번호를 돌려준다
+    }
+    // InodeTable, 블록 저장소 초기화 (superblock의 inode/블록 수도 함께 설정된다)
+    initInodeTable();
+    initBlockStore();
+}
+
+// 파일 시스템 전체를 내린다. inode/블록 테이블은 통째로 초기화하고
+// 노드 slab은 arena처럼 한꺼번에 비우므로, 노드마다 inode/블록/노드를 반납하지 않는다.
+void destroyFileSystem(Node* root) {
+    fs_close_all();
+    walkTree(root, 0, discardNodeMemory, NULL, NULL);
+    freeRetiredSlots();
+    slabReleaseAll(&nodeCache);
+    slabReleaseAll(&dirCache);
+    metaIndexReset();
+    __atomic_store_n(&metaIndexStale, false, __ATOMIC_RELEASE);
+    stringPoolReset(&namePool);
+    ngramReset();
+    __atomic_store_n(&contentIndexStale, false, __ATOMIC_RELEASE);
+    clearContentDirty();
+    initInodeTable();
+    initBlockStore();
+}
+
+void printMemoryStats() {
+    SlabStats stats = slabGetStats(&nodeCache);
+    printf("노드 slab: 객체 크기 %zu bytes, slab당 %zu개\n", nodeCache.objectSize, nodeCache.objectsPerSlab);
+    printf("  사용 중 %lu개 (최대 %lu개), 누적 할당 %lu회, 누적 해제 %lu회, 일괄 해제 %lu회\n",
+           stats.inUse, stats.peakInUse, stats.allocations, stats.frees, stats.bulkReleases);
+    printf("  slab %lu개, 확보한 메모리 %lu bytes\n", stats.slabCount, stats.bytesReserved);
+    SlabStats dirStats = slabGetStats(&dirCache);
+    printf("디렉터리 slab: 객체 크기 %zu bytes, 사용 중 %lu개, 확보한 메모리 %lu bytes\n", dirCache.objectSize,
+           dirStats.inUse, dirStats.bytesReserved);
+    StringPoolStats names = stringPoolGetStats(&namePool);
+    printf("이름 표: 이름 %lu개 (노드 %lu개가 참조), 다시 쓴 이름 %lu회, 사용 %zu bytes, 확보한 메모리 %zu bytes\n",
+           names.strings, names.references, names.hits, names.bytesUsed, names.bytesReserved);
+    printf("inode: %d / %d 사용, 블록: %d / %d 사용 (블록 크기 %d bytes)\n",
+           superblock.usedInodes, superblock.totalInodes, superblock.usedBlocks, superblock.totalBlocks, BLOCK_SIZE);
+    if (cacheIsOpen()) {
+        CacheStats cache = cacheGetStats();
+        unsigned long lookups = cache.hits + cache.misses;
+        printf("버퍼 캐시: %zu페이지 (%zu bytes), 적중 %lu회, 미스 %lu회 (적중률 %.1f%%), 미리 읽기 %lu페이지\n",
+               cache.pages, cache.pages * CACHE_PAGE_BYTES, cache.hits, cache.misses,
+               lookups > 0 ? 100.0 * cache.hits / lookups : 0.0, cache.readahead);
+        printf("  내보냄 %lu페이지, 기록 %lu페이지 (pwritev %lu회), 더러운 페이지 %zu개\n",
+               cache.evictions, cache.writebacks, cache.writeCalls, cache.dirty);
+    }
+    CompressStats compress = compressGetStats();
+    if (compress.files > 0 || compress.frameMisses > 0) {
+        printf("압축: 파일 %lu개 (%llu bytes -> %llu bytes), 푼 프레임 %lu개, 프레임 캐시 적중 %lu회\n", compress.files,
+               compress.rawBytes, compress.storedBytes, compress.frameMisses, compress.frameHits);
+    }
+    MetaIndexStats meta = metaIndexGetStats();
+    bool metaStale = __atomic_load_n(&metaIndexStale, __ATOMIC_ACQUIRE);
+    printf("메타데이터 색인: 파일 %ld개, %zu bytes%s\n", meta.files, meta.bytes, metaStale ? " (다음 find 때 다시 만듦)" : "");
+}
+
+// 파일들이 가리키는 블록 수와 실제로 쓰는 블록 수를 비교해 중복 제거(공유) 비율과 아낀 메모리를 보여 준다.
+// 복사(copy-on-write)로 함께 쓰는 블록도 포함한다. 모든 inode를 읽으므로 단독으로 들어와서 부른다.
+void printDedupStats() {
+    long files = 0;
+    long long logicalBytes = 0, referencedBlocks = 0;
+    for (size_t index = 0; index < inodeTable.allocated.bitCount; index++) {
+        if (!bitmapTest(&inodeTable.allocated, index)) {
+            continue;
+        }
+        if (INODE_TYPE(index) != FILE_TYPE) {
+            continue;
+        }
+        Inode* inode = getInode(index);
+        if (inode->node == NULL) {
+            continue;
+        }
+        files++;
+        logicalBytes += INODE_SIZE(index);
+        for (int i = 0; i < inode->extents.count; i++) {
+            referencedBlocks += inode->extents.extents[i].count;
+        }
+    }
+    long long usedBlocks = superblock.usedBlocks;
+    long long savedBytes = (referencedBlocks - usedBlocks) * BLOCK_SIZE;
+    printf("파일 %ld개, 내용 %lld bytes, 파일이 가리키는 블록 %lld개, 실제로 쓰는 블록 %lld개\n", files, logicalBytes,
+           referencedBlocks, usedBlocks);
+    printf("중복 제거 비율 %.2f:1, 아낀 메모리 %lld bytes\n",
+           usedBlocks > 0 ? (double)referencedBlocks / usedBlocks : 1.0, savedBytes > 0 ? savedBytes : 0);
+    DedupStats stats = dedupGetStats();
+    printf("내용 표: blob %ld개 (%zu bytes), 조회 %lu회, 같은 내용 %lu회 (%llu bytes 공유), 해시만 같은 내용 %lu회\n",
+           stats.blobs, stats.tableBytes, stats.lookups, stats.hits, stats.sharedBytes, stats.mismatches);
+}
+
+typedef struct FindState {
+    const char* name;
+    NodeType type;
+    Node* found;
+} FindState;
+
+static WalkAction matchNode(Node* node, int depth, void* state) {
+    FindState* find = (FindState*)state;
+    if (node->type == find->type && strcmp(node->name, find->name) == 0) {
+        find->found = node;
+        return WALK_STOP;
+    }
+    return WALK_CONTINUE;
+}
+
+Node* findNode(Node* node, const char* name, NodeType type) {
+    FindState find = {name, type, NULL};
+    walkTree(node, WALK_LOCKED, matchNode, NULL, &find);
+    return find.found;
+}
+
+// 덴트리 캐시를 먼저 확인하고, 없으면 디렉터리 인덱스에서 찾아 결과(없음 포함)를 캐시한다.
+Node* lookupChild(Node* parent, const char* name, NodeType type) {
+    Node* result = NULL;
+    switch (dcacheLookup(parent->serial, name, type, &result)) {
+    case DCACHE_HIT:
+        return result;
+    case DCACHE_NEGATIVE:
+        return NULL;
+    case DCACHE_MISS:
+        break;
+    }
+    // 찾는 동안 디렉터리가 바뀌었으면 결과를 캐시하지 않는다 (낡은 음성 항목이 남지 않도록)
+    unsigned int observed = dirReadBegin(&parent->dir->lock);
+    result = findChild(parent, name, type);
+    if ((observed & 1) == 0) {
+        dcacheInsert(parent->serial, name, type, result, &parent->dir->lock.sequence, observed);
+    }
+    return result;
+}
+
+// "/a/b/c" 형태의 경로를 루트부터 한 단계씩 따라간다. 마지막 구성 요소는 type이어야 하고,
+// 중간 구성 요소는 모두 디렉터리여야 한다. 앞의 '/'는 생략할 수 있고, "." 과 ".." 도 지원한다.
+// 이전 방식과의 호환을 위해 "root" 한 단어는 루트 디렉터리를 뜻한다.
+Node* resolvePath(Node* root, const char* path, NodeType type) {
+    if (strcmp(path, "root") == 0) {
+        return type == DIR_TYPE ? root : NULL;
+    }
+    Node* current = root;
+    const char* p = path;
+    char component[100];
+    int depth = 0; // 실제로 찾아본 구성 요소 수
+
+    while (1) {
+        while (*p == '/') {
+            p++;
+        }
+        if (*p == '\0') {
+            break;
+        }
+        const char* end = strchr(p, '/');
+        size_t length = end ? (size_t)(end - p) : strlen(p);
+        if (length >= sizeof(component)) {
+            return NULL;
+        }
+        memcpy(component, p, length);
+        component[length] = '\0';
+        p += length;
+
+        while (*p == '/') {
+            p++;
+        }
+        bool last = (*p == '\0');
+        if (strcmp(component, ".") == 0) {
+            continue;
+        }
+        if (strcmp(component, "..") == 0) {
+            if (current->parent != NULL) {
+                current = current->parent;
+            }
+            continue;
+        }
+        current = lookupChild(current, component, last ? type : DIR_TYPE);
+        depth++;
+        if (current == NULL) {
+            STATS_RECORD_LOOKUP(depth);
+            return NULL;
+        }
+    }
+    STATS_RECORD_LOOKUP(depth);
+    return current->type == type ? current : NULL;
+}
+
+// 일부만 고친 파일은 바로 다시 색인하지 않고 표시만 해 둔다. 다음 검색이 표시된 파일만 다시 읽어 색인하므로
+// 작은 쓰기가 파일 전체를 읽지 않고, 검색 사이의 여러 번의 쓰기는 한 번에 반영된다.
+static void markContentDirty(int inode) {
+    pthread_mutex_lock(&contentDirty.lock);
+    bitmapGrow(&contentDirty.marked, (size_t)inode + 1);
+    if (!bitmapTest(&contentDirty.marked, inode)) {
+        bitmapSet(&contentDirty.marked, inode);
+        if (contentDirty.count == contentDirty.capacity) {
+            contentDirty.capacity = contentDirty.capacity == 0 ? 64 : contentDirty.capacity * 2;
+            contentDirty.inodes = (int*)realloc(contentDirty.inodes, contentDirty.capacity * sizeof(int));
+        }
+        contentDirty.inodes[contentDirty.count++] = inode;
+    }
+    pthread_mutex_unlock(&contentDirty.lock);
+}
+
+static void clearContentDirty() {
+    pthread_mutex_lock(&contentDirty.lock);
+    bitmapDestroy(&contentDirty.marked);
+    free(contentDirty.inodes);
+    contentDirty.inodes = NULL;
+    contentDirty.count = contentDirty.capacity = 0;
+    pthread_mutex_unlock(&contentDirty.lock);
+}
+
+// 표시된 파일을 다시 색인한다. 목록을 떼어 온 뒤 파일마다 그 디렉터리의 읽기 잠금 안에서 읽으므로
+// 함께 들어온 명령과 겹쳐도 된다. 그 사이 다시 고친 파일은 다시 표시되어 다음 검색이 반영한다.
+static void reindexDirtyContent() {
+    pthread_mutex_lock(&contentDirty.lock);
+    int* inodes = contentDirty.inodes;
+    int count = contentDirty.count;
+    for (int i = 0; i < count; i++) {
+        bitmapClear(&contentDirty.marked, inodes[i]);
+    }
+    contentDirty.inodes = NULL;
+    contentDirty.count = contentDirty.capacity = 0;
+    pthread_mutex_unlock(&contentDirty.lock);
+
+    for (int i = 0; i < count; i++) {
+        Node* node = getInode(inodes[i])->node;
+        if (node == NULL || node->type != FILE_TYPE || node->parent == NULL) {
+            continue; // 그 사이 지워졌다
+        }
+        dirReadLock(&node->parent->dir->lock);
+        char* content = loadFileContent(node);
+        ngramIndexFile(inodes[i], content, (size_t)INODE_SIZE(node->inode));
+        dirReadUnlock(&node->parent->dir->lock);
+        free(content);
+    }
+    free(inodes);
+}
+
+// 파일의 이름, 크기, 시간을 메타데이터 색인에 넣는다. 파일이 든 디렉터리의 쓰기 잠금을 쥔 채로 부른다.
+static void indexFileMetadata(Node* fileNode) {
+    int index = fileNode->inode;
+    metaIndexPut(index, fileNode->name, INODE_SIZE(index), INODE_MODIFIED(index), INODE_CREATED(index));
+}
+
+// 파일 내용을 통째로 바꾸고 3-gram 색인도 함께 갱신한다.
+// 트리에 연결된 파일이면 크기 변화를 상위 디렉터리 집계에도 반영한다.
+static bool setFileContent(Node* fileNode, const char* data, size_t length) {
+    Inode* inode = nodeInode(fileNode);
+    long oldSize = INODE_SIZE(fileNode->inode);
+    bool written = fileWrite(inode, data, length);
+    if (written) {
+        ngramIndexFile(fileNode->inode, data, length);
+    } else {
+        ngramRemoveFile(fileNode->inode); // 실패하면 빈 파일이 된다
+    }
+    if (isLinked(fileNode)) {
+        propagateSize(fileNode->parent, INODE_SIZE(fileNode->inode) - oldSize, 0);
+    }
+    return written;
+}
+
+// 원본과 블록을 공유하는 사본을 만든다 (copy-on-write). 내용이 같으므로 3-gram 색인도 복제만 한다.
+static void shareFileContent(Node* copy, Node* original) {
+    Inode* inode = nodeInode(copy);
+    long oldSize = INODE_SIZE(copy->inode);
+    fileShare(inode, nodeInode(original));
+    ngramCloneFile(original->inode, copy->inode);
+    indexFileMetadata(copy);
+    if (isLinked(copy)) {
+        propagateSize(copy->parent, INODE_SIZE(copy->inode) - oldSize, 0);
+    }
+}
+
+// 실행 중인 명령의 저널 레코드 (runCommand가 채운다). 변경 함수는 검사를 모두 통과한 뒤 디렉터리 잠금을
+// 쥔 채로 남기므로, 같은 디렉터리를 바꾸는 명령들은 실제로 적용된 순서대로 저널에 남는다.
+// 남긴 레코드의 번호는 sequence에 두고, runCommand가 잠금을 놓은 뒤 디스크에 내려갈 때까지 기다린다.
+typedef struct PendingRecord {
+    JournalOp op; // 0이면 남길 것이 없다
+    int argCount;
+    const char* const* args;
+    unsigned long long sequence; // 남긴 레코드 번호, 남기지 않았으면 0
+} PendingRecord;
+static __thread PendingRecord pendingRecord;
+
+static void commitPendingRecord() {
+    if (pendingRecord.op != 0) {
+        pendingRecord.sequence = journalAppend(pendingRecord.op, commandTime(), pendingRecord.argCount, pendingRecord.args);
+        pendingRecord.op = 0;
+    }
+}
+
+// 두 디렉터리를 함께 잠글 때는 일련번호가 작은 쪽부터 잡는다. 조상은 항상 자손보다 먼저 만들어지므로
+// (이미지도 위에서부터 되살리고, 복사본도 위에서부터 만든다) 이 순서는 조상 먼저와도 같다.
+static void lockDirectoryPair(Node* source, Node* target) {
+    if (source == target) {
+        dirWriteLock(&target->dir->lock);
+    } else if (source->serial < target->serial) {
+        dirReadLock(&source->dir->lock);
+        dirWriteLock(&target->dir->lock);
+    } else {
+        dirWriteLock(&target->dir->lock);
+        dirReadLock(&source->dir->lock);
+    }
+}
+
+static void unlockDirectoryPair(Node* source, Node* target) {
+    dirWriteUnlock(&target->dir->lock);
+    if (source != target) {
+        dirReadUnlock(&source->dir->lock);
+    }
+}
+
+// ctime은 정적 버퍼를 쓰므로 여러 스레드에서 부를 수 있도록 ctime_r을 쓴다. 줄바꿈은 뗀다.
+static const char* formatTime(const time_t* when, char buffer[32]) {
+    ctime_r(when, buffer);
+    buffer[strcspn(buffer, "\n")] = '\0';
+    return buffer;
+}
+
+void updateFileContent(Node* fileNode, const char* newContent) {
+    if (fileNode == NULL || fileNode->type != FILE_TYPE) {
+        printf("유효하지 않은 파일 노드입니다.\n");
+        return;
+    }
+    Node* parent = isLinked(fileNode) ? fileNode->parent : NULL; // 아직 붙이지 않은 노드는 잠글 필요가 없다
+    if (parent != NULL) {
+        dirWriteLock(&parent->dir->lock);
+    }
+    if (!setFileContent(fileNode, newContent, strlen(newContent))) {
+        printf("파일 내용을 저장할 블록이 부족합니다.\n");
+    }
+    INODE_MODIFIED(fileNode->inode) = commandTime();
+    indexFileMetadata(fileNode);
+    if (parent != NULL) {
+        dirWriteUnlock(&parent->dir->lock);
+    }
+}
+
+// 파일 내용의 [offset, offset + length)를 읽는다 (openfile.c). 파일이 든 디렉터리의 읽기 잠금 안에서 읽는다.
+size_t readFileRange(Node* fileNode, size_t offset, char* buffer, size_t length) {
+    Node* parent = fileNode->parent;
+    dirReadLock(&parent->dir->lock);
+    size_t got = fileRead(nodeInode(fileNode), offset, buffer, length);
+    dirReadUnlock(&parent->dir->lock);
+    return got;
+}
+
+// 내용의 [offset, offset + length)를 바꾸고 쓰기가 끝난 위치를 돌려준다. 블록이 모자라면 -1.
+// append면 잠금 안에서 본 파일 끝에 쓴다. 닿는 블록만 고치며, 3-gram 색인은 다음 검색 때 이 파일만 다시 만든다.
+long writeFileRange(Node* fileNode, long offset, const char* data, size_t length, bool append) {
+    Node* parent = fileNode->parent;
+    dirWriteLock(&parent->dir->lock);
+    Inode* inode = nodeInode(fileNode);
+    if (append) {
+        offset = INODE_SIZE(fileNode->inode);
+    }
+    commitPendingRecord();
+    long oldSize = INODE_SIZE(fileNode->inode);
+    bool written = fileWriteAt(inode, (size_t)offset, data, length);
+    if (written && length > 0) {
+        INODE_MODIFIED(fileNode->inode) = commandTime();
+        markContentDirty(fileNode->inode);
+        indexFileMetadata(fileNode);
+        propagateSize(parent, INODE_SIZE(fileNode->inode) - oldSize, 0);
+    }
+    dirWriteUnlock(&parent->dir->lock);
+    return written ? offset + (long)length : -1;
+}
+
+// 파일 크기를 size로 바꾼다. 늘어난 부분은 0으로 채운다. 블록이 모자라면 false.
+bool truncateFile(Node* fileNode, size_t size) {
+    Node* parent = fileNode->parent;
+    dirWriteLock(&parent->dir->lock);
+    Inode* inode = nodeInode(fileNode);
+    commitPendingRecord();
+    long oldSize = INODE_SIZE(fileNode->inode);
+    bool resized = fileTruncate(inode, size);
+    if (resized && INODE_SIZE(fileNode->inode) != oldSize) {
+        INODE_MODIFIED(fileNode->inode) = commandTime();
+        markContentDirty(fileNode->inode);
+        indexFileMetadata(fileNode);
+        propagateSize(parent, INODE_SIZE(fileNode->inode) - oldSize, 0);
+    }
+    dirWriteUnlock(&parent->dir->lock);
+    return resized;
+}
+
+// 같은 이름이 없을 때만 parent 아래에 새 노드를 만들어 붙인다. 이름 확인부터 연결까지 부모 쓰기 잠금 안에서
+// 하므로 두 스레드가 같은 이름을 함께 만들 수 없다. 파일이면 content를 내용으로 쓴다 (NULL이면 빈 파일).
+Node* makeChild(Node* parent, const char* name, NodeType type, const char* content) {
+    if (parent->type != DIR_TYPE) {
+        printf("'%s'는 디렉터리가 아닙니다.\n", parent->name);
+        return NULL;
+    }
+    dirWriteLock(&parent->dir->lock);
+    if (findChildLocked(parent, name, type) != NULL) {
+        dirWriteUnlock(&parent->dir->lock);
+        printf("같은 이름의 %s 이미 존재합니다: %s\n", type == DIR_TYPE ? "디렉터리가" : "파일이", name);
+        return NULL;
+    }
+    Node* child = createNode(name, type, parent);
+    if (child == NULL) {
+        dirWriteUnlock(&parent->dir->lock);
+        return NULL;
+    }
+    commitPendingRecord();
+    // 연결하기 전에 내용을 쓰므로, 검색하는 쪽은 이 잠금을 기다렸다가 다 쓴 파일만 본다
+    if (type == FILE_TYPE && content != NULL && !setFileContent(child, content, strlen(content))) {
+        printf("파일 내용을 저장할 블록이 부족합니다.\n");
+    }
+    if (type == FILE_TYPE) {
+        indexFileMetadata(child);
+    }
+    long bytes, files;
+    subtreeTotals(child, &bytes, &files);
+    linkChild(parent, child);
+    dirWriteUnlock(&parent->dir->lock);
+    propagateSize(parent, bytes, files);
+    return child;
+}
+
+// 잠금 없이 미리 만들고 내용까지 채운 노드를 붙인다. 내용을 쓰는 동안 부모 잠금을 쥐지 않으므로
+// 같은 디렉터리에 여러 파일을 함께 채울 수 있다. 3-gram 색인과 메타데이터 색인은 건드리지 않는다
+// (호출자가 markContentIndexStale, markMetaIndexStale).
+bool adoptChild(Node* parent, Node* child) {
+    dirWriteLock(&parent->dir->lock);
+    if (findChildLocked(parent, child->name, child->type) != NULL) {
+        dirWriteUnlock(&parent->dir->lock);
+        return false;
+    }
+    long bytes, files;
+    subtreeTotals(child, &bytes, &files);
+    linkChild(parent, child);
+    dirWriteUnlock(&parent->dir->lock);
+    propagateSize(parent, bytes, files);
+    return true;
+}
+
+char* loadFileContent(Node* fileNode) {
+    Inode* inode = nodeInode(fileNode);
+    char* content = (char*)malloc(INODE_SIZE(fileNode->inode) + 1);
+    size_t length = fileRead(inode, 0, content, INODE_SIZE(fileNode->inode));
+    content[length] = '\0';
+    return content;
+}
+
+// 파일이 든 디렉터리의 잠금을 쥔 채로 부른다.
+static void printFileInfo(Node* fileNode) {
+    char timeBuffer[32];
+    printf("파일 이름: %s\n", fileNode->name);
+    char* content = loadFileContent(fileNode);
+    printf("파일 내용: %s\n", content);
+    free(content);
+    printf("파일 크기: %ld bytes\n", INODE_SIZE(fileNode->inode));
+    printf("생성 시간: %s\n", formatTime(&INODE_CREATED(fileNode->inode), timeBuffer));
+    printf("수정 시간: %s\n", formatTime(&INODE_MODIFIED(fileNode->inode), timeBuffer));
+    printf("파일의 부모 디렉토리: %s\n", fileNode->parent ? fileNode->parent->name : "없음");
+}
+
+// 디렉터리에 들어갈 때마다 먼저 인덱스로 찾고, 없으면 하위 디렉터리를 순서대로 내려간다.
+// 디렉터리의 읽기 잠금은 아래로 내려가기 전(enter)에 잠깐 따로 잡는다.
+static WalkAction readfileInDirectory(Node* node, int depth, void* state) {
+    const char* name = (const char*)state;
+    if (node->type == FILE_TYPE) {
+        if (depth == 0 && strcmp(node->name, name) == 0) {
+            printFileInfo(node);
+            return WALK_STOP;
+        }
+        return WALK_CONTINUE;
+    }
+    dirReadLock(&node->dir->lock);
+    Node* child = findChildLocked(node, name, FILE_TYPE);
+    if (child != NULL) {
+        printFileInfo(child);
+    }
+    dirReadUnlock(&node->dir->lock);
+    return child != NULL ? WALK_STOP : WALK_CONTINUE;
+}
+
+void readfile(Node* node, const char* name) {
+    if (walkTree(node, WALK_LOCKED, readfileInDirectory, NULL, (void*)name)) {
+        printf("'%s' 파일을 찾을 수 없습니다.\n", name);
+    }
+}
+
+void updatefile(Node* parent, const char* name, const char* newContent) {
+    if (parent->type != DIR_TYPE) {
+        printf("'%s'는 디렉터리가 아닙니다.\n", parent->name);
+        return;
+    }
+    dirWriteLock(&parent->dir->lock);
+    Node* child = findChildLocked(parent, name, FILE_TYPE);
+    if (child == NULL) {
+        dirWriteUnlock(&parent->dir->lock);
+        printf("'%s' 파일을 찾을 수 없습니다.\n", name);
+        return;
+    }
+    commitPendingRecord();
+    // 파일 내용을 업데이트하고 수정 시간 갱신
+    if (!setFileContent(child, newContent, strlen(newContent))) {
+        indexFileMetadata(child); // 빈 파일이 되었다
+        dirWriteUnlock(&parent->dir->lock);
+        printf("파일 내용을 저장할 블록이 부족합니다.\n");
+        return;
+    }
+    INODE_MODIFIED(child->inode) = commandTime();
+    indexFileMetadata(child);
+    long fileSize = INODE_SIZE(child->inode);
+    time_t modified = INODE_MODIFIED(child->inode);
+    dirWriteUnlock(&parent->dir->lock);
+
+    char timeBuffer[32];
+    FS_NOTICE("파일 '%s'의 내용이 업데이트 되었습니다.\n", name);
+    printf("새로운 파일 내용: %s\n", newContent);
+    printf("파일 크기: %ld bytes\n", fileSize);
+    printf("수정 시간: %s\n", formatTime(&modified, timeBuffer));
+}
+
+// inode의 fileSize만큼만 읽어 길이 기반 SIMD 검색으로 확인한다.
+static bool fileContains(Node* fileNode, const char* keyword) {
+    Inode* inode = nodeInode(fileNode);
+    char* content = (char*)malloc(INODE_SIZE(fileNode->inode) > 0 ? INODE_SIZE(fileNode->inode) : 1);
+    size_t length = fileRead(inode, 0, content, INODE_SIZE(fileNode->inode));
+    bool matched = memsearch(content, length, keyword, strlen(keyword)) != NULL;
+    free(content);
+    return matched;
+}
+
+// 파일이 든 디렉터리의 잠금을 쥔 채로 부른다.
+static void formatSearchHit(TextBuffer* text, Node* node, const char* keyword) {
+    char timeBuffer[32];
+    textPrintf(text, "키워드 '%s'를 포함하는 파일: %s\n", keyword, node->name);
+    textPrintf(text, "해당 파일의 부모 디렉토리: %s\n", node->parent->name);
+    textPrintf(text, "파일 크기: %ld바이트\n", INODE_SIZE(node->inode));
+    textPrintf(text, "생성 시간: %s\n", formatTime(&INODE_CREATED(node->inode), timeBuffer));
+    textPrintf(text, "수정 시간: %s\n\n", formatTime(&INODE_MODIFIED(node->inode), timeBuffer));
+}
+
+typedef struct ScanState {
+    TextBuffer text;
+    const char* keyword;
+} ScanState;
+
+static void initScanState(void* state, void* context) {
+    ScanState* scan = (ScanState*)state;
+    textInit(&scan->text);
+    scan->keyword = (const char*)context;
+}
+
+static void flushScanState(void* state, void* context) {
+    ScanState* scan = (ScanState*)state;
+    textFlush(&scan->text, stdout);
+    textFree(&scan->text);
+}
+
+// 시작 노드가 아닌 파일은 부모 읽기 잠금 안에서 불린다.
+static WalkAction scanNode(Node* node, int depth, void* state) {
+    ScanState* scan = (ScanState*)state;
+    if (node->type == FILE_TYPE && depth > 0 && fileContains(node, scan->keyword)) {
+        formatSearchHit(&scan->text, node, scan->keyword);
+    }
+    return WALK_CONTINUE;
+}
+
+// 색인을 쓸 수 없을 때(키워드가 3바이트 미만) 트리 전체를 나눠 훑는다.
+static void scanTreeForKeyword(Node* node, const char* keyword) {
+    ParallelWalk walk = {scanNode, sizeof(ScanState), initScanState, flushScanState, (void*)keyword};
+    walkTreeParallel(node, &walk);
+}
+
+static bool isInSubtree(Node* node, Node* top) {
+    for (; node != NULL; node = node->parent) {
+        if (node == top) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static int nodeDepth(const Node* node) {
+    int depth = 0;
+    for (; node->parent != NULL; node = node->parent) {
+        depth++;
+    }
+    return depth;
+}
+
+typedef struct TreeKey {
+    Node* node;
+    int depth;
+} TreeKey;
+
+// 전위 순서 비교. 두 노드를 같은 깊이로 올린 뒤 공통 부모 바로 아래의 형제끼리 일련번호로 비교한다.
+// 노드는 부모 잠금 안에서 만들어져 바로 목록 끝에 붙고, 이미지는 전위 순서로 다시 만들어지며,
+// 디렉터리 사본도 위에서부터 만들어 붙이고, 가져오기도 붙일 순서대로 노드를 만들므로
+// 형제 목록은 항상 일련번호 오름차순이다.
+static int compareTreeOrder(const void* left, const void* right) {
+    const TreeKey* a = (const TreeKey*)left;
+    const TreeKey* b = (const TreeKey*)right;
+    const Node* x = a->node;
+    const Node* y = b->node;
+    for (int depth = a->depth; depth > b->depth; depth--) {
+        x = x->parent;
+    }
+    for (int depth = b->depth; depth > a->depth; depth--) {
+        y = y->parent;
+    }
+    if (x == y) {
+        return (a->depth > b->depth) - (a->depth < b->depth); // 조상이 먼저
+    }
+    while (x->parent != y->parent) {
+        x = x->parent;
+        y = y->parent;
+    }
+    return (x->serial > y->serial) - (x->serial < y->serial);
+}
+
+static void sortTreeOrder(TreeKey* keys, long count) {
+    for (long i = 0; i < count; i++) {
+        keys[i].depth = nodeDepth(keys[i].node);
+    }
+    qsort(keys, count, sizeof(TreeKey), compareTreeOrder);
+}
+
+#define CANDIDATES_PER_TASK 32
+
+typedef struct CandidateJob {
+    const int* candidates;
+    int count;
+    Node* top;
+    const char* keyword;
+    Node** hits; // 후보마다 한 칸, 맞으면 파일 노드
+} CandidateJob;
+
+// 후보는 부모 읽기 잠금을 잡고 아직 트리에 붙어 있는지부터 본다
+// (내용을 쓰는 중인 새 파일은 붙이기 전이므로 건너뛴다).
+static void checkCandidates(void* context, long task) {
+    CandidateJob* job = (CandidateJob*)context;
+    int end = (int)((task + 1) * CANDIDATES_PER_TASK < job->count ? (task + 1) * CANDIDATES_PER_TASK : job->count);
+    for (int i = (int)(task * CANDIDATES_PER_TASK); i < end; i++) {
+        job->hits[i] = NULL;
+        Node* file = getInode(job->candidates[i])->node;
+        if (file == NULL || file->type != FILE_TYPE || !isInSubtree(file, job->top)) {
+            continue;
+        }
+        Node* parent = file->parent;
+        dirReadLock(&parent->dir->lock);
+        if (isLinked(file) && fileContains(file, job->keyword)) {
+            job->hits[i] = file;
+        }
+        dirReadUnlock(&parent->dir->lock);
+    }
+}
+
+// 모든 파일을 inode 번호 순서로 색인한다. 게시 목록이 inode 순으로 정렬되어 있으므로
+// 이 순서로 넣으면 항상 목록 끝에 붙는다 (트리 순서로 넣으면 중간 삽입이 반복된다).
+static void indexAllContent() {
+    char* content = NULL;
+    long capacity = 0;
+    for (size_t index = 0; index < inodeTable.allocated.bitCount; index++) {
+        if (!bitmapTest(&inodeTable.allocated, index)) {
+            continue;
+        }
+        if (INODE_TYPE(index) != FILE_TYPE) {
+            continue;
+        }
+        Inode* inode = getInode(index);
+        if (inode->node == NULL) {
+            continue;
+        }
+        if (INODE_SIZE(index) > capacity) {
+            capacity = INODE_SIZE(index);
+            content = (char*)realloc(content, capacity);
+        }
+        size_t length = fileRead(inode, 0, content, INODE_SIZE(index));
+        ngramIndexFile((int)index, content, length);
+    }
+    free(content);
+}
+
+// 이미지에서 불러온 직후에는 3-gram 색인이 없다. 시작을 늦추지 않도록 첫 검색 때 만든다.
+void markContentIndexStale() {
+    __atomic_store_n(&contentIndexStale, true, __ATOMIC_RELEASE);
+}
+
+// 3-gram 색인으로 후보 파일을 추린 뒤, 후보만 스레드 풀에서 나눠 실제 내용으로 확인한다.
+// 색인 없이 훑을 때와 같도록 결과는 트리(전위) 순서로 정렬해 출력한다.
+// 색인을 다시 만드는 동안에는 파일이 바뀌면 안 되므로, 명령 처리부는 그때 단독으로 들어온다.
+void searchfile(Node* node, const char* keyword) {
+    if (__atomic_exchange_n(&contentIndexStale, false, __ATOMIC_ACQ_REL)) {
+        ngramReset();
+        indexAllContent();
+        clearContentDirty();
+    } else if (__atomic_load_n(&contentDirty.count, __ATOMIC_RELAXED) > 0) {
+        reindexDirtyContent();
+    }
+    int* candidates;
+    int count = ngramQuery(keyword, strlen(keyword), &candidates);
+    if (count < 0) {
+        scanTreeForKeyword(node, keyword);
+        return;
     }
+    CandidateJob job = {candidates, count, node, keyword, (Node**)malloc((count > 0 ? count : 1) * sizeof(Node*))};
+    workPoolRun((count + CANDIDATES_PER_TASK - 1) / CANDIDATES_PER_TASK, checkCandidates, &job);
+    free(candidates);
 
-    return newNode;
+    TreeKey* hits = (TreeKey*)malloc((count > 0 ? count : 1) * sizeof(TreeKey));
+    long hitCount = 0;
+    for (int i = 0; i < count; i++) {
+        if (job.hits[i] != NULL) {
+            hits[hitCount++].node = job.hits[i];
+        }
+    }
+    free(job.hits);
+    sortTreeOrder(hits, hitCount);
+    TextBuffer text;
+    textInit(&text);
+    for (long i = 0; i < hitCount; i++) {
+        Node* parent = hits[i].node->parent;
+        dirReadLock(&parent->dir->lock);
+        formatSearchHit(&text, hits[i].node, keyword);
+        dirReadUnlock(&parent->dir->lock);
+    }
+    textFlush(&text, stdout);
+    textFree(&text);
+    free(hits);
 }
 
-void freeInode(int index) {
-    if (index >= 0 && index < MAX_INODES) {
-        inodeTable.isAllocated[index] = false;
-        superblock.usedInodes--;
-        printf("Inode %d 가 해제되었습니다.\n", index);
+// 모든 파일을 메타데이터 색인에 넣는다. 이미 든 파일은 값만 고친다.
+static void indexAllMetadata() {
+    for (size_t index = 0; index < inodeTable.allocated.bitCount; index++) {
+        if (!bitmapTest(&inodeTable.allocated, index)) {
+            continue;
+        }
+        if (INODE_TYPE(index) != FILE_TYPE) {
+            continue;
+        }
+        Node* node = getInode(index)->node;
+        if (node != NULL) {
+            metaIndexPut((int)index, node->name, INODE_SIZE(index), INODE_MODIFIED(index), INODE_CREATED(index));
+        }
     }
 }
 
-void addChild(Node* parent, Node* child) {
-    if (parent->dir.childCount < 30) {
-        parent->dir.children[parent->dir.childCount++] = child;
-    } else {
-        printf("자식 노드의 최대 개수를 초과했습니다.\n");
-    }
+// 불러오기와 가져오기는 노드를 한꺼번에 만들므로 파일마다 넣지 않고 첫 find 때 만든다.
+void markMetaIndexStale() {
+    __atomic_store_n(&metaIndexStale, true, __ATOMIC_RELEASE);
 }
 
+// find 조건. 크기와 시간은 [low, high] 범위로 모으고, 이름은 glob 패턴 하나다.
+typedef struct FindQuery {
+    long long low[META_NAME], high[META_NAME]; // META_SIZE, META_MTIME, META_CTIME 순서
+    bool bounded[META_NAME];
+    const char* pattern; // 없으면 NULL
+    char prefix[NODE_NAME_SIZE]; // 패턴에서 첫 와일드카드 앞까지
+} FindQuery;
 
-void printTree(Node* node, int level) {
-    for (int i = 0; i < level; i++) {
-        printf("  ");
+// "size>100", "mtime<3600", "name=*.txt" 꼴의 조건 하나를 query에 더한다.
+// mtime, ctime은 지금부터 몇 초 전인지로 받는다 (mtime<3600은 한 시간 안에 고친 파일).
+static bool parseFindCondition(FindQuery* query, char* condition, time_t now) {
+    static const char* const fields[] = {"size", "mtime", "ctime", "name"};
+    size_t fieldLength = strcspn(condition, "<>=");
+    int field = -1;
+    for (int k = 0; k <= META_NAME; k++) {
+        if (strlen(fields[k]) == fieldLength && strncmp(condition, fields[k], fieldLength) == 0) {
+            field = k;
+        }
     }
-    if (node->type == DIR_TYPE) {
-        printf("%s/\n", node->dir.name);
-    } else {
-        printf("%s\n", node->file.name);
+    char* op = condition + fieldLength;
+    char* value = op + (op[0] != '\0' && op[1] == '=' ? 2 : 1);
+    if (field < 0 || *op == '\0') {
+        return false;
     }
-    if (node->type == DIR_TYPE) {
-        for (int i = 0; i < node->dir.childCount; i++) {
-            printTree((Node*)node->dir.children[i], level + 1);
+    if (field == META_NAME) {
+        if (op[0] != '=' || op[1] == '=' || *value == '\0' || strlen(value) >= NODE_NAME_SIZE) {
+            return false;
         }
+        query->pattern = value;
+        size_t literal = strcspn(value, "*?[\\");
+        memcpy(query->prefix, value, literal);
+        query->prefix[literal] = '\0';
+        return true;
+    }
+    char* end;
+    long long number = strtoll(value, &end, 10);
+    if (*value == '\0' || *end != '\0' || number < 0) {
+        return false;
+    }
+    char direction = op[0];
+    if (field != META_SIZE) { // 나이를 시각으로 바꾸면 크고 작음이 뒤집힌다
+        number = (long long)now - number;
+        direction = direction == '<' ? '>' : direction == '>' ? '<' : direction;
+    }
+    bool inclusive = op[0] == '=' || op[1] == '=';
+    long long* low = &query->low[field];
+    long long* high = &query->high[field];
+    if (direction == '<' || direction == '=') {
+        long long bound = direction == '<' && !inclusive ? number - 1 : number;
+        *high = bound < *high ? bound : *high;
     }
+    if (direction == '>' || direction == '=') {
+        long long bound = direction == '>' && !inclusive ? number + 1 : number;
+        *low = bound > *low ? bound : *low;
+    }
+    query->bounded[field] = true;
+    return true;
 }
 
-void freeTree(Node* node) {
-    if (node->type == DIR_TYPE) {
-        for (int i = 0; i < node->dir.childCount; i++) {
-            freeTree((Node*)node->dir.children[i]);
+static bool matchesFindQuery(const FindQuery* query, const MetaEntry* entry) {
+    for (int k = 0; k < META_NAME; k++) {
+        long long value = k == META_SIZE ? entry->size : k == META_MTIME ? entry->mtime : entry->ctime;
+        if (query->bounded[k] && (value < query->low[k] || value > query->high[k])) {
+            return false;
         }
     }
-    freeInode(node->type == DIR_TYPE ? node->dir.inodeIndex : node->file.inodeIndex);
-    free(node);
+    return query->pattern == NULL || fnmatch(query->pattern, entry->name, 0) == 0;
 }
 
-Node* findNode(Node* node, const char* name, NodeType type) {
-    if (node->type == type && strcmp(node->dir.name, name) == 0) {
-        return node;
+// 조건마다 색인에서 범위에 든 항목을 지금까지 가장 적은 수까지만 세어 보고, 가장 좁은 색인 하나를 훑는다.
+// 세는 비용도 고른 범위의 크기를 넘지 않는다. 조건이 없으면 모든 파일이다.
+static MetaRange chooseFindRange(const FindQuery* query) {
+    MetaRange best = {META_SIZE, LLONG_MIN, LLONG_MAX, NULL};
+    long bestCount = LONG_MAX;
+    if (query->prefix[0] != '\0') {
+        best = (MetaRange){META_NAME, 0, 0, query->prefix};
+        bestCount = metaIndexCount(&best, bestCount);
     }
-    if (node->type == DIR_TYPE) {
-        for (int i = 0; i < node->dir.childCount; i++) {
-            Node* found = findNode((Node*)node->dir.children[i], name, type);
-            if (found != NULL) {
-                return found;
-            }
+    for (int k = 0; k < META_NAME; k++) {
+        if (!query->bounded[k]) {
+            continue;
+        }
+        MetaRange range = {(MetaKey)k, query->low[k], query->high[k], NULL};
+        long count = metaIndexCount(&range, bestCount);
+        if (count < bestCount) {
+            best = range;
+            bestCount = count;
         }
     }
-    return NULL;
+    return best;
 }
 
-void updateFileContent(Node* fileNode, const char* newContent) {
-    if (fileNode == NULL || fileNode->type != FILE_TYPE) {
-        printf("유효하지 않은 파일 노드입니다.\n");
-        return;
+typedef struct FindMatches {
+    const FindQuery* query;
+    int* inodes;
+    long count, capacity;
+} FindMatches;
+
+static bool collectFindMatch(int inode, const MetaEntry* entry, void* context) {
+    FindMatches* matches = (FindMatches*)context;
+    if (!matchesFindQuery(matches->query, entry)) {
+        return true;
     }
-    int newContentSize = strlen(newContent);
-    if (newContentSize >= sizeof(fileNode->file.content)) {
-        printf("파일 내용이 너무 깁니다. 최대 길이는 %lu 입니다.\n", sizeof(fileNode->file.content) - 1);
-        return;
+    if (matches->count == matches->capacity) {
+        matches->capacity = matches->capacity == 0 ? 64 : matches->capacity * 2;
+        matches->inodes = (int*)realloc(matches->inodes, matches->capacity * sizeof(int));
     }
-    strcpy(fileNode->file.content, newContent);
-    int inodeIndex = fileNode->file.inodeIndex;
-    inodeTable.inodes[inodeIndex].fileSize = newContentSize;
-    inodeTable.inodes[inodeIndex].modified = time(NULL);
+    matches->inodes[matches->count++] = inode;
+    return true;
 }
 
-void readfile(Node* node, const char* name) {
-    bool found = false;
-    
-    if (node->type == FILE_TYPE) {
-        if (strcmp(node->file.name, name) == 0) {
-            printf("파일 이름: %s\n", node->file.name);
-            printf("파일 내용: %s\n", node->file.content);
-            printf("파일 크기: %d bytes\n", node->file.inode.fileSize);
-            
-            char* createdTime = ctime(&node->file.inode.created);
-            createdTime[strlen(createdTime) - 1] = '\0'; // 줄바꿈 제거
-            printf("생성 시간: %s\n", createdTime);
-            
-            char* modifiedTime = ctime(&node->file.inode.modified);
-            modifiedTime[strlen(modifiedTime) - 1] = '\0'; // 줄바꿈 제거
-            printf("수정 시간: %s\n", modifiedTime);
-            
-            printf("파일의 부모 디렉토리: %s\n", node->parent ? node->parent->dir.name : "없음");
-            found = true;
-        }
-    } else if (node->type == DIR_TYPE) {
-        for (int i = 0; i < node->dir.childCount; i++) {
-            Node* child = (Node*)node->dir.children[i];
-            if (child->type == FILE_TYPE && strcmp(child->file.name, name) == 0) {
-                printf("파일 이름: %s\n", child->file.name);
-                printf("파일 내용: %s\n", child->file.content);
-                printf("파일 크기: %d bytes\n", child->file.inode.fileSize);
-                
-                char* createdTime = ctime(&child->file.inode.created);
-                createdTime[strlen(createdTime) - 1] = '\0'; // 줄바꿈 제거
-                printf("생성 시간: %s\n", createdTime);
-                
-                char* modifiedTime = ctime(&child->file.inode.modified);
-                modifiedTime[strlen(modifiedTime) - 1] = '\0'; // 줄바꿈 제거
-                printf("수정 시간: %s\n", modifiedTime);
-                
-                printf("파일의 부모 디렉토리: %s\n", node->dir.name);
-                found = true;
-                break;
-            } else if (child->type == DIR_TYPE) {
-                readfile(child, name); // 재귀적으로 탐색
-            }
-        }
+// 루트에서 node까지의 경로 ("/a/b/c")
+static void formatNodePath(TextBuffer* text, const Node* node) {
+    const Node* chain[256];
+    int depth = 0;
+    for (; node->parent != NULL && depth < 256; node = node->parent) {
+        chain[depth++] = node;
     }
-    
-    if (!found && node->parent == NULL) { // 최상위 노드에서 파일을 찾지 못했으면
-        printf("'%s' 파일을 찾을 수 없습니다.\n", name);
+    while (depth > 0) {
+        const char* name = chain[--depth]->name;
+        textAppend(text, "/", 1);
+        textAppend(text, name, strlen(name));
     }
 }
 
-void updatefile(Node* parent, const char* name, const char* newContent) {
-    if (parent->type != DIR_TYPE) {
-        printf("'%s'는 디렉터리가 아닙니다.\n", parent->dir.name);
-        return;
+// 메타데이터 색인으로 조건에 맞는 파일을 찾는다. 비용은 O(log n + 고른 범위에 든 파일 수)다.
+// 나머지 조건과 디렉터리 안인지는 고른 범위의 항목마다 확인하고, 결과는 searchfile처럼 트리 순서로 출력한다.
+// 색인을 다시 만드는 동안에는 명령 처리부가 단독으로 들어온다.
+void findFiles(Node* top, const char* conditions) {
+    FindQuery query;
+    memset(&query, 0, sizeof(query));
+    for (int k = 0; k < META_NAME; k++) {
+        query.low[k] = LLONG_MIN;
+        query.high[k] = LLONG_MAX;
     }
-    bool found = false;
-    for (int i = 0; i < parent->dir.childCount; i++) {
-        Node* child = (Node*)parent->dir.children[i];
-        if (child->type == FILE_TYPE && strcmp(child->file.name, name) == 0) {
-            // 파일 내용을 업데이트하고 수정 시간 갱신
-            strncpy(child->file.content, newContent, sizeof(child->file.content) - 1);
-            child->file.content[sizeof(child->file.content) - 1] = '\0'; // 안전하게 NULL 종료
-            child->file.inode.fileSize = strlen(newContent);
-            time(&child->file.inode.modified);
-
-            printf("파일 '%s'의 내용이 업데이트 되었습니다.\n", name);
-            printf("새로운 파일 내용: %s\n", child->file.content);
-            printf("파일 크기: %d bytes\n", child->file.inode.fileSize);
-
-            char* modifiedTime = ctime(&child->file.inode.modified);
-            modifiedTime[strlen(modifiedTime) - 1] = '\0'; // 줄바꿈 제거
-            printf("수정 시간: %s\n", modifiedTime);
-
-            found = true;
-            break;
+    char* line = strdup(conditions);
+    char* saved;
+    time_t now = time(NULL);
+    for (char* token = strtok_r(line, " \t", &saved); token != NULL; token = strtok_r(NULL, " \t", &saved)) {
+        if (!parseFindCondition(&query, token, now)) {
+            printf("알 수 없는 조건입니다: %s (예: size>1000 mtime<3600 ctime>=60 name=*.txt)\n", token);
+            free(line);
+            return;
         }
     }
-    if (!found) {
-        printf("'%s' 파일을 찾을 수 없습니다.\n", name);
+    if (__atomic_exchange_n(&metaIndexStale, false, __ATOMIC_ACQ_REL)) {
+        indexAllMetadata();
     }
-}
+    MetaRange range = chooseFindRange(&query);
+    FindMatches matches = {&query, NULL, 0, 0};
+    metaIndexScan(&range, collectFindMatch, &matches);
+    free(line); // 패턴을 다 쓴 뒤에
 
-void searchfile(Node* node, const char* keyword) {
-    if (node->type == FILE_TYPE) {
-        if (strstr(node->file.content, keyword) != NULL) {
-            printf("키워드 '%s'를 포함하는 파일: %s\n", keyword, node->file.name);
-            printf("해당 파일의 부모 디렉토리: %s\n", node->parent->dir.name);
-            printf("파일 크기: %d바이트\n", node->file.inode.fileSize);
-            
-            // 생성 시간 출력
-            char* createdTime = ctime(&node->file.inode.created);
-            createdTime[strlen(createdTime) - 1] = '\0'; // 줄바꿈 제거
-            printf("생성 시간: %s\n", createdTime);
-            
-            // 수정 시간 출력
-            char* modifiedTime = ctime(&node->file.inode.modified);
-            modifiedTime[strlen(modifiedTime) - 1] = '\0'; // 줄바꿈 제거
-            printf("수정 시간: %s\n\n", modifiedTime);
-        }
-    } else if (node->type == DIR_TYPE) {
-        for (int i = 0; i < node->dir.childCount; i++) {
-            searchfile((Node*)node->dir.children[i], keyword);
+    TreeKey* hits = (TreeKey*)malloc((matches.count > 0 ? matches.count : 1) * sizeof(TreeKey));
+    long hitCount = 0;
+    for (long i = 0; i < matches.count; i++) {
+        Node* node = getInode(matches.inodes[i])->node;
+        if (node != NULL && node != top && isInSubtree(node, top)) {
+            hits[hitCount++].node = node;
         }
     }
+    free(matches.inodes);
+    sortTreeOrder(hits, hitCount);
+    TextBuffer text;
+    textInit(&text);
+    char timeBuffer[32];
+    for (long i = 0; i < hitCount; i++) {
+        Node* parent = hits[i].node->parent;
+        dirReadLock(&parent->dir->lock);
+        int index = hits[i].node->inode;
+        formatNodePath(&text, hits[i].node);
+        textPrintf(&text, " (%ld bytes, 수정 시간 %s)\n", INODE_SIZE(index), formatTime(&INODE_MODIFIED(index), timeBuffer));
+        dirReadUnlock(&parent->dir->lock);
+    }
+    textPrintf(&text, "조건에 맞는 파일: %ld개\n", hitCount);
+    textFlush(&text, stdout);
+    textFree(&text);
+    free(hits);
 }
 
 int hasChildWithName(Node* parent, const char* name, int type) {
     if (parent->type != DIR_TYPE) {
         return 0; // 부모가 디렉터리가 아니면 항상 0을 반환
     }
-    for (int i = 0; i < parent->dir.childCount; i++) {
-        Node* child = (Node*)parent->dir.children[i];
-        if (type == DIR_TYPE && child->type == DIR_TYPE && strcmp(child->dir.name, name) == 0) {
-            return 1; // 동일한 이름의 디렉터리 발견
-        } else if (type == FILE_TYPE && child->type == FILE_TYPE && strcmp(child->file.name, name) == 0) {
-            return 1; // 동일한 이름의 파일 발견
-        }
-    }
-    return 0; // 동일한 이름의 자식 노드 없음
+    return findChild(parent, name, (NodeType)type) != NULL;
 }
 
 void renameNode(Node* parent, const char* oldName, const char* newName, NodeType type) {
     if (parent->type != DIR_TYPE) {
-        printf("'%s'는 디렉터리가 아닙니다.\n", parent->dir.name);
+        printf("'%s'는 디렉터리가 아닙니다.\n", parent->name);
         return;
     }
+    dirWriteLock(&parent->dir->lock);
     // 같은 이름을 가진 자식 노드가 있는지 확인
-    if (hasChildWithName(parent, newName, type)) {
+    if (findChildLocked(parent, newName, type) != NULL) {
+        dirWriteUnlock(&parent->dir->lock);
         printf("'%s' 이름을 가진 %s가 이미 존재합니다.\n", newName, type == DIR_TYPE ? "디렉터리" : "파일");
         return;
     }
 
-    bool found = false;
-    for (int i = 0; i < parent->dir.childCount; i++) {
-        Node* child = (Node*)parent->dir.children[i];
-        if (child->type == type && strcmp(type == DIR_TYPE ? child->dir.name : child->file.name, oldName) == 0) {
-            // 이름 변경
-            strcpy(type == DIR_TYPE ? child->dir.name : child->file.name, newName);
-            if (type == DIR_TYPE) {
-                child->dir.inode.modified = time(NULL); // 노드 수정 시간 업데이트
-            } else {
-                child->file.inode.modified = time(NULL); // 노드 수정 시간 업데이트
-            }
-            printf("'%s'의 이름이 '%s'(으)로 변경되었습니다.\n", oldName, newName);
-            found = true;
-            break;
-        }
-    }
-    if (!found) {
+    Node* child = findChildLocked(parent, oldName, type);
+    if (child == NULL) {
+        dirWriteUnlock(&parent->dir->lock);
         printf("'%s'를 찾을 수 없습니다.\n", oldName);
+        return;
     }
+    commitPendingRecord();
+    // 이름이 인덱스 키이므로 떼어낸 뒤 이름을 바꾸고 다시 넣는다 (인덱스만 갱신, 순서는 유지)
+    int slot = indexFind(&parent->dir->index, oldName, type);
+    indexRemoveSlot(&parent->dir->index, slot);
+    dcacheInvalidate(parent->serial, oldName, type);
+    const char* oldInterned = child->name;
+    __atomic_store_n(&child->name, stringPoolIntern(&namePool, newName), __ATOMIC_RELAXED);
+    INODE_MODIFIED(child->inode) = commandTime(); // 노드 수정 시간 업데이트
+    if (type == FILE_TYPE) {
+        indexFileMetadata(child); // 색인이 예전 이름을 가리키지 않게 반납보다 먼저
+    }
+    stringPoolRelease(&namePool, oldInterned); // 잠그지 않고 읽는 쪽이 볼 수 있어도 이름 표 밖으로는 나가지 않는다
+    indexInsert(&parent->dir->index, child);
+    dcacheInvalidate(parent->serial, newName, type);
+    dirWriteUnlock(&parent->dir->lock);
+    FS_NOTICE("'%s'의 이름이 '%s'(으)로 변경되었습니다.\n", oldName, newName);
 }
 
+// 노드를 해제하므로 다른 스레드가 트리에 들어와 있지 않을 때(fsEnterExclusive) 부른다.
 void deleteNode(Node* parent, const char* name, NodeType type) {
     if (parent->type != DIR_TYPE) {
-        printf("'%s'는 디렉터리가 아닙니다.\n", parent->dir.name);
+        printf("'%s'는 디렉터리가 아닙니다.\n", parent->name);
         return;
     }
 
-    for (int i = 0; i < parent->dir.childCount; i++) {
-        Node* child = (Node*)parent->dir.children[i];
-        if (child->type == type && strcmp(type == DIR_TYPE ? child->dir.name : child->file.name, name) == 0) {
-            // 자식 노드 삭제 처리
-            freeTree(child);
-            // 배열에서 삭제된 노드 제거
-            for (int j = i; j < parent->dir.childCount - 1; j++) {
-                parent->dir.children[j] = parent->dir.children[j + 1];
-            }
-            parent->dir.childCount--;
-            printf("'%s' %s가 삭제되었습니다.\n", name, type == DIR_TYPE ? "디렉터리" : "파일");
-            return;
-        }
+    Node* child = findChild(parent, name, type);
+    if (child == NULL) {
+        printf("'%s' %s를 찾을 수 없습니다.\n", name, type == DIR_TYPE ? "디렉터리" : "파일");
+        return;
     }
-
-    printf("'%s' %s를 찾을 수 없습니다.\n", name, type == DIR_TYPE ? "디렉터리" : "파일");
+    commitPendingRecord();
+    // 인덱스와 목록에서 떼어낸 뒤 자식 노드 삭제 처리
+    removeChild(parent, child);
+    freeTree(child);
+    FS_NOTICE("'%s' %s가 삭제되었습니다.\n", name, type == DIR_TYPE ? "디렉터리" : "파일");
 }
 
-void deepCopyNode(Node* original, Node* copy) {
+// 원본 노드 하나의 내용을 사본에 옮긴다. 생성/수정 시간은 createNode가 복사 시점으로 설정한다.
+static void copyNodeContent(Node* original, Node* copy) {
     if (original->type == FILE_TYPE) {
-        strcpy(copy->file.content, original->file.content);
-        copy->file.inode.fileSize = original->file.inode.fileSize;
-        copy->file.inode.created = time(NULL); // 복사 시점을 생성 시간으로 설정
-        copy->file.inode.modified = time(NULL); // 복사 시점을 수정 시간으로 설정
-        copy->file.inode.linkCount = 1; // 새 파일이므로 링크 수는 1
-    } else if (original->type == DIR_TYPE) {
-        for (int i = 0; i < original->dir.childCount; i++) {
-            Node* child = (Node*)original->dir.children[i];
-            Node* newChild = createNode(child->type == DIR_TYPE ? child->dir.name : child->file.name, child->type, copy);
-            if (child->type == DIR_TYPE) {
-                copy->dir.inode.fileSize = 0; // 자식 노드에 따라 달라질 수 있으므로, 0으로 초기화
-                copy->dir.inode.created = time(NULL); // 복사 시점을 생성 시간으로 설정
-                copy->dir.inode.modified = time(NULL); // 복사 시점을 수정 시간으로 설정
-                copy->dir.inode.linkCount = original->dir.inode.linkCount; // 링크 수는 원본 디렉터리 링크 수와 동일하게 설정
-                deepCopyNode(child, newChild);
-            } else { // FILE_TYPE
-                strcpy(newChild->file.content, child->file.content);
-                copy->file.inode.fileSize = original->file.inode.fileSize;
-                copy->file.inode.created = time(NULL); // 복사 시점을 생성 시간으로 설정
-                copy->file.inode.modified = time(NULL); // 복사 시점을 수정 시간으로 설정
-                copy->file.inode.linkCount = 1; // 새 파일이므로 링크 수는 1
-            }
-            addChild(copy, newChild);
+        // 내용은 복사하지 않고 블록을 공유한다. 어느 쪽이든 처음 쓸 때 새 블록을 받는다.
+        shareFileContent(copy, original);
+        INODE_LINKS(copy->inode) = 1; // 새 파일이므로 링크 수는 1
+    } else {
+        INODE_SIZE(copy->inode) = 0; // 자식 노드에 따라 달라질 수 있으므로, 0으로 초기화
+        INODE_LINKS(copy->inode) = INODE_LINKS(original->inode); // 링크 수는 원본 디렉터리 링크 수와 동일하게 설정
+    }
+}
+
+// copies[d]는 깊이 d에 있는 원본 디렉터리의 사본이다.
+typedef struct CopyState {
+    Node** copies;
+    int capacity;
+} CopyState;
+
+static WalkAction copyVisit(Node* original, int depth, void* state) {
+    CopyState* copy = (CopyState*)state;
+    Node* target = copy->copies[0];
+    if (depth > 0) {
+        target = createNode(original->name, original->type, copy->copies[depth - 1]);
+        if (target == NULL) {
+            return WALK_SKIP;
+        }
+    }
+    copyNodeContent(original, target);
+    if (depth > 0) {
+        addChild(copy->copies[depth - 1], target);
+    }
+    if (original->type == DIR_TYPE) {
+        if (depth >= copy->capacity) {
+            copy->capacity *= 2;
+            copy->copies = (Node**)realloc(copy->copies, copy->capacity * sizeof(Node*));
         }
+        copy->copies[depth] = target;
     }
+    return WALK_CONTINUE;
+}
+
+// 원본 파일은 호출자가 부모 잠금을 쥐고 있어야 한다. 원본 디렉터리는 하나씩 읽기 잠금하며 내려간다.
+// 사본은 아직 트리에 붙지 않았으므로 다른 스레드가 보지 못한다.
+void deepCopyNode(Node* original, Node* copy) {
+    CopyState state = {(Node**)malloc(16 * sizeof(Node*)), 16};
+    state.copies[0] = copy;
+    walkTree(original, WALK_LOCKED, copyVisit, NULL, &state);
+    free(state.copies);
 }
 
 void copyNode(Node* parent, const char* name, const char* newName, NodeType targetType, Node* targetParent) {
     if (parent->type != DIR_TYPE) {
-        printf("'%s'는 디렉터리가 아닙니다.\n", parent->dir.name);
+        printf("'%s'는 디렉터리가 아닙니다.\n", parent->name);
         return;
     }
     if (targetParent->type != DIR_TYPE) {
-        printf("'%s'는 디렉터리가 아닙니다.\n", targetParent->dir.name);
+        printf("'%s'는 디렉터리가 아닙니다.\n", targetParent->name);
         return;
     }
-    if (hasChildWithName(targetParent, newName, targetType)) {
-        printf("'%s' 이름을 가진 노드가 이미 '%s' 디렉터리에 존재합니다.\n", newName, targetParent->dir.name);
+    lockDirectoryPair(parent, targetParent);
+    if (findChildLocked(targetParent, newName, targetType) != NULL) {
+        unlockDirectoryPair(parent, targetParent);
+        printf("'%s' 이름을 가진 노드가 이미 '%s' 디렉터리에 존재합니다.\n", newName, targetParent->name);
         return;
     }
     
-    for (int i = 0; i < parent->dir.childCount; i++) {
-        Node* child = (Node*)parent->dir.children[i];
-        if ((child->type == targetType) && ((targetType == DIR_TYPE && strcmp(child->dir.name, name) == 0) || (targetType == FILE_TYPE && strcmp(child->file.name, name) == 0))) {
-            Node* newCopy = createNode(newName, child->type, targetParent);
-            deepCopyNode(child, newCopy);
-            addChild(targetParent, newCopy);
-            printf("'%s'가 '%s'(으)로 복사되었습니다.\n", name, newName);
-            return;
-        }
+    Node* child = findChildLocked(parent, name, targetType);
+    if (child == NULL) {
+        unlockDirectoryPair(parent, targetParent);
+        printf("'%s'를 찾을 수 없습니다.\n", name);
+        return;
+    }
+    Node* newCopy = createNode(newName, child->type, targetParent);
+    if (newCopy == NULL) {
+        unlockDirectoryPair(parent, targetParent);
+        return;
     }
-    printf("'%s'를 찾을 수 없습니다.\n", name);
+    commitPendingRecord();
+    long bytes, files;
+    if (child->type == FILE_TYPE) {
+        deepCopyNode(child, newCopy);
+        subtreeTotals(newCopy, &bytes, &files);
+        linkChild(targetParent, newCopy);
+        unlockDirectoryPair(parent, targetParent);
+    } else {
+        // 원본 하위 디렉터리를 하나씩 잠그며 복사하는데 사본을 넣을 곳이 그 안일 수도 있으므로 먼저 놓는다.
+        // 디렉터리 복사는 단독으로 들어온 상태에서만 하므로 그 사이에 바뀌는 것은 없다.
+        unlockDirectoryPair(parent, targetParent);
+        deepCopyNode(child, newCopy);
+        subtreeTotals(newCopy, &bytes, &files);
+        dirWriteLock(&targetParent->dir->lock);
+        linkChild(targetParent, newCopy);
+        dirWriteUnlock(&targetParent->dir->lock);
+    }
+    propagateSize(targetParent, bytes, files);
+    FS_NOTICE("'%s'가 '%s'(으)로 복사되었습니다.\n", name, newName);
 }
 
-void calculateDirectorySize(Node* node, int* totalSize) {
-    if (node->type == FILE_TYPE) {
-        *totalSize += node->file.inode.fileSize;
-    } else if (node->type == DIR_TYPE) {
-        int inodeIndex = node->dir.inodeIndex;
-        *totalSize += inodeTable.inodes[inodeIndex].fileSize;
-        for (int i = 0; i < node->dir.childCount; i++) {
-            calculateDirectorySize((Node*)node->dir.children[i], totalSize);
-        }
-    }
+static void initSizeState(void* state, void* context) {
+    *(long*)state = 0;
+}
+
+static void addSizeState(void* state, void* context) {
+    *(long*)context += *(long*)state;
+}
+
+static WalkAction addNodeSize(Node* node, int depth, void* state) {
+    *(long*)state += INODE_SIZE(node->inode);
+    return WALK_CONTINUE;
+}
+
+// 집계값을 쓰지 않고 트리를 나눠 훑어 실제 크기를 더한다 (집계 검사, 벤치마크용).
+void calculateDirectorySize(Node* node, long* totalSize) {
+    ParallelWalk walk = {addNodeSize, sizeof(long), initSizeState, addSizeState, totalSize};
+    walkTreeParallel(node, &walk);
 }
 
+// 디렉터리마다 유지하는 집계값을 그대로 읽으므로 트리를 훑지 않는다.
 void printDirectorySize(Node* node) {
     if (node == NULL || node->type != DIR_TYPE) {
         printf("유효하지 않은 디렉터리 노드입니다.\n");
         return;
     }
-    int totalSize = 0;
-    calculateDirectorySize(node, &totalSize);
-    printf("디렉터리 '%s'의 총 크기: %d bytes\n", node->dir.name, totalSize);
+    printf("디렉터리 '%s'의 총 크기: %ld bytes (파일 %ld개)\n", node->name,
+           __atomic_load_n(&node->dir->subtreeBytes, __ATOMIC_RELAXED),
+           __atomic_load_n(&node->dir->subtreeFiles, __ATOMIC_RELAXED));
 }
 
+typedef struct SubtreeSum {
+    long bytes;
+    long files;
+} SubtreeSum;
 
-void dir_main() {
-    Node* root = createNode("root", DIR_TYPE, NULL);
+typedef struct Mismatch {
+    TreeKey key;
+    SubtreeSum actual;
+} Mismatch;
 
-    superblock.totalInodes = MAX_INODES;
-    superblock.usedInodes = 1;
-    superblock.totalBlocks = 1000; // 임의의 값
-    superblock.usedBlocks = 0;
-    superblock.fileSystemSize = 1000000; // 임의의 값 (1MB)
+// sums[d]는 지금 훑고 있는 깊이 d 디렉터리의 실제 합계다.
+typedef struct CheckState {
+    SubtreeSum* sums;
+    int capacity;
+    Mismatch* mismatches;
+    int mismatchCount, mismatchCapacity;
+} CheckState;
 
-    // InodeTable 초기화
-    for (int i = 0; i < MAX_INODES; i++) {
-        inodeTable.isAllocated[i] = false;
+static WalkAction checkEnter(Node* node, int depth, void* state) {
+    CheckState* check = (CheckState*)state;
+    if (node->type == FILE_TYPE) {
+        if (depth > 0) {
+            check->sums[depth - 1].bytes += INODE_SIZE(node->inode);
+            check->sums[depth - 1].files++;
+        }
+        return WALK_CONTINUE;
+    }
+    if (depth >= check->capacity) {
+        check->capacity *= 2;
+        check->sums = (SubtreeSum*)realloc(check->sums, check->capacity * sizeof(SubtreeSum));
+    }
+    check->sums[depth] = (SubtreeSum){INODE_SIZE(node->inode), 0};
+    return WALK_CONTINUE;
+}
+
+static void checkLeave(Node* dir, int depth, void* state) {
+    CheckState* check = (CheckState*)state;
+    SubtreeSum sum = check->sums[depth];
+    if (sum.bytes != dir->dir->subtreeBytes || sum.files != dir->dir->subtreeFiles) {
+        if (check->mismatchCount == check->mismatchCapacity) {
+            check->mismatchCapacity = check->mismatchCapacity == 0 ? 16 : check->mismatchCapacity * 2;
+            check->mismatches = (Mismatch*)realloc(check->mismatches, check->mismatchCapacity * sizeof(Mismatch));
+        }
+        check->mismatches[check->mismatchCount++] = (Mismatch){{dir, depth}, sum};
+    }
+    if (depth > 0) {
+        check->sums[depth - 1].bytes += sum.bytes;
+        check->sums[depth - 1].files += sum.files;
     }
-    inodeTable.isAllocated[root->dir.inodeIndex] = true; // 루트 디렉터리 inode 사용 표시
+}
 
-    char command[100], name[100], parentName[100], content[1024];
+// 모든 디렉터리의 집계값을 전체 탐색 결과와 비교한다. 어긋난 디렉터리 수를 돌려준다.
+// 한 번의 후위 탐색으로 디렉터리마다 실제 합계를 아래에서부터 쌓고, 어긋난 디렉터리는 트리 순서로 출력한다.
+// 다른 스레드가 바꾸는 중이면 잠깐 어긋나 보일 수 있으므로 명령 처리부는 단독으로 들어와서 부른다.
+int checkDirectoryAggregates(Node* node) {
+    if (node->type != DIR_TYPE) {
+        return 0;
+    }
+    CheckState check = {(SubtreeSum*)malloc(64 * sizeof(SubtreeSum)), 64, NULL, 0, 0};
+    walkTree(node, WALK_LOCKED, checkEnter, checkLeave, &check);
+    // 키의 깊이는 정렬에서만 쓰므로 node 기준 깊이여도 된다
+    qsort(check.mismatches, check.mismatchCount, sizeof(Mismatch), compareTreeOrder);
+    for (int i = 0; i < check.mismatchCount; i++) {
+        Node* dir = check.mismatches[i].key.node;
+        printf("집계 불일치: '%s' 저장값 %ld bytes/%ld개, 실제 %ld bytes/%ld개\n", dir->name,
+               dir->dir->subtreeBytes, dir->dir->subtreeFiles, check.mismatches[i].actual.bytes, check.mismatches[i].actual.files);
+    }
+    int mismatches = check.mismatchCount;
+    free(check.sums);
+    free(check.mismatches);
+    return mismatches;
+}
 
-    while (1) {
-        printf("명령을 입력하세요 (makedir, makefile, readfile, updatefile, searchfile, print, delete, rename, copy, dirsize, quit): ");
-        scanf("%s", command);
+// scanf(" %[^\n]")처럼 앞의 공백을 건너뛰고 줄 끝까지 읽되, 길이 제한 없이 읽는다.
+static char* readContentLine() {
+    int c;
+    while ((c = getchar()) != EOF && (c == ' ' || c == '\t' || c == '\n' || c == '\r')) {
+    }
+    if (c == EOF) {
+        return NULL;
+    }
+    ungetc(c, stdin);
+
+    char* line = NULL;
+    size_t capacity = 0;
+    ssize_t length = getline(&line, &capacity, stdin);
+    if (length < 0) {
+        free(line);
+        return NULL;
+    }
+    if (length > 0 && line[length - 1] == '\n') {
+        line[length - 1] = '\0';
+    }
+    return line;
+}
+
+// 명령 인자의 종류. ARG_DIR은 디렉터리 경로로, 받자마자 찾아 보고 없으면 명령을 취소한다.
+typedef enum {
+    ARG_DIR,
+    ARG_WORD, // 공백 없는 한 단어
+    ARG_LINE // 줄 끝까지 (공백 포함)
+} ArgKind;
+
+typedef struct CommandArg {
+    ArgKind kind;
+    const char* prompt; // 대화형 모드에서 보여줄 안내
+} CommandArg;
+
+typedef enum {
+    CMD_MAKEDIR, CMD_MAKEFILE, CMD_READFILE, CMD_UPDATEFILE, CMD_SEARCHFILE, CMD_PRINT,
+    CMD_RENAME, CMD_DELETE, CMD_COPY, CMD_DIRSIZE, CMD_DIRCHECK, CMD_MEMSTAT, CMD_STATS,
+    CMD_IMPORT, CMD_EXPORT, CMD_DEDUPSTAT, CMD_COMPRESS, CMD_FIND,
+    CMD_APPENDFILE, CMD_WRITEFILE, CMD_TRUNCATEFILE, CMD_READRANGE
+} CommandId;
+
+#define MAX_COMMAND_ARGS JOURNAL_MAX_ARGS
+
+typedef struct Command {
+    const char* name;
+    CommandId id;
+    JournalOp journalOp; // 0이면 트리를 바꾸지 않는 명령
+    int argCount;
+    CommandArg args[MAX_COMMAND_ARGS];
+} Command;
+
+#define PARENT_ARG {ARG_DIR, "부모 디렉터리 경로: "}
+#define TYPE_ARG {ARG_WORD, "타입 ('file' 또는 'dir'): "}
+
+// 대화형 모드와 배치 모드가 같은 표를 쓴다. 인자 순서는 저널 레코드의 인자 순서와 같다.
+static const Command commands[] = {
+    {"makedir", CMD_MAKEDIR, JOURNAL_MAKEDIR, 2, {PARENT_ARG, {ARG_WORD, "이름: "}}},
+    {"makefile", CMD_MAKEFILE, JOURNAL_MAKEFILE, 3, {PARENT_ARG, {ARG_WORD, "이름: "}, {ARG_LINE, "파일 내용: "}}},
+    {"readfile", CMD_READFILE, 0, 2, {PARENT_ARG, {ARG_WORD, "파일 이름: "}}},
+    {"updatefile", CMD_UPDATEFILE, JOURNAL_UPDATEFILE, 3, {PARENT_ARG, {ARG_WORD, "파일 이름: "}, {ARG_LINE, "새로운 파일 내용: "}}},
+    {"searchfile", CMD_SEARCHFILE, 0, 1, {{ARG_LINE, "검색할 키워드: "}}},
+    {"print", CMD_PRINT, 0, 0, {}},
+    {"rename", CMD_RENAME, JOURNAL_RENAME, 4, {PARENT_ARG, {ARG_WORD, "변경할 파일/디렉터리의 이름: "}, {ARG_WORD, "새 이름: "}, TYPE_ARG}},
+    {"delete", CMD_DELETE, JOURNAL_DELETE, 3, {PARENT_ARG, {ARG_WORD, "삭제할 파일/디렉터리의 이름: "}, TYPE_ARG}},
+    {"copy", CMD_COPY, JOURNAL_COPY, 5, {PARENT_ARG, {ARG_WORD, "복사할 파일/디렉터리의 이름: "}, TYPE_ARG,
+                                          {ARG_WORD, "어디에 복사할지. 디렉터리의 경로: "}, {ARG_WORD, "복사할 파일/디렉터리의 새 이름: "}}},
+    {"dirsize", CMD_DIRSIZE, 0, 1, {PARENT_ARG}},
+    {"dircheck", CMD_DIRCHECK, 0, 0, {}},
+    {"memstat", CMD_MEMSTAT, 0, 0, {}},
+    {"stats", CMD_STATS, 0, 0, {}},
+    {"import", CMD_IMPORT, 0, 2, {{ARG_WORD, "가져올 호스트 디렉터리: "}, {ARG_DIR, "넣을 디렉터리 경로: "}}},
+    {"export", CMD_EXPORT, 0, 2, {{ARG_DIR, "내보낼 디렉터리 경로: "}, {ARG_WORD, "호스트 디렉터리: "}}},
+    {"dedupstat", CMD_DEDUPSTAT, 0, 0, {}},
+    {"compress", CMD_COMPRESS, 0, 1, {{ARG_WORD, "몇 초 넘게 쓰지 않은 파일을 압축할지: "}}},
+    {"find", CMD_FIND, 0, 2, {{ARG_DIR, "찾을 디렉터리 경로: "}, {ARG_LINE, "조건 (예: size>1000 mtime<3600 name=*.txt): "}}},
+    {"appendfile", CMD_APPENDFILE, JOURNAL_APPENDFILE, 3, {PARENT_ARG, {ARG_WORD, "파일 이름: "}, {ARG_LINE, "덧붙일 내용: "}}},
+    {"writefile", CMD_WRITEFILE, JOURNAL_WRITEFILE, 4, {PARENT_ARG, {ARG_WORD, "파일 이름: "}, {ARG_WORD, "쓸 위치 (바이트): "},
+                                                      {ARG_LINE, "쓸 내용: "}}},
+    {"truncatefile", CMD_TRUNCATEFILE, JOURNAL_TRUNCATEFILE, 3, {PARENT_ARG, {ARG_WORD, "파일 이름: "}, {ARG_WORD, "새 크기 (바이트): "}}},
+    {"readrange", CMD_READRANGE, 0, 4, {PARENT_ARG, {ARG_WORD, "파일 이름: "}, {ARG_WORD, "읽을 위치 (바이트): "},
+                                        {ARG_WORD, "읽을 길이 (바이트): "}}},
+};
+#define COMMAND_COUNT (sizeof(commands) / sizeof(commands[0]))
+
+static const Command* findCommand(const char* name) {
+    for (size_t i = 0; i < COMMAND_COUNT; i++) {
+        if (strcmp(commands[i].name, name) == 0) {
+            return &commands[i];
+        }
+    }
+    return NULL;
+}
+
+static NodeType parseType(const char* typeName) {
+    return strcmp(typeName, "dir") == 0 ? DIR_TYPE : FILE_TYPE;
+}
+
+static Node* resolveDirectory(Node* root, const char* path) {
+    Node* node = resolvePath(root, path, DIR_TYPE);
+    if (node == NULL || node->type != DIR_TYPE) {
+        printf("'%s' 디렉터리를 찾을 수 없습니다.\n", path);
+        return NULL;
+    }
+    return node;
+}
+
+// 바이트 수 인자. 0 이상의 정수가 아니면 안내하고 false.
+static bool parseByteCount(const char* text, long* value) {
+    char* end;
+    *value = strtol(text, &end, 10);
+    if (*text == '\0' || *end != '\0' || *value < 0) {
+        printf("'%s'은(는) 올바른 바이트 수가 아닙니다.\n", text);
+        return false;
+    }
+    return true;
+}
+
+// 파일 일부를 읽고 쓰는 명령. fd API(openfile.h)로 열어 닿는 바이트만 다룬다. appendfile은 파일이 없으면 만든다.
+static void fileRangeCommand(Node* parent, CommandId id, char** args) {
+    long number = 0, length = 0;
+    if (id != CMD_APPENDFILE && !parseByteCount(args[2], &number)) {
+        return;
+    }
+    if (id == CMD_READRANGE && !parseByteCount(args[3], &length)) {
+        return;
+    }
+    int flags = id == CMD_READRANGE ? FS_O_READ : id == CMD_APPENDFILE ? FS_O_WRITE | FS_O_APPEND | FS_O_CREATE : FS_O_WRITE;
+    int fd = fs_open(parent, args[1], flags);
+    if (fd < 0) {
+        printf("'%s' 파일을 찾을 수 없습니다.\n", args[1]);
+        return;
+    }
+    bool done = true;
+    if (id == CMD_APPENDFILE) {
+        done = fs_append(fd, args[2], strlen(args[2])) >= 0;
+        if (done) {
+            FS_NOTICE("파일 '%s'에 %zu바이트를 덧붙였습니다.\n", args[1], strlen(args[2]));
+        }
+    } else if (id == CMD_WRITEFILE) {
+        done = fs_pwrite(fd, args[3], strlen(args[3]), number) >= 0;
+        if (done) {
+            FS_NOTICE("파일 '%s'의 %ld번째 바이트부터 %zu바이트를 썼습니다.\n", args[1], number, strlen(args[3]));
+        }
+    } else if (id == CMD_TRUNCATEFILE) {
+        done = fs_truncate(fd, number) == 0;
+        if (done) {
+            FS_NOTICE("파일 '%s'의 크기를 %ld bytes로 바꿨습니다.\n", args[1], number);
+        }
+    } else {
+        long size = fs_lseek(fd, 0, SEEK_END);
+        long available = number < size ? size - number : 0;
+        char* buffer = (char*)malloc(length < available ? length + 1 : available + 1);
+        ssize_t got = fs_pread(fd, buffer, length < available ? length : available, number);
+        printf("파일 내용 [%ld, %ld): ", number, number + (long)got);
+        fwrite(buffer, 1, (size_t)got, stdout);
+        printf("\n");
+        free(buffer);
+    }
+    if (!done) {
+        printf("파일 내용을 저장할 블록이 부족합니다.\n");
+    }
+    fs_close(fd);
+}
+
+// 가져온 내용과 압축은 저널에 남기지 않으므로, 끝나면 명령 루프가 바로 체크포인트한다.
+static __thread bool checkpointRequested = false;
 
-        if (strcmp(command, "quit") == 0) {
+// 인자를 모두 받은 명령을 실행한다. parent는 디렉터리 경로 인자(ARG_DIR)를 찾은 노드다.
+// 변경 명령은 검사를 통과하면 적용하기 직전에 pendingRecord를 저널에 남긴다.
+static void executeCommand(Node* root, const Command* command, Node* parent, char** args) {
+    switch (command->id) {
+    case CMD_MAKEDIR:
+        if (makeChild(parent, args[1], DIR_TYPE, NULL) != NULL) {
+            FS_NOTICE("디렉터리 '%s' 가 생성되었습니다.\n", args[1]);
+        }
+        break;
+    case CMD_MAKEFILE:
+        if (makeChild(parent, args[1], FILE_TYPE, args[2]) != NULL) {
+            FS_NOTICE("파일 '%s' 가 생성되었습니다.\n", args[1]);
+        }
+        break;
+    case CMD_READFILE:
+        readfile(parent, args[1]);
+        break;
+    case CMD_UPDATEFILE:
+        updatefile(parent, args[1], args[2]);
+        break;
+    case CMD_SEARCHFILE:
+        searchfile(root, args[0]);
+        break;
+    case CMD_PRINT:
+        printTree(root, 0);
+        break;
+    case CMD_RENAME:
+        renameNode(parent, args[1], args[2], parseType(args[3]));
+        break;
+    case CMD_DELETE:
+        deleteNode(parent, args[1], parseType(args[2]));
+        break;
+    case CMD_COPY: {
+        Node* targetParent = resolveDirectory(root, args[3]);
+        if (targetParent != NULL) {
+            copyNode(parent, args[1], args[4], parseType(args[2]), targetParent);
+        }
+        break;
+    }
+    case CMD_DIRSIZE:
+        printDirectorySize(parent);
+        break;
+    case CMD_DIRCHECK:
+        printf("디렉터리 집계 검사 완료: 불일치 %d개\n", checkDirectoryAggregates(root));
+        break;
+    case CMD_MEMSTAT:
+        printMemoryStats();
+        if (journalIsOpen()) {
+            JournalStats stats = journalGetStats();
+            printf("저널: 레코드 %lu개, fdatasync %lu회, %lu bytes 기록, 시작 시 재적용 %lu개\n",
+                   stats.records, stats.flushes, stats.bytes, stats.replayed);
+        }
+        break;
+    case CMD_STATS:
+        statsPrint();
+        break;
+    case CMD_IMPORT:
+        checkpointRequested = importTree(parent, args[0]);
+        break;
+    case CMD_EXPORT:
+        exportTree(parent, args[1]);
+        break;
+    case CMD_DEDUPSTAT:
+        printDedupStats();
+        break;
+    case CMD_COMPRESS: {
+        char* end;
+        long after = strtol(args[0], &end, 10);
+        if (*end != '\0' || after < 0) {
+            printf("'%s'은(는) 올바른 초가 아닙니다.\n", args[0]);
             break;
-        } else if (strcmp(command, "makedir") == 0 || strcmp(command, "makefile") == 0) {
-            printf("부모 디렉터리 이름: ");
-            scanf("%s", parentName);
-            Node* parentNode = findNode(root, parentName, DIR_TYPE);
+        }
+        int compressed = compressColdFiles(after);
+        printf("파일 %d개를 압축했습니다.\n", compressed);
+        checkpointRequested = compressed > 0;
+        break;
+    }
+    case CMD_FIND:
+        findFiles(parent, args[1]);
+        break;
+    case CMD_APPENDFILE:
+    case CMD_WRITEFILE:
+    case CMD_TRUNCATEFILE:
+    case CMD_READRANGE:
+        fileRangeCommand(parent, command->id, args);
+        break;
+    }
+}
 
-            if (parentNode == NULL || parentNode->type != DIR_TYPE) {
-                printf("'%s' 디렉터리를 찾을 수 없습니다.\n", parentName);
-                continue;
-            }
+// 노드를 해제하거나 트리 전체가 멈춰 있어야 하는 명령만 단독으로 들어온다.
+static bool needsExclusive(const Command* command, char** args) {
+    switch (command->id) {
+    case CMD_DELETE:
+    case CMD_DIRCHECK:
+    case CMD_DEDUPSTAT:
+    case CMD_COMPRESS:
+    case CMD_IMPORT: // 색인을 낡은 것으로 표시하므로, 공유로 들어온 검색이 그 표시를 보지 않게 한다
+        return true;
+    case CMD_COPY:
+        return parseType(args[2]) == DIR_TYPE;
+    case CMD_SEARCHFILE:
+        return __atomic_load_n(&contentIndexStale, __ATOMIC_ACQUIRE); // 색인을 다시 만들면서 모든 파일을 읽는다
+    case CMD_FIND:
+        return __atomic_load_n(&metaIndexStale, __ATOMIC_ACQUIRE);
+    default:
+        return false;
+    }
+}
 
-            printf("이름: ");
-            scanf("%s", name);
+// 디렉터리 경로 인자의 위치. 없으면 -1.
+static int directoryArg(const Command* command) {
+    for (int i = 0; i < command->argCount; i++) {
+        if (command->args[i].kind == ARG_DIR) {
+            return i;
+        }
+    }
+    return -1;
+}
 
-            // 여기에 추가된 부분: 같은 이름의 자식 노드가 있는지 검사
-            if (strcmp(command, "makedir") == 0) {
-                int foundDirectory = hasChildWithName(parentNode, name, DIR_TYPE);
-                if (foundDirectory) {
-                    printf("같은 이름의 디렉터리가 이미 존재합니다: %s\n", name);
-                    continue; // 같은 이름의 노드가 있으면 명령을 건너뛴다
-                }
-            } else if (strcmp(command, "makefile") == 0) {
-                int foundFile = hasChildWithName(parentNode, name, FILE_TYPE);
-                if (foundFile) {
-                    printf("같은 이름의 파일이 이미 존재합니다: %s\n", name);
-                    continue; // 같은 이름의 노드가 있으면 명령을 건너뛴다
-                }
-            }
+// 트리에 들어온 뒤 디렉터리 경로 인자를 다시 찾아 명령을 실행하고, 걸린 시간을 명령 이름별 히스토그램에 남긴다.
+// 들어오기 전에 찾아 둔 노드는 그 사이 다른 스레드가 지웠을 수 있으므로 쓰지 않는다.
+// journaled가 참이면 변경 명령을 저널에 남긴다. 디렉터리를 찾지 못하면 false.
+static bool runCommand(Node* root, const Command* command, char** args, bool journaled) {
+    STATS_TIMER_START(start);
+    bool exclusive = needsExclusive(command, args);
+    for (;;) {
+        if (exclusive) {
+            fsEnterExclusive();
+            break;
+        }
+        fsEnterShared();
+        // 들어오기 전에 본 색인 표시가 그 사이 바뀌었으면 공유로는 다시 만들 수 없으므로 단독으로 다시 들어온다
+        if (!needsExclusive(command, args)) {
+            break;
+        }
+        fsExitShared();
+        exclusive = true;
+    }
+    commandClock = replayClock != 0 ? replayClock : time(NULL);
+    bool writes = journaled && command->journalOp != 0;
+    if (writes) {
+        journalBeginWrite();
+    }
+    Node* parent = NULL;
+    int dirArg = directoryArg(command);
+    bool found = dirArg < 0 || (parent = resolveDirectory(root, args[dirArg])) != NULL;
+    pendingRecord.sequence = 0;
+    if (found) {
+        if (writes) {
+            pendingRecord = (PendingRecord){command->journalOp, command->argCount, (const char* const*)args, 0};
+        }
+        executeCommand(root, command, parent, args);
+        pendingRecord.op = 0; // 검사에서 걸려 남기지 않은 레코드
+    }
+    if (exclusive) {
+        fsExitExclusive();
+    } else {
+        fsExitShared();
+    }
+    if (writes) {
+        journalEndWrite(pendingRecord.sequence); // 변경이 디스크에 남은 뒤에 명령을 끝낸다
+    }
+    commandClock = 0;
+    STATS_RECORD_COMMAND(command->name, start);
+    return found;
+}
+
+// 저널 레코드를 같은 명령으로 다시 실행한다. 레코드는 검사를 통과한 명령만 남기므로
+// 이미지 위에 순서대로 다시 적용하면 종료 직전의 트리가 된다.
+static void applyJournalRecord(const JournalRecord* record, void* context) {
+    Node* root = (Node*)context;
+    for (size_t i = 0; i < COMMAND_COUNT; i++) {
+        if (commands[i].journalOp == record->op) {
+            replayClock = record->time; // 원래 명령의 생성/수정 시간을 되살린다
+            runCommand(root, &commands[i], (char**)record->args, false);
+            replayClock = 0;
+            return;
+        }
+    }
+}
 
-            if (strcmp(command, "makedir") == 0) {
-                Node* newDir = createNode(name, DIR_TYPE, parentNode);
-                addChild(parentNode, newDir);
-                printf("디렉터리 '%s' 가 생성되었습니다.\n", name);
-            } else { // makefile
-                printf("파일 내용: ");
-                scanf(" %[^\n]s", content); // 공백을 포함한 내용을 받기 위해 수정
-                Node* newFile = createNode(name, FILE_TYPE, parentNode);
-                strcpy(newFile->file.content, content);
-                newFile->file.inode.fileSize = strlen(content); // 파일 크기 설정
-                addChild(parentNode, newFile);
-                updateFileContent(newFile, content);
-                printf("파일 '%s' 가 생성되었습니다.\n", name);
+// 이미지를 저장하고, 저장이 끝났으면 이미지에 반영된 저널을 비운다.
+// MINIOS_COMPRESS_AFTER가 있으면 저장하기 전에 오래 쓰지 않은 파일을 압축한다.
+static void checkpoint(Node* root, const char* image) {
+    fsEnterExclusive();
+    long after = compressAfter();
+    if (after >= 0) {
+        compressColdFiles(after);
+    }
+    if (saveImage(root, image, journalSequence())) {
+        journalCheckpoint();
+        FS_NOTICE("이미지 '%s'에 저장했습니다.\n", image);
+    }
+    fsExitExclusive();
+}
+
+// MINIOS_COMPRESS_AFTER가 있으면 명령 사이에 그 간격(최소 1초)마다 오래 쓰지 않은 파일을 압축한다.
+// 이미지를 쓰면 압축한 뒤 바로 체크포인트한다.
+static void compressIfDue(Node* root, const char* image) {
+    static __thread time_t lastSweep = 0;
+    long after = compressAfter();
+    time_t now = time(NULL);
+    if (after < 0 || now - lastSweep < (after > 0 ? after : 1)) {
+        return;
+    }
+    lastSweep = now;
+    fsEnterExclusive();
+    int compressed = compressColdFiles(after);
+    fsExitExclusive();
+    if (compressed > 0 && image != NULL) {
+        checkpoint(root, image);
+    }
+}
+
+// 저장된 이미지가 있으면 이어서 쓰고, 없으면 빈 루트에서 시작한다.
+// 이미지 뒤에 남은 저널은 다시 적용하고 바로 체크포인트한다.
+static Node* openSession(const char** image) {
+    initFileSystem();
+
+    *image = imagePath();
+    unsigned long long appliedSequence = 0;
+    Node* root = *image != NULL ? loadImage(*image, &appliedSequence) : NULL;
+    if (root != NULL) {
+        FS_NOTICE("이미지 '%s'에서 노드 %d개를 불러왔습니다.\n", *image, superblock.usedInodes);
+    } else {
+        root = createNode("root", DIR_TYPE, NULL);
+    }
+
+    if (*image != NULL) {
+        // 파일 내용은 <이미지>.blocks에 두고 버퍼 캐시를 거친다. 캐시가 더러운 페이지를 쓰기 전에 저널을 먼저 내려보낸다.
+        cacheSetWritebackHook(journalSync);
+        if (cacheBudget() > 0 && !blockStoreBacked()) {
+            imageAttachData(*image);
+        }
+        char journalPath[4096];
+        snprintf(journalPath, sizeof(journalPath), "%s.journal", *image);
+        if (journalOpen(journalPath, appliedSequence)) {
+            int replayed = journalReplay(applyJournalRecord, root);
+            if (replayed > 0) {
+                FS_NOTICE("저널에서 변경 %d개를 다시 적용했습니다.\n", replayed);
+                checkpoint(root, *image);
             }
-        } else if (strcmp(command, "readfile") == 0) {
-            printf("부모 디렉터리 이름: ");
-            scanf("%s", parentName);
-            Node* parentNode = findNode(root, parentName, DIR_TYPE);
-            if (parentNode == NULL || parentNode->type != DIR_TYPE) {
-                printf("'%s' 디렉터리를 찾을 수 없습니다.\n", parentName);
+        }
+    }
+    return root;
+}
+
+static void closeSession(Node* root, const char* image) {
+    if (image != NULL) {
+        checkpoint(root, image);
+        journalClose();
+    }
+    // 작업 스레드는 다음 세션이 처음 쓸 때 다시 만든다
+    workPoolShutdown();
+}
+
+void dir_main() {
+    const char* image;
+    Node* root = openSession(&image);
+
+    char word[100];
+    char words[MAX_COMMAND_ARGS][100];
+
+    while (1) {
+        printf("명령을 입력하세요 (makedir, makefile, readfile, updatefile, searchfile, print, delete, rename, copy, dirsize, dircheck, memstat, stats, import, export, dedupstat, compress, find, appendfile, writefile, truncatefile, readrange, quit): ");
+        if (scanf("%99s", word) != 1 || strcmp(word, "quit") == 0) {
+            break;
+        }
+        const Command* command = findCommand(word);
+        if (command == NULL) {
+            printf("알 수 없는 명령입니다.\n");
+            continue;
+        }
+
+        // 인자마다 안내를 보여주고 받는다. 디렉터리 경로는 받자마자 확인한다.
+        char* args[MAX_COMMAND_ARGS] = {NULL};
+        char* line = NULL;
+        bool ready = true, ended = false;
+        for (int i = 0; i < command->argCount && ready; i++) {
+            printf("%s", command->args[i].prompt);
+            if (command->args[i].kind == ARG_LINE) {
+                line = readContentLine(); // 공백을 포함한 내용을 길이 제한 없이 받는다
+                ended = line == NULL;
+                ready = !ended;
+                args[i] = line;
                 continue;
             }
-            printf("파일 이름: ");
-            scanf("%s", name);
-            readfile(parentNode, name);
-        } else if (strcmp(command, "updatefile") == 0) {
-            printf("부모 디렉터리 이름: ");
-            scanf("%s", parentName);
-            Node* parentNode = findNode(root, parentName, DIR_TYPE);
-            if (parentNode == NULL || parentNode->type != DIR_TYPE) {
-                printf("'%s' 디렉터리를 찾을 수 없습니다.\n", parentName);
-                continue;
+            if (scanf("%99s", words[i]) != 1) {
+                ended = true;
+                ready = false;
+                break;
             }
-            printf("파일 이름: ");
-            scanf("%s", name);
-            printf("새로운 파일 내용: ");
-            scanf(" %[^\n]s", content); // 공백을 포함한 내용을 받기 위해 수정
-            updatefile(parentNode, name, content);
-        } else if (strcmp(command, "searchfile") == 0) {
-            printf("검색할 키워드: ");
-            scanf(" %[^\n]s", content); // 공백을 포함한 키워드를 받기 위해 수정
-            searchfile(root, content);
-        } else if (strcmp(command, "print") == 0) {
-            printTree(root, 0);
-        } else if (strcmp(command, "rename") ==0) {
-            char oldName[100];
-            char newName[100];
-            NodeType type;
-            char typeName[10];
-
-            printf("부모 디렉터리 이름: ");
-            scanf("%s", parentName);
-            Node* parentNode = findNode(root, parentName, DIR_TYPE);
-            if (parentNode == NULL || parentNode->type != DIR_TYPE) {
-                printf("'%s' 디렉터리를 찾을 수 없습니다.\n", parentName);
-                continue;
+            args[i] = words[i];
+            if (command->args[i].kind == ARG_DIR) {
+                fsEnterShared();
+                ready = resolveDirectory(root, args[i]) != NULL; // 없는 경로면 나머지 인자를 묻지 않는다
+                fsExitShared();
             }
+        }
+        if (ready) {
+            runCommand(root, command, args, true);
+        }
+        if (checkpointRequested && image != NULL) {
+            checkpoint(root, image);
+        }
+        checkpointRequested = false;
+        compressIfDue(root, image);
+        free(line);
+        if (ended) {
+            break;
+        }
+    }
 
-            printf("변경할 파일/디렉터리의 이름: ");
-            scanf("%s", oldName);
-            printf("새 이름: ");
-            scanf("%s", newName);
-            printf("타입 ('file' 또는 'dir'): ");
-            scanf("%s", typeName);
-            type = strcmp(typeName, "dir") == 0 ? DIR_TYPE : FILE_TYPE;
-
-            renameNode(parentNode, oldName, newName, type);
-        } else if (strcmp(command, "delete") == 0) {
-            NodeType type;
-            char typeName[10];
-
-            printf("부모 디렉터리 이름: ");
-            scanf("%s", parentName);
-            Node* parentNode = findNode(root, parentName, DIR_TYPE);
-            if (parentNode == NULL || parentNode->type != DIR_TYPE) {
-                printf("'%s' 디렉터리를 찾을 수 없습니다.\n", parentName);
-                continue;
-            }
+    // 트리 출력은 작업 스레드로 나눠 돌므로 세션이 풀을 내리기 전에 한다
+    printTree(root, 0);
+    closeSession(root, image);
+    destroyFileSystem(root);
+}
 
-            printf("삭제할 파일/디렉터리의 이름: ");
-            scanf("%s", name);
-            printf("타입 ('file' 또는 'dir'): ");
-            scanf("%s", typeName);
-            type = strcmp(typeName, "dir") == 0 ? DIR_TYPE : FILE_TYPE;
-
-            deleteNode(parentNode, name, type);
-        } else if (strcmp(command, "copy") == 0) {            
-            char newName[100];
-            char nodeName[100];
-            NodeType type;
-            char typeName[10];
-
-            printf("부모 디렉터리 이름: ");
-            scanf("%s", parentName);
-            Node* parentNode = findNode(root, parentName, DIR_TYPE);
-            if (parentNode == NULL || parentNode->type != DIR_TYPE) {
-                printf("'%s' 디렉터리를 찾을 수 없습니다.\n", parentName);
-                continue;
-            }
+// 공백으로 구분된 다음 단어를 잘라 낸다. 없으면 NULL.
+static char* nextToken(char** cursor) {
+    char* start = *cursor;
+    while (*start == ' ' || *start == '\t') {
+        start++;
+    }
+    if (*start == '\0') {
+        *cursor = start;
+        return NULL;
+    }
+    char* end = start;
+    while (*end != '\0' && *end != ' ' && *end != '\t') {
+        end++;
+    }
+    if (*end != '\0') {
+        *end++ = '\0';
+    }
+    *cursor = end;
+    return start;
+}
+
+// 배치 모드: 한 줄에 명령 하나씩 ("makefile /a/b 이름 내용…"). 마지막 ARG_LINE 인자는 줄 끝까지다.
+// 빈 줄과 '#'으로 시작하는 줄은 건너뛴다. quiet이면 작업마다 나오는 안내 메시지를 끈다.
+// 끝나면 체크포인트하고, 처리하지 못한 줄 수를 돌려준다.
+int dir_batch(FILE* input, bool quiet) {
+    quietMode = quiet;
+    const char* image;
+    Node* root = openSession(&image);
+
+    char* line = NULL;
+    size_t capacity = 0;
+    ssize_t length;
+    long lineNumber = 0;
+    int failures = 0;
+    while ((length = getline(&line, &capacity, input)) >= 0) {
+        lineNumber++;
+        while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r')) {
+            line[--length] = '\0';
+        }
+        char* cursor = line;
+        char* name = nextToken(&cursor);
+        if (name == NULL || name[0] == '#') {
+            continue;
+        }
+        if (strcmp(name, "quit") == 0) {
+            break;
+        }
+        const Command* command = findCommand(name);
+        if (command == NULL) {
+            printf("%ld번째 줄: 알 수 없는 명령 '%s'\n", lineNumber, name);
+            failures++;
+            continue;
+        }
 
-            printf("복사할 파일/디렉터리의 이름: ");
-            scanf("%s", name);
-            printf("타입 ('file' 또는 'dir'): ");
-            scanf("%s", typeName);
-            printf("어디에 복사할지. 디렉터리의 이름: ");
-            scanf("%s", nodeName);
-            printf("복사할 파일/디렉터리의 새 이름: ");
-            scanf("%s", newName);
-            type = strcmp(typeName, "dir") == 0 ? DIR_TYPE : FILE_TYPE;
-            
-            Node* newNode = findNode(root, nodeName, DIR_TYPE);
-
-            copyNode(parentNode, name, newName, type, newNode);
-
-        } else if(strcmp(command, "dirsize") == 0) {
-            printf("부모 디렉터리 이름: ");
-            scanf("%s", parentName);
-            Node* parentNode = findNode(root, parentName, DIR_TYPE);
-            if (parentNode == NULL || parentNode->type != DIR_TYPE) {
-                printf("'%s' 디렉터리를 찾을 수 없습니다.\n", parentName);
+        char* args[MAX_COMMAND_ARGS] = {NULL};
+        bool ready = true;
+        for (int i = 0; i < command->argCount && ready; i++) {
+            if (command->args[i].kind == ARG_LINE) {
+                while (*cursor == ' ' || *cursor == '\t') {
+                    cursor++;
+                }
+                args[i] = cursor;
+                cursor += strlen(cursor);
                 continue;
             }
-            printDirectorySize(parentNode);
+            args[i] = nextToken(&cursor);
+            if (args[i] == NULL) {
+                printf("%ld번째 줄: '%s' 명령의 인자가 부족합니다.\n", lineNumber, name);
+                ready = false;
+            } else if (strlen(args[i]) >= 100) {
+                printf("%ld번째 줄: '%s'이(가) 너무 깁니다.\n", lineNumber, args[i]);
+                ready = false;
+            }
         }
-        else {
-            printf("알 수 없는 명령입니다.\n");
+        if (!ready || !runCommand(root, command, args, true)) {
+            failures++;
+        }
+        if (checkpointRequested && image != NULL) {
+            checkpoint(root, image);
         }
+        checkpointRequested = false;
+        compressIfDue(root, image);
     }
+    free(line);
 
-    printTree(root, 0);
-    freeTree(root);
-
+    closeSession(root, image);
+    destroyFileSystem(root);
+    quietMode = false;
+    fflush(stdout);
+    return failures;
 }
@@ -0,0 +1,413 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/uio.h>
+#include "bcache.h"
+
+#define CACHE_IO_SEGMENTS 256 // preadv/pwritev 한 번에 넘기는 페이지 수
+
+typedef struct CacheFrame {
+    long page; // -1이면 비어 있다
+    int next; // 같은 해시 칸의 다음 프레임, 없으면 -1
+    int pins;
+    unsigned char references; // CLOCK 카운터 (0..2)
+    bool dirty;
+    bool loading; // 데이터 파일에서 읽는 중. 끝날 때까지 고정한 쪽도 기다린다
+} CacheFrame;
+
+typedef struct BufferCache {
+    int fd;
+    char* memory; // frameCount * CACHE_PAGE_BYTES
+    CacheFrame* frames;
+    int frameCount;
+    int usedFrames; // 앞에서부터 한 번이라도 쓴 프레임 수. 다 차기 전에는 내보내지 않는다
+    int* buckets; // 페이지 번호 -> 프레임 (체인)
+    unsigned long bucketMask;
+    int hand; // 시곗바늘
+    long nextSequential; // 마지막으로 읽어 온 페이지 다음 번호
+    int window; // 다음 순차 읽기 때 미리 읽을 페이지 수
+    int waiters; // 빈 프레임이나 읽기 완료를 기다리는 스레드 수
+    void (*writebackHook)(void);
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    CacheStats stats;
+} BufferCache;
+
+static BufferCache cache = { .fd = -1, .lock = PTHREAD_MUTEX_INITIALIZER, .changed = PTHREAD_COND_INITIALIZER };
+
+size_t cacheBudget(void) {
+    const char* value = getenv("MINIOS_CACHE_MB");
+    if (value == NULL || value[0] == '\0') {
+        return (size_t)CACHE_DEFAULT_MB << 20;
+    }
+    char* end;
+    long parsed = strtol(value, &end, 10);
+    return (*end == '\0' && parsed >= 0) ? (size_t)parsed << 20 : (size_t)CACHE_DEFAULT_MB << 20;
+}
+
+static unsigned long bucketOf(long page) {
+    return ((unsigned long)page * 0x9E3779B97F4A7C15ULL >> 17) & cache.bucketMask;
+}
+
+static int lookupFrame(long page) {
+    for (int index = cache.buckets[bucketOf(page)]; index >= 0; index = cache.frames[index].next) {
+        if (cache.frames[index].page == page) {
+            return index;
+        }
+    }
+    return -1;
+}
+
+static void hashFrame(int index, long page) {
+    unsigned long bucket = bucketOf(page);
+    cache.frames[index].page = page;
+    cache.frames[index].next = cache.buckets[bucket];
+    cache.buckets[bucket] = index;
+}
+
+static void unhashFrame(int index) {
+    int* link = &cache.buckets[bucketOf(cache.frames[index].page)];
+    while (*link != index) {
+        link = &cache.frames[*link].next;
+    }
+    *link = cache.frames[index].next;
+    cache.frames[index].page = -1;
+}
+
+static char* frameData(int index) {
+    return cache.memory + (size_t)index * CACHE_PAGE_BYTES;
+}
+
+// 번호가 이어진 페이지들을 데이터 파일과 주고받는다. 파일 끝을 넘어 읽은 부분은 0으로 채운다.
+static bool transferPages(bool write, long page, const int* frames, int count) {
+    struct iovec iov[CACHE_IO_SEGMENTS];
+    while (count > 0) {
+        int batch = count < CACHE_IO_SEGMENTS ? count : CACHE_IO_SEGMENTS;
+        for (int i = 0; i < batch; i++) {
+            iov[i].iov_base = frameData(frames[i]);
+            iov[i].iov_len = CACHE_PAGE_BYTES;
+        }
+        size_t length = (size_t)batch * CACHE_PAGE_BYTES;
+        size_t done = 0;
+        while (done < length) {
+            // 앞에서 끝난 조각을 건너뛴다
+            int first = (int)(done / CACHE_PAGE_BYTES);
+            size_t inPage = done % CACHE_PAGE_BYTES;
+            iov[first].iov_base = frameData(frames[first]) + inPage;
+            iov[first].iov_len = CACHE_PAGE_BYTES - inPage;
+            off_t offset = (off_t)(page * CACHE_PAGE_BYTES + done);
+            ssize_t moved = write ? pwritev(cache.fd, iov + first, batch - first, offset)
+                                  : preadv(cache.fd, iov + first, batch - first, offset);
+            if (moved < 0 && errno == EINTR) {
+                continue;
+            }
+            if (moved < 0 || (moved == 0 && write)) {
+                printf("데이터 파일을 %s 수 없습니다: %s\n", write ? "쓸" : "읽을", strerror(errno));
+                if (!write) {
+                    memset(frameData(frames[first]) + inPage, 0, CACHE_PAGE_BYTES - inPage);
+                    for (int i = first + 1; i < batch; i++) {
+                        memset(frameData(frames[i]), 0, CACHE_PAGE_BYTES);
+                    }
+                }
+                return false;
+            }
+            if (moved == 0) { // 아직 한 번도 쓰지 않은 영역
+                memset(frameData(frames[first]) + inPage, 0, CACHE_PAGE_BYTES - inPage);
+                for (int i = first + 1; i < batch; i++) {
+                    memset(frameData(frames[i]), 0, CACHE_PAGE_BYTES);
+                }
+                break;
+            }
+            done += (size_t)moved;
+            if (write) {
+                cache.stats.writeCalls++;
+            }
+        }
+        page += batch;
+        frames += batch;
+        count -= batch;
+    }
+    return true;
+}
+
+static int compareFramePage(const void* left, const void* right) {
+    long a = cache.frames[*(const int*)left].page;
+    long b = cache.frames[*(const int*)right].page;
+    return a < b ? -1 : a > b;
+}
+
+// 더러운 프레임들을 페이지 번호순으로 정렬해 이어진 구간마다 한 번에 쓴다. 잠금 안에서 부른다.
+static void writeFrames(int* frames, int count) {
+    if (count == 0) {
+        return;
+    }
+    if (cache.writebackHook != NULL) {
+        cache.writebackHook();
+    }
+    qsort(frames, count, sizeof(int), compareFramePage);
+    int start = 0;
+    for (int i = 1; i <= count; i++) {
+        if (i < count && cache.frames[frames[i]].page == cache.frames[frames[i - 1]].page + 1) {
+            continue;
+        }
+        if (transferPages(true, cache.frames[frames[start]].page, frames + start, i - start)) {
+            for (int j = start; j < i; j++) {
+                cache.frames[frames[j]].dirty = false;
+            }
+            cache.stats.writebacks += i - start;
+        }
+        start = i;
+    }
+}
+
+static bool evictable(const CacheFrame* frame) {
+    return frame->pins == 0 && !frame->loading;
+}
+
+// 내보낼 더러운 프레임과 함께, 바늘 앞쪽에서 곧 내보낼 더러운 프레임들을 모아 쓴다.
+static void writeBatch(int victim) {
+    int batch[CACHE_WRITEBACK_BATCH];
+    int count = 0;
+    batch[count++] = victim;
+    for (int i = 0; i < cache.frameCount && count < CACHE_WRITEBACK_BATCH; i++) {
+        int index = (cache.hand + i) % cache.frameCount;
+        if (index != victim && cache.frames[index].dirty && evictable(&cache.frames[index])) {
+            batch[count++] = index;
+        }
+    }
+    writeFrames(batch, count);
+}
+
+// 빈 프레임을 하나 마련한다. 모두 고정되어 있으면 -1. 잠금 안에서 부른다.
+static int evictFrame(void) {
+    if (cache.usedFrames < cache.frameCount) {
+        return cache.usedFrames++;
+    }
+    // 카운터가 최대 2이므로 세 바퀴 안에 고정되지 않은 프레임은 하나 이상 0이 된다
+    for (int step = 0; step < 3 * cache.frameCount; step++) {
+        int index = cache.hand;
+        CacheFrame* frame = &cache.frames[index];
+        cache.hand = (cache.hand + 1) % cache.frameCount;
+        if (!evictable(frame)) {
+            continue;
+        }
+        if (frame->references > 0) {
+            frame->references--;
+            continue;
+        }
+        if (frame->dirty) {
+            writeBatch(index);
+            if (frame->dirty) { // 쓰지 못했으면 내보내지 않는다
+                continue;
+            }
+        }
+        unhashFrame(index);
+        cache.stats.evictions++;
+        return index;
+    }
+    return -1;
+}
+
+// page 다음으로 캐시에 없는 페이지들을 미리 읽을 프레임으로 잡는다. 캐시의 1/4을 넘게 잡지 않는다.
+static int claimReadahead(long page, int window, int* frames) {
+    int limit = cache.frameCount / 4;
+    int count = 0;
+    for (int i = 1; i < window && count < limit; i++) {
+        if (lookupFrame(page + i) >= 0) {
+            break;
+        }
+        int index = evictFrame();
+        if (index < 0) {
+            break;
+        }
+        CacheFrame* frame = &cache.frames[index];
+        frame->pins = 0;
+        frame->references = 0; // 쓰이지 않으면 가장 먼저 나간다
+        frame->dirty = false;
+        frame->loading = true;
+        hashFrame(index, page + i);
+        frames[count++] = index;
+    }
+    return count;
+}
+
+char* cachePin(long page, bool wait, int* pin) {
+    pthread_mutex_lock(&cache.lock);
+    int index;
+    while (1) {
+        index = lookupFrame(page);
+        if (index >= 0) {
+            CacheFrame* frame = &cache.frames[index];
+            frame->pins++;
+            if (frame->references < 2) {
+                frame->references++;
+            }
+            cache.stats.hits++;
+            while (frame->loading) {
+                cache.waiters++;
+                pthread_cond_wait(&cache.changed, &cache.lock);
+                cache.waiters--;
+            }
+            pthread_mutex_unlock(&cache.lock);
+            *pin = index;
+            return frameData(index);
+        }
+        index = evictFrame();
+        if (index >= 0) {
+            break;
+        }
+        if (!wait) {
+            pthread_mutex_unlock(&cache.lock);
+            return NULL;
+        }
+        cache.waiters++;
+        pthread_cond_wait(&cache.changed, &cache.lock); // 그 사이 누가 이 페이지를 읽어 왔을 수 있다
+        cache.waiters--;
+    }
+
+    CacheFrame* frame = &cache.frames[index];
+    frame->pins = 1;
+    frame->references = 1;
+    frame->dirty = false;
+    frame->loading = true;
+    hashFrame(index, page);
+    cache.stats.misses++;
+
+    int frames[1 + CACHE_MAX_READAHEAD];
+    frames[0] = index;
+    int count = 1;
+    if (page == cache.nextSequential) {
+        cache.window = cache.window * 2 < CACHE_MAX_READAHEAD ? cache.window * 2 : CACHE_MAX_READAHEAD;
+        count += claimReadahead(page, cache.window, frames + 1);
+        cache.stats.readahead += count - 1;
+    } else {
+        cache.window = 1;
+    }
+    cache.nextSequential = page + count;
+    pthread_mutex_unlock(&cache.lock);
+
+    transferPages(false, page, frames, count);
+
+    pthread_mutex_lock(&cache.lock);
+    for (int i = 0; i < count; i++) {
+        cache.frames[frames[i]].loading = false;
+    }
+    if (cache.waiters > 0) {
+        pthread_cond_broadcast(&cache.changed);
+    }
+    pthread_mutex_unlock(&cache.lock);
+    *pin = index;
+    return frameData(index);
+}
+
+void cacheUnpin(int pin, bool dirty) {
+    pthread_mutex_lock(&cache.lock);
+    CacheFrame* frame = &cache.frames[pin];
+    frame->dirty = frame->dirty || dirty;
+    if (--frame->pins == 0 && cache.waiters > 0) {
+        pthread_cond_broadcast(&cache.changed);
+    }
+    pthread_mutex_unlock(&cache.lock);
+}
+
+bool cacheFlush(void) {
+    if (cache.fd < 0) {
+        return true;
+    }
+    pthread_mutex_lock(&cache.lock);
+    int* frames = (int*)malloc((cache.frameCount + 1) * sizeof(int));
+    int count = 0;
+    for (int i = 0; i < cache.usedFrames; i++) {
+        if (cache.frames[i].dirty && evictable(&cache.frames[i])) {
+            frames[count++] = i;
+        }
+    }
+    writeFrames(frames, count);
+    bool clean = true;
+    for (int i = 0; i < count; i++) {
+        clean = clean && !cache.frames[frames[i]].dirty;
+    }
+    free(frames);
+    bool ok = clean && fdatasync(cache.fd) == 0;
+    pthread_mutex_unlock(&cache.lock);
+    return ok;
+}
+
+bool cacheOpen(const char* path, size_t budgetBytes, bool truncate) {
+    cacheClose();
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC | (truncate ? O_TRUNC : 0), 0644);
+    if (fd < 0) {
+        printf("데이터 파일 '%s'을(를) 열 수 없습니다: %s\n", path, strerror(errno));
+        return false;
+    }
+    size_t frameCount = budgetBytes / CACHE_PAGE_BYTES;
+    if (frameCount < CACHE_MIN_PAGES) {
+        frameCount = CACHE_MIN_PAGES;
+    }
+    unsigned long bucketCount = 1;
+    while (bucketCount < frameCount * 2) {
+        bucketCount <<= 1;
+    }
+    cache.memory = (char*)malloc(frameCount * CACHE_PAGE_BYTES);
+    cache.frames = (CacheFrame*)calloc(frameCount, sizeof(CacheFrame));
+    cache.buckets = (int*)malloc(bucketCount * sizeof(int));
+    if (cache.memory == NULL || cache.frames == NULL || cache.buckets == NULL) {
+        printf("버퍼 캐시 %zu bytes를 잡을 수 없습니다.\n", frameCount * CACHE_PAGE_BYTES);
+        close(fd);
+        cacheClose();
+        return false;
+    }
+    memset(cache.buckets, 0xff, bucketCount * sizeof(int));
+    for (size_t i = 0; i < frameCount; i++) {
+        cache.frames[i].page = -1;
+        cache.frames[i].next = -1;
+    }
+    cache.fd = fd;
+    cache.frameCount = (int)frameCount;
+    cache.usedFrames = 0;
+    cache.bucketMask = bucketCount - 1;
+    cache.hand = 0;
+    cache.nextSequential = -1;
+    cache.window = 1;
+    memset(&cache.stats, 0, sizeof(cache.stats));
+    cache.stats.pages = frameCount;
+    return true;
+}
+
+void cacheClose(void) {
+    if (cache.fd >= 0) {
+        close(cache.fd);
+    }
+    free(cache.memory);
+    free(cache.frames);
+    free(cache.buckets);
+    cache.fd = -1;
+    cache.memory = NULL;
+    cache.frames = NULL;
+    cache.buckets = NULL;
+    cache.frameCount = 0;
+    cache.usedFrames = 0;
+}
+
+bool cacheIsOpen(void) {
+    return cache.fd >= 0;
+}
+
+void cacheSetWritebackHook(void (*hook)(void)) {
+    cache.writebackHook = hook;
+}
+
+CacheStats cacheGetStats(void) {
+    pthread_mutex_lock(&cache.lock);
+    CacheStats stats = cache.stats;
+    stats.dirty = 0;
+    for (int i = 0; i < cache.usedFrames; i++) {
+        stats.dirty += cache.frames[i].dirty;
+    }
+    pthread_mutex_unlock(&cache.lock);
+    return stats;
+}
@@ -0,0 +1,898 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <pthread.h>
+#include "fs.h"
+#include "bcache.h"
+#include "dedup.h"
+#include "compress.h"
+#include "xxhash.h"
+#include "stats.h"
+
+#define IO_SEGMENTS 256 // preadv/writev 한 번에 넘기는 조각 수
+
+typedef struct BlockStore {
+    char* chunks[MAX_BLOCK_CHUNKS]; // 청크마다 BLOCK_CHUNK_BYTES 바이트
+    int chunkCount;
+    Bitmap allocated;
+    unsigned int* refCounts; // 블록마다 이 블록을 가리키는 파일 수 (복사된 파일은 블록을 공유한다)
+    // 이미지에서 불러온 경우: 앞쪽 mappedChunks개의 청크와 refCounts는 mapping 안을 가리킨다
+    void* mapping;
+    size_t mappingLength;
+    int mappedChunks;
+    int refCountsMapped;
+    bool backed; // 블록 내용이 데이터 파일에 있고 버퍼 캐시(bcache.h)를 거친다. chunks는 쓰지 않는다
+} BlockStore;
+static BlockStore blockStore;
+// 비트맵, 참조 수, 청크 목록을 보호한다. 청크는 옮기지 않으므로 블록 내용을 읽고 쓸 때는 잡지 않는다
+// (파일 내용은 그 파일이 든 디렉터리의 잠금이 보호한다). 가장 안쪽 잠금이다.
+static pthread_mutex_t blockLock = PTHREAD_MUTEX_INITIALIZER;
+
+static int growBlockStore() {
+    if (blockStore.chunkCount == MAX_BLOCK_CHUNKS) {
+        return 0;
+    }
+    char* chunk = NULL; // 데이터 파일을 쓰면 블록 번호만 늘리고, 파일은 처음 쓸 때 늘어난다
+    if (!blockStore.backed && (chunk = (char*)malloc(BLOCK_CHUNK_BYTES)) == NULL) {
+        return 0;
+    }
+    size_t oldBlocks = (size_t)blockStore.chunkCount * BLOCK_CHUNK_SIZE;
+    blockStore.chunks[blockStore.chunkCount++] = chunk;
+    bitmapGrow(&blockStore.allocated, (size_t)blockStore.chunkCount * BLOCK_CHUNK_SIZE);
+    size_t refBytes = (size_t)blockStore.chunkCount * BLOCK_CHUNK_SIZE * sizeof(unsigned int);
+    if (blockStore.refCountsMapped) {
+        // 매핑된 배열은 realloc할 수 없으므로 처음 늘어날 때 힙으로 옮긴다
+        unsigned int* refCounts = (unsigned int*)malloc(refBytes);
+        memcpy(refCounts, blockStore.refCounts, oldBlocks * sizeof(unsigned int));
+        blockStore.refCounts = refCounts;
+        blockStore.refCountsMapped = 0;
+    } else {
+        blockStore.refCounts = (unsigned int*)realloc(blockStore.refCounts, refBytes);
+    }
+    superblock.totalBlocks = blockStore.chunkCount * BLOCK_CHUNK_SIZE;
+    superblock.fileSystemSize = (long)superblock.totalBlocks * BLOCK_SIZE;
+    return 1;
+}
+
+// 청크와 매핑을 모두 내려놓는다.
+static void releaseBlockStore() {
+    for (int i = blockStore.mappedChunks; i < blockStore.chunkCount; i++) {
+        free(blockStore.chunks[i]);
+    }
+    if (!blockStore.refCountsMapped) {
+        free(blockStore.refCounts);
+    }
+    if (blockStore.mapping != NULL) {
+        munmap(blockStore.mapping, blockStore.mappingLength);
+    }
+    if (blockStore.backed) {
+        cacheClose();
+    }
+    dedupReset();
+    bitmapDestroy(&blockStore.allocated);
+    blockStore.chunkCount = 0;
+    blockStore.refCounts = NULL;
+    blockStore.mapping = NULL;
+    blockStore.mappingLength = 0;
+    blockStore.mappedChunks = 0;
+    blockStore.refCountsMapped = 0;
+    blockStore.backed = false;
+}
+
+// 모든 블록을 미사용 상태로 되돌린다. 이미 만든 청크는 재사용하고, 이미지 매핑과 데이터 파일은 내려놓는다.
+void initBlockStore(void) {
+    if (blockStore.mapping != NULL || blockStore.backed) {
+        releaseBlockStore();
+    }
+    if (blockStore.chunkCount == 0) {
+        bitmapInit(&blockStore.allocated, 0);
+        growBlockStore();
+    }
+    bitmapClearAll(&blockStore.allocated);
+    dedupReset();
+    compressReset();
+    superblock.totalBlocks = blockStore.chunkCount * BLOCK_CHUNK_SIZE;
+    superblock.usedBlocks = 0;
+    superblock.fileSystemSize = (long)superblock.totalBlocks * BLOCK_SIZE;
+}
+
+static int allocateBlockLocked(void) {
+    long block = bitmapAllocate(&blockStore.allocated);
+    if (block < 0) {
+        size_t oldCount = blockStore.allocated.bitCount;
+        if (!growBlockStore()) {
+            printf("더 이상 할당 가능한 블록이 없습니다.\n");
+            return -1;
+        }
+        blockStore.allocated.hint = oldCount / 64;
+        block = bitmapAllocate(&blockStore.allocated);
+    }
+    superblock.usedBlocks++;
+    STATS_COUNT(blockAllocations);
+    blockStore.refCounts[block] = 1;
+    return (int)block;
+}
+
+int allocateBlock(void) {
+    pthread_mutex_lock(&blockLock);
+    int block = allocateBlockLocked();
+    pthread_mutex_unlock(&blockLock);
+    return block;
+}
+
+void retainBlock(int block) {
+    pthread_mutex_lock(&blockLock);
+    blockStore.refCounts[block]++;
+    pthread_mutex_unlock(&blockLock);
+}
+
+// 참조를 하나 놓고, 마지막 참조였으면 블록을 반납한다.
+static void freeBlockLocked(int block) {
+    if (block >= 0 && bitmapTest(&blockStore.allocated, block)) {
+        if (--blockStore.refCounts[block] > 0) {
+            return;
+        }
+        bitmapClear(&blockStore.allocated, block);
+        dedupForgetLocked(block);
+        superblock.usedBlocks--;
+        STATS_COUNT(blockFrees);
+    }
+}
+
+void freeBlock(int block) {
+    pthread_mutex_lock(&blockLock);
+    freeBlockLocked(block);
+    pthread_mutex_unlock(&blockLock);
+}
+
+unsigned int blockRefCount(int block) {
+    pthread_mutex_lock(&blockLock);
+    unsigned int count = bitmapTest(&blockStore.allocated, block) ? blockStore.refCounts[block] : 0;
+    pthread_mutex_unlock(&blockLock);
+    return count;
+}
+
+int blockStoreChunkCount(void) {
+    return blockStore.chunkCount;
+}
+
+const char* blockStoreChunk(int chunk) {
+    return blockStore.chunks[chunk];
+}
+
+const unsigned int* blockStoreRefCounts(void) {
+    return blockStore.refCounts;
+}
+
+const Bitmap* blockStoreBitmap(void) {
+    return &blockStore.allocated;
+}
+
+// 매핑된 이미지의 데이터 영역을 그대로 블록 저장소로 쓴다. 블록 내용과 참조 수 배열은 복사하지 않으므로
+// 실제로 읽거나 쓰는 페이지만 그때 읽혀 온다 (MAP_PRIVATE라 수정은 메모리에만 남는다).
+// data가 NULL이면 블록 내용은 데이터 파일에 있으므로 블록을 쓰기 전에 blockStoreAttach를 불러야 한다.
+void blockStoreAdopt(void* mapping, size_t mappingLength, char* data, int chunkCount,
+                     unsigned int* refCounts, const unsigned long long* bitmapWords, int usedBlocks) {
+    releaseBlockStore();
+    blockStore.mapping = mapping;
+    blockStore.mappingLength = mappingLength;
+    blockStore.backed = data == NULL;
+    blockStore.mappedChunks = blockStore.backed ? 0 : chunkCount;
+    blockStore.chunkCount = chunkCount;
+    for (int i = 0; i < chunkCount; i++) {
+        blockStore.chunks[i] = blockStore.backed ? NULL : data + (size_t)i * BLOCK_CHUNK_BYTES;
+    }
+    blockStore.refCounts = refCounts;
+    blockStore.refCountsMapped = 1;
+    bitmapInit(&blockStore.allocated, (size_t)chunkCount * BLOCK_CHUNK_SIZE);
+    memcpy(blockStore.allocated.words, bitmapWords, blockStore.allocated.wordCount * sizeof(unsigned long long));
+    blockStore.allocated.setCount = usedBlocks;
+    if (chunkCount == 0) {
+        growBlockStore();
+    }
+    superblock.totalBlocks = blockStore.chunkCount * BLOCK_CHUNK_SIZE;
+    superblock.usedBlocks = usedBlocks;
+    superblock.fileSystemSize = (long)superblock.totalBlocks * BLOCK_SIZE;
+}
+
+// 메모리에 있는 블록 내용을 데이터 파일로 옮기고, 이후로는 버퍼 캐시를 거쳐 읽고 쓴다.
+// 데이터 파일을 쓰는 이미지를 불러온 상태면 (blockStoreAdopt에 data NULL) 파일을 그대로 연다.
+// 옮기지 못하면 메모리에 그대로 남고 false. 트리를 아무도 쓰지 않을 때 부른다.
+bool blockStoreAttach(const char* path, size_t cacheBytes) {
+    if (blockStore.backed) {
+        return cacheIsOpen() || cacheOpen(path, cacheBytes, false);
+    }
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    bool ok = fd >= 0;
+    for (int i = 0; ok && i < blockStore.chunkCount; i++) {
+        const char* chunk = blockStore.chunks[i];
+        size_t done = 0;
+        while (ok && done < BLOCK_CHUNK_BYTES) {
+            ssize_t written = pwrite(fd, chunk + done, BLOCK_CHUNK_BYTES - done,
+                                     (off_t)((size_t)i * BLOCK_CHUNK_BYTES + done));
+            ok = written > 0 || (written < 0 && errno == EINTR);
+            done += written > 0 ? (size_t)written : 0;
+        }
+    }
+    ok = ok && fdatasync(fd) == 0;
+    if (fd >= 0 && close(fd) != 0) {
+        ok = false;
+    }
+    if (!ok || !cacheOpen(path, cacheBytes, false)) {
+        printf("데이터 파일 '%s'에 블록을 옮기지 못했습니다. 메모리에 그대로 둡니다.\n", path);
+        return false;
+    }
+
+    // 참조 수가 매핑 안에 있으면 매핑을 내려놓기 전에 힙으로 옮긴다
+    size_t blockCount = (size_t)blockStore.chunkCount * BLOCK_CHUNK_SIZE;
+    if (blockStore.refCountsMapped) {
+        unsigned int* refCounts = (unsigned int*)malloc(blockCount * sizeof(unsigned int));
+        memcpy(refCounts, blockStore.refCounts, blockCount * sizeof(unsigned int));
+        blockStore.refCounts = refCounts;
+        blockStore.refCountsMapped = 0;
+    }
+    for (int i = 0; i < blockStore.chunkCount; i++) {
+        if (i >= blockStore.mappedChunks) {
+            free(blockStore.chunks[i]);
+        }
+        blockStore.chunks[i] = NULL;
+    }
+    if (blockStore.mapping != NULL) {
+        munmap(blockStore.mapping, blockStore.mappingLength);
+        blockStore.mapping = NULL;
+        blockStore.mappingLength = 0;
+    }
+    blockStore.mappedChunks = 0;
+    blockStore.backed = true;
+    return true;
+}
+
+bool blockStoreBacked(void) {
+    return blockStore.backed;
+}
+
+bool blockStoreSync(void) {
+    return !blockStore.backed || cacheFlush();
+}
+
+static char* blockData(int block) {
+    return blockStore.chunks[block >> BLOCK_CHUNK_SHIFT] + (size_t)(block & (BLOCK_CHUNK_SIZE - 1)) * BLOCK_SIZE;
+}
+
+// block부터 메모리에서 이어져 있는 블록 수 (메모리면 청크 끝까지, 캐시를 쓰면 캐시 페이지 끝까지)
+static int contiguousBlocks(int block) {
+    return blockStore.backed ? CACHE_PAGE_BLOCKS - (block & (CACHE_PAGE_BLOCKS - 1))
+                             : BLOCK_CHUNK_SIZE - (block & (BLOCK_CHUNK_SIZE - 1));
+}
+
+// 블록 내용의 주소. 캐시를 쓰면 그 페이지를 고정하므로 다 쓴 뒤 releaseBlocks로 놓는다 (메모리면 pin은 -1).
+// wait가 아니고 캐시에 빈 페이지가 없으면 NULL.
+static char* accessBlocks(int block, bool wait, int* pin) {
+    if (!blockStore.backed) {
+        *pin = -1;
+        return blockData(block);
+    }
+    char* page = cachePin(block >> CACHE_PAGE_SHIFT, wait, pin);
+    return page == NULL ? NULL : page + (size_t)(block & (CACHE_PAGE_BLOCKS - 1)) * BLOCK_SIZE;
+}
+
+static void releaseBlocks(int pin, bool dirty) {
+    if (pin >= 0) {
+        cacheUnpin(pin, dirty);
+    }
+}
+
+// 블록 내용의 한 조각 [data, data + length)를 다룬다. position은 조각의 파일 안 위치에서 시작 offset을 뺀 값.
+// false를 돌려주면 거기서 멈춘다.
+typedef bool (*RunFn)(char* data, size_t position, size_t length, void* context);
+
+// 파일 내용의 [offset, offset + length) 바이트를 메모리에서 이어진 조각 단위로 fn에 넘긴다.
+// 조각을 하나씩만 고정하므로 캐시가 작아도 막히지 않는다. dirty면 조각을 고친 것으로 표시한다.
+static bool forEachRun(const ExtentList* list, size_t offset, size_t length, bool dirty, RunFn fn, void* context) {
+    long skip = (long)(offset / BLOCK_SIZE); // 건너뛸 블록 수
+    size_t inBlock = offset % BLOCK_SIZE;
+    size_t done = 0;
+    for (int i = 0; i < list->count && done < length; i++) {
+        int count = list->extents[i].count;
+        if (skip >= count) {
+            skip -= count;
+            continue;
+        }
+        int b = (int)skip;
+        skip = 0;
+        while (b < count && done < length) {
+            int block = list->extents[i].start + b;
+            int run = contiguousBlocks(block);
+            if (run > count - b) {
+                run = count - b;
+            }
+            size_t chunk = (size_t)run * BLOCK_SIZE - inBlock;
+            if (chunk > length - done) {
+                chunk = length - done;
+            }
+            int pin;
+            char* data = accessBlocks(block, true, &pin) + inBlock;
+            bool more = fn(data, done, chunk, context);
+            releaseBlocks(pin, dirty);
+            if (!more) {
+                return false;
+            }
+            done += chunk;
+            b += run;
+            inBlock = 0;
+        }
+    }
+    return true;
+}
+
+static bool copyIn(char* data, size_t position, size_t length, void* buffer) {
+    memcpy(data, (const char*)buffer + position, length);
+    return true;
+}
+
+static bool copyOut(char* data, size_t position, size_t length, void* buffer) {
+    memcpy((char*)buffer + position, data, length);
+    return true;
+}
+
+static bool sameAs(char* data, size_t position, size_t length, void* buffer) {
+    return memcmp(data, (const char*)buffer + position, length) == 0;
+}
+
+static bool hashRun(char* data, size_t position, size_t length, void* state) {
+    (void)position;
+    xxh64Update((Xxh64State*)state, data, length);
+    return true;
+}
+
+// 블록을 파일 끝에 붙인다. 직전 구간과 이어지면 구간을 늘리기만 한다.
+static void appendBlock(ExtentList* list, int block) {
+    if (list->count > 0) {
+        Extent* last = &list->extents[list->count - 1];
+        if (last->start + last->count == block) {
+            last->count++;
+            return;
+        }
+    }
+    if (list->count == list->capacity) {
+        list->capacity = list->capacity == 0 ? 2 : list->capacity * 2;
+        list->extents = (Extent*)realloc(list->extents, list->capacity * sizeof(Extent));
+    }
+    list->extents[list->count].start = block;
+    list->extents[list->count].count = 1;
+    list->count++;
+}
+
+static void releaseExtents(ExtentList* list) {
+    if (list->count > 0) {
+        pthread_mutex_lock(&blockLock);
+        for (int i = 0; i < list->count; i++) {
+            for (int b = 0; b < list->extents[i].count; b++) {
+                freeBlockLocked(list->extents[i].start + b);
+            }
+        }
+        pthread_mutex_unlock(&blockLock);
+    }
+    free(list->extents);
+    list->extents = NULL;
+    list->count = 0;
+    list->capacity = 0;
+}
+
+void fileRelease(Inode* inode) {
+    if (inode->storedSize > 0) {
+        compressForget(inode->extents.extents[0].start);
+        inode->storedSize = 0;
+    }
+    releaseExtents(&inode->extents);
+    INODE_SIZE(inode->number) = 0;
+}
+
+// 블록 count개를 잠금 한 번으로 잡아 구간 목록 끝에 붙인다. 이어서 잡히는 블록은 한 구간으로 합쳐진다.
+// 모자라면 잡은 데까지만 붙이고 false (호출자가 fileRelease로 돌려준다).
+static bool appendBlocks(ExtentList* list, size_t count) {
+    pthread_mutex_lock(&blockLock);
+    for (size_t i = 0; i < count; i++) {
+        int block = allocateBlockLocked();
+        if (block < 0) {
+            pthread_mutex_unlock(&blockLock);
+            return false;
+        }
+        appendBlock(list, block);
+    }
+    pthread_mutex_unlock(&blockLock);
+    return true;
+}
+
+// 앞쪽 keep개만 남기고 뒤쪽 블록을 반납한다.
+static void truncateBlocks(ExtentList* list, size_t keep) {
+    pthread_mutex_lock(&blockLock);
+    for (int i = 0; i < list->count; i++) {
+        Extent* extent = &list->extents[i];
+        if (keep >= (size_t)extent->count) {
+            keep -= extent->count;
+            continue;
+        }
+        for (int b = (int)keep; b < extent->count; b++) {
+            freeBlockLocked(extent->start + b);
+        }
+        extent->count = (int)keep;
+        keep = 0;
+    }
+    while (list->count > 0 && list->extents[list->count - 1].count == 0) {
+        list->count--;
+    }
+    pthread_mutex_unlock(&blockLock);
+}
+
+// 내용이 같은 blob을 찾아 그 블록을 함께 쓰는 구간 목록을 shared에 만든다. 표에서 찾은 뒤 블록 참조를
+// 먼저 잡아 두므로 비교하는 동안 blob이 사라지지 않는다. 비교는 data가 있으면 data와, 없으면 other의 블록과 한다.
+static bool findDuplicate(unsigned long long hash, size_t length, const char* data, const ExtentList* other,
+                          ExtentList* shared) {
+    pthread_mutex_lock(&blockLock);
+    int blob = dedupFindLocked(hash, (long)length);
+    if (blob < 0) {
+        pthread_mutex_unlock(&blockLock);
+        dedupRecord(false, false, 0);
+        return false;
+    }
+    const ExtentList* source = dedupExtentsLocked(blob);
+    shared->extents = (Extent*)malloc(source->count * sizeof(Extent));
+    memcpy(shared->extents, source->extents, source->count * sizeof(Extent));
+    shared->count = shared->capacity = source->count;
+    for (int i = 0; i < source->count; i++) {
+        for (int b = 0; b < source->extents[i].count; b++) {
+            blockStore.refCounts[source->extents[i].start + b]++;
+        }
+    }
+    pthread_mutex_unlock(&blockLock);
+
+    bool same;
+    if (data != NULL) {
+        same = forEachRun(shared, 0, length, false, sameAs, (void*)data);
+    } else {
+        // 두 구간 목록을 함께 고정하지 않도록 한쪽을 잘라 읽어 와 비교한다
+        char buffer[64 * 1024];
+        same = true;
+        for (size_t offset = 0; same && offset < length; offset += sizeof(buffer)) {
+            size_t chunk = length - offset < sizeof(buffer) ? length - offset : sizeof(buffer);
+            forEachRun(other, offset, chunk, false, copyOut, buffer);
+            same = forEachRun(shared, offset, chunk, false, sameAs, buffer);
+        }
+    }
+    dedupRecord(same, !same, (long)length);
+    if (!same) {
+        releaseExtents(shared);
+    }
+    return same;
+}
+
+static void registerBlob(unsigned long long hash, const Inode* inode) {
+    pthread_mutex_lock(&blockLock);
+    dedupInsertLocked(hash, INODE_SIZE(inode->number), &inode->extents);
+    pthread_mutex_unlock(&blockLock);
+}
+
+// 내용 전체를 바꾼다. 같은 내용이 이미 블록 저장소에 있으면 새로 쓰지 않고 그 블록을 함께 쓴다.
+bool fileWrite(Inode* inode, const char* data, size_t length) {
+    fileRelease(inode);
+    inode->accessed = time(NULL);
+    if (length == 0) {
+        return true;
+    }
+    unsigned long long hash = xxh64(data, length, 0);
+    if (findDuplicate(hash, length, data, NULL, &inode->extents)) {
+        INODE_SIZE(inode->number) = (long)length;
+        return true;
+    }
+    if (!appendBlocks(&inode->extents, (length + BLOCK_SIZE - 1) / BLOCK_SIZE)) {
+        fileRelease(inode);
+        return false;
+    }
+    forEachRun(&inode->extents, 0, length, true, copyIn, (void*)data);
+    INODE_SIZE(inode->number) = (long)length;
+    registerBlob(hash, inode);
+    return true;
+}
+
+static bool zeroRun(char* data, size_t position, size_t length, void* unused) {
+    (void)position;
+    (void)unused;
+    memset(data, 0, length);
+    return true;
+}
+
+static size_t blocksFor(size_t bytes) {
+    return (bytes + BLOCK_SIZE - 1) / BLOCK_SIZE;
+}
+
+// 파일의 index번째 블록을 찾는다. extent에 그 블록이 든 구간 번호, 돌려주는 값은 구간 안의 위치다.
+static int locateBlock(const ExtentList* list, size_t index, int* extent) {
+    for (int i = 0; i < list->count; i++) {
+        if (index < (size_t)list->extents[i].count) {
+            *extent = i;
+            return (int)index;
+        }
+        index -= list->extents[i].count;
+    }
+    *extent = -1;
+    return -1;
+}
+
+static void insertExtents(ExtentList* list, int at, int count) {
+    while (list->count + count > list->capacity) {
+        list->capacity = list->capacity == 0 ? 2 : list->capacity * 2;
+        list->extents = (Extent*)realloc(list->extents, list->capacity * sizeof(Extent));
+    }
+    memmove(&list->extents[at + count], &list->extents[at], (list->count - at) * sizeof(Extent));
+    list->count += count;
+}
+
+// 파일의 index번째 블록을 block으로 바꾼다. 그 블록이 든 구간은 많아야 셋으로 나뉜다.
+static void replaceBlock(ExtentList* list, size_t index, int block) {
+    int i;
+    int at = locateBlock(list, index, &i);
+    Extent old = list->extents[i];
+    if (old.count == 1) {
+        list->extents[i].start = block;
+    } else if (at == 0) {
+        insertExtents(list, i, 1);
+        list->extents[i] = (Extent){block, 1};
+        list->extents[i + 1] = (Extent){old.start + 1, old.count - 1};
+    } else if (at == old.count - 1) {
+        insertExtents(list, i + 1, 1);
+        list->extents[i].count--;
+        list->extents[i + 1] = (Extent){block, 1};
+    } else {
+        insertExtents(list, i + 1, 2);
+        list->extents[i].count = at;
+        list->extents[i + 1] = (Extent){block, 1};
+        list->extents[i + 2] = (Extent){old.start + at + 1, old.count - at - 1};
+    }
+}
+
+// 블록 하나의 내용을 다른 블록에 옮긴다. 두 페이지를 함께 고정하지 않도록 한 번 거쳐 복사한다.
+static void copyBlock(int from, int to) {
+    char buffer[BLOCK_SIZE];
+    int pin;
+    memcpy(buffer, accessBlocks(from, true, &pin), BLOCK_SIZE);
+    releaseBlocks(pin, false);
+    memcpy(accessBlocks(to, true, &pin), buffer, BLOCK_SIZE);
+    releaseBlocks(pin, true);
+}
+
+// 압축된 파일은 일부만 고칠 수 없으므로 먼저 풀어서 다시 쓴다.
+static bool inflateFile(Inode* inode) {
+    if (inode->storedSize == 0) {
+        return true;
+    }
+    size_t size = (size_t)INODE_SIZE(inode->number);
+    char* content = (char*)malloc(size);
+    if (content == NULL) {
+        return false;
+    }
+    fileRead(inode, 0, content, size);
+    bool written = fileWrite(inode, content, size);
+    free(content);
+    return written;
+}
+
+// 블록을 제자리에서 고치거나 일부만 바꾸기 전에 부른다. 같은 blob의 블록은 모두 같은 파일들이 함께 가지고
+// 있어야 하므로, 이 파일이 등록한(또는 함께 쓰는) blob을 표에서 지운다. 일부만 고친 파일은 다시 등록하지 않는다.
+// 표에서 지운 뒤에 참조 수를 보므로, 그 사이 표에서 이 블록을 찾아 간 쪽이 있으면 참조 수에 드러난다.
+static void prepareInPlace(Inode* inode) {
+    if (inode->extents.count > 0) {
+        pthread_mutex_lock(&blockLock);
+        dedupForgetLocked(inode->extents.extents[0].start);
+        pthread_mutex_unlock(&blockLock);
+    }
+}
+
+// 파일의 [first, last) 블록 중 다른 파일과 함께 쓰는 블록을 새 블록으로 바꾼다 (copy-on-write).
+// [keepFrom, keepTo) 바이트는 곧 덮어쓰므로, 그 안에 통째로 드는 블록은 내용을 옮기지 않는다.
+static bool privatizeBlocks(Inode* inode, size_t first, size_t last, size_t keepFrom, size_t keepTo) {
+    for (size_t index = first; index < last; index++) {
+        int extent;
+        int at = locateBlock(&inode->extents, index, &extent);
+        int block = inode->extents.extents[extent].start + at;
+        pthread_mutex_lock(&blockLock);
+        if (blockStore.refCounts[block] == 1) {
+            pthread_mutex_unlock(&blockLock);
+            continue;
+        }
+        int copy = allocateBlockLocked();
+        pthread_mutex_unlock(&blockLock);
+        if (copy < 0) {
+            return false;
+        }
+        if (index * BLOCK_SIZE < keepFrom || (index + 1) * BLOCK_SIZE > keepTo) {
+            copyBlock(block, copy);
+        }
+        replaceBlock(&inode->extents, index, copy);
+        freeBlock(block);
+    }
+    return true;
+}
+
+// 파일을 newSize로 늘린다. [fileSize, zeroTo) 바이트는 0으로 채운다 (그 뒤는 호출자가 곧 쓴다).
+static bool extendFile(Inode* inode, size_t newSize, size_t zeroTo) {
+    size_t oldSize = (size_t)INODE_SIZE(inode->number);
+    size_t oldBlocks = blocksFor(oldSize);
+    if (oldSize % BLOCK_SIZE != 0 && !privatizeBlocks(inode, oldBlocks - 1, oldBlocks, 0, 0)) {
+        return false;
+    }
+    if (!appendBlocks(&inode->extents, blocksFor(newSize) - oldBlocks)) {
+        truncateBlocks(&inode->extents, oldBlocks);
+        return false;
+    }
+    if (zeroTo > oldSize) {
+        forEachRun(&inode->extents, oldSize, zeroTo - oldSize, true, zeroRun, NULL);
+    }
+    INODE_SIZE(inode->number) = (long)newSize;
+    return true;
+}
+
+// 내용의 [offset, offset + length)만 바꾼다. 닿는 블록만 고치고, 함께 쓰던 블록은 그 블록만 새로 받는다.
+// 파일 끝을 넘으면 늘리고, 끝과 offset 사이는 0으로 채운다. 블록이 모자라면 크기는 그대로 두고 false.
+bool fileWriteAt(Inode* inode, size_t offset, const char* data, size_t length) {
+    inode->accessed = time(NULL);
+    if (length == 0) {
+        return true;
+    }
+    if (!inflateFile(inode)) {
+        return false;
+    }
+    prepareInPlace(inode);
+    size_t oldSize = (size_t)INODE_SIZE(inode->number);
+    size_t end = offset + length;
+    size_t first = (offset < oldSize ? offset : oldSize) / BLOCK_SIZE;
+    size_t last = blocksFor(end) < blocksFor(oldSize) ? blocksFor(end) : blocksFor(oldSize);
+    if (first < last && !privatizeBlocks(inode, first, last, offset, end)) {
+        return false;
+    }
+    if (end > oldSize && !extendFile(inode, end, offset)) {
+        return false;
+    }
+    forEachRun(&inode->extents, offset, length, true, copyIn, (void*)data);
+    return true;
+}
+
+// 크기를 size로 바꾼다. 줄이면 뒤쪽 블록을 반납하고, 늘리면 늘어난 부분을 0으로 채운다.
+bool fileTruncate(Inode* inode, size_t size) {
+    inode->accessed = time(NULL);
+    if (size == (size_t)INODE_SIZE(inode->number)) {
+        return true;
+    }
+    if (size == 0) {
+        fileRelease(inode);
+        return true;
+    }
+    if (!inflateFile(inode)) {
+        return false;
+    }
+    prepareInPlace(inode);
+    if (size > (size_t)INODE_SIZE(inode->number)) {
+        return extendFile(inode, size, size);
+    }
+    truncateBlocks(&inode->extents, blocksFor(size));
+    INODE_SIZE(inode->number) = (long)size;
+    return true;
+}
+
+// 파일 내용 중 [offset, length) 바이트를 메모리에서 이어진 조각으로 나눠 iov에 담는다 (최대 max개).
+// 번호가 이어진 블록은 같은 청크(캐시를 쓰면 같은 캐시 페이지) 안에서는 메모리도 이어져 있으므로 그 경계에서만 끊긴다.
+// 캐시를 쓰면 조각마다 페이지를 고정해 pins에 담는다. 첫 조각만 빈 페이지를 기다리고, 나머지는 캐시가
+// 차면 거기서 멈추므로 여러 스레드가 페이지를 나눠 쥔 채 서로 기다리는 일이 없다.
+static int gatherSegments(const ExtentList* list, size_t length, size_t offset, struct iovec* iov, int* pins, int max) {
+    int count = 0;
+    size_t position = 0; // 지금 보는 블록의 파일 안 위치
+    for (int i = 0; i < list->count && count < max && position < length; i++) {
+        int block = list->extents[i].start;
+        int end = block + list->extents[i].count;
+        size_t extentBytes = (size_t)list->extents[i].count * BLOCK_SIZE;
+        if (position + extentBytes <= offset) {
+            position += extentBytes;
+            continue;
+        }
+        while (block < end && count < max && position < length) {
+            int run = contiguousBlocks(block);
+            int runEnd = end - block < run ? end : block + run;
+            size_t runBytes = (size_t)(runEnd - block) * BLOCK_SIZE;
+            size_t from = offset > position ? offset - position : 0;
+            size_t to = position + runBytes > length ? length - position : runBytes;
+            if (from < to) {
+                char* data = accessBlocks(block, count == 0, &pins[count]);
+                if (data == NULL) {
+                    return count;
+                }
+                iov[count].iov_base = data + from;
+                iov[count].iov_len = to - from;
+                count++;
+            }
+            position += runBytes;
+            block = runEnd;
+        }
+    }
+    return count;
+}
+
+static void releaseSegments(const int* pins, int count, bool dirty) {
+    for (int i = 0; i < count; i++) {
+        releaseBlocks(pins[i], dirty);
+    }
+}
+
+// fd의 앞 length 바이트로 내용 전체를 바꾼다. 블록을 먼저 잡고 preadv로 블록에 바로 읽어 들이므로
+// 중간 버퍼를 거치지 않는다. 파일이 그 사이 줄었으면 읽은 만큼만 남긴다. 실패하면 빈 파일이 되고 errno가 남는다.
+bool fileReadFd(Inode* inode, int fd, size_t length) {
+    fileRelease(inode);
+    inode->accessed = time(NULL);
+    if (!appendBlocks(&inode->extents, (length + BLOCK_SIZE - 1) / BLOCK_SIZE)) {
+        fileRelease(inode);
+        errno = ENOSPC;
+        return false;
+    }
+    struct iovec iov[IO_SEGMENTS];
+    int pins[IO_SEGMENTS];
+    size_t done = 0;
+    while (done < length) {
+        int count = gatherSegments(&inode->extents, length, done, iov, pins, IO_SEGMENTS);
+        ssize_t got = preadv(fd, iov, count, (off_t)done);
+        int error = errno;
+        releaseSegments(pins, count, got > 0);
+        if (got < 0 && error == EINTR) {
+            continue;
+        }
+        if (got < 0) {
+            fileRelease(inode);
+            errno = error;
+            return false;
+        }
+        if (got == 0) {
+            break;
+        }
+        done += (size_t)got;
+    }
+    if (done < length) {
+        truncateBlocks(&inode->extents, (done + BLOCK_SIZE - 1) / BLOCK_SIZE);
+    }
+    INODE_SIZE(inode->number) = (long)done;
+
+    // 읽어 들인 블록을 해시해 같은 내용이 있으면 그쪽 블록으로 바꾸고 방금 쓴 블록은 돌려준다
+    if (done > 0) {
+        Xxh64State state;
+        xxh64Init(&state, 0);
+        forEachRun(&inode->extents, 0, done, false, hashRun, &state);
+        unsigned long long hash = xxh64Digest(&state);
+        ExtentList shared = {NULL, 0, 0};
+        if (findDuplicate(hash, done, NULL, &inode->extents, &shared)) {
+            releaseExtents(&inode->extents);
+            inode->extents = shared;
+        } else {
+            registerBlob(hash, inode);
+        }
+    }
+    return true;
+}
+
+// 압축된 파일은 프레임씩 풀어서 쓴다.
+static bool writeDecompressed(const Inode* inode, int fd) {
+    char* buffer = (char*)malloc(COMPRESS_FRAME);
+    size_t done = 0, length = (size_t)INODE_SIZE(inode->number);
+    while (done < length) {
+        size_t chunk = fileRead(inode, done, buffer, COMPRESS_FRAME);
+        for (size_t written = 0; written < chunk;) {
+            ssize_t wrote = write(fd, buffer + written, chunk - written);
+            if (wrote < 0 && errno == EINTR) {
+                continue;
+            }
+            if (wrote <= 0) {
+                int error = errno;
+                free(buffer);
+                errno = error;
+                return false;
+            }
+            written += (size_t)wrote;
+        }
+        done += chunk;
+    }
+    free(buffer);
+    return true;
+}
+
+// 내용 전체를 fd의 지금 위치에 writev로 쓴다. 블록에서 바로 내보내므로 내용을 모으는 복사가 없다.
+bool fileWriteFd(const Inode* inode, int fd) {
+    if (inode->storedSize > 0) {
+        return writeDecompressed(inode, fd);
+    }
+    struct iovec iov[IO_SEGMENTS];
+    int pins[IO_SEGMENTS];
+    size_t length = (size_t)INODE_SIZE(inode->number);
+    size_t done = 0;
+    while (done < length) {
+        int count = gatherSegments(&inode->extents, length, done, iov, pins, IO_SEGMENTS);
+        ssize_t wrote = writev(fd, iov, count);
+        int error = errno;
+        releaseSegments(pins, count, false);
+        if (wrote < 0 && error == EINTR) {
+            continue;
+        }
+        if (wrote <= 0) {
+            errno = error;
+            return false;
+        }
+        done += (size_t)wrote;
+    }
+    return true;
+}
+
+// dst가 src와 같은 블록을 공유하게 한다 (copy-on-write). 내용은 복사하지 않고 블록 참조 수만 늘린다.
+// 공유 블록은 어느 한쪽이 fileWrite로 내용을 바꿀 때 그쪽만 새 블록을 받으므로 다른 쪽에는 영향이 없다.
+void fileShare(Inode* dst, const Inode* src) {
+    fileRelease(dst);
+    const ExtentList* from = &src->extents;
+    if (from->count > 0) {
+        dst->extents.extents = (Extent*)malloc(from->count * sizeof(Extent));
+        memcpy(dst->extents.extents, from->extents, from->count * sizeof(Extent));
+        dst->extents.count = dst->extents.capacity = from->count;
+        pthread_mutex_lock(&blockLock);
+        for (int i = 0; i < from->count; i++) {
+            for (int b = 0; b < from->extents[i].count; b++) {
+                blockStore.refCounts[from->extents[i].start + b]++;
+            }
+        }
+        pthread_mutex_unlock(&blockLock);
+    }
+    INODE_SIZE(dst->number) = INODE_SIZE(src->number);
+    dst->storedSize = src->storedSize;
+    dst->accessed = time(NULL);
+}
+
+size_t fileRead(const Inode* inode, size_t offset, char* buffer, size_t length) {
+    if (offset >= (size_t)INODE_SIZE(inode->number)) {
+        return 0;
+    }
+    if (length > (size_t)INODE_SIZE(inode->number) - offset) {
+        length = (size_t)INODE_SIZE(inode->number) - offset;
+    }
+    // 읽은 시간은 내용이 아니므로 const로 받은 inode에도 남긴다 (같은 디렉터리를 읽는 스레드끼리 겹칠 수 있다)
+    __atomic_store_n(&((Inode*)inode)->accessed, time(NULL), __ATOMIC_RELAXED);
+    if (inode->storedSize > 0) {
+        return compressedRead(inode, offset, buffer, length);
+    }
+    forEachRun(&inode->extents, offset, length, false, copyOut, buffer);
+    return length;
+}
+
+size_t fileReadStored(const Inode* inode, size_t offset, char* buffer, size_t length) {
+    size_t stored = (size_t)(inode->storedSize > 0 ? inode->storedSize : INODE_SIZE(inode->number));
+    if (offset >= stored) {
+        return 0;
+    }
+    if (length > stored - offset) {
+        length = stored - offset;
+    }
+    forEachRun(&inode->extents, offset, length, false, copyOut, buffer);
+    return length;
+}
+
+// 압축한 내용을 새 블록에 쓰고 원래 블록을 반납한다. 파일 크기는 그대로다.
+bool fileStoreCompressed(Inode* inode, const char* stream, size_t length) {
+    ExtentList list = {NULL, 0, 0};
+    if (!appendBlocks(&list, (length + BLOCK_SIZE - 1) / BLOCK_SIZE)) {
+        releaseExtents(&list);
+        return false;
+    }
+    forEachRun(&list, 0, length, true, copyIn, (void*)stream);
+    long size = INODE_SIZE(inode->number);
+    fileRelease(inode);
+    inode->extents = list;
+    INODE_SIZE(inode->number) = size;
+    inode->storedSize = (long)length;
+    return true;
+}
@@ -0,0 +1,248 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "compress.h"
+#include "lz4.h"
+
+typedef struct FrameSlot {
+    int head; // 압축 내용의 첫 블록
+    int frame;
+    bool used;
+    bool referenced; // CLOCK 참조 비트
+    char* data; // COMPRESS_FRAME 바이트, 처음 쓸 때 잡는다
+} FrameSlot;
+
+typedef struct FrameCache {
+    FrameSlot slots[COMPRESS_CACHE_FRAMES];
+    int hand;
+    pthread_mutex_t lock; // 칸과 통계를 보호한다. 푸는 일은 잠금 밖에서 한다
+    CompressStats stats;
+} FrameCache;
+
+static FrameCache frameCache = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+long compressAfter(void) {
+    const char* value = getenv("MINIOS_COMPRESS_AFTER");
+    if (value == NULL || value[0] == '\0') {
+        return -1;
+    }
+    char* end;
+    long seconds = strtol(value, &end, 10);
+    return *end == '\0' && seconds >= 0 ? seconds : -1;
+}
+
+static size_t blocksFor(size_t bytes) {
+    return (bytes + BLOCK_SIZE - 1) / BLOCK_SIZE;
+}
+
+static size_t frameCount(const Inode* inode) {
+    return ((size_t)INODE_SIZE(inode->number) + COMPRESS_FRAME - 1) / COMPRESS_FRAME;
+}
+
+// 내용을 프레임으로 나눠 압축한 스트림을 stream에 만든다 (크기 표 + 프레임). 스트림 길이를 돌려준다.
+// stream은 크기 표와 원래 내용이 모두 들어갈 만큼이어야 한다 (압축되지 않는 프레임은 그대로 넣는다).
+static size_t buildStream(const Inode* inode, char* frame, char* stream) {
+    size_t frames = frameCount(inode);
+    size_t size = (size_t)INODE_SIZE(inode->number);
+    size_t length = frames * sizeof(unsigned int);
+    for (size_t i = 0; i < frames; i++) {
+        size_t offset = i * COMPRESS_FRAME;
+        size_t bytes = size - offset < COMPRESS_FRAME ? size - offset : COMPRESS_FRAME;
+        fileReadStored(inode, offset, frame, bytes);
+        unsigned int entry;
+        int packed = lz4Compress(frame, (int)bytes, stream + length, (int)bytes - 1);
+        if (packed > 0) {
+            entry = (unsigned int)packed;
+        } else {
+            memcpy(stream + length, frame, bytes);
+            entry = (unsigned int)bytes | COMPRESS_RAW_FRAME;
+        }
+        memcpy(stream + i * sizeof(unsigned int), &entry, sizeof(entry));
+        length += entry & ~COMPRESS_RAW_FRAME;
+    }
+    return length;
+}
+
+// 압축해서 블록이 줄어들 때만 바꾼다.
+static bool compressFile(Inode* inode, char* frame) {
+    size_t size = (size_t)INODE_SIZE(inode->number);
+    char* stream = (char*)malloc(frameCount(inode) * sizeof(unsigned int) + size);
+    if (stream == NULL) {
+        return false;
+    }
+    size_t length = buildStream(inode, frame, stream);
+    bool smaller = blocksFor(length) < blocksFor(size);
+    bool stored = smaller && fileStoreCompressed(inode, stream, length);
+    free(stream);
+    if (stored) {
+        pthread_mutex_lock(&frameCache.lock);
+        frameCache.stats.files++;
+        frameCache.stats.rawBytes += size;
+        frameCache.stats.storedBytes += length;
+        pthread_mutex_unlock(&frameCache.lock);
+    }
+    return stored;
+}
+
+int compressColdFiles(long after) {
+    time_t cutoff = time(NULL) - after;
+    char* frame = (char*)malloc(COMPRESS_FRAME);
+    int compressed = 0;
+    for (size_t index = 0; frame != NULL && index < inodeTable.allocated.bitCount; index++) {
+        if (!bitmapTest(&inodeTable.allocated, index)) {
+            continue;
+        }
+        if (INODE_TYPE(index) != FILE_TYPE || INODE_SIZE(index) < COMPRESS_MIN_SIZE) {
+            continue;
+        }
+        Inode* inode = getInode(index);
+        if (inode->node == NULL || inode->storedSize > 0) {
+            continue;
+        }
+        time_t touched = inode->accessed > INODE_MODIFIED(index) ? inode->accessed : INODE_MODIFIED(index);
+        if (touched > cutoff || blockRefCount(inode->extents.extents[0].start) > 1) {
+            continue;
+        }
+        compressed += compressFile(inode, frame);
+    }
+    free(frame);
+    pthread_mutex_lock(&frameCache.lock);
+    frameCache.stats.sweeps++;
+    pthread_mutex_unlock(&frameCache.lock);
+    return compressed;
+}
+
+// 잠금을 쥔 채로 부른다. 빈 칸이 있으면 그 칸, 없으면 CLOCK으로 내보낼 칸.
+static FrameSlot* victimLocked(void) {
+    for (int i = 0; i < COMPRESS_CACHE_FRAMES; i++) {
+        if (!frameCache.slots[i].used) {
+            return &frameCache.slots[i];
+        }
+    }
+    while (frameCache.slots[frameCache.hand].referenced) {
+        frameCache.slots[frameCache.hand].referenced = false;
+        frameCache.hand = (frameCache.hand + 1) % COMPRESS_CACHE_FRAMES;
+    }
+    FrameSlot* slot = &frameCache.slots[frameCache.hand];
+    frameCache.hand = (frameCache.hand + 1) % COMPRESS_CACHE_FRAMES;
+    return slot;
+}
+
+static FrameSlot* findLocked(int head, int frame) {
+    for (int i = 0; i < COMPRESS_CACHE_FRAMES; i++) {
+        FrameSlot* slot = &frameCache.slots[i];
+        if (slot->used && slot->head == head && slot->frame == frame) {
+            return slot;
+        }
+    }
+    return NULL;
+}
+
+// 프레임 하나에서 [from, to)를 out에 담는다. position은 그 프레임이 스트림에서 시작하는 위치다.
+static void copyFrame(const Inode* inode, int frame, size_t position, unsigned int entry, size_t frameBytes,
+                      size_t from, size_t to, char* out) {
+    size_t packed = entry & ~COMPRESS_RAW_FRAME;
+    if (entry & COMPRESS_RAW_FRAME) {
+        fileReadStored(inode, position + from, out, to - from);
+        return;
+    }
+    int head = inode->extents.extents[0].start;
+    pthread_mutex_lock(&frameCache.lock);
+    FrameSlot* slot = findLocked(head, frame);
+    if (slot != NULL) {
+        slot->referenced = true;
+        memcpy(out, slot->data + from, to - from);
+        frameCache.stats.frameHits++;
+        pthread_mutex_unlock(&frameCache.lock);
+        return;
+    }
+    pthread_mutex_unlock(&frameCache.lock);
+
+    char* source = (char*)malloc(packed);
+    char* data = (char*)malloc(COMPRESS_FRAME);
+    fileReadStored(inode, position, source, packed);
+    int length = lz4Decompress(source, (int)packed, data, COMPRESS_FRAME);
+    free(source);
+    pthread_mutex_lock(&frameCache.lock);
+    if (length != (int)frameBytes) {
+        frameCache.stats.corrupt++;
+        pthread_mutex_unlock(&frameCache.lock);
+        free(data);
+        memset(out, 0, to - from);
+        printf("압축된 파일 내용을 풀 수 없습니다 (블록 %d, 프레임 %d).\n", head, frame);
+        return;
+    }
+    frameCache.stats.frameMisses++;
+    memcpy(out, data + from, to - from);
+    if (findLocked(head, frame) == NULL) { // 그 사이 다른 스레드가 같은 프레임을 넣지 않았으면
+        slot = victimLocked();
+        char* old = slot->data;
+        slot->data = data;
+        data = old;
+        slot->head = head;
+        slot->frame = frame;
+        slot->used = true;
+        slot->referenced = false;
+    }
+    pthread_mutex_unlock(&frameCache.lock);
+    free(data);
+}
+
+size_t compressedRead(const Inode* inode, size_t offset, char* buffer, size_t length) {
+    if (length == 0) {
+        return 0;
+    }
+    size_t frames = frameCount(inode);
+    size_t size = (size_t)INODE_SIZE(inode->number);
+    size_t first = offset / COMPRESS_FRAME;
+    size_t last = (offset + length - 1) / COMPRESS_FRAME;
+    unsigned int local[256];
+    unsigned int* table = last < 256 ? local : (unsigned int*)malloc((last + 1) * sizeof(unsigned int));
+    fileReadStored(inode, 0, (char*)table, (last + 1) * sizeof(unsigned int));
+
+    size_t position = frames * sizeof(unsigned int);
+    for (size_t i = 0; i < first; i++) {
+        position += table[i] & ~COMPRESS_RAW_FRAME;
+    }
+    size_t done = 0;
+    for (size_t i = first; i <= last; i++) {
+        size_t frameStart = i * COMPRESS_FRAME;
+        size_t frameBytes = size - frameStart < COMPRESS_FRAME ? size - frameStart : COMPRESS_FRAME;
+        size_t from = offset + done - frameStart;
+        size_t to = offset + length - frameStart < frameBytes ? offset + length - frameStart : frameBytes;
+        copyFrame(inode, (int)i, position, table[i], frameBytes, from, to, buffer + done);
+        done += to - from;
+        position += table[i] & ~COMPRESS_RAW_FRAME;
+    }
+    if (table != local) {
+        free(table);
+    }
+    return length;
+}
+
+void compressForget(int headBlock) {
+    pthread_mutex_lock(&frameCache.lock);
+    for (int i = 0; i < COMPRESS_CACHE_FRAMES; i++) {
+        if (frameCache.slots[i].used && frameCache.slots[i].head == headBlock) {
+            frameCache.slots[i].used = false;
+        }
+    }
+    pthread_mutex_unlock(&frameCache.lock);
+}
+
+void compressReset(void) {
+    pthread_mutex_lock(&frameCache.lock);
+    for (int i = 0; i < COMPRESS_CACHE_FRAMES; i++) {
+        frameCache.slots[i].used = false;
+    }
+    pthread_mutex_unlock(&frameCache.lock);
+}
+
+CompressStats compressGetStats(void) {
+    pthread_mutex_lock(&frameCache.lock);
+    CompressStats stats = frameCache.stats;
+    pthread_mutex_unlock(&frameCache.lock);
+    return stats;
+}
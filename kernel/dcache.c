@@ -0,0 +1,244 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <sched.h>
+#include "dcache.h"
+
+#define DCACHE_SHARDS 16 // 해시 상위 비트로 고르는 조각 수. 조각마다 잠금과 LRU가 따로 있다
+#define SHARD_CAPACITY (DCACHE_CAPACITY / DCACHE_SHARDS)
+#define SHARD_BUCKETS (SHARD_CAPACITY * 2) // 조각별 해시 버킷 수 (2의 거듭제곱)
+#define NIL -1
+
+typedef struct DcacheEntry {
+    unsigned long parentSerial;
+    int type;
+    unsigned int hash;
+    char name[DCACHE_NAME_MAX];
+    struct Node* node; // NULL이면 음성 항목
+    int hashNext; // 같은 버킷의 다음 항목
+    int lruPrev; // LRU 목록 (head가 가장 최근)
+    int lruNext;
+} DcacheEntry;
+
+typedef struct DcacheShard {
+    unsigned char lock; // 짧게만 잡으므로 mutex 대신 스핀락
+    DcacheEntry entries[SHARD_CAPACITY];
+    int buckets[SHARD_BUCKETS];
+    int lruHead, lruTail;
+    int freeList; // 사용하지 않는 항목 (hashNext로 연결)
+    DcacheStats stats;
+} __attribute__((aligned(64))) DcacheShard;
+
+static DcacheShard shards[DCACHE_SHARDS];
+static pthread_once_t initOnce = PTHREAD_ONCE_INIT;
+
+static bool shardTryLock(DcacheShard* shard) {
+    return !__atomic_exchange_n(&shard->lock, 1, __ATOMIC_ACQUIRE);
+}
+
+static void shardLock(DcacheShard* shard) {
+    while (!shardTryLock(shard)) {
+        while (__atomic_load_n(&shard->lock, __ATOMIC_RELAXED)) {
+            sched_yield();
+        }
+    }
+}
+
+static void shardUnlock(DcacheShard* shard) {
+    __atomic_store_n(&shard->lock, 0, __ATOMIC_RELEASE);
+}
+
+static unsigned int dcacheHash(unsigned long parentSerial, const char* name, int type) {
+    unsigned int hash = 2166136261u;
+    for (const unsigned char* p = (const unsigned char*)name; *p; p++) {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+    hash ^= (unsigned int)(parentSerial * 2654435761u) ^ (unsigned int)(parentSerial >> 32);
+    hash ^= (unsigned int)type;
+    hash *= 16777619u;
+    return hash;
+}
+
+// 버킷은 하위 비트, 조각은 상위 비트로 고른다.
+static DcacheShard* shardFor(unsigned int hash) {
+    return &shards[hash >> 28];
+}
+
+static void lruUnlink(DcacheShard* shard, int i) {
+    DcacheEntry* entries = shard->entries;
+    if (entries[i].lruPrev != NIL) entries[entries[i].lruPrev].lruNext = entries[i].lruNext;
+    else shard->lruHead = entries[i].lruNext;
+    if (entries[i].lruNext != NIL) entries[entries[i].lruNext].lruPrev = entries[i].lruPrev;
+    else shard->lruTail = entries[i].lruPrev;
+}
+
+static void lruPushFront(DcacheShard* shard, int i) {
+    DcacheEntry* entries = shard->entries;
+    entries[i].lruPrev = NIL;
+    entries[i].lruNext = shard->lruHead;
+    if (shard->lruHead != NIL) entries[shard->lruHead].lruPrev = i;
+    shard->lruHead = i;
+    if (shard->lruTail == NIL) shard->lruTail = i;
+}
+
+// 항목을 찾는다. prevOut에는 버킷 체인에서 바로 앞 항목을 돌려준다 (삭제용).
+static int findEntry(DcacheShard* shard, unsigned long parentSerial, const char* name, int type, unsigned int hash,
+                     int* prevOut) {
+    DcacheEntry* entries = shard->entries;
+    int prev = NIL;
+    for (int i = shard->buckets[hash & (SHARD_BUCKETS - 1)]; i != NIL; i = entries[i].hashNext) {
+        if (entries[i].hash == hash && entries[i].parentSerial == parentSerial &&
+            entries[i].type == type && strcmp(entries[i].name, name) == 0) {
+            if (prevOut) *prevOut = prev;
+            return i;
+        }
+        prev = i;
+    }
+    return NIL;
+}
+
+static void removeEntry(DcacheShard* shard, int i, int prev) {
+    DcacheEntry* entries = shard->entries;
+    if (prev != NIL) entries[prev].hashNext = entries[i].hashNext;
+    else shard->buckets[entries[i].hash & (SHARD_BUCKETS - 1)] = entries[i].hashNext;
+    lruUnlink(shard, i);
+    entries[i].hashNext = shard->freeList;
+    shard->freeList = i;
+}
+
+static void resetShard(DcacheShard* shard) {
+    for (int i = 0; i < SHARD_BUCKETS; i++) {
+        shard->buckets[i] = NIL;
+    }
+    shard->freeList = NIL;
+    for (int i = SHARD_CAPACITY - 1; i >= 0; i--) {
+        shard->entries[i].hashNext = shard->freeList;
+        shard->freeList = i;
+    }
+    shard->lruHead = shard->lruTail = NIL;
+}
+
+static void initShards(void) {
+    for (int s = 0; s < DCACHE_SHARDS; s++) {
+        resetShard(&shards[s]);
+    }
+}
+
+void dcacheInit(void) {
+    pthread_once(&initOnce, initShards);
+}
+
+void dcacheClear(void) {
+    dcacheInit();
+    for (int s = 0; s < DCACHE_SHARDS; s++) {
+        shardLock(&shards[s]);
+        resetShard(&shards[s]);
+        shardUnlock(&shards[s]);
+    }
+}
+
+// 조각이 다른 스레드에 잡혀 있으면 기다리지 않고 없는 것으로 친다 (디렉터리 인덱스에서 찾으면 된다).
+DcacheResult dcacheLookup(unsigned long parentSerial, const char* name, int type, struct Node** result) {
+    dcacheInit();
+    unsigned int hash = dcacheHash(parentSerial, name, type);
+    DcacheShard* shard = shardFor(hash);
+    if (!shardTryLock(shard)) {
+        return DCACHE_MISS;
+    }
+    DcacheResult outcome;
+    int i = findEntry(shard, parentSerial, name, type, hash, NULL);
+    if (i == NIL) {
+        shard->stats.misses++;
+        outcome = DCACHE_MISS;
+    } else {
+        lruUnlink(shard, i);
+        lruPushFront(shard, i);
+        *result = shard->entries[i].node;
+        if (shard->entries[i].node == NULL) {
+            shard->stats.negativeHits++;
+            outcome = DCACHE_NEGATIVE;
+        } else {
+            shard->stats.hits++;
+            outcome = DCACHE_HIT;
+        }
+    }
+    shardUnlock(shard);
+    return outcome;
+}
+
+void dcacheInsert(unsigned long parentSerial, const char* name, int type, struct Node* node,
+                  const unsigned int* generation, unsigned int observed) {
+    dcacheInit();
+    if (strlen(name) >= DCACHE_NAME_MAX) {
+        return; // 너무 긴 이름은 캐시하지 않는다
+    }
+    unsigned int hash = dcacheHash(parentSerial, name, type);
+    DcacheShard* shard = shardFor(hash);
+    shardLock(shard);
+    // 찾아본 뒤에 디렉터리가 바뀌었으면 결과가 이미 낡았을 수 있다. 바꾼 쪽의 무효화는
+    // 이 잠금을 잡은 뒤에 오므로, 여기서 값이 같으면 넣어도 곧 지워진다.
+    if (generation != NULL && __atomic_load_n(generation, __ATOMIC_ACQUIRE) != observed) {
+        shardUnlock(shard);
+        return;
+    }
+    DcacheEntry* entries = shard->entries;
+    int i = findEntry(shard, parentSerial, name, type, hash, NULL);
+    if (i != NIL) {
+        entries[i].node = node;
+        lruUnlink(shard, i);
+        lruPushFront(shard, i);
+        shardUnlock(shard);
+        return;
+    }
+    if (shard->freeList == NIL) {
+        // 가장 오래 쓰지 않은 항목을 내보낸다
+        int victim = shard->lruTail;
+        int prev = NIL;
+        findEntry(shard, entries[victim].parentSerial, entries[victim].name, entries[victim].type, entries[victim].hash,
+                  &prev);
+        removeEntry(shard, victim, prev);
+        shard->stats.evictions++;
+    }
+    i = shard->freeList;
+    shard->freeList = entries[i].hashNext;
+
+    entries[i].parentSerial = parentSerial;
+    entries[i].type = type;
+    entries[i].hash = hash;
+    strcpy(entries[i].name, name);
+    entries[i].node = node;
+    int bucket = hash & (SHARD_BUCKETS - 1);
+    entries[i].hashNext = shard->buckets[bucket];
+    shard->buckets[bucket] = i;
+    lruPushFront(shard, i);
+    shardUnlock(shard);
+}
+
+void dcacheInvalidate(unsigned long parentSerial, const char* name, int type) {
+    dcacheInit();
+    unsigned int hash = dcacheHash(parentSerial, name, type);
+    DcacheShard* shard = shardFor(hash);
+    shardLock(shard);
+    int prev = NIL;
+    int i = findEntry(shard, parentSerial, name, type, hash, &prev);
+    if (i != NIL) {
+        removeEntry(shard, i, prev);
+    }
+    shardUnlock(shard);
+}
+
+DcacheStats dcacheGetStats(void) {
+    DcacheStats total = {0};
+    for (int s = 0; s < DCACHE_SHARDS; s++) {
+        shardLock(&shards[s]);
+        total.hits += shards[s].stats.hits;
+        total.negativeHits += shards[s].stats.negativeHits;
+        total.misses += shards[s].stats.misses;
+        total.evictions += shards[s].stats.evictions;
+        shardUnlock(&shards[s]);
+    }
+    return total;
+}
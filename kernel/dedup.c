@@ -0,0 +1,186 @@
+#include <stdlib.h>
+#include <string.h>
+#include "dedup.h"
+#include "bitmap.h"
+
+typedef struct Blob {
+    unsigned long long hash;
+    long length;
+    ExtentList extents; // 표가 가진 사본. 빈 칸이면 count가 0
+    int next; // 같은 해시 칸의 다음 blob (빈 칸이면 빈 칸 목록의 다음)
+    int headNext; // 같은 첫 블록 칸의 다음 blob
+} Blob;
+
+typedef struct DedupTable {
+    Blob* blobs;
+    int capacity;
+    int count;
+    int freeList;
+    int* hashBuckets;
+    int* headBuckets;
+    unsigned long bucketMask; // 칸 수 - 1, 아직 없으면 칸 수 0
+    Bitmap heads; // 어느 blob의 첫 블록인 블록 (반납할 때 빨리 거른다)
+    DedupStats stats;
+} DedupTable;
+
+static DedupTable table = { .freeList = -1 };
+
+static unsigned long hashBucket(unsigned long long hash) {
+    return (unsigned long)(hash ^ (hash >> 29)) & table.bucketMask;
+}
+
+static unsigned long headBucket(int block) {
+    return ((unsigned long)block * 0x9E3779B97F4A7C15ULL >> 20) & table.bucketMask;
+}
+
+static int headOf(const Blob* blob) {
+    return blob->extents.extents[0].start;
+}
+
+static void linkBlob(int index) {
+    Blob* blob = &table.blobs[index];
+    unsigned long bucket = hashBucket(blob->hash);
+    blob->next = table.hashBuckets[bucket];
+    table.hashBuckets[bucket] = index;
+    bucket = headBucket(headOf(blob));
+    blob->headNext = table.headBuckets[bucket];
+    table.headBuckets[bucket] = index;
+}
+
+// blob 수가 칸 수를 넘으면 칸을 두 배로 늘려 다시 건다.
+static void growBuckets(void) {
+    unsigned long bucketCount = table.hashBuckets == NULL ? 1024 : (table.bucketMask + 1) * 2;
+    free(table.hashBuckets);
+    free(table.headBuckets);
+    table.hashBuckets = (int*)malloc(bucketCount * sizeof(int));
+    table.headBuckets = (int*)malloc(bucketCount * sizeof(int));
+    memset(table.hashBuckets, 0xff, bucketCount * sizeof(int));
+    memset(table.headBuckets, 0xff, bucketCount * sizeof(int));
+    table.bucketMask = bucketCount - 1;
+    for (int i = 0; i < table.capacity; i++) {
+        if (table.blobs[i].extents.count > 0) {
+            linkBlob(i);
+        }
+    }
+}
+
+int dedupFindLocked(unsigned long long hash, long length) {
+    if (table.hashBuckets == NULL) {
+        return -1;
+    }
+    for (int index = table.hashBuckets[hashBucket(hash)]; index >= 0; index = table.blobs[index].next) {
+        if (table.blobs[index].hash == hash && table.blobs[index].length == length) {
+            return index;
+        }
+    }
+    return -1;
+}
+
+const ExtentList* dedupExtentsLocked(int blob) {
+    return &table.blobs[blob].extents;
+}
+
+void dedupInsertLocked(unsigned long long hash, long length, const ExtentList* extents) {
+    if (extents->count == 0 || dedupFindLocked(hash, length) >= 0) {
+        return;
+    }
+    if (table.hashBuckets == NULL || (unsigned long)table.count >= table.bucketMask + 1) {
+        growBuckets();
+    }
+    if (table.freeList < 0) {
+        int capacity = table.capacity == 0 ? 256 : table.capacity * 2;
+        table.blobs = (Blob*)realloc(table.blobs, capacity * sizeof(Blob));
+        memset(table.blobs + table.capacity, 0, (capacity - table.capacity) * sizeof(Blob));
+        for (int i = capacity - 1; i >= table.capacity; i--) { // 앞쪽 칸부터 쓰도록 뒤에서부터 넣는다
+            table.blobs[i].next = table.freeList;
+            table.freeList = i;
+        }
+        table.capacity = capacity;
+    }
+    int index = table.freeList;
+    table.freeList = table.blobs[index].next;
+    Blob* blob = &table.blobs[index];
+    blob->hash = hash;
+    blob->length = length;
+    blob->extents.extents = (Extent*)malloc(extents->count * sizeof(Extent));
+    memcpy(blob->extents.extents, extents->extents, extents->count * sizeof(Extent));
+    blob->extents.count = blob->extents.capacity = extents->count;
+    linkBlob(index);
+    table.count++;
+    int head = headOf(blob);
+    bitmapGrow(&table.heads, (size_t)head + 1);
+    bitmapSet(&table.heads, head);
+}
+
+static void unlinkChain(int* link, int index, bool byHead) {
+    while (*link != index) {
+        link = byHead ? &table.blobs[*link].headNext : &table.blobs[*link].next;
+    }
+    *link = byHead ? table.blobs[index].headNext : table.blobs[index].next;
+}
+
+void dedupForgetLocked(int block) {
+    if (!bitmapTest(&table.heads, block)) {
+        return;
+    }
+    bitmapClear(&table.heads, block);
+    int index = table.headBuckets[headBucket(block)];
+    while (index >= 0 && headOf(&table.blobs[index]) != block) {
+        index = table.blobs[index].headNext;
+    }
+    if (index < 0) {
+        return;
+    }
+    Blob* blob = &table.blobs[index];
+    unlinkChain(&table.hashBuckets[hashBucket(blob->hash)], index, false);
+    unlinkChain(&table.headBuckets[headBucket(block)], index, true);
+    free(blob->extents.extents);
+    memset(blob, 0, sizeof(*blob));
+    blob->next = table.freeList;
+    table.freeList = index;
+    table.count--;
+}
+
+void dedupRecord(bool hit, bool mismatch, long length) {
+    __atomic_add_fetch(&table.stats.lookups, 1, __ATOMIC_RELAXED);
+    if (hit) {
+        __atomic_add_fetch(&table.stats.hits, 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&table.stats.sharedBytes, (unsigned long long)length, __ATOMIC_RELAXED);
+    }
+    if (mismatch) {
+        __atomic_add_fetch(&table.stats.mismatches, 1, __ATOMIC_RELAXED);
+    }
+}
+
+void dedupForEach(DedupVisitFn visit, void* context) {
+    for (int i = 0; i < table.capacity; i++) {
+        if (table.blobs[i].extents.count > 0) {
+            visit(table.blobs[i].hash, table.blobs[i].length, &table.blobs[i].extents, context);
+        }
+    }
+}
+
+void dedupReset(void) {
+    for (int i = 0; i < table.capacity; i++) {
+        free(table.blobs[i].extents.extents);
+    }
+    free(table.blobs);
+    free(table.hashBuckets);
+    free(table.headBuckets);
+    bitmapDestroy(&table.heads);
+    memset(&table, 0, sizeof(table));
+    table.freeList = -1;
+}
+
+DedupStats dedupGetStats(void) {
+    DedupStats stats = table.stats;
+    stats.blobs = table.count;
+    stats.tableBytes = (size_t)table.capacity * sizeof(Blob) + table.heads.wordCount * sizeof(unsigned long long);
+    if (table.hashBuckets != NULL) {
+        stats.tableBytes += 2 * (table.bucketMask + 1) * sizeof(int);
+    }
+    for (int i = 0; i < table.capacity; i++) {
+        stats.tableBytes += (size_t)table.blobs[i].extents.capacity * sizeof(Extent);
+    }
+    return stats;
+}
@@ -0,0 +1,403 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "image.h"
+#include "bcache.h"
+#include "dedup.h"
+#include "walk.h"
+
+// 저장할 때 노드 레코드, 구간, 이름을 모아 두는 버퍼
+typedef struct ImageBuilder {
+    ImageNode* nodes;
+    size_t nodeCount, nodeCapacity;
+    Extent* extents;
+    size_t extentCount, extentCapacity;
+    char* names;
+    size_t namesLength, namesCapacity;
+    int* dirRecords; // dirRecords[d]: 지금 훑고 있는 깊이 d 디렉터리의 레코드 번호
+    size_t dirRecordCapacity;
+    ImageBlob* blobs;
+    size_t blobCount, blobCapacity;
+    ImageCompressed* compressed;
+    size_t compressedCount, compressedCapacity;
+} ImageBuilder;
+
+static void* growArray(void* array, size_t* capacity, size_t needed, size_t elementSize) {
+    if (needed <= *capacity) {
+        return array;
+    }
+    size_t newCapacity = *capacity == 0 ? 64 : *capacity;
+    while (newCapacity < needed) {
+        newCapacity *= 2;
+    }
+    *capacity = newCapacity;
+    return realloc(array, newCapacity * elementSize);
+}
+
+// 전위 순회로 레코드를 쌓는다. 자식은 형제 목록 순서(생성 순서) 그대로 저장된다.
+static WalkAction collectNode(Node* node, int depth, void* state) {
+    ImageBuilder* builder = (ImageBuilder*)state;
+    int parentRecord = depth == 0 ? -1 : builder->dirRecords[depth - 1];
+    const char* name = node->name;
+    Inode* inode = getInode(node->inode);
+    size_t nameLength = strlen(name) + 1;
+
+    builder->names = (char*)growArray(builder->names, &builder->namesCapacity, builder->namesLength + nameLength, 1);
+    memcpy(builder->names + builder->namesLength, name, nameLength);
+
+    builder->nodes = (ImageNode*)growArray(builder->nodes, &builder->nodeCapacity, builder->nodeCount + 1, sizeof(ImageNode));
+    int record = (int)builder->nodeCount++;
+    ImageNode* out = &builder->nodes[record];
+    memset(out, 0, sizeof(*out));
+    out->inode = node->inode;
+    out->parent = parentRecord;
+    out->type = node->type;
+    out->linkCount = INODE_LINKS(node->inode);
+    out->nameOffset = (unsigned int)builder->namesLength;
+    out->fileSize = INODE_SIZE(node->inode);
+    out->created = INODE_CREATED(node->inode);
+    out->modified = INODE_MODIFIED(node->inode);
+    builder->namesLength += nameLength;
+
+    if (node->type == FILE_TYPE) {
+        if (inode->storedSize > 0) {
+            builder->compressed = (ImageCompressed*)growArray(builder->compressed, &builder->compressedCapacity,
+                                                              builder->compressedCount + 1, sizeof(ImageCompressed));
+            builder->compressed[builder->compressedCount++] = (ImageCompressed){(unsigned long long)record, inode->storedSize};
+        }
+        out->extentStart = builder->extentCount;
+        out->extentCount = inode->extents.count;
+        builder->extents = (Extent*)growArray(builder->extents, &builder->extentCapacity,
+                                              builder->extentCount + inode->extents.count, sizeof(Extent));
+        if (inode->extents.count > 0) { // 빈 파일은 익스텐트 배열이 없다
+            memcpy(builder->extents + builder->extentCount, inode->extents.extents,
+                   inode->extents.count * sizeof(Extent));
+        }
+        builder->extentCount += inode->extents.count;
+        return WALK_CONTINUE;
+    }
+    builder->dirRecords = (int*)growArray(builder->dirRecords, &builder->dirRecordCapacity, depth + 1, sizeof(int));
+    builder->dirRecords[depth] = record;
+    return WALK_CONTINUE;
+}
+
+// blob의 구간은 노드 구간 뒤에 붙인다 (노드를 모두 모은 뒤에 부른다).
+static void collectBlob(unsigned long long hash, long length, const ExtentList* extents, void* state) {
+    ImageBuilder* builder = (ImageBuilder*)state;
+    builder->blobs = (ImageBlob*)growArray(builder->blobs, &builder->blobCapacity, builder->blobCount + 1, sizeof(ImageBlob));
+    builder->blobs[builder->blobCount++] = (ImageBlob){hash, length, builder->extentCount, (unsigned long long)extents->count};
+    builder->extents = (Extent*)growArray(builder->extents, &builder->extentCapacity,
+                                          builder->extentCount + extents->count, sizeof(Extent));
+    memcpy(builder->extents + builder->extentCount, extents->extents, extents->count * sizeof(Extent));
+    builder->extentCount += extents->count;
+}
+
+static unsigned long long align8(unsigned long long offset) {
+    return (offset + 7) & ~7ULL;
+}
+
+static bool writePadding(FILE* out, unsigned long long from, unsigned long long to) {
+    static const char zeros[8] = {0};
+    return to == from || fwrite(zeros, 1, to - from, out) == to - from;
+}
+
+// 경로를 직접 지정했을 때만 이미지에 저장한다. 기본은 예전처럼 메모리에만 둔다.
+const char* imagePath(void) {
+    const char* path = getenv("MINIOS_IMAGE");
+    return path == NULL || path[0] == '\0' ? NULL : path;
+}
+
+// 임시 파일에 쓰고 fsync한 뒤 rename하므로, 저장 도중 멈춰도 이전 이미지는 그대로 남는다.
+// 지금 매핑해서 쓰고 있는 이미지도 rename 뒤에는 이전 파일을 가리키므로 안전하다.
+bool saveImage(Node* root, const char* path, unsigned long long journalSequence) {
+    ImageBuilder builder;
+    memset(&builder, 0, sizeof(builder));
+    walkTree(root, 0, collectNode, NULL, &builder); // 단독으로 들어온 상태에서 저장하므로 잠그지 않는다
+    dedupForEach(collectBlob, &builder);
+
+    // 데이터 파일에 있는 내용은 먼저 내려보내고, 이미지에는 메타데이터만 쓴다
+    bool external = blockStoreBacked();
+    if (external && !blockStoreSync()) {
+        printf("데이터 파일을 내려보내지 못해 이미지 '%s'을(를) 저장하지 않았습니다.\n", path);
+        free(builder.nodes);
+        free(builder.extents);
+        free(builder.names);
+        free(builder.dirRecords);
+        free(builder.blobs);
+        free(builder.compressed);
+        return false;
+    }
+    const Bitmap* bitmap = blockStoreBitmap();
+    int chunkCount = blockStoreChunkCount();
+    size_t blockCount = (size_t)chunkCount * BLOCK_CHUNK_SIZE;
+
+    ImageHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, IMAGE_MAGIC, sizeof(header.magic));
+    header.version = IMAGE_VERSION;
+    header.blockSize = BLOCK_SIZE;
+    header.blockChunkSize = BLOCK_CHUNK_SIZE;
+    header.chunkCount = chunkCount;
+    header.usedBlocks = superblock.usedBlocks;
+    header.nodeCount = (int)builder.nodeCount;
+    header.inodeCount = superblock.totalInodes;
+    header.dataOffset = IMAGE_HEADER_SIZE;
+    header.dataExternal = external;
+    header.refCountsOffset = header.dataOffset + (external ? 0 : (unsigned long long)chunkCount * BLOCK_CHUNK_BYTES);
+    header.bitmapOffset = align8(header.refCountsOffset + blockCount * sizeof(unsigned int));
+    header.bitmapWords = bitmap->wordCount;
+    header.nodesOffset = align8(header.bitmapOffset + bitmap->wordCount * sizeof(unsigned long long));
+    header.extentsOffset = align8(header.nodesOffset + builder.nodeCount * sizeof(ImageNode));
+    header.extentCount = builder.extentCount;
+    header.namesOffset = align8(header.extentsOffset + builder.extentCount * sizeof(Extent));
+    header.namesLength = builder.namesLength;
+    header.blobsOffset = align8(header.namesOffset + builder.namesLength);
+    header.blobCount = builder.blobCount;
+    header.compressedOffset = align8(header.blobsOffset + builder.blobCount * sizeof(ImageBlob));
+    header.compressedCount = builder.compressedCount;
+    header.savedAt = time(NULL);
+    header.journalSequence = journalSequence;
+
+    size_t tempLength = strlen(path) + 5;
+    char* tempPath = (char*)malloc(tempLength);
+    snprintf(tempPath, tempLength, "%s.tmp", path);
+
+    bool ok = false;
+    FILE* out = fopen(tempPath, "wb");
+    if (out == NULL) {
+        printf("이미지 파일 '%s'을(를) 만들 수 없습니다.\n", tempPath);
+    } else {
+        char headerPage[IMAGE_HEADER_SIZE];
+        memset(headerPage, 0, sizeof(headerPage));
+        memcpy(headerPage, &header, sizeof(header));
+        ok = fwrite(headerPage, 1, sizeof(headerPage), out) == sizeof(headerPage);
+        for (int i = 0; ok && !external && i < chunkCount; i++) {
+            ok = fwrite(blockStoreChunk(i), 1, BLOCK_CHUNK_BYTES, out) == BLOCK_CHUNK_BYTES;
+        }
+        ok = ok && fwrite(blockStoreRefCounts(), sizeof(unsigned int), blockCount, out) == blockCount;
+        ok = ok && writePadding(out, header.refCountsOffset + blockCount * sizeof(unsigned int), header.bitmapOffset);
+        ok = ok && fwrite(bitmap->words, sizeof(unsigned long long), bitmap->wordCount, out) == bitmap->wordCount;
+        ok = ok && fwrite(builder.nodes, sizeof(ImageNode), builder.nodeCount, out) == builder.nodeCount;
+        ok = ok && fwrite(builder.extents, sizeof(Extent), builder.extentCount, out) == builder.extentCount;
+        ok = ok && writePadding(out, header.extentsOffset + builder.extentCount * sizeof(Extent), header.namesOffset);
+        ok = ok && fwrite(builder.names, 1, builder.namesLength, out) == builder.namesLength;
+        ok = ok && writePadding(out, header.namesOffset + builder.namesLength, header.blobsOffset);
+        ok = ok && (builder.blobCount == 0 ||
+                    fwrite(builder.blobs, sizeof(ImageBlob), builder.blobCount, out) == builder.blobCount);
+        ok = ok && writePadding(out, header.blobsOffset + builder.blobCount * sizeof(ImageBlob), header.compressedOffset);
+        ok = ok && (builder.compressedCount == 0 ||
+                    fwrite(builder.compressed, sizeof(ImageCompressed), builder.compressedCount, out) ==
+                        builder.compressedCount);
+        ok = ok && fflush(out) == 0 && fsync(fileno(out)) == 0;
+        ok = (fclose(out) == 0) && ok;
+        if (ok && rename(tempPath, path) != 0) {
+            ok = false;
+        }
+        if (!ok) {
+            printf("이미지 파일 '%s'을(를) 저장하지 못했습니다.\n", path);
+            unlink(tempPath);
+        }
+    }
+
+    free(tempPath);
+    free(builder.nodes);
+    free(builder.extents);
+    free(builder.names);
+    free(builder.dirRecords);
+    free(builder.blobs);
+    free(builder.compressed);
+    return ok;
+}
+
+static bool validHeader(const ImageHeader* header, size_t length) {
+    if (memcmp(header->magic, IMAGE_MAGIC, sizeof(header->magic)) != 0 || header->version != IMAGE_VERSION ||
+        header->blockSize != BLOCK_SIZE || header->blockChunkSize != BLOCK_CHUNK_SIZE) {
+        return false;
+    }
+    if (header->chunkCount < 0 || header->chunkCount > MAX_BLOCK_CHUNKS || header->nodeCount < 1 ||
+        header->inodeCount < header->nodeCount || header->inodeCount > MAX_INODE_CHUNKS * INODE_CHUNK_SIZE) {
+        return false;
+    }
+    unsigned long long blockCount = (unsigned long long)header->chunkCount * BLOCK_CHUNK_SIZE;
+    unsigned long long dataBytes = header->dataExternal ? 0 : (unsigned long long)header->chunkCount * BLOCK_CHUNK_BYTES;
+    return header->dataExternal <= 1 && header->dataOffset == IMAGE_HEADER_SIZE &&
+           header->refCountsOffset == header->dataOffset + dataBytes &&
+           header->bitmapOffset >= header->refCountsOffset + blockCount * sizeof(unsigned int) &&
+           header->bitmapWords == (blockCount + 63) / 64 &&
+           header->nodesOffset >= header->bitmapOffset + header->bitmapWords * sizeof(unsigned long long) &&
+           header->extentsOffset >= header->nodesOffset + (unsigned long long)header->nodeCount * sizeof(ImageNode) &&
+           header->namesOffset >= header->extentsOffset + header->extentCount * sizeof(Extent) &&
+           header->namesOffset + header->namesLength <= length &&
+           (header->blobCount == 0 || (header->blobsOffset >= header->namesOffset + header->namesLength &&
+                                       header->blobsOffset + header->blobCount * sizeof(ImageBlob) <= length)) &&
+           (header->compressedCount == 0 ||
+            (header->compressedOffset >= header->blobsOffset + header->blobCount * sizeof(ImageBlob) &&
+             header->compressedCount <= (unsigned long long)header->nodeCount &&
+             header->compressedOffset + header->compressedCount * sizeof(ImageCompressed) <= length));
+}
+
+// 이름은 노드의 이름 칸(100 bytes)에 들어가야 한다.
+static bool validName(const char* name, unsigned long long available) {
+    size_t limit = available < 100 ? (size_t)available : 100;
+    return memchr(name, '\0', limit) != NULL;
+}
+
+// 이미지를 MAP_PRIVATE로 통째로 매핑한다. 블록 데이터와 참조 수는 매핑을 그대로 쓰고
+// (건드리는 페이지만 읽혀 온다), 노드와 inode만 레코드에서 다시 만든다.
+Node* loadImage(const char* path, unsigned long long* journalSequence) {
+    *journalSequence = 0;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < IMAGE_HEADER_SIZE) {
+        close(fd);
+        printf("이미지 파일 '%s'이(가) 올바르지 않습니다.\n", path);
+        return NULL;
+    }
+    size_t length = (size_t)st.st_size;
+    char* base = (char*)mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        printf("이미지 파일 '%s'을(를) 매핑할 수 없습니다.\n", path);
+        return NULL;
+    }
+
+    const ImageHeader* header = (const ImageHeader*)base;
+    if (memcmp(header->magic, IMAGE_MAGIC, sizeof(header->magic)) == 0 && header->version != IMAGE_VERSION) {
+        unsigned int version = header->version;
+        munmap(base, length);
+        printf("이미지 파일 '%s'은(는) 버전 %u입니다 (이 버전은 %d만 읽습니다).\n", path, version, IMAGE_VERSION);
+        return NULL;
+    }
+    if (!validHeader(header, length)) {
+        munmap(base, length);
+        printf("이미지 파일 '%s'이(가) 올바르지 않습니다.\n", path);
+        return NULL;
+    }
+    int nodeCount = header->nodeCount;
+    const ImageNode* records = (const ImageNode*)(base + header->nodesOffset);
+    const Extent* extents = (const Extent*)(base + header->extentsOffset);
+    const char* names = base + header->namesOffset;
+    // 헤더와, 비트맵부터 압축 목록까지 곧바로 다 읽을 메타데이터만 미리 읽어 둔다 (참조 수는 블록 데이터처럼 필요할 때 읽힌다)
+    unsigned long long metadataEnd = header->namesOffset + header->namesLength;
+    if (header->blobCount > 0) {
+        metadataEnd = header->blobsOffset + header->blobCount * sizeof(ImageBlob);
+    }
+    if (header->compressedCount > 0) {
+        metadataEnd = header->compressedOffset + header->compressedCount * sizeof(ImageCompressed);
+    }
+    unsigned long long metadataStart = header->bitmapOffset & ~(unsigned long long)(sysconf(_SC_PAGESIZE) - 1);
+    madvise(base, header->dataOffset, MADV_WILLNEED);
+    madvise(base + metadataStart, metadataEnd - metadataStart, MADV_WILLNEED);
+
+    // 이후로 매핑은 블록 저장소가 소유한다 (다음 initBlockStore에서 해제된다)
+    blockStoreAdopt(base, length, header->dataExternal ? NULL : base + header->dataOffset, header->chunkCount,
+                    (unsigned int*)(base + header->refCountsOffset),
+                    (const unsigned long long*)(base + header->bitmapOffset), header->usedBlocks);
+    if (header->dataExternal && !imageAttachData(path)) {
+        initFileSystem();
+        printf("이미지 파일 '%s'의 데이터 파일을 열 수 없습니다.\n", path);
+        return NULL;
+    }
+
+    Node** byRecord = (Node**)malloc(nodeCount * sizeof(Node*));
+    Node* root = NULL;
+    for (int i = 0; i < nodeCount; i++) {
+        const ImageNode* record = &records[i];
+        bool valid = record->inode >= 0 && record->inode < header->inodeCount && (record->type == DIR_TYPE || record->type == FILE_TYPE) &&
+                     record->nameOffset < header->namesLength &&
+                     validName(names + record->nameOffset, header->namesLength - record->nameOffset) &&
+                     record->extentStart + record->extentCount <= header->extentCount &&
+                     (i == 0 ? record->parent == -1 : record->parent >= 0 && record->parent < i &&
+                                                      byRecord[record->parent]->type == DIR_TYPE);
+        Node* node = valid ? restoreNode(names + record->nameOffset, (NodeType)record->type, record->inode) : NULL;
+        if (node == NULL) {
+            printf("이미지 파일 '%s'의 노드 레코드 %d이(가) 올바르지 않습니다.\n", path, i);
+            if (root != NULL) {
+                destroyFileSystem(root);
+            } else {
+                initFileSystem();
+            }
+            free(byRecord);
+            return NULL;
+        }
+        Inode* inode = getInode(record->inode);
+        INODE_SIZE(record->inode) = record->fileSize;
+        INODE_CREATED(record->inode) = (time_t)record->created;
+        INODE_MODIFIED(record->inode) = (time_t)record->modified;
+        INODE_LINKS(record->inode) = record->linkCount;
+        inode->storedSize = 0;
+        if (record->extentCount > 0) {
+            inode->extents.extents = (Extent*)malloc(record->extentCount * sizeof(Extent));
+            memcpy(inode->extents.extents, extents + record->extentStart, record->extentCount * sizeof(Extent));
+            inode->extents.count = record->extentCount;
+            inode->extents.capacity = record->extentCount;
+        }
+        byRecord[i] = node;
+        if (i == 0) {
+            root = node;
+        } else {
+            attachRestoredChild(byRecord[record->parent], node);
+        }
+    }
+    free(byRecord);
+
+    // 압축된 파일은 블록에 든 길이를 되살린다. 블록 수와 맞지 않는 항목은 버린다.
+    const ImageCompressed* compressed = (const ImageCompressed*)(base + header->compressedOffset);
+    for (unsigned long long i = 0; i < header->compressedCount; i++) {
+        if (compressed[i].record >= (unsigned long long)nodeCount || records[compressed[i].record].type != FILE_TYPE) {
+            continue;
+        }
+        Inode* inode = getInode(records[compressed[i].record].inode);
+        long long blocks = 0;
+        for (int e = 0; e < inode->extents.count; e++) {
+            blocks += inode->extents.extents[e].count;
+        }
+        long long stored = compressed[i].storedSize;
+        if (stored > 0 && (stored + BLOCK_SIZE - 1) / BLOCK_SIZE == blocks) {
+            inode->storedSize = (long)stored;
+        }
+    }
+
+    // 중복 제거 표를 되살린다. 이미 반납된 블록을 가리키는 blob은 버린다.
+    const ImageBlob* blobs = (const ImageBlob*)(base + header->blobsOffset);
+    for (unsigned long long i = 0; i < header->blobCount; i++) {
+        const ImageBlob* blob = &blobs[i];
+        if (blob->extentCount == 0 || blob->extentCount > header->extentCount ||
+            blob->extentStart > header->extentCount - blob->extentCount) {
+            continue;
+        }
+        ExtentList list = {(Extent*)(extents + blob->extentStart), (int)blob->extentCount, (int)blob->extentCount};
+        bool live = true;
+        for (int e = 0; live && e < list.count; e++) {
+            live = list.extents[e].start >= 0 && list.extents[e].count > 0 &&
+                   (long long)list.extents[e].start + list.extents[e].count <= superblock.totalBlocks &&
+                   blockRefCount(list.extents[e].start) > 0;
+        }
+        if (live) {
+            dedupInsertLocked(blob->hash, (long)blob->length, &list);
+        }
+    }
+
+    recomputeAggregates(root);
+    markContentIndexStale();
+    markMetaIndexStale();
+    *journalSequence = header->journalSequence;
+    return root;
+}
+
+bool imageAttachData(const char* path) {
+    size_t length = strlen(path) + sizeof(IMAGE_DATA_SUFFIX);
+    char* dataPath = (char*)malloc(length);
+    snprintf(dataPath, length, "%s%s", path, IMAGE_DATA_SUFFIX);
+    bool ok = blockStoreAttach(dataPath, cacheBudget());
+    free(dataPath);
+    return ok;
+}
@@ -0,0 +1,452 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/stat.h>
+#include "journal.h"
+
+#define JOURNAL_MAGIC 0x324E524Au // "JRN2" (명령 시각이 들어간 레코드)
+
+typedef struct JournalRecordHeader {
+    unsigned int magic;
+    unsigned int op;
+    unsigned long long sequence;
+    long long time; // 명령 시각 (time_t)
+    unsigned int payloadLength;
+    unsigned int checksum; // sequence, op, time, payload에 대한 FNV-1a
+} JournalRecordHeader;
+
+typedef struct Journal {
+    int fd;
+    bool open;
+    pthread_t flusher;
+    pthread_mutex_t lock;
+    pthread_cond_t wake; // flush 스레드를 깨운다
+    pthread_cond_t durable; // flush가 끝났음을 알린다
+    char* buffer; // 아직 내려보내지 않은 레코드
+    size_t length, capacity;
+    char* spare; // flush 중에는 이 버퍼에 쓰고, 끝나면 맞바꾼다
+    size_t spareCapacity;
+    struct timespec oldest; // 버퍼에서 가장 오래 기다린 레코드가 들어온 시각
+    unsigned long long nextSequence;
+    unsigned long long appendedSequence;
+    unsigned long long durableSequence;
+    unsigned long long appliedSequence; // 이미지에 이미 반영된 마지막 번호
+    size_t windowBytes;
+    long delayMs;
+    int syncWaiters;
+    int writers; // journalBeginWrite 뒤에 아직 레코드를 기다리기 시작하지 않은 변경 명령 수
+    int commitWaiters; // journalEndWrite에서 자기 레코드를 기다리는 명령 수
+    bool async; // MINIOS_JOURNAL_ASYNC: 명령이 레코드를 기다리지 않는다
+    bool flushing;
+    bool stopping;
+    bool writeFailed;
+    JournalStats stats;
+} Journal;
+
+static Journal journal = { .fd = -1, .lock = PTHREAD_MUTEX_INITIALIZER,
+                           .wake = PTHREAD_COND_INITIALIZER, .durable = PTHREAD_COND_INITIALIZER };
+
+static unsigned int fnv1a(unsigned int hash, const void* data, size_t length) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static unsigned int recordChecksum(const JournalRecordHeader* header, const char* payload) {
+    unsigned int hash = 2166136261u;
+    hash = fnv1a(hash, &header->sequence, sizeof(header->sequence));
+    hash = fnv1a(hash, &header->op, sizeof(header->op));
+    hash = fnv1a(hash, &header->time, sizeof(header->time));
+    return fnv1a(hash, payload, header->payloadLength);
+}
+
+static long envLong(const char* name, long fallback) {
+    const char* value = getenv(name);
+    if (value == NULL || value[0] == '\0') {
+        return fallback;
+    }
+    char* end;
+    long parsed = strtol(value, &end, 10);
+    return (*end == '\0' && parsed >= 0) ? parsed : fallback;
+}
+
+static bool deadlinePassed(const struct timespec* deadline) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return now.tv_sec > deadline->tv_sec || (now.tv_sec == deadline->tv_sec && now.tv_nsec >= deadline->tv_nsec);
+}
+
+static void writeAll(const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(journal.fd, data, length);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            journal.writeFailed = true;
+            return;
+        }
+        data += written;
+        length -= written;
+    }
+}
+
+// 버퍼가 크기 창을 넘거나, 가장 오래된 레코드의 지연 창이 지나거나, 누가 sync를 기다리면
+// 버퍼를 통째로 넘겨받아 한 번에 쓰고 fdatasync한다. 그동안 새 레코드는 다른 버퍼에 쌓인다.
+static void* flushLoop(void* unused) {
+    (void)unused;
+    pthread_mutex_lock(&journal.lock);
+    while (1) {
+        while (!journal.stopping && journal.length == 0) {
+            pthread_cond_wait(&journal.wake, &journal.lock);
+        }
+        if (journal.length == 0) {
+            break; // stopping
+        }
+        struct timespec deadline = journal.oldest;
+        deadline.tv_sec += journal.delayMs / 1000;
+        deadline.tv_nsec += (journal.delayMs % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        // 기다리는 명령이 있고 레코드를 더 남길 명령이 없으면 창을 채울 이유가 없다
+        while (!journal.stopping && journal.syncWaiters == 0 && journal.length < journal.windowBytes &&
+               !(journal.commitWaiters > 0 && journal.writers == 0) && !deadlinePassed(&deadline)) {
+            pthread_cond_timedwait(&journal.wake, &journal.lock, &deadline);
+        }
+
+        char* batch = journal.buffer;
+        size_t batchLength = journal.length;
+        size_t batchCapacity = journal.capacity;
+        unsigned long long batchSequence = journal.appendedSequence;
+        journal.buffer = journal.spare;
+        journal.capacity = journal.spareCapacity;
+        journal.length = 0;
+        journal.flushing = true;
+        pthread_mutex_unlock(&journal.lock);
+
+        writeAll(batch, batchLength);
+        if (fdatasync(journal.fd) != 0) {
+            journal.writeFailed = true;
+        }
+
+        pthread_mutex_lock(&journal.lock);
+        journal.spare = batch;
+        journal.spareCapacity = batchCapacity;
+        journal.flushing = false;
+        journal.durableSequence = batchSequence;
+        journal.stats.flushes++;
+        journal.stats.bytes += batchLength;
+        pthread_cond_broadcast(&journal.durable);
+    }
+    pthread_mutex_unlock(&journal.lock);
+    return NULL;
+}
+
+bool journalOpen(const char* path, unsigned long long appliedSequence) {
+    journal.fd = open(path, O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (journal.fd < 0) {
+        printf("저널 파일 '%s'을(를) 열 수 없습니다.\n", path);
+        return false;
+    }
+    journal.appliedSequence = appliedSequence;
+    journal.nextSequence = appliedSequence + 1;
+    journal.appendedSequence = appliedSequence;
+    journal.durableSequence = appliedSequence;
+    journal.windowBytes = (size_t)envLong("MINIOS_JOURNAL_BYTES", JOURNAL_DEFAULT_BYTES);
+    journal.delayMs = envLong("MINIOS_JOURNAL_DELAY_MS", JOURNAL_DEFAULT_DELAY_MS);
+    journal.async = envLong("MINIOS_JOURNAL_ASYNC", 0) != 0;
+    journal.writers = 0;
+    journal.commitWaiters = 0;
+    journal.stopping = false;
+    journal.writeFailed = false;
+    memset(&journal.stats, 0, sizeof(journal.stats));
+    if (pthread_create(&journal.flusher, NULL, flushLoop, NULL) != 0) {
+        close(journal.fd);
+        journal.fd = -1;
+        printf("저널 flush 스레드를 만들 수 없습니다.\n");
+        return false;
+    }
+    journal.open = true;
+    return true;
+}
+
+bool journalIsOpen(void) {
+    return journal.open;
+}
+
+static bool readWholeFile(int fd, char** data, size_t* length) {
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        return false;
+    }
+    *length = (size_t)st.st_size;
+    *data = (char*)malloc(*length > 0 ? *length : 1);
+    size_t done = 0;
+    while (done < *length) {
+        ssize_t got = pread(fd, *data + done, *length - done, done);
+        if (got <= 0) {
+            if (got < 0 && errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        done += got;
+    }
+    *length = done;
+    return true;
+}
+
+// 레코드 하나를 해석한다. 인자는 scratch에 NUL로 끝나는 문자열로 풀어 둔다.
+static bool decodeRecord(const char* data, size_t available, JournalRecord* record, char* scratch, size_t* recordLength) {
+    JournalRecordHeader header;
+    if (available < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != JOURNAL_MAGIC || header.payloadLength > available - sizeof(header) ||
+        header.op < JOURNAL_MAKEDIR || header.op > JOURNAL_TRUNCATEFILE) {
+        return false;
+    }
+    const char* payload = data + sizeof(header);
+    if (recordChecksum(&header, payload) != header.checksum) {
+        return false;
+    }
+    size_t offset = 0;
+    int argCount = 0;
+    while (offset < header.payloadLength) {
+        unsigned int argLength;
+        if (argCount == JOURNAL_MAX_ARGS || header.payloadLength - offset < sizeof(argLength)) {
+            return false;
+        }
+        memcpy(&argLength, payload + offset, sizeof(argLength));
+        offset += sizeof(argLength);
+        if (argLength > header.payloadLength - offset) {
+            return false;
+        }
+        memcpy(scratch, payload + offset, argLength);
+        scratch[argLength] = '\0';
+        record->args[argCount++] = scratch;
+        scratch += argLength + 1;
+        offset += argLength;
+    }
+    static const int expectedArgs[] = {0, 2, 3, 3, 4, 3, 5, 3, 4, 3}; // JournalOp별 인자 수
+    if (argCount != expectedArgs[header.op]) {
+        return false;
+    }
+    record->op = (JournalOp)header.op;
+    record->sequence = header.sequence;
+    record->time = (time_t)header.time;
+    record->argCount = argCount;
+    *recordLength = sizeof(header) + header.payloadLength;
+    return true;
+}
+
+// 이미지에 반영되지 않은 레코드를 순서대로 다시 적용한다. 쓰다 만 꼬리 레코드는 잘라낸다.
+int journalReplay(JournalApplyFn apply, void* context) {
+    char* data;
+    size_t length;
+    if (!journal.open || !readWholeFile(journal.fd, &data, &length)) {
+        return 0;
+    }
+    char* scratch = (char*)malloc(length + JOURNAL_MAX_ARGS + 1);
+    size_t offset = 0;
+    unsigned long long lastSequence = journal.appliedSequence;
+    int replayed = 0;
+    while (offset < length) {
+        JournalRecord record;
+        size_t recordLength;
+        if (!decodeRecord(data + offset, length - offset, &record, scratch, &recordLength)) {
+            printf("저널의 %zu번째 바이트 이후가 손상되어 잘라냅니다.\n", offset);
+            if (ftruncate(journal.fd, offset) != 0 || fdatasync(journal.fd) != 0) {
+                printf("저널을 잘라낼 수 없습니다.\n");
+            }
+            break;
+        }
+        if (record.sequence > journal.appliedSequence) {
+            apply(&record, context);
+            replayed++;
+        }
+        if (record.sequence > lastSequence) {
+            lastSequence = record.sequence;
+        }
+        offset += recordLength;
+    }
+    free(scratch);
+    free(data);
+
+    pthread_mutex_lock(&journal.lock);
+    journal.nextSequence = lastSequence + 1;
+    journal.appendedSequence = lastSequence;
+    journal.durableSequence = lastSequence;
+    journal.stats.replayed += replayed;
+    pthread_mutex_unlock(&journal.lock);
+    return replayed;
+}
+
+static void reserve(size_t needed) {
+    if (journal.length + needed <= journal.capacity) {
+        return;
+    }
+    size_t capacity = journal.capacity == 0 ? 4096 : journal.capacity;
+    while (capacity < journal.length + needed) {
+        capacity *= 2;
+    }
+    journal.buffer = (char*)realloc(journal.buffer, capacity);
+    journal.capacity = capacity;
+}
+
+static void put(const void* data, size_t length) {
+    memcpy(journal.buffer + journal.length, data, length);
+    journal.length += length;
+}
+
+void journalBeginWrite(void) {
+    if (!journal.open) {
+        return;
+    }
+    pthread_mutex_lock(&journal.lock);
+    journal.writers++;
+    pthread_mutex_unlock(&journal.lock);
+}
+
+unsigned long long journalAppend(JournalOp op, time_t time, int argCount, const char* const* args) {
+    if (!journal.open) {
+        return 0;
+    }
+    unsigned int argLengths[JOURNAL_MAX_ARGS];
+    JournalRecordHeader header;
+    header.magic = JOURNAL_MAGIC;
+    header.op = op;
+    header.time = (long long)time;
+    header.payloadLength = 0;
+    for (int i = 0; i < argCount; i++) {
+        argLengths[i] = (unsigned int)strlen(args[i]);
+        header.payloadLength += sizeof(unsigned int) + argLengths[i];
+    }
+
+    pthread_mutex_lock(&journal.lock);
+    if (journal.length == 0) {
+        clock_gettime(CLOCK_REALTIME, &journal.oldest);
+    }
+    header.sequence = journal.nextSequence++;
+    reserve(sizeof(header) + header.payloadLength);
+    size_t headerOffset = journal.length;
+    journal.length += sizeof(header);
+    size_t payloadOffset = journal.length;
+    for (int i = 0; i < argCount; i++) {
+        put(&argLengths[i], sizeof(unsigned int));
+        put(args[i], argLengths[i]);
+    }
+    header.checksum = recordChecksum(&header, journal.buffer + payloadOffset);
+    memcpy(journal.buffer + headerOffset, &header, sizeof(header));
+    journal.appendedSequence = header.sequence;
+    journal.stats.records++;
+    if (journal.length >= journal.windowBytes || journal.delayMs == 0 || journal.length == sizeof(header) + header.payloadLength) {
+        pthread_cond_signal(&journal.wake);
+    }
+    pthread_mutex_unlock(&journal.lock);
+    return header.sequence;
+}
+
+// 명령의 잠금을 모두 놓은 뒤에 부른다. 기다리는 동안 다른 명령의 레코드가 같은 fdatasync에 함께 실린다.
+void journalEndWrite(unsigned long long sequence) {
+    if (!journal.open) {
+        return;
+    }
+    pthread_mutex_lock(&journal.lock);
+    journal.writers--;
+    if (sequence != 0 && !journal.async) {
+        journal.commitWaiters++;
+        pthread_cond_signal(&journal.wake);
+        while (journal.durableSequence < sequence) {
+            pthread_cond_wait(&journal.durable, &journal.lock);
+        }
+        journal.commitWaiters--;
+        if (journal.writeFailed) {
+            printf("저널을 디스크에 쓰지 못했습니다.\n");
+            journal.writeFailed = false;
+        }
+    } else if (journal.writers == 0 && journal.commitWaiters > 0) {
+        pthread_cond_signal(&journal.wake); // 레코드 없이 끝났으니 남은 명령들의 레코드를 바로 내려보낸다
+    }
+    pthread_mutex_unlock(&journal.lock);
+}
+
+void journalSync(void) {
+    if (!journal.open) {
+        return;
+    }
+    pthread_mutex_lock(&journal.lock);
+    unsigned long long target = journal.appendedSequence;
+    journal.syncWaiters++;
+    pthread_cond_signal(&journal.wake);
+    while (journal.durableSequence < target) {
+        pthread_cond_wait(&journal.durable, &journal.lock);
+    }
+    journal.syncWaiters--;
+    if (journal.writeFailed) {
+        printf("저널을 디스크에 쓰지 못했습니다.\n");
+        journal.writeFailed = false;
+    }
+    pthread_mutex_unlock(&journal.lock);
+}
+
+unsigned long long journalSequence(void) {
+    pthread_mutex_lock(&journal.lock);
+    unsigned long long sequence = journal.appendedSequence;
+    pthread_mutex_unlock(&journal.lock);
+    return sequence;
+}
+
+// 호출하기 전에 journalSequence()까지 반영한 이미지가 저장되어 있어야 한다.
+void journalCheckpoint(void) {
+    if (!journal.open) {
+        return;
+    }
+    journalSync();
+    pthread_mutex_lock(&journal.lock);
+    while (journal.flushing || journal.length > 0) {
+        pthread_cond_signal(&journal.wake);
+        pthread_cond_wait(&journal.durable, &journal.lock);
+    }
+    if (ftruncate(journal.fd, 0) != 0 || fdatasync(journal.fd) != 0) {
+        printf("저널을 비울 수 없습니다.\n");
+    }
+    journal.appliedSequence = journal.appendedSequence;
+    pthread_mutex_unlock(&journal.lock);
+}
+
+void journalClose(void) {
+    if (!journal.open) {
+        return;
+    }
+    journalSync();
+    pthread_mutex_lock(&journal.lock);
+    journal.stopping = true;
+    pthread_cond_signal(&journal.wake);
+    pthread_mutex_unlock(&journal.lock);
+    pthread_join(journal.flusher, NULL);
+    close(journal.fd);
+    journal.fd = -1;
+    journal.open = false;
+    free(journal.buffer);
+    free(journal.spare);
+    journal.buffer = journal.spare = NULL;
+    journal.length = journal.capacity = journal.spareCapacity = 0;
+}
+
+JournalStats journalGetStats(void) {
+    pthread_mutex_lock(&journal.lock);
+    JournalStats stats = journal.stats;
+    pthread_mutex_unlock(&journal.lock);
+    return stats;
+}
@@ -1,48 +1,109 @@
-//kernel.c
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <readline/readline.h>
-#include <readline/history.h>
-
-void print_minios(const char* str);
-void handle_dir_command();
-
-int main() {
-    print_minios("[MiniOS SSU] Hello, World!");
-
-    char *input;
-    while(1) {
-        input = readline("커맨드를 입력하세요(종료:exit) : ");
-
-        if (input == NULL) {
-            break;
-        }
-
-        if (strcmp(input, "exit") == 0) {
-            free(input);
-            break;
-        }
-
-        // 입력된 명령어를 공백으로 분리
-        if (strcmp(input, "minisystem") == 0) {
-            minisystem();
-        } else if (strcmp(input, "dir") == 0) {
-            handle_dir_command();
-        } else system(input);
-
-        free(input);
-    }
-
-    print_minios("[MiniOS SSU] MiniOS Shutdown........");
-
-    return 1;
-}
-
-void handle_dir_command() {
-    dir_main(); 
-}
-void print_minios(const char* str) {
-    printf("%s\n", str);
-}
-
+//kernel.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <readline/readline.h>
+#include <readline/history.h>
+#include "system.h"
+#include "fs.h"
+#include "stats.h"
+#include "shell.h"
+
+void print_minios(const char* str);
+int handle_dir_command(int argc, char** argv);
+int handle_dir_batch(int argc, char** argv);
+int handle_dirbatch_command(int argc, char** argv);
+
+int main(int argc, char* argv[]) {
+    // minios --batch [-q] <스크립트|->: 셸 없이 배치 모드만 실행하고 끝낸다
+    if (argc >= 2 && strcmp(argv[1], "--batch") == 0) {
+        static char outputBuffer[1 << 20];
+        setvbuf(stdout, outputBuffer, _IOFBF, sizeof(outputBuffer));
+        int failures = handle_dir_batch(argc - 1, argv + 1);
+        statsDumpOnExit();
+        fflush(stdout);
+        return failures == 0 ? 0 : 1;
+    }
+
+    print_minios("[MiniOS SSU] Hello, World!");
+
+    shellInit();
+    shellRegister("minisystem", minisystem);
+    shellRegister("dir", handle_dir_command);
+    shellRegister("dirbatch", handle_dirbatch_command);
+
+    char *input;
+    while(1) {
+        input = readline("커맨드를 입력하세요(종료:exit) : ");
+
+        if (input == NULL) {
+            break;
+        }
+
+        if (strcmp(input, "exit") == 0) {
+            free(input);
+            break;
+        }
+
+        // 내장 명령은 프로세스 안에서, 나머지는 셸 없이 바로 실행한다 (shell.h)
+        shellExecute(input);
+
+        free(input);
+    }
+
+    statsDumpOnExit();
+    print_minios("[MiniOS SSU] MiniOS Shutdown........");
+
+    return 1;
+}
+
+// 인자가 붙으면 예전처럼 같은 이름의 외부 명령으로 넘긴다
+int handle_dir_command(int argc, char** argv) {
+    if (argc > 1) {
+        return SHELL_DEFER;
+    }
+    dir_main();
+    return 0;
+}
+
+// 사용법 오류의 -1이 SHELL_DEFER로 읽히지 않도록 종료 상태로 바꾼다
+int handle_dirbatch_command(int argc, char** argv) {
+    int failures = handle_dir_batch(argc, argv);
+    return failures < 0 ? 2 : failures > 0;
+}
+
+// dirbatch [-q] <스크립트|->: 스크립트 파일(또는 '-'이면 표준 입력)의 명령을 한 줄씩 실행한다.
+// 처리하지 못한 줄 수를 돌려준다.
+int handle_dir_batch(int argc, char** argv) {
+    int quiet = 0;
+    char* path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-q") == 0) {
+            quiet = 1;
+        } else {
+            path = argv[i];
+        }
+    }
+    if (path == NULL) {
+        printf("사용법: dirbatch [-q] <스크립트 파일|->\n");
+        return -1;
+    }
+
+    FILE* input = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+    if (input == NULL) {
+        printf("'%s' 파일을 열 수 없습니다.\n", path);
+        return -1;
+    }
+    int failures = dir_batch(input, quiet);
+    if (input != stdin) {
+        fclose(input);
+    }
+    if (failures > 0) {
+        printf("배치: %d줄을 처리하지 못했습니다.\n", failures);
+    }
+    return failures;
+}
+void print_minios(const char* str) {
+    printf("%s\n", str);
+}
+
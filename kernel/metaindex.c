@@ -0,0 +1,257 @@
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <pthread.h>
+#include "metaindex.h"
+
+typedef struct SkipNode {
+    long long key; // 이름 색인이면 쓰지 않는다
+    const char* name;
+    int inode;
+    int level;
+    struct SkipNode* next[]; // level개
+} SkipNode;
+
+typedef struct SkipList {
+    SkipNode* head; // 모든 층을 가진 빈 머리 노드
+    int level; // 지금 쓰는 층 수
+    size_t bytes;
+} SkipList;
+
+typedef struct MetaIndex {
+    SkipList lists[META_KEY_COUNT];
+    MetaEntry* entries; // inode 번호로 찾는 색인에 넣은 값
+    size_t entryCapacity;
+    long files;
+    unsigned long long rng;
+} MetaIndex;
+
+static MetaIndex metaIndex;
+static pthread_mutex_t metaLock = PTHREAD_MUTEX_INITIALIZER;
+
+static long long keyOf(const MetaEntry* entry, MetaKey key) {
+    switch (key) {
+    case META_SIZE:
+        return entry->size;
+    case META_MTIME:
+        return entry->mtime;
+    case META_CTIME:
+        return entry->ctime;
+    default:
+        return 0;
+    }
+}
+
+// node가 (key, name, inode)보다 앞이면 음수
+static int compareNode(MetaKey kind, const SkipNode* node, long long key, const char* name, int inode) {
+    if (kind == META_NAME) {
+        int order = strcmp(node->name, name);
+        if (order != 0) {
+            return order;
+        }
+    } else if (node->key != key) {
+        return node->key < key ? -1 : 1;
+    }
+    return (node->inode > inode) - (node->inode < inode);
+}
+
+// 층 수는 1/4 확률로 하나씩 늘어난다 (xorshift64*)
+static int randomLevel(void) {
+    unsigned long long x = metaIndex.rng;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    metaIndex.rng = x;
+    unsigned long long bits = x * 2685821657736338717ULL;
+    int level = 1;
+    while (level < META_MAX_LEVEL && (bits & 3) == 0) {
+        level++;
+        bits >>= 2;
+    }
+    return level;
+}
+
+static void ensureLists(void) {
+    if (metaIndex.lists[0].head != NULL) {
+        return;
+    }
+    metaIndex.rng = 0x9E3779B97F4A7C15ULL;
+    for (int k = 0; k < META_KEY_COUNT; k++) {
+        size_t bytes = sizeof(SkipNode) + META_MAX_LEVEL * sizeof(SkipNode*);
+        metaIndex.lists[k].head = (SkipNode*)calloc(1, bytes);
+        metaIndex.lists[k].head->level = META_MAX_LEVEL;
+        metaIndex.lists[k].level = 1;
+        metaIndex.lists[k].bytes = bytes;
+    }
+}
+
+// (key, name, inode)보다 앞인 마지막 노드를 층마다 update에 담는다.
+static void findPredecessors(MetaKey kind, long long key, const char* name, int inode, SkipNode** update) {
+    SkipList* list = &metaIndex.lists[kind];
+    SkipNode* node = list->head;
+    for (int level = list->level - 1; level >= 0; level--) {
+        while (node->next[level] != NULL && compareNode(kind, node->next[level], key, name, inode) < 0) {
+            node = node->next[level];
+        }
+        update[level] = node;
+    }
+}
+
+static void listInsert(MetaKey kind, const MetaEntry* entry, int inode) {
+    SkipList* list = &metaIndex.lists[kind];
+    SkipNode* update[META_MAX_LEVEL];
+    long long key = keyOf(entry, kind);
+    findPredecessors(kind, key, entry->name, inode, update);
+    int level = randomLevel();
+    for (int l = list->level; l < level; l++) {
+        update[l] = list->head;
+    }
+    if (level > list->level) {
+        list->level = level;
+    }
+    size_t bytes = sizeof(SkipNode) + level * sizeof(SkipNode*);
+    SkipNode* node = (SkipNode*)malloc(bytes);
+    node->key = key;
+    node->name = entry->name;
+    node->inode = inode;
+    node->level = level;
+    for (int l = 0; l < level; l++) {
+        node->next[l] = update[l]->next[l];
+        update[l]->next[l] = node;
+    }
+    list->bytes += bytes;
+}
+
+static void listRemove(MetaKey kind, const MetaEntry* entry, int inode) {
+    SkipList* list = &metaIndex.lists[kind];
+    SkipNode* update[META_MAX_LEVEL];
+    findPredecessors(kind, keyOf(entry, kind), entry->name, inode, update);
+    SkipNode* node = update[0]->next[0];
+    if (node == NULL || node->inode != inode) {
+        return;
+    }
+    for (int l = 0; l < node->level; l++) {
+        update[l]->next[l] = node->next[l];
+    }
+    while (list->level > 1 && list->head->next[list->level - 1] == NULL) {
+        list->level--;
+    }
+    list->bytes -= sizeof(SkipNode) + node->level * sizeof(SkipNode*);
+    free(node);
+}
+
+static void removeLocked(int inode) {
+    if ((size_t)inode >= metaIndex.entryCapacity || !metaIndex.entries[inode].indexed) {
+        return;
+    }
+    MetaEntry* entry = &metaIndex.entries[inode];
+    for (int k = 0; k < META_KEY_COUNT; k++) {
+        listRemove((MetaKey)k, entry, inode);
+    }
+    entry->indexed = false;
+    metaIndex.files--;
+}
+
+void metaIndexPut(int inode, const char* name, long long size, long long mtime, long long ctime) {
+    pthread_mutex_lock(&metaLock);
+    ensureLists();
+    if ((size_t)inode >= metaIndex.entryCapacity) {
+        size_t capacity = metaIndex.entryCapacity == 0 ? 1024 : metaIndex.entryCapacity;
+        while (capacity <= (size_t)inode) {
+            capacity *= 2;
+        }
+        metaIndex.entries = (MetaEntry*)realloc(metaIndex.entries, capacity * sizeof(MetaEntry));
+        memset(metaIndex.entries + metaIndex.entryCapacity, 0, (capacity - metaIndex.entryCapacity) * sizeof(MetaEntry));
+        metaIndex.entryCapacity = capacity;
+    }
+    MetaEntry* entry = &metaIndex.entries[inode];
+    MetaEntry updated = {size, mtime, ctime, name, true};
+    if (!entry->indexed) {
+        *entry = updated;
+        for (int k = 0; k < META_KEY_COUNT; k++) {
+            listInsert((MetaKey)k, entry, inode);
+        }
+        metaIndex.files++;
+        pthread_mutex_unlock(&metaLock);
+        return;
+    }
+    // 바뀐 키의 색인만 고친다
+    for (int k = 0; k < META_KEY_COUNT; k++) {
+        bool changed = k == META_NAME ? entry->name != name
+                                      : keyOf(entry, (MetaKey)k) != keyOf(&updated, (MetaKey)k);
+        if (changed) {
+            listRemove((MetaKey)k, entry, inode);
+            listInsert((MetaKey)k, &updated, inode);
+        }
+    }
+    *entry = updated;
+    pthread_mutex_unlock(&metaLock);
+}
+
+void metaIndexRemove(int inode) {
+    pthread_mutex_lock(&metaLock);
+    removeLocked(inode);
+    pthread_mutex_unlock(&metaLock);
+}
+
+void metaIndexReset(void) {
+    pthread_mutex_lock(&metaLock);
+    for (int k = 0; k < META_KEY_COUNT; k++) {
+        SkipNode* node = metaIndex.lists[k].head;
+        while (node != NULL) {
+            SkipNode* next = node->next[0];
+            free(node);
+            node = next;
+        }
+    }
+    free(metaIndex.entries);
+    memset(&metaIndex, 0, sizeof(metaIndex));
+    pthread_mutex_unlock(&metaLock);
+}
+
+void metaIndexScan(const MetaRange* range, MetaVisitFn visit, void* context) {
+    pthread_mutex_lock(&metaLock);
+    if (metaIndex.lists[0].head == NULL) {
+        pthread_mutex_unlock(&metaLock);
+        return;
+    }
+    SkipNode* update[META_MAX_LEVEL];
+    bool byName = range->key == META_NAME;
+    size_t prefixLength = byName ? strlen(range->prefix) : 0;
+    findPredecessors(range->key, range->low, byName ? range->prefix : NULL, INT_MIN, update);
+    for (SkipNode* node = update[0]->next[0]; node != NULL; node = node->next[0]) {
+        bool inside = byName ? strncmp(node->name, range->prefix, prefixLength) == 0 : node->key <= range->high;
+        if (!inside || !visit(node->inode, &metaIndex.entries[node->inode], context)) {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&metaLock);
+}
+
+typedef struct CountState {
+    long count;
+    long limit;
+} CountState;
+
+static bool countEntry(int inode, const MetaEntry* entry, void* context) {
+    (void)inode;
+    (void)entry;
+    CountState* state = (CountState*)context;
+    return ++state->count < state->limit;
+}
+
+long metaIndexCount(const MetaRange* range, long limit) {
+    CountState state = {0, limit};
+    metaIndexScan(range, countEntry, &state);
+    return state.count;
+}
+
+MetaIndexStats metaIndexGetStats(void) {
+    pthread_mutex_lock(&metaLock);
+    MetaIndexStats stats = {metaIndex.files, metaIndex.entryCapacity * sizeof(MetaEntry)};
+    for (int k = 0; k < META_KEY_COUNT; k++) {
+        stats.bytes += metaIndex.lists[k].bytes;
+    }
+    pthread_mutex_unlock(&metaLock);
+    return stats;
+}
@@ -0,0 +1,346 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "ngram.h"
+
+#define EMPTY_KEY 0xFFFFFFFFu // 3-gram은 24비트이므로 빈 슬롯 표시로 쓸 수 있다
+
+typedef struct Posting {
+    unsigned int key; // 3-gram
+    int* inodes; // 오름차순
+    int count;
+    int capacity;
+} Posting;
+
+typedef struct GramCount {
+    unsigned int gram;
+    int count; // 파일 안에서 등장한 횟수
+} GramCount;
+
+typedef struct Forward {
+    GramCount* grams; // gram 오름차순
+    int count;
+} Forward;
+
+static Posting* postings; // 오픈 어드레싱 해시 테이블 (3-gram -> 게시 목록)
+static size_t postingCapacity;
+static size_t postingUsed;
+
+static Forward* forward; // inode 번호로 인덱싱
+static int forwardCapacity;
+
+// 색인 전체를 보호한다. 검색끼리는 함께 읽고, 3-gram 목록 만들기(정렬)는 잠그기 전에 끝낸다.
+static pthread_rwlock_t indexLock = PTHREAD_RWLOCK_INITIALIZER;
+
+static unsigned int gramAt(const char* p) {
+    const unsigned char* u = (const unsigned char*)p;
+    return ((unsigned int)u[0] << 16) | ((unsigned int)u[1] << 8) | u[2];
+}
+
+static size_t gramHash(unsigned int gram) {
+    return (size_t)(gram * 2654435761u);
+}
+
+static void postingTableInit(size_t capacity) {
+    postings = (Posting*)malloc(capacity * sizeof(Posting));
+    for (size_t i = 0; i < capacity; i++) {
+        postings[i].key = EMPTY_KEY;
+    }
+    postingCapacity = capacity;
+    postingUsed = 0;
+}
+
+// 없으면 NULL (create가 0일 때), 있으면 해당 게시 목록
+static Posting* postingFor(unsigned int gram, int create) {
+    if (postings == NULL) {
+        if (!create) {
+            return NULL;
+        }
+        postingTableInit(1024);
+    }
+    if (create && (postingUsed + 1) * 4 > postingCapacity * 3) {
+        Posting* old = postings;
+        size_t oldCapacity = postingCapacity;
+        postingTableInit(oldCapacity * 2);
+        for (size_t i = 0; i < oldCapacity; i++) {
+            if (old[i].key != EMPTY_KEY) {
+                size_t slot = gramHash(old[i].key) & (postingCapacity - 1);
+                while (postings[slot].key != EMPTY_KEY) {
+                    slot = (slot + 1) & (postingCapacity - 1);
+                }
+                postings[slot] = old[i];
+                postingUsed++;
+            }
+        }
+        free(old);
+    }
+    size_t slot = gramHash(gram) & (postingCapacity - 1);
+    while (postings[slot].key != EMPTY_KEY) {
+        if (postings[slot].key == gram) {
+            return &postings[slot];
+        }
+        slot = (slot + 1) & (postingCapacity - 1);
+    }
+    if (!create) {
+        return NULL;
+    }
+    postings[slot].key = gram;
+    postings[slot].inodes = NULL;
+    postings[slot].count = 0;
+    postings[slot].capacity = 0;
+    postingUsed++;
+    return &postings[slot];
+}
+
+// 정렬된 배열에서 value 이상인 첫 위치
+static int lowerBound(const int* values, int count, int value) {
+    int low = 0, high = count;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (values[mid] < value) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+static void postingAdd(unsigned int gram, int inode) {
+    Posting* posting = postingFor(gram, 1);
+    int at = lowerBound(posting->inodes, posting->count, inode); // 대개 끝에 붙는다
+    if (at < posting->count && posting->inodes[at] == inode) {
+        return;
+    }
+    if (posting->count == posting->capacity) {
+        posting->capacity = posting->capacity == 0 ? 4 : posting->capacity * 2;
+        posting->inodes = (int*)realloc(posting->inodes, posting->capacity * sizeof(int));
+    }
+    memmove(posting->inodes + at + 1, posting->inodes + at, (posting->count - at) * sizeof(int));
+    posting->inodes[at] = inode;
+    posting->count++;
+}
+
+static void postingRemove(unsigned int gram, int inode) {
+    Posting* posting = postingFor(gram, 0);
+    if (posting == NULL) {
+        return;
+    }
+    int at = lowerBound(posting->inodes, posting->count, inode);
+    if (at < posting->count && posting->inodes[at] == inode) {
+        memmove(posting->inodes + at, posting->inodes + at + 1, (posting->count - at - 1) * sizeof(int));
+        posting->count--;
+    }
+}
+
+static int compareGram(const void* a, const void* b) {
+    unsigned int x = *(const unsigned int*)a, y = *(const unsigned int*)b;
+    return x < y ? -1 : x > y;
+}
+
+#define RADIX_MIN_GRAMS 256 // 이보다 적으면 qsort가 더 빠르다
+
+// 24비트 3-gram을 8비트씩 세 번 나눠 놓는 LSD 기수 정렬. 큰 파일에서 비교 정렬의 n log n 대신 n에 비례한다.
+// 모든 값의 자리가 같은 패스는 건너뛴다. 정렬된 배열(grams 또는 scratch)을 돌려준다.
+static unsigned int* radixSortGrams(unsigned int* grams, unsigned int* scratch, size_t count) {
+    size_t histogram[3][256];
+    memset(histogram, 0, sizeof(histogram));
+    for (size_t i = 0; i < count; i++) {
+        histogram[0][grams[i] & 0xFF]++;
+        histogram[1][(grams[i] >> 8) & 0xFF]++;
+        histogram[2][grams[i] >> 16]++;
+    }
+    unsigned int* from = grams;
+    unsigned int* to = scratch;
+    for (int pass = 0; pass < 3; pass++) {
+        int shift = pass * 8;
+        size_t* offsets = histogram[pass];
+        if (offsets[(from[0] >> shift) & 0xFF] == count) {
+            continue;
+        }
+        size_t offset = 0;
+        for (int digit = 0; digit < 256; digit++) {
+            size_t bucket = offsets[digit];
+            offsets[digit] = offset;
+            offset += bucket;
+        }
+        for (size_t i = 0; i < count; i++) {
+            to[offsets[(from[i] >> shift) & 0xFF]++] = from[i];
+        }
+        unsigned int* swap = from;
+        from = to;
+        to = swap;
+    }
+    return from;
+}
+
+// data의 3-gram을 모아 gram 오름차순의 (gram, 횟수) 목록으로 만든다.
+static Forward buildForward(const char* data, size_t length) {
+    Forward result = {NULL, 0};
+    if (length < NGRAM_SIZE) {
+        return result;
+    }
+    size_t total = length - NGRAM_SIZE + 1;
+    unsigned int* buffer = (unsigned int*)malloc(total * sizeof(unsigned int) * (total < RADIX_MIN_GRAMS ? 1 : 2));
+    unsigned int* grams = buffer;
+    for (size_t i = 0; i < total; i++) {
+        grams[i] = gramAt(data + i);
+    }
+    if (total < RADIX_MIN_GRAMS) {
+        qsort(grams, total, sizeof(unsigned int), compareGram);
+    } else {
+        grams = radixSortGrams(buffer, buffer + total, total);
+    }
+
+    result.grams = (GramCount*)malloc(total * sizeof(GramCount));
+    for (size_t i = 0; i < total; i++) {
+        if (result.count > 0 && result.grams[result.count - 1].gram == grams[i]) {
+            result.grams[result.count - 1].count++;
+        } else {
+            result.grams[result.count].gram = grams[i];
+            result.grams[result.count].count = 1;
+            result.count++;
+        }
+    }
+    free(buffer);
+    result.grams = (GramCount*)realloc(result.grams, (result.count > 0 ? result.count : 1) * sizeof(GramCount));
+    return result;
+}
+
+static Forward* forwardFor(int inode) {
+    if (inode >= forwardCapacity) {
+        int capacity = forwardCapacity == 0 ? 1024 : forwardCapacity;
+        while (capacity <= inode) {
+            capacity *= 2;
+        }
+        forward = (Forward*)realloc(forward, capacity * sizeof(Forward));
+        memset(forward + forwardCapacity, 0, (capacity - forwardCapacity) * sizeof(Forward));
+        forwardCapacity = capacity;
+    }
+    return &forward[inode];
+}
+
+void ngramIndexFile(int inode, const char* data, size_t length) {
+    Forward next = buildForward(data, length);
+    pthread_rwlock_wrlock(&indexLock);
+    Forward* old = forwardFor(inode);
+
+    // 두 정렬 목록을 나란히 훑어 새로 생긴/없어진 3-gram만 게시 목록에 반영한다
+    int i = 0, j = 0;
+    while (i < old->count || j < next.count) {
+        if (j == next.count || (i < old->count && old->grams[i].gram < next.grams[j].gram)) {
+            postingRemove(old->grams[i++].gram, inode);
+        } else if (i == old->count || next.grams[j].gram < old->grams[i].gram) {
+            postingAdd(next.grams[j++].gram, inode);
+        } else {
+            i++;
+            j++;
+        }
+    }
+    free(old->grams);
+    *old = next;
+    pthread_rwlock_unlock(&indexLock);
+}
+
+static void removeFileLocked(int inode) {
+    if (inode >= forwardCapacity) {
+        return;
+    }
+    Forward* old = &forward[inode];
+    for (int i = 0; i < old->count; i++) {
+        postingRemove(old->grams[i].gram, inode);
+    }
+    free(old->grams);
+    old->grams = NULL;
+    old->count = 0;
+}
+
+void ngramRemoveFile(int inode) {
+    pthread_rwlock_wrlock(&indexLock);
+    removeFileLocked(inode);
+    pthread_rwlock_unlock(&indexLock);
+}
+
+void ngramCloneFile(int sourceInode, int targetInode) {
+    pthread_rwlock_wrlock(&indexLock);
+    forwardFor(sourceInode > targetInode ? sourceInode : targetInode); // 배열을 미리 늘려 둔다
+    Forward* source = &forward[sourceInode];
+    Forward clone = {NULL, source->count};
+    if (source->count > 0) {
+        clone.grams = (GramCount*)malloc(source->count * sizeof(GramCount));
+        memcpy(clone.grams, source->grams, source->count * sizeof(GramCount));
+    }
+    removeFileLocked(targetInode);
+    for (int i = 0; i < clone.count; i++) {
+        postingAdd(clone.grams[i].gram, targetInode);
+    }
+    forward[targetInode] = clone;
+    pthread_rwlock_unlock(&indexLock);
+}
+
+static int comparePostingSize(const void* a, const void* b) {
+    const Posting* x = *(Posting* const*)a;
+    const Posting* y = *(Posting* const*)b;
+    return x->count - y->count;
+}
+
+int ngramQuery(const char* keyword, size_t length, int** candidates) {
+    *candidates = NULL;
+    if (length < NGRAM_SIZE) {
+        return -1;
+    }
+    Forward grams = buildForward(keyword, length);
+    Posting** lists = (Posting**)malloc(grams.count * sizeof(Posting*));
+    pthread_rwlock_rdlock(&indexLock);
+    for (int i = 0; i < grams.count; i++) {
+        lists[i] = postingFor(grams.grams[i].gram, 0);
+        if (lists[i] == NULL || lists[i]->count == 0) {
+            pthread_rwlock_unlock(&indexLock);
+            free(lists);
+            free(grams.grams);
+            return 0; // 어떤 파일에도 없는 3-gram이 있으면 결과가 없다
+        }
+    }
+    // 가장 짧은 목록을 기준으로 나머지 목록에서 이진 탐색하며 교집합을 구한다
+    qsort(lists, grams.count, sizeof(Posting*), comparePostingSize);
+    int* result = (int*)malloc(lists[0]->count * sizeof(int));
+    int resultCount = 0;
+    int* cursor = (int*)calloc(grams.count, sizeof(int));
+    for (int k = 0; k < lists[0]->count; k++) {
+        int inode = lists[0]->inodes[k];
+        int inAll = 1;
+        for (int i = 1; i < grams.count && inAll; i++) {
+            cursor[i] += lowerBound(lists[i]->inodes + cursor[i], lists[i]->count - cursor[i], inode);
+            inAll = cursor[i] < lists[i]->count && lists[i]->inodes[cursor[i]] == inode;
+        }
+        if (inAll) {
+            result[resultCount++] = inode;
+        }
+    }
+    pthread_rwlock_unlock(&indexLock);
+    free(cursor);
+    free(lists);
+    free(grams.grams);
+    *candidates = result;
+    return resultCount;
+}
+
+void ngramReset(void) {
+    pthread_rwlock_wrlock(&indexLock);
+    for (size_t i = 0; i < postingCapacity; i++) {
+        if (postings[i].key != EMPTY_KEY) {
+            free(postings[i].inodes);
+        }
+    }
+    free(postings);
+    postings = NULL;
+    postingCapacity = postingUsed = 0;
+    for (int i = 0; i < forwardCapacity; i++) {
+        free(forward[i].grams);
+    }
+    free(forward);
+    forward = NULL;
+    forwardCapacity = 0;
+    pthread_rwlock_unlock(&indexLock);
+}
@@ -0,0 +1,234 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include "openfile.h"
+
+typedef struct OpenFile {
+    Node* node;
+    unsigned long serial; // 노드가 지워지고 다른 노드가 그 자리를 쓰는지 가린다
+    int inode;
+    int flags;
+    long offset;
+    bool used;
+} OpenFile;
+
+static OpenFile openFiles[FS_OPEN_MAX];
+static pthread_mutex_t openFileLock = PTHREAD_MUTEX_INITIALIZER; // 표와 위치를 보호한다
+
+// fd의 사본을 돌려준다. 노드가 지워졌으면 false (errno ESTALE).
+static bool lookupFd(int fd, OpenFile* file) {
+    pthread_mutex_lock(&openFileLock);
+    bool used = fd >= 0 && fd < FS_OPEN_MAX && openFiles[fd].used;
+    if (used) {
+        *file = openFiles[fd];
+    }
+    pthread_mutex_unlock(&openFileLock);
+    if (!used) {
+        errno = EBADF;
+        return false;
+    }
+    Node* node = getInode(file->inode)->node;
+    if (node != file->node || node->serial != file->serial) {
+        errno = ESTALE;
+        return false;
+    }
+    return true;
+}
+
+static bool checkAccess(const OpenFile* file, int mode) {
+    if ((file->flags & mode) == 0) {
+        errno = EBADF;
+        return false;
+    }
+    return true;
+}
+
+// start에서 path의 마지막 구성 요소 앞까지 따라간 디렉터리. name에 마지막 구성 요소를 담는다.
+static Node* resolveParent(Node* start, const char* path, char name[NODE_NAME_SIZE]) {
+    const char* slash = strrchr(path, '/');
+    const char* last = slash != NULL ? slash + 1 : path;
+    if (strlen(last) == 0 || strlen(last) >= NODE_NAME_SIZE) {
+        return NULL;
+    }
+    strcpy(name, last);
+    if (slash == NULL) {
+        return start;
+    }
+    char directory[4096];
+    size_t length = (size_t)(slash - path);
+    if (length >= sizeof(directory)) {
+        return NULL;
+    }
+    memcpy(directory, path, length);
+    directory[length] = '\0';
+    return length == 0 ? start : resolvePath(start, directory, DIR_TYPE);
+}
+
+int fs_open(Node* start, const char* path, int flags) {
+    if ((flags & (FS_O_READ | FS_O_WRITE)) == 0 ||
+        ((flags & (FS_O_CREATE | FS_O_TRUNCATE | FS_O_APPEND)) != 0 && (flags & FS_O_WRITE) == 0)) {
+        errno = EINVAL;
+        return -1;
+    }
+    char name[NODE_NAME_SIZE];
+    Node* parent = resolveParent(start, path, name);
+    if (parent == NULL) {
+        errno = ENOENT;
+        return -1;
+    }
+    Node* node = lookupChild(parent, name, FILE_TYPE);
+    if (node == NULL && (flags & FS_O_CREATE) != 0) {
+        node = makeChild(parent, name, FILE_TYPE, NULL);
+        if (node == NULL) {
+            node = lookupChild(parent, name, FILE_TYPE); // 그 사이 다른 스레드가 만들었다
+        }
+    }
+    if (node == NULL) {
+        errno = ENOENT;
+        return -1;
+    }
+    if ((flags & FS_O_TRUNCATE) != 0 && !truncateFile(node, 0)) {
+        errno = ENOSPC;
+        return -1;
+    }
+    pthread_mutex_lock(&openFileLock);
+    int fd = 0;
+    while (fd < FS_OPEN_MAX && openFiles[fd].used) {
+        fd++;
+    }
+    if (fd < FS_OPEN_MAX) {
+        openFiles[fd] = (OpenFile){node, node->serial, node->inode, flags, 0, true};
+    }
+    pthread_mutex_unlock(&openFileLock);
+    if (fd == FS_OPEN_MAX) {
+        errno = EMFILE;
+        return -1;
+    }
+    return fd;
+}
+
+ssize_t fs_pread(int fd, void* buffer, size_t length, long offset) {
+    OpenFile file;
+    if (!lookupFd(fd, &file) || !checkAccess(&file, FS_O_READ)) {
+        return -1;
+    }
+    if (offset < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    return (ssize_t)readFileRange(file.node, (size_t)offset, (char*)buffer, length);
+}
+
+// append면 offset을 무시하고 끝에 쓴다. 쓰기가 끝난 위치를 end에 담는다.
+static ssize_t writeAt(int fd, const void* data, size_t length, long offset, bool append, long* end) {
+    OpenFile file;
+    if (!lookupFd(fd, &file) || !checkAccess(&file, FS_O_WRITE)) {
+        return -1;
+    }
+    if (offset < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    *end = writeFileRange(file.node, offset, (const char*)data, length, append);
+    if (*end < 0) {
+        errno = ENOSPC;
+        return -1;
+    }
+    return (ssize_t)length;
+}
+
+ssize_t fs_pwrite(int fd, const void* data, size_t length, long offset) {
+    OpenFile file;
+    if (lookupFd(fd, &file) && (file.flags & FS_O_APPEND) != 0) { // POSIX처럼 O_APPEND면 끝에 쓴다
+        return fs_append(fd, data, length);
+    }
+    long end;
+    return writeAt(fd, data, length, offset, false, &end);
+}
+
+ssize_t fs_append(int fd, const void* data, size_t length) {
+    long end;
+    return writeAt(fd, data, length, 0, true, &end);
+}
+
+static void setOffset(int fd, long offset) {
+    pthread_mutex_lock(&openFileLock);
+    openFiles[fd].offset = offset;
+    pthread_mutex_unlock(&openFileLock);
+}
+
+ssize_t fs_read(int fd, void* buffer, size_t length) {
+    OpenFile file;
+    if (!lookupFd(fd, &file)) {
+        return -1;
+    }
+    ssize_t got = fs_pread(fd, buffer, length, file.offset);
+    if (got > 0) {
+        setOffset(fd, file.offset + (long)got);
+    }
+    return got;
+}
+
+ssize_t fs_write(int fd, const void* data, size_t length) {
+    OpenFile file;
+    if (!lookupFd(fd, &file)) {
+        return -1;
+    }
+    long end;
+    ssize_t wrote = writeAt(fd, data, length, file.offset, (file.flags & FS_O_APPEND) != 0, &end);
+    if (wrote >= 0) {
+        setOffset(fd, end);
+    }
+    return wrote;
+}
+
+long fs_lseek(int fd, long offset, int whence) {
+    OpenFile file;
+    if (!lookupFd(fd, &file)) {
+        return -1;
+    }
+    long base = whence == SEEK_SET ? 0 : whence == SEEK_CUR ? file.offset : INODE_SIZE(file.inode);
+    if ((whence != SEEK_SET && whence != SEEK_CUR && whence != SEEK_END) || base + offset < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    setOffset(fd, base + offset);
+    return base + offset;
+}
+
+int fs_truncate(int fd, long size) {
+    OpenFile file;
+    if (!lookupFd(fd, &file) || !checkAccess(&file, FS_O_WRITE)) {
+        return -1;
+    }
+    if (size < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (!truncateFile(file.node, (size_t)size)) {
+        errno = ENOSPC;
+        return -1;
+    }
+    return 0;
+}
+
+int fs_close(int fd) {
+    pthread_mutex_lock(&openFileLock);
+    bool used = fd >= 0 && fd < FS_OPEN_MAX && openFiles[fd].used;
+    if (used) {
+        openFiles[fd].used = false;
+    }
+    pthread_mutex_unlock(&openFileLock);
+    if (!used) {
+        errno = EBADF;
+        return -1;
+    }
+    return 0;
+}
+
+void fs_close_all(void) {
+    pthread_mutex_lock(&openFileLock);
+    memset(openFiles, 0, sizeof(openFiles));
+    pthread_mutex_unlock(&openFileLock);
+}
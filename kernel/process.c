@@ -0,0 +1,553 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "system.h"
+
+#define NICE_0_WEIGHT 1024
+#define SCHED_LATENCY_NS 6000000ULL // CFS: 작업이 이 수 이하면 이 시간 안에 모두 한 번씩 돈다
+#define SCHED_MIN_GRANULARITY_NS 750000ULL // CFS: 한 번 받으면 적어도 이만큼은 돈다
+#define SCHED_NR_LATENCY 8
+
+// kernel/sched/core.c의 sched_prio_to_weight. nice가 1 오를 때마다 약 1.25배씩 CPU 몫이 준다.
+static const unsigned long prioToWeight[40] = {
+    88761, 71755, 56483, 46273, 36291,
+    29154, 23254, 18705, 14949, 11916,
+    9548, 7620, 6100, 4904, 3906,
+    3121, 2501, 1991, 1586, 1277,
+    1024, 820, 655, 526, 423,
+    335, 272, 215, 172, 137,
+    110, 87, 70, 56, 45,
+    36, 29, 23, 18, 15,
+};
+
+static Scheduler* runningScheduler; // schedulerRun 중인 스케줄러. taskTick/taskYield가 쓴다
+
+const char* schedPolicyName(SchedPolicy policy) {
+    return policy == SCHED_O1 ? "o1" : "cfs";
+}
+
+bool parseSchedPolicy(const char* text, SchedPolicy* policy) {
+    if (strcmp(text, "o1") == 0) {
+        *policy = SCHED_O1;
+    } else if (strcmp(text, "cfs") == 0) {
+        *policy = SCHED_CFS;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// ---- O(1): 우선순위 배열 ----
+
+// 2.6 커널의 task_timeslice: nice 0이 100ms, -20이 800ms, 19가 5ms
+static int timeSliceTicks(int prio) {
+    int ms = prio < NICE_TO_PRIO(0) ? (MAX_PRIO - prio) * 20 : (MAX_PRIO - prio) * 5;
+    unsigned long long ticks = ms * 1000000ULL / SCHED_TICK_NS;
+    return ticks > 0 ? (int)ticks : 1;
+}
+
+static void arrayEnqueue(PrioArray* array, Task* task) {
+    int prio = task->prio;
+    task->runNext = NULL;
+    task->runPrev = array->queueTail[prio];
+    if (array->queueTail[prio] != NULL) {
+        array->queueTail[prio]->runNext = task;
+    } else {
+        array->queueHead[prio] = task;
+        array->bitmap[prio / 64] |= 1ULL << (prio % 64);
+    }
+    array->queueTail[prio] = task;
+    array->count++;
+}
+
+static Task* arrayDequeueFirst(PrioArray* array, int prio) {
+    Task* task = array->queueHead[prio];
+    array->queueHead[prio] = task->runNext;
+    if (task->runNext != NULL) {
+        task->runNext->runPrev = NULL;
+    } else {
+        array->queueTail[prio] = NULL;
+        array->bitmap[prio / 64] &= ~(1ULL << (prio % 64));
+    }
+    task->runNext = NULL;
+    array->count--;
+    return task;
+}
+
+// sched_find_first_bit: 비어 있지 않은 가장 높은 우선순위(가장 작은 번호). 없으면 MAX_PRIO
+static int firstPrio(const PrioArray* array) {
+    for (int word = 0; word < (MAX_PRIO + 63) / 64; word++) {
+        if (array->bitmap[word] != 0) {
+            return word * 64 + __builtin_ctzll(array->bitmap[word]);
+        }
+    }
+    return MAX_PRIO;
+}
+
+static Task* pickO1(Scheduler* scheduler) {
+    if (scheduler->active->count == 0) {
+        // active가 비면 두 배열을 맞바꾼다. expired의 작업은 슬라이스를 이미 새로 받았다.
+        PrioArray* swap = scheduler->active;
+        scheduler->active = scheduler->expired;
+        scheduler->expired = swap;
+    }
+    int prio = firstPrio(scheduler->active);
+    return prio < MAX_PRIO ? arrayDequeueFirst(scheduler->active, prio) : NULL;
+}
+
+static void putO1(Scheduler* scheduler, Task* task) {
+    bool expired = task->yielded || task->timeSlice == 0;
+    if (task->timeSlice == 0) {
+        task->timeSlice = timeSliceTicks(task->prio);
+    }
+    arrayEnqueue(expired ? scheduler->expired : scheduler->active, task);
+}
+
+// ---- CFS: vruntime 순서의 레드-블랙 트리 ----
+
+static void rotateLeft(Scheduler* scheduler, Task* x) {
+    Task* y = x->rbRight;
+    x->rbRight = y->rbLeft;
+    if (y->rbLeft != NULL) {
+        y->rbLeft->rbParent = x;
+    }
+    y->rbParent = x->rbParent;
+    if (x->rbParent == NULL) {
+        scheduler->rbRoot = y;
+    } else if (x == x->rbParent->rbLeft) {
+        x->rbParent->rbLeft = y;
+    } else {
+        x->rbParent->rbRight = y;
+    }
+    y->rbLeft = x;
+    x->rbParent = y;
+}
+
+static void rotateRight(Scheduler* scheduler, Task* x) {
+    Task* y = x->rbLeft;
+    x->rbLeft = y->rbRight;
+    if (y->rbRight != NULL) {
+        y->rbRight->rbParent = x;
+    }
+    y->rbParent = x->rbParent;
+    if (x->rbParent == NULL) {
+        scheduler->rbRoot = y;
+    } else if (x == x->rbParent->rbRight) {
+        x->rbParent->rbRight = y;
+    } else {
+        x->rbParent->rbLeft = y;
+    }
+    y->rbRight = x;
+    x->rbParent = y;
+}
+
+static bool isRed(const Task* task) {
+    return task != NULL && task->rbRed;
+}
+
+// vruntime이 같으면 먼저 들어온 작업이 왼쪽에 남는다
+static void rbInsert(Scheduler* scheduler, Task* task) {
+    Task* parent = NULL;
+    Task** link = &scheduler->rbRoot;
+    bool leftmost = true;
+    while (*link != NULL) {
+        parent = *link;
+        if (task->vruntime < parent->vruntime) {
+            link = &parent->rbLeft;
+        } else {
+            link = &parent->rbRight;
+            leftmost = false;
+        }
+    }
+    task->rbParent = parent;
+    task->rbLeft = task->rbRight = NULL;
+    task->rbRed = true;
+    *link = task;
+    if (leftmost) {
+        scheduler->leftmost = task;
+    }
+
+    Task* node = task;
+    while (isRed(node->rbParent)) {
+        Task* up = node->rbParent;
+        Task* grand = up->rbParent; // 빨간 노드는 뿌리가 아니므로 있다
+        if (up == grand->rbLeft) {
+            Task* uncle = grand->rbRight;
+            if (isRed(uncle)) {
+                up->rbRed = uncle->rbRed = false;
+                grand->rbRed = true;
+                node = grand;
+                continue;
+            }
+            if (node == up->rbRight) {
+                rotateLeft(scheduler, up);
+                node = up;
+                up = node->rbParent;
+            }
+            up->rbRed = false;
+            grand->rbRed = true;
+            rotateRight(scheduler, grand);
+        } else {
+            Task* uncle = grand->rbLeft;
+            if (isRed(uncle)) {
+                up->rbRed = uncle->rbRed = false;
+                grand->rbRed = true;
+                node = grand;
+                continue;
+            }
+            if (node == up->rbLeft) {
+                rotateRight(scheduler, up);
+                node = up;
+                up = node->rbParent;
+            }
+            up->rbRed = false;
+            grand->rbRed = true;
+            rotateLeft(scheduler, grand);
+        }
+    }
+    scheduler->rbRoot->rbRed = false;
+}
+
+static void transplant(Scheduler* scheduler, Task* old, Task* replacement) {
+    if (old->rbParent == NULL) {
+        scheduler->rbRoot = replacement;
+    } else if (old == old->rbParent->rbLeft) {
+        old->rbParent->rbLeft = replacement;
+    } else {
+        old->rbParent->rbRight = replacement;
+    }
+    if (replacement != NULL) {
+        replacement->rbParent = old->rbParent;
+    }
+}
+
+// 검은 노드가 빠진 자리(node, NULL일 수 있다)의 검은 높이를 되돌린다
+static void eraseFixup(Scheduler* scheduler, Task* node, Task* parent) {
+    while (node != scheduler->rbRoot && !isRed(node)) {
+        if (node == parent->rbLeft) {
+            Task* sibling = parent->rbRight;
+            if (isRed(sibling)) {
+                sibling->rbRed = false;
+                parent->rbRed = true;
+                rotateLeft(scheduler, parent);
+                sibling = parent->rbRight;
+            }
+            if (!isRed(sibling->rbLeft) && !isRed(sibling->rbRight)) {
+                sibling->rbRed = true;
+                node = parent;
+                parent = node->rbParent;
+                continue;
+            }
+            if (!isRed(sibling->rbRight)) {
+                sibling->rbLeft->rbRed = false;
+                sibling->rbRed = true;
+                rotateRight(scheduler, sibling);
+                sibling = parent->rbRight;
+            }
+            sibling->rbRed = parent->rbRed;
+            parent->rbRed = false;
+            sibling->rbRight->rbRed = false;
+            rotateLeft(scheduler, parent);
+        } else {
+            Task* sibling = parent->rbLeft;
+            if (isRed(sibling)) {
+                sibling->rbRed = false;
+                parent->rbRed = true;
+                rotateRight(scheduler, parent);
+                sibling = parent->rbLeft;
+            }
+            if (!isRed(sibling->rbLeft) && !isRed(sibling->rbRight)) {
+                sibling->rbRed = true;
+                node = parent;
+                parent = node->rbParent;
+                continue;
+            }
+            if (!isRed(sibling->rbLeft)) {
+                sibling->rbRight->rbRed = false;
+                sibling->rbRed = true;
+                rotateLeft(scheduler, sibling);
+                sibling = parent->rbLeft;
+            }
+            sibling->rbRed = parent->rbRed;
+            parent->rbRed = false;
+            sibling->rbLeft->rbRed = false;
+            rotateRight(scheduler, parent);
+        }
+        node = scheduler->rbRoot;
+    }
+    if (node != NULL) {
+        node->rbRed = false;
+    }
+}
+
+static void rbErase(Scheduler* scheduler, Task* task) {
+    if (task == scheduler->leftmost) {
+        // 가장 왼쪽 노드는 왼쪽 자식이 없으므로 다음 노드는 오른쪽 서브트리의 맨 왼쪽이거나 부모다
+        Task* next = task->rbRight;
+        if (next != NULL) {
+            while (next->rbLeft != NULL) {
+                next = next->rbLeft;
+            }
+        } else {
+            next = task->rbParent;
+        }
+        scheduler->leftmost = next;
+    }
+
+    Task* child;
+    Task* parent;
+    bool removedRed = task->rbRed;
+    if (task->rbLeft == NULL) {
+        child = task->rbRight;
+        parent = task->rbParent;
+        transplant(scheduler, task, child);
+    } else if (task->rbRight == NULL) {
+        child = task->rbLeft;
+        parent = task->rbParent;
+        transplant(scheduler, task, child);
+    } else {
+        Task* successor = task->rbRight;
+        while (successor->rbLeft != NULL) {
+            successor = successor->rbLeft;
+        }
+        removedRed = successor->rbRed;
+        child = successor->rbRight;
+        if (successor->rbParent == task) {
+            parent = successor;
+        } else {
+            parent = successor->rbParent;
+            transplant(scheduler, successor, successor->rbRight);
+            successor->rbRight = task->rbRight;
+            successor->rbRight->rbParent = successor;
+        }
+        transplant(scheduler, task, successor);
+        successor->rbLeft = task->rbLeft;
+        successor->rbLeft->rbParent = successor;
+        successor->rbRed = task->rbRed;
+    }
+    if (!removedRed) {
+        eraseFixup(scheduler, child, parent);
+    }
+}
+
+// min_vruntime은 실행 중인 작업과 큐의 가장 왼쪽 작업 중 작은 쪽을 따라가되 줄어들지 않는다
+static void updateMinVruntime(Scheduler* scheduler, const Task* running) {
+    unsigned long long vruntime = running != NULL ? running->vruntime : scheduler->minVruntime;
+    if (scheduler->leftmost != NULL && (running == NULL || scheduler->leftmost->vruntime < vruntime)) {
+        vruntime = scheduler->leftmost->vruntime;
+    }
+    if (vruntime > scheduler->minVruntime) {
+        scheduler->minVruntime = vruntime;
+    }
+}
+
+static Task* pickCfs(Scheduler* scheduler) {
+    Task* task = scheduler->leftmost;
+    if (task != NULL) {
+        rbErase(scheduler, task);
+    }
+    return task;
+}
+
+// ---- 정책 공통 ----
+
+static Task* pickNextTask(Scheduler* scheduler) {
+    Task* task = scheduler->policy == SCHED_O1 ? pickO1(scheduler) : pickCfs(scheduler);
+    if (task != NULL) {
+        scheduler->readyCount--;
+        task->state = TASK_RUNNING;
+        task->sliceStart = task->runTicks;
+    }
+    return task;
+}
+
+static void putPrevTask(Scheduler* scheduler, Task* task) {
+    if (scheduler->policy == SCHED_O1) {
+        putO1(scheduler, task);
+    } else {
+        rbInsert(scheduler, task);
+    }
+    task->yielded = false;
+    task->state = TASK_READY;
+    scheduler->readyCount++;
+}
+
+static void chargeTick(Scheduler* scheduler, Task* task) {
+    task->runTicks++;
+    scheduler->ticks++;
+    if (scheduler->policy == SCHED_O1) {
+        if (task->timeSlice > 0) {
+            task->timeSlice--;
+        }
+    } else {
+        task->vruntime += SCHED_TICK_NS * NICE_0_WEIGHT / task->weight;
+        updateMinVruntime(scheduler, task);
+    }
+}
+
+// scheduler_tick/check_preempt_tick: 방금 한 틱을 쓴 작업을 내려야 하는가
+static bool needResched(Scheduler* scheduler, const Task* task) {
+    if (scheduler->readyCount == 0) {
+        return false;
+    }
+    if (scheduler->policy == SCHED_O1) {
+        return task->timeSlice == 0 || firstPrio(scheduler->active) < task->prio;
+    }
+    unsigned long running = scheduler->readyCount + 1;
+    unsigned long long period = running > SCHED_NR_LATENCY ? running * SCHED_MIN_GRANULARITY_NS : SCHED_LATENCY_NS;
+    unsigned long long ideal = period * task->weight / scheduler->totalWeight;
+    unsigned long long ran = (task->runTicks - task->sliceStart) * SCHED_TICK_NS;
+    if (ran > ideal) {
+        return true;
+    }
+    if (ran < SCHED_MIN_GRANULARITY_NS) {
+        return false;
+    }
+    return task->vruntime > scheduler->leftmost->vruntime + ideal;
+}
+
+Task* scheduleNext(Scheduler* scheduler, Task* prev) {
+    if (prev != NULL) {
+        chargeTick(scheduler, prev);
+        putPrevTask(scheduler, prev);
+    }
+    return pickNextTask(scheduler);
+}
+
+Scheduler* schedulerCreate(SchedPolicy policy) {
+    Scheduler* scheduler = (Scheduler*)calloc(1, sizeof(Scheduler));
+    scheduler->policy = policy;
+    scheduler->nextPid = 1;
+    slabCacheInit(&scheduler->taskCache, "task_struct", sizeof(Task), 256);
+    scheduler->active = &scheduler->arrays[0];
+    scheduler->expired = &scheduler->arrays[1];
+    return scheduler;
+}
+
+void schedulerDestroy(Scheduler* scheduler) {
+    for (long i = 0; i < scheduler->allCount; i++) {
+        free(scheduler->allTasks[i]->stack);
+    }
+    slabReleaseAll(&scheduler->taskCache);
+    free(scheduler->allTasks);
+    free(scheduler);
+}
+
+Task* taskCreate(Scheduler* scheduler, const char* name, int nice, TaskFn fn, void* arg) {
+    Task* task = (Task*)slabAlloc(&scheduler->taskCache);
+    memset(task, 0, sizeof(Task));
+    nice = nice < MIN_NICE ? MIN_NICE : nice > MAX_NICE ? MAX_NICE : nice;
+    task->pid = scheduler->nextPid++;
+    snprintf(task->name, sizeof(task->name), "%s", name);
+    task->nice = nice;
+    task->prio = NICE_TO_PRIO(nice);
+    task->fn = fn;
+    task->arg = arg;
+    task->finishTick = -1;
+    task->timeSlice = timeSliceTicks(task->prio);
+    task->weight = prioToWeight[nice - MIN_NICE];
+    task->vruntime = scheduler->minVruntime; // 새 작업이 오래 기다린 작업들을 앞지르지 않게 한다
+
+    if (scheduler->allCount == scheduler->allCapacity) {
+        scheduler->allCapacity = scheduler->allCapacity == 0 ? 64 : scheduler->allCapacity * 2;
+        scheduler->allTasks = (Task**)realloc(scheduler->allTasks, scheduler->allCapacity * sizeof(Task*));
+    }
+    scheduler->allTasks[scheduler->allCount++] = task;
+    scheduler->taskCount++;
+    scheduler->totalWeight += task->weight;
+    putPrevTask(scheduler, task);
+    return task;
+}
+
+static void finishTask(Scheduler* scheduler, Task* task) {
+    task->state = TASK_DEAD;
+    task->finishTick = (long long)scheduler->ticks;
+    scheduler->taskCount--;
+    scheduler->totalWeight -= task->weight;
+}
+
+// makecontext로 만든 작업의 시작점. 작업 함수가 끝나면 uc_link를 따라 schedulerRun으로 돌아가고,
+// 거기서 스택을 돌려준다 (자기 스택 위에서는 해제할 수 없다).
+static void taskEntry() {
+    Task* task = runningScheduler->current;
+    task->fn(task->arg);
+    finishTask(runningScheduler, task);
+}
+
+// 실행 큐에서 다음 작업을 꺼낸다. 실행할 함수가 없는 작업은 바로 끝낸다.
+static Task* pickRunnable(Scheduler* scheduler) {
+    Task* task;
+    while ((task = pickNextTask(scheduler)) != NULL && task->fn == NULL) {
+        finishTask(scheduler, task);
+    }
+    return task;
+}
+
+// from에 지금 문맥을 저장하고 next로 넘어간다. 처음 도는 작업이면 스택을 잡는다.
+static void switchTo(Scheduler* scheduler, ucontext_t* from, Task* next) {
+    scheduler->current = next;
+    scheduler->contextSwitches++;
+    next->switches++;
+    if (next->stack == NULL) {
+        next->stack = malloc(TASK_STACK_SIZE);
+        getcontext(&next->context);
+        next->context.uc_stack.ss_sp = next->stack;
+        next->context.uc_stack.ss_size = TASK_STACK_SIZE;
+        next->context.uc_link = &scheduler->mainContext;
+        makecontext(&next->context, taskEntry, 0);
+    }
+    swapcontext(from, &next->context);
+}
+
+unsigned long long schedulerRun(Scheduler* scheduler, unsigned long long maxTicks) {
+    unsigned long long start = scheduler->ticks;
+    scheduler->tickLimit = start + maxTicks;
+    runningScheduler = scheduler;
+    while (scheduler->ticks < scheduler->tickLimit) {
+        Task* next = pickRunnable(scheduler);
+        if (next == NULL) {
+            break;
+        }
+        switchTo(scheduler, &scheduler->mainContext, next);
+        // 작업이 끝났거나 (current가 그 작업) 틱을 다 써서 (current가 NULL) 돌아왔다
+        Task* done = scheduler->current;
+        if (done != NULL && done->state == TASK_DEAD) {
+            free(done->stack);
+            done->stack = NULL;
+        }
+        scheduler->current = NULL;
+    }
+    runningScheduler = NULL;
+    return scheduler->ticks - start;
+}
+
+// 지금 작업을 큐에 되돌리고 다음 작업에 넘긴다. 같은 작업이 다시 뽑히면 문맥을 바꾸지 않는다.
+static void reschedule(Scheduler* scheduler, Task* task) {
+    putPrevTask(scheduler, task);
+    if (scheduler->ticks >= scheduler->tickLimit) {
+        scheduler->current = NULL;
+        swapcontext(&task->context, &scheduler->mainContext);
+        return;
+    }
+    Task* next = pickRunnable(scheduler);
+    if (next != task) {
+        switchTo(scheduler, &task->context, next);
+    }
+}
+
+void taskTick() {
+    Scheduler* scheduler = runningScheduler;
+    Task* task = scheduler->current;
+    chargeTick(scheduler, task);
+    if (scheduler->ticks >= scheduler->tickLimit || needResched(scheduler, task)) {
+        reschedule(scheduler, task);
+    }
+}
+
+void taskYield() {
+    Scheduler* scheduler = runningScheduler;
+    Task* task = scheduler->current;
+    chargeTick(scheduler, task);
+    task->yielded = true;
+    reschedule(scheduler, task);
+}
@@ -0,0 +1,885 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <signal.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pwd.h>
+#include <grp.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "shell.h"
+#include "stats.h"
+
+extern char** environ;
+
+#define BUILTIN_SLOTS 64 // 내장 명령 해시 표 (2의 거듭제곱, 절반까지만 채운다)
+#define DEFAULT_PATH "/usr/local/bin:/usr/bin:/bin"
+#define COPY_BUFFER_SIZE (64 * 1024)
+#define SIX_MONTHS (182L * 24 * 60 * 60) // ls -l이 연도를 보여 주는 기준
+
+typedef struct Builtin {
+    const char* name; // NULL이면 빈 칸
+    BuiltinFn fn;
+} Builtin;
+
+static Builtin builtins[BUILTIN_SLOTS];
+static int builtinCount;
+
+// PATH에서 찾은 실행 파일 경로. PATH 값이 바뀌면 통째로 비운다.
+typedef struct PathEntry {
+    char* name; // NULL이면 빈 칸
+    char* path;
+} PathEntry;
+
+static struct {
+    PathEntry* entries; // 오픈 어드레싱(선형 탐사)
+    int capacity;
+    int count;
+    char* pathVariable; // 캐시를 채울 때의 PATH 값
+} pathCache;
+
+static unsigned int hashName(const char* name) {
+    unsigned int hash = 2166136261u;
+    for (const unsigned char* p = (const unsigned char*)name; *p; p++) {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+void shellRegister(const char* name, BuiltinFn fn) {
+    unsigned int mask = BUILTIN_SLOTS - 1;
+    for (unsigned int slot = hashName(name) & mask;; slot = (slot + 1) & mask) {
+        if (builtins[slot].name == NULL) {
+            if (builtinCount >= BUILTIN_SLOTS / 2) {
+                printf("내장 명령을 더 등록할 수 없습니다: %s\n", name);
+                return;
+            }
+            builtins[slot] = (Builtin){name, fn};
+            builtinCount++;
+            return;
+        }
+        if (strcmp(builtins[slot].name, name) == 0) {
+            builtins[slot].fn = fn; // 같은 이름은 새로 등록한 쪽으로 바꾼다
+            return;
+        }
+    }
+}
+
+static const Builtin* findBuiltin(const char* name) {
+    unsigned int mask = BUILTIN_SLOTS - 1;
+    for (unsigned int slot = hashName(name) & mask; builtins[slot].name != NULL; slot = (slot + 1) & mask) {
+        if (strcmp(builtins[slot].name, name) == 0) {
+            return &builtins[slot];
+        }
+    }
+    return NULL;
+}
+
+static void clearPathCache() {
+    for (int i = 0; i < pathCache.capacity; i++) {
+        free(pathCache.entries[i].name);
+        free(pathCache.entries[i].path);
+    }
+    free(pathCache.entries);
+    free(pathCache.pathVariable);
+    memset(&pathCache, 0, sizeof(pathCache));
+}
+
+static void pathCachePut(char* name, char* path) {
+    unsigned int mask = pathCache.capacity - 1;
+    unsigned int slot = hashName(name) & mask;
+    while (pathCache.entries[slot].name != NULL) {
+        slot = (slot + 1) & mask;
+    }
+    pathCache.entries[slot] = (PathEntry){name, path};
+    pathCache.count++;
+}
+
+static void growPathCache() {
+    PathEntry* old = pathCache.entries;
+    int oldCapacity = pathCache.capacity;
+    pathCache.capacity = oldCapacity == 0 ? 64 : oldCapacity * 2;
+    pathCache.entries = (PathEntry*)calloc(pathCache.capacity, sizeof(PathEntry));
+    pathCache.count = 0;
+    for (int i = 0; i < oldCapacity; i++) {
+        if (old[i].name != NULL) {
+            pathCachePut(old[i].name, old[i].path);
+        }
+    }
+    free(old);
+}
+
+static int pathCacheFind(const char* name) {
+    if (pathCache.capacity == 0) {
+        return -1;
+    }
+    unsigned int mask = pathCache.capacity - 1;
+    for (unsigned int slot = hashName(name) & mask; pathCache.entries[slot].name != NULL; slot = (slot + 1) & mask) {
+        if (strcmp(pathCache.entries[slot].name, name) == 0) {
+            return (int)slot;
+        }
+    }
+    return -1;
+}
+
+// 실행에 실패한 항목을 지운다. 뒤따르는 항목은 다시 넣어 탐사 순서가 끊기지 않게 한다.
+static void forgetExecutable(const char* name) {
+    int slot = pathCacheFind(name);
+    if (slot < 0) {
+        return;
+    }
+    unsigned int mask = pathCache.capacity - 1;
+    free(pathCache.entries[slot].name);
+    free(pathCache.entries[slot].path);
+    pathCache.entries[slot] = (PathEntry){NULL, NULL};
+    pathCache.count--;
+    for (unsigned int next = (slot + 1) & mask; pathCache.entries[next].name != NULL; next = (next + 1) & mask) {
+        PathEntry moved = pathCache.entries[next];
+        pathCache.entries[next] = (PathEntry){NULL, NULL};
+        pathCache.count--;
+        pathCachePut(moved.name, moved.path);
+    }
+}
+
+static bool isExecutableFile(const char* path) {
+    struct stat st;
+    return stat(path, &st) == 0 && S_ISREG(st.st_mode) && access(path, X_OK) == 0;
+}
+
+// PATH를 앞에서부터 훑어 처음 나오는 실행 파일을 찾는다. 빈 항목은 현재 디렉터리다.
+static char* searchPath(const char* pathVariable, const char* name) {
+    size_t nameLength = strlen(name);
+    const char* start = pathVariable;
+    while (1) {
+        const char* end = strchr(start, ':');
+        size_t dirLength = end != NULL ? (size_t)(end - start) : strlen(start);
+        char* candidate = (char*)malloc(dirLength + nameLength + 3);
+        if (dirLength == 0) {
+            sprintf(candidate, "./%s", name);
+        } else {
+            memcpy(candidate, start, dirLength);
+            candidate[dirLength] = '/';
+            memcpy(candidate + dirLength + 1, name, nameLength + 1);
+        }
+        if (isExecutableFile(candidate)) {
+            return candidate;
+        }
+        free(candidate);
+        if (end == NULL) {
+            return NULL;
+        }
+        start = end + 1;
+    }
+}
+
+static const char* lookupExecutable(const char* name) {
+    const char* pathVariable = getenv("PATH");
+    if (pathVariable == NULL) {
+        pathVariable = DEFAULT_PATH;
+    }
+    if (pathCache.pathVariable == NULL || strcmp(pathCache.pathVariable, pathVariable) != 0) {
+        clearPathCache();
+        pathCache.pathVariable = strdup(pathVariable);
+    }
+    int slot = pathCacheFind(name);
+    if (slot >= 0) {
+        return pathCache.entries[slot].path;
+    }
+    char* path = searchPath(pathVariable, name);
+    if (path == NULL) {
+        return NULL;
+    }
+    if ((pathCache.count + 1) * 2 > pathCache.capacity) {
+        growPathCache();
+    }
+    pathCachePut(strdup(name), path);
+    return path;
+}
+
+static int exitStatus(int status) {
+    if (WIFEXITED(status)) {
+        return WEXITSTATUS(status);
+    }
+    return WIFSIGNALED(status) ? 128 + WTERMSIG(status) : 1;
+}
+
+// system()처럼 기다리는 동안 SIGINT/SIGQUIT는 셸이 무시하고, 자식은 기본 동작으로 받는다.
+// 실행하지 못하면 *error에 errno 값을 남긴다.
+static int spawnAndWait(const char* path, char** argv, int* error) {
+    fflush(stdout);
+    struct sigaction ignore, oldInterrupt, oldQuit;
+    memset(&ignore, 0, sizeof(ignore));
+    ignore.sa_handler = SIG_IGN;
+    sigemptyset(&ignore.sa_mask);
+    sigaction(SIGINT, &ignore, &oldInterrupt);
+    sigaction(SIGQUIT, &ignore, &oldQuit);
+    sigset_t childSignal, oldMask;
+    sigemptyset(&childSignal);
+    sigaddset(&childSignal, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &childSignal, &oldMask);
+
+    posix_spawnattr_t attributes;
+    posix_spawnattr_init(&attributes);
+    sigset_t defaults;
+    sigemptyset(&defaults);
+    if (oldInterrupt.sa_handler != SIG_IGN) {
+        sigaddset(&defaults, SIGINT);
+    }
+    if (oldQuit.sa_handler != SIG_IGN) {
+        sigaddset(&defaults, SIGQUIT);
+    }
+    posix_spawnattr_setsigdefault(&attributes, &defaults);
+    posix_spawnattr_setsigmask(&attributes, &oldMask);
+    posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK);
+
+    pid_t pid;
+    int status = 0;
+    *error = posix_spawn(&pid, path, NULL, &attributes, argv, environ);
+    posix_spawnattr_destroy(&attributes);
+    if (*error == 0) {
+        while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+        }
+    }
+
+    sigaction(SIGINT, &oldInterrupt, NULL);
+    sigaction(SIGQUIT, &oldQuit, NULL);
+    sigprocmask(SIG_SETMASK, &oldMask, NULL);
+    return *error == 0 ? exitStatus(status) : SHELL_NOT_FOUND;
+}
+
+// #!이 없는 스크립트는 sh처럼 /bin/sh로 읽힌다.
+static int spawnProgram(const char* path, char** argv, int* error) {
+    int status = spawnAndWait(path, argv, error);
+    if (*error != ENOEXEC) {
+        return status;
+    }
+    int argc = 0;
+    while (argv[argc] != NULL) {
+        argc++;
+    }
+    char** shellArgv = (char**)malloc((argc + 2) * sizeof(char*));
+    shellArgv[0] = "sh";
+    shellArgv[1] = (char*)path;
+    memcpy(shellArgv + 2, argv + 1, argc * sizeof(char*)); // 끝의 NULL까지
+    status = spawnAndWait("/bin/sh", shellArgv, error);
+    free(shellArgv);
+    return status;
+}
+
+static int runExternal(char** argv) {
+    int error;
+    if (strchr(argv[0], '/') != NULL) {
+        int status = spawnProgram(argv[0], argv, &error);
+        if (error != 0) {
+            printf("%s: %s\n", argv[0], strerror(error));
+            return error == ENOENT ? SHELL_NOT_FOUND : 126;
+        }
+        return status;
+    }
+    // 캐시한 경로의 파일이 그 사이 없어졌으면 한 번 더 찾아본다
+    for (int attempt = 0; attempt < 2; attempt++) {
+        const char* path = lookupExecutable(argv[0]);
+        if (path == NULL) {
+            break;
+        }
+        int status = spawnProgram(path, argv, &error);
+        if (error == 0) {
+            return status;
+        }
+        forgetExecutable(argv[0]);
+        if (error != ENOENT) {
+            printf("%s: %s\n", argv[0], strerror(error));
+            return 126;
+        }
+    }
+    printf("%s: 명령을 찾을 수 없습니다.\n", argv[0]);
+    return SHELL_NOT_FOUND;
+}
+
+// 내장 명령이면 그 이름을, 아니면 "external"을 statsName에 남긴다.
+static int executeWords(int argc, char** argv, const char** statsName) {
+    const Builtin* builtin = findBuiltin(argv[0]);
+    if (builtin != NULL) {
+        int status = builtin->fn(argc, argv);
+        if (status != SHELL_DEFER) {
+            *statsName = builtin->name;
+            return status;
+        }
+    }
+    *statsName = "external";
+    return runExternal(argv);
+}
+
+// 공백으로 낱말을 나누고 따옴표와 역슬래시를 푼다. storage는 line보다 1바이트 이상 커야 한다.
+// 셸이 해석해야 하는 문법(파이프, 리다이렉션, 변수, 명령 치환, 와일드카드, ~, 주석, 변수 대입)이 보이면 false.
+static bool splitWords(const char* line, char* storage, char** words, int* count) {
+    const char* p = line;
+    char* out = storage;
+    int n = 0;
+    while (1) {
+        while (*p == ' ' || *p == '\t') {
+            p++;
+        }
+        if (*p == '\0') {
+            break;
+        }
+        if (*p == '#' || *p == '~' || n == SHELL_MAX_ARGS - 1) {
+            return false;
+        }
+        words[n++] = out;
+        while (*p != '\0' && *p != ' ' && *p != '\t') {
+            char c = *p;
+            if (c == '\\') {
+                if (p[1] == '\0') {
+                    return false;
+                }
+                *out++ = p[1];
+                p += 2;
+            } else if (c == '\'') {
+                const char* close = strchr(p + 1, '\'');
+                if (close == NULL) {
+                    return false;
+                }
+                memcpy(out, p + 1, close - p - 1);
+                out += close - p - 1;
+                p = close + 1;
+            } else if (c == '"') {
+                for (p++; *p != '"'; p++) {
+                    if (*p == '\0' || *p == '$' || *p == '`') {
+                        return false;
+                    }
+                    if (*p == '\\' && p[1] != '\0' && strchr("\"\\$`", p[1]) != NULL) {
+                        p++;
+                    }
+                    *out++ = *p;
+                }
+                p++;
+            } else if (strchr("|&;<>()$`*?[", c) != NULL || (c == '=' && n == 1)) {
+                return false;
+            } else {
+                *out++ = c;
+                p++;
+            }
+        }
+        *out++ = '\0';
+    }
+    words[n] = NULL;
+    *count = n;
+    return true;
+}
+
+int shellExecute(const char* line) {
+    STATS_TIMER_START(start);
+    char* storage = (char*)malloc(strlen(line) + 1);
+    char* words[SHELL_MAX_ARGS];
+    int count;
+    int status = 0;
+    const char* statsName = NULL;
+    if (!splitWords(line, storage, words, &count)) {
+        char* shellArgv[] = {"sh", "-c", (char*)line, NULL};
+        int error;
+        status = spawnAndWait("/bin/sh", shellArgv, &error);
+        if (error != 0) {
+            printf("/bin/sh를 실행할 수 없습니다: %s\n", strerror(error));
+        }
+        statsName = "external";
+    } else if (count > 0) {
+        status = executeWords(count, words, &statsName);
+    }
+    free(storage);
+    if (statsName != NULL) {
+        STATS_RECORD_COMMAND(statsName, start);
+    }
+    return status;
+}
+
+// 예전처럼 /bin/sh(dash)의 echo와 같게 -n만 옵션으로 받고 역슬래시 이스케이프는 항상 푼다.
+// \c를 만나면 false를 돌려주고 거기서 출력을 끝낸다.
+static bool echoEscaped(const char* text) {
+    for (const char* p = text; *p != '\0'; p++) {
+        if (*p != '\\' || p[1] == '\0') {
+            putchar(*p);
+            continue;
+        }
+        p++;
+        switch (*p) {
+        case 'a': putchar('\a'); break;
+        case 'b': putchar('\b'); break;
+        case 'c': return false;
+        case 'f': putchar('\f'); break;
+        case 'n': putchar('\n'); break;
+        case 'r': putchar('\r'); break;
+        case 't': putchar('\t'); break;
+        case 'v': putchar('\v'); break;
+        case '\\': putchar('\\'); break;
+        case '0': {
+            int value = 0;
+            for (int digits = 0; digits < 3 && p[1] >= '0' && p[1] <= '7'; digits++) {
+                value = value * 8 + (*++p - '0');
+            }
+            putchar(value);
+            break;
+        }
+        default:
+            putchar('\\');
+            putchar(*p);
+            break;
+        }
+    }
+    return true;
+}
+
+static int builtinEcho(int argc, char** argv) {
+    int first = 1;
+    bool newline = true;
+    if (argc > 1 && strcmp(argv[1], "-n") == 0) {
+        newline = false;
+        first = 2;
+    }
+    for (int i = first; i < argc; i++) {
+        if (i > first) {
+            putchar(' ');
+        }
+        if (!echoEscaped(argv[i])) {
+            return 0;
+        }
+    }
+    if (newline) {
+        putchar('\n');
+    }
+    return 0;
+}
+
+// stdout 버퍼를 거쳐 쓰므로 앞뒤의 다른 출력과 순서가 섞이지 않는다.
+static bool copyToStdout(int fd, const char* name) {
+    char* buffer = (char*)malloc(COPY_BUFFER_SIZE);
+    bool ok = true;
+    while (1) {
+        ssize_t length = read(fd, buffer, COPY_BUFFER_SIZE);
+        if (length < 0 && errno == EINTR) {
+            continue;
+        }
+        if (length < 0) {
+            printf("cat: %s: %s\n", name, strerror(errno));
+            ok = false;
+        }
+        if (length <= 0) {
+            break;
+        }
+        fwrite(buffer, 1, length, stdout);
+    }
+    free(buffer);
+    return ok;
+}
+
+static int builtinCat(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            return SHELL_DEFER;
+        }
+    }
+    if (argc == 1) {
+        return copyToStdout(STDIN_FILENO, "-") ? 0 : 1;
+    }
+    int status = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-") == 0) {
+            status |= !copyToStdout(STDIN_FILENO, "-");
+            continue;
+        }
+        int fd = open(argv[i], O_RDONLY);
+        if (fd < 0) {
+            printf("cat: %s: %s\n", argv[i], strerror(errno));
+            status = 1;
+            continue;
+        }
+        status |= !copyToStdout(fd, argv[i]);
+        close(fd);
+    }
+    return status;
+}
+
+typedef struct LsOptions {
+    bool all; // -a: .과 ..까지
+    bool almostAll; // -A: .과 ..만 빼고 숨은 파일까지
+    bool longFormat; // -l
+    bool onePerLine; // -1 (터미널이 아니면 항상)
+} LsOptions;
+
+typedef struct LsEntry {
+    char* name;
+    struct stat st;
+    char* linkTarget; // -l에서 심볼릭 링크가 가리키는 곳
+} LsEntry;
+
+typedef struct LsList {
+    LsEntry* entries;
+    int count;
+    int capacity;
+} LsList;
+
+static void lsAdd(LsList* list, const char* name, const struct stat* st, const char* linkPath) {
+    if (list->count == list->capacity) {
+        list->capacity = list->capacity == 0 ? 64 : list->capacity * 2;
+        list->entries = (LsEntry*)realloc(list->entries, list->capacity * sizeof(LsEntry));
+    }
+    LsEntry* entry = &list->entries[list->count++];
+    entry->name = strdup(name);
+    entry->st = *st;
+    entry->linkTarget = NULL;
+    if (linkPath != NULL && S_ISLNK(st->st_mode)) {
+        char target[PATH_MAX];
+        ssize_t length = readlink(linkPath, target, sizeof(target) - 1);
+        if (length >= 0) {
+            target[length] = '\0';
+            entry->linkTarget = strdup(target);
+        }
+    }
+}
+
+static void lsFree(LsList* list) {
+    for (int i = 0; i < list->count; i++) {
+        free(list->entries[i].name);
+        free(list->entries[i].linkTarget);
+    }
+    free(list->entries);
+    memset(list, 0, sizeof(*list));
+}
+
+static int compareLsEntry(const void* left, const void* right) {
+    return strcmp(((const LsEntry*)left)->name, ((const LsEntry*)right)->name);
+}
+
+static void formatMode(mode_t mode, char out[11]) {
+    out[0] = S_ISDIR(mode) ? 'd' : S_ISLNK(mode) ? 'l' : S_ISCHR(mode) ? 'c' : S_ISBLK(mode) ? 'b'
+           : S_ISFIFO(mode) ? 'p' : S_ISSOCK(mode) ? 's' : '-';
+    const char* letters = "rwxrwxrwx";
+    for (int i = 0; i < 9; i++) {
+        out[1 + i] = (mode & (0400 >> i)) ? letters[i] : '-';
+    }
+    if (mode & S_ISUID) {
+        out[3] = (mode & S_IXUSR) ? 's' : 'S';
+    }
+    if (mode & S_ISGID) {
+        out[6] = (mode & S_IXGRP) ? 's' : 'S';
+    }
+    if (mode & S_ISVTX) {
+        out[9] = (mode & S_IXOTH) ? 't' : 'T';
+    }
+    out[10] = '\0';
+}
+
+static void ownerName(uid_t uid, char* out, size_t size) {
+    struct passwd* pw = getpwuid(uid);
+    if (pw != NULL) {
+        snprintf(out, size, "%s", pw->pw_name);
+    } else {
+        snprintf(out, size, "%u", (unsigned int)uid);
+    }
+}
+
+static void groupName(gid_t gid, char* out, size_t size) {
+    struct group* gr = getgrgid(gid);
+    if (gr != NULL) {
+        snprintf(out, size, "%s", gr->gr_name);
+    } else {
+        snprintf(out, size, "%u", (unsigned int)gid);
+    }
+}
+
+static void lsPrintLong(const LsList* list) {
+    int linkWidth = 1, ownerWidth = 1, groupWidth = 1, sizeWidth = 1;
+    char text[64];
+    for (int i = 0; i < list->count; i++) {
+        const struct stat* st = &list->entries[i].st;
+        int width = snprintf(text, sizeof(text), "%lu", (unsigned long)st->st_nlink);
+        linkWidth = width > linkWidth ? width : linkWidth;
+        ownerName(st->st_uid, text, sizeof(text));
+        ownerWidth = (int)strlen(text) > ownerWidth ? (int)strlen(text) : ownerWidth;
+        groupName(st->st_gid, text, sizeof(text));
+        groupWidth = (int)strlen(text) > groupWidth ? (int)strlen(text) : groupWidth;
+        width = snprintf(text, sizeof(text), "%lld", (long long)st->st_size);
+        sizeWidth = width > sizeWidth ? width : sizeWidth;
+    }
+    time_t now = time(NULL);
+    for (int i = 0; i < list->count; i++) {
+        const LsEntry* entry = &list->entries[i];
+        char mode[11], owner[64], group[64], when[32];
+        formatMode(entry->st.st_mode, mode);
+        ownerName(entry->st.st_uid, owner, sizeof(owner));
+        groupName(entry->st.st_gid, group, sizeof(group));
+        struct tm local;
+        localtime_r(&entry->st.st_mtime, &local);
+        bool recent = entry->st.st_mtime <= now && now - entry->st.st_mtime < SIX_MONTHS;
+        strftime(when, sizeof(when), recent ? "%b %e %H:%M" : "%b %e  %Y", &local);
+        printf("%s %*lu %-*s %-*s %*lld %s %s", mode, linkWidth, (unsigned long)entry->st.st_nlink, ownerWidth, owner,
+               groupWidth, group, sizeWidth, (long long)entry->st.st_size, when, entry->name);
+        if (entry->linkTarget != NULL) {
+            printf(" -> %s", entry->linkTarget);
+        }
+        putchar('\n');
+    }
+}
+
+// 터미널이면 ls처럼 세로로 채우는 여러 열로, 아니면 한 줄에 하나씩 출력한다.
+static void lsPrintNames(const LsList* list, const LsOptions* options) {
+    if (list->count == 0) {
+        return;
+    }
+    struct winsize size;
+    int width = 80;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 && size.ws_col > 0) {
+        width = size.ws_col;
+    }
+    if (options->onePerLine || !isatty(STDOUT_FILENO)) {
+        for (int i = 0; i < list->count; i++) {
+            printf("%s\n", list->entries[i].name);
+        }
+        return;
+    }
+    int longest = 1;
+    for (int i = 0; i < list->count; i++) {
+        int length = (int)strlen(list->entries[i].name);
+        longest = length > longest ? length : longest;
+    }
+    int columnWidth = longest + 2;
+    int columns = width / columnWidth > 0 ? width / columnWidth : 1;
+    int rows = (list->count + columns - 1) / columns;
+    for (int row = 0; row < rows; row++) {
+        for (int column = 0; column < columns; column++) {
+            int index = column * rows + row;
+            if (index >= list->count) {
+                break;
+            }
+            if (index + rows >= list->count) {
+                printf("%s", list->entries[index].name); // 줄 끝에는 공백을 붙이지 않는다
+            } else {
+                printf("%-*s", columnWidth, list->entries[index].name);
+            }
+        }
+        putchar('\n');
+    }
+}
+
+static void lsPrint(LsList* list, const LsOptions* options) {
+    qsort(list->entries, list->count, sizeof(LsEntry), compareLsEntry);
+    if (options->longFormat) {
+        lsPrintLong(list);
+    } else {
+        lsPrintNames(list, options);
+    }
+}
+
+static bool lsDirectory(const char* path, const LsOptions* options) {
+    DIR* dir = opendir(path);
+    if (dir == NULL) {
+        printf("ls: '%s' 디렉터리를 열 수 없습니다: %s\n", path, strerror(errno));
+        return false;
+    }
+    LsList list = {NULL, 0, 0};
+    long long blocks = 0;
+    char childPath[PATH_MAX];
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        const char* name = entry->d_name;
+        bool dotOrDotDot = strcmp(name, ".") == 0 || strcmp(name, "..") == 0;
+        if (name[0] == '.' && !options->all && (!options->almostAll || dotOrDotDot)) {
+            continue;
+        }
+        struct stat st;
+        memset(&st, 0, sizeof(st));
+        if (options->longFormat) {
+            snprintf(childPath, sizeof(childPath), "%s/%s", path, name);
+            if (lstat(childPath, &st) != 0) {
+                continue; // 읽는 사이에 지워졌다
+            }
+            blocks += st.st_blocks;
+        }
+        lsAdd(&list, name, &st, options->longFormat ? childPath : NULL);
+    }
+    closedir(dir);
+    if (options->longFormat) {
+        printf("total %lld\n", blocks / 2); // st_blocks는 512바이트 단위, ls는 1K 단위로 보여 준다
+    }
+    lsPrint(&list, options);
+    lsFree(&list);
+    return true;
+}
+
+static int builtinLs(int argc, char** argv) {
+    LsOptions options = {false, false, false, false};
+    int first = 1;
+    for (; first < argc && argv[first][0] == '-' && argv[first][1] != '\0'; first++) {
+        for (const char* flag = argv[first] + 1; *flag != '\0'; flag++) {
+            switch (*flag) {
+            case 'a': options.all = true; break;
+            case 'A': options.almostAll = true; break;
+            case 'l': options.longFormat = true; break;
+            case '1': options.onePerLine = true; break;
+            default: return SHELL_DEFER; // 나머지 옵션은 진짜 ls에 맡긴다
+            }
+        }
+    }
+    if (first == argc) {
+        return lsDirectory(".", &options) ? 0 : 2;
+    }
+    // ls처럼 파일 인자를 먼저 모아 보여 주고, 디렉터리는 하나씩 이름을 붙여 보여 준다
+    int status = 0;
+    LsList files = {NULL, 0, 0};
+    int directories = 0;
+    for (int i = first; i < argc; i++) {
+        struct stat st;
+        int result = options.longFormat ? lstat(argv[i], &st) : stat(argv[i], &st);
+        if (result != 0) {
+            printf("ls: '%s'에 접근할 수 없습니다: %s\n", argv[i], strerror(errno));
+            status = 2;
+        } else if (S_ISDIR(st.st_mode)) {
+            directories++;
+        } else {
+            lsAdd(&files, argv[i], &st, argv[i]);
+        }
+    }
+    lsPrint(&files, &options);
+    bool printed = files.count > 0;
+    bool labeled = argc - first > 1;
+    lsFree(&files);
+    for (int i = first; i < argc && directories > 0; i++) {
+        struct stat st;
+        int result = options.longFormat ? lstat(argv[i], &st) : stat(argv[i], &st);
+        if (result != 0 || !S_ISDIR(st.st_mode)) {
+            continue;
+        }
+        if (labeled) {
+            printf("%s%s:\n", printed ? "\n" : "", argv[i]);
+        }
+        printed = true;
+        if (!lsDirectory(argv[i], &options)) {
+            status = 2;
+        }
+    }
+    return status;
+}
+
+static int builtinPwd(int argc, char** argv) {
+    if (argc > 1) {
+        return SHELL_DEFER;
+    }
+    char path[PATH_MAX];
+    if (getcwd(path, sizeof(path)) == NULL) {
+        printf("pwd: %s\n", strerror(errno));
+        return 1;
+    }
+    printf("%s\n", path);
+    return 0;
+}
+
+// 예전에는 system()이 띄운 셸 안에서만 바뀌고 말았지만, 이제 minios 프로세스의 현재 디렉터리를 바꾼다.
+static int builtinCd(int argc, char** argv) {
+    if (argc > 2) {
+        printf("cd: 인자가 너무 많습니다.\n");
+        return 1;
+    }
+    const char* target = argc == 2 ? argv[1] : getenv("HOME");
+    bool printTarget = false;
+    if (target != NULL && strcmp(target, "-") == 0) {
+        target = getenv("OLDPWD");
+        printTarget = true;
+    }
+    if (target == NULL) {
+        printf("cd: %s이(가) 설정되어 있지 않습니다.\n", printTarget ? "OLDPWD" : "HOME");
+        return 1;
+    }
+    char previous[PATH_MAX];
+    bool havePrevious = getcwd(previous, sizeof(previous)) != NULL;
+    if (chdir(target) != 0) {
+        printf("cd: %s: %s\n", target, strerror(errno));
+        return 1;
+    }
+    if (havePrevious) {
+        setenv("OLDPWD", previous, 1);
+    }
+    char current[PATH_MAX];
+    if (getcwd(current, sizeof(current)) != NULL) {
+        setenv("PWD", current, 1);
+        if (printTarget) {
+            printf("%s\n", current);
+        }
+    }
+    return 0;
+}
+
+static int builtinEnv(int argc, char** argv) {
+    if (argc > 1) {
+        return SHELL_DEFER; // env VAR=값 명령 형태는 진짜 env에 맡긴다
+    }
+    for (char** variable = environ; *variable != NULL; variable++) {
+        printf("%s\n", *variable);
+    }
+    return 0;
+}
+
+static double secondsBetween(const struct timeval* from, const struct timeval* to) {
+    return (to->tv_sec - from->tv_sec) + (to->tv_usec - from->tv_usec) / 1e6;
+}
+
+static void printDuration(const char* label, double seconds, bool posix) {
+    if (posix) {
+        printf("%s %.2f\n", label, seconds);
+    } else {
+        int minutes = (int)(seconds / 60);
+        printf("%s\t%dm%.3fs\n", label, minutes, seconds - minutes * 60);
+    }
+}
+
+// time [-p] 명령...: 명령을 같은 방식(내장 또는 외부)으로 실행하고 걸린 시간을 bash의 time처럼 보여 준다.
+// user/sys는 셸 자신과 끝난 자식 프로세스의 사용량을 더한 값이다.
+static int builtinTime(int argc, char** argv) {
+    bool posix = argc > 1 && strcmp(argv[1], "-p") == 0;
+    int first = posix ? 2 : 1;
+    struct timespec startWall, endWall;
+    struct rusage startSelf, startChildren, endSelf, endChildren;
+    clock_gettime(CLOCK_MONOTONIC, &startWall);
+    getrusage(RUSAGE_SELF, &startSelf);
+    getrusage(RUSAGE_CHILDREN, &startChildren);
+    int status = 0;
+    if (first < argc) {
+        const char* statsName;
+        status = executeWords(argc - first, argv + first, &statsName);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &endWall);
+    getrusage(RUSAGE_SELF, &endSelf);
+    getrusage(RUSAGE_CHILDREN, &endChildren);
+
+    double real = (endWall.tv_sec - startWall.tv_sec) + (endWall.tv_nsec - startWall.tv_nsec) / 1e9;
+    double user = secondsBetween(&startSelf.ru_utime, &endSelf.ru_utime) +
+                  secondsBetween(&startChildren.ru_utime, &endChildren.ru_utime);
+    double system = secondsBetween(&startSelf.ru_stime, &endSelf.ru_stime) +
+                    secondsBetween(&startChildren.ru_stime, &endChildren.ru_stime);
+    if (!posix) {
+        putchar('\n');
+    }
+    printDuration("real", real, posix);
+    printDuration("user", user, posix);
+    printDuration("sys", system, posix);
+    return status;
+}
+
+void shellInit() {
+    shellRegister("echo", builtinEcho);
+    shellRegister("cat", builtinCat);
+    shellRegister("ls", builtinLs);
+    shellRegister("pwd", builtinPwd);
+    shellRegister("cd", builtinCd);
+    shellRegister("env", builtinEnv);
+    shellRegister("time", builtinTime);
+}
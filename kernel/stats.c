@@ -0,0 +1,243 @@
+#ifndef MINIOS_NO_STATS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "stats.h"
+#include "dcache.h"
+#include "journal.h"
+
+typedef struct CommandStats {
+    const char* name;
+    StatsHistogram latency;
+} CommandStats;
+
+FsCounters fsCounters;
+static CommandStats commandStats[STATS_MAX_COMMANDS];
+static int commandCount;
+static pthread_mutex_t commandLock = PTHREAD_MUTEX_INITIALIZER; // 명령 목록과 히스토그램
+
+unsigned long long statsNow(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+static int bucketOf(unsigned long long value) {
+    if (value < STATS_SUB_BUCKETS) {
+        return (int)value;
+    }
+    int exponent = 63 - __builtin_clzll(value);
+    int sub = (int)((value >> (exponent - STATS_SUB_BUCKET_BITS)) & (STATS_SUB_BUCKETS - 1));
+    return (exponent - STATS_SUB_BUCKET_BITS + 1) * STATS_SUB_BUCKETS + sub;
+}
+
+// 칸이 나타내는 구간의 가운데 값
+static unsigned long long bucketValue(int bucket) {
+    if (bucket < STATS_SUB_BUCKETS) {
+        return bucket;
+    }
+    int exponent = bucket / STATS_SUB_BUCKETS + STATS_SUB_BUCKET_BITS - 1;
+    unsigned long long sub = bucket % STATS_SUB_BUCKETS;
+    unsigned long long width = 1ULL << (exponent - STATS_SUB_BUCKET_BITS);
+    return (1ULL << exponent) + sub * width + width / 2;
+}
+
+static void histogramRecord(StatsHistogram* histogram, unsigned long long value) {
+    histogram->counts[bucketOf(value)]++;
+    if (histogram->total == 0 || value < histogram->min) {
+        histogram->min = value;
+    }
+    if (value > histogram->max) {
+        histogram->max = value;
+    }
+    histogram->total++;
+    histogram->sum += value;
+}
+
+static unsigned long long histogramPercentile(const StatsHistogram* histogram, double percentile) {
+    if (histogram->total == 0) {
+        return 0;
+    }
+    unsigned long long target = (unsigned long long)(percentile / 100.0 * histogram->total + 0.5);
+    if (target == 0) {
+        target = 1;
+    }
+    unsigned long long seen = 0;
+    for (int bucket = 0; bucket < STATS_BUCKETS; bucket++) {
+        seen += histogram->counts[bucket];
+        if (seen >= target) {
+            unsigned long long value = bucketValue(bucket);
+            if (value < histogram->min) {
+                return histogram->min;
+            }
+            return value > histogram->max ? histogram->max : value;
+        }
+    }
+    return histogram->max;
+}
+
+static double histogramMean(const StatsHistogram* histogram) {
+    return histogram->total == 0 ? 0.0 : (double)histogram->sum / histogram->total;
+}
+
+// 명령 이름은 표에 있는 문자열이라 대개 포인터 비교로 바로 찾는다.
+void statsRecordCommand(const char* name, unsigned long long nanoseconds) {
+    pthread_mutex_lock(&commandLock);
+    CommandStats* entry = NULL;
+    for (int i = 0; i < commandCount; i++) {
+        if (commandStats[i].name == name || strcmp(commandStats[i].name, name) == 0) {
+            entry = &commandStats[i];
+            break;
+        }
+    }
+    if (entry == NULL) {
+        if (commandCount == STATS_MAX_COMMANDS) {
+            pthread_mutex_unlock(&commandLock);
+            return;
+        }
+        entry = &commandStats[commandCount++];
+        entry->name = name;
+    }
+    histogramRecord(&entry->latency, nanoseconds);
+    pthread_mutex_unlock(&commandLock);
+}
+
+void statsRecordLookup(int depth) {
+    __atomic_fetch_add(&fsCounters.lookups, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&fsCounters.lookupComponents, depth, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&fsCounters.lookupDepths[depth < STATS_MAX_DEPTH ? depth : STATS_MAX_DEPTH], 1, __ATOMIC_RELAXED);
+}
+
+static int maxLookupDepth(void) {
+    for (int depth = STATS_MAX_DEPTH; depth > 0; depth--) {
+        if (fsCounters.lookupDepths[depth] > 0) {
+            return depth;
+        }
+    }
+    return 0;
+}
+
+static double ratio(unsigned long long part, unsigned long long whole) {
+    return whole == 0 ? 0.0 : (double)part / whole;
+}
+
+void statsPrint(void) {
+    printf("%-12s %10s %10s %10s %10s %10s %10s  (μs)\n", "명령", "호출 수", "평균", "p50", "p90", "p99", "최대");
+    pthread_mutex_lock(&commandLock);
+    for (int i = 0; i < commandCount; i++) {
+        const StatsHistogram* latency = &commandStats[i].latency;
+        printf("%-12s %10llu %10.1f %10.1f %10.1f %10.1f %10.1f\n", commandStats[i].name, latency->total,
+               histogramMean(latency) / 1000.0, histogramPercentile(latency, 50) / 1000.0,
+               histogramPercentile(latency, 90) / 1000.0, histogramPercentile(latency, 99) / 1000.0,
+               latency->max / 1000.0);
+    }
+    pthread_mutex_unlock(&commandLock);
+    printf("inode: 할당 %llu회, 해제 %llu회 / 블록: 할당 %llu회, 반납 %llu회\n", fsCounters.inodeAllocations,
+           fsCounters.inodeFrees, fsCounters.blockAllocations, fsCounters.blockFrees);
+    printf("경로 탐색: %llu회, 평균 깊이 %.2f, 최대 깊이 %d\n", fsCounters.lookups,
+           fsCounters.lookups == 0 ? 0.0 : (double)fsCounters.lookupComponents / fsCounters.lookups, maxLookupDepth());
+    DcacheStats dcache = dcacheGetStats();
+    unsigned long long dcacheLookups = dcache.hits + dcache.negativeHits + dcache.misses;
+    printf("덴트리 캐시: 적중률 %.1f%% (적중 %lu, 음성 적중 %lu, 실패 %lu, 내보냄 %lu)\n",
+           100.0 * ratio(dcache.hits + dcache.negativeHits, dcacheLookups), dcache.hits, dcache.negativeHits,
+           dcache.misses, dcache.evictions);
+    JournalStats journal = journalGetStats();
+    printf("저널: 레코드 %lu개, fdatasync %lu회 (평균 %.1f개씩)\n", journal.records, journal.flushes,
+           ratio(journal.records, journal.flushes));
+}
+
+static void writeJson(FILE* out) {
+    fprintf(out, "{\n  \"commands\": [");
+    pthread_mutex_lock(&commandLock);
+    for (int i = 0; i < commandCount; i++) {
+        const StatsHistogram* latency = &commandStats[i].latency;
+        fprintf(out, "%s\n    {\"name\": \"%s\", \"count\": %llu, \"mean_ns\": %.0f, \"min_ns\": %llu, "
+                     "\"p50_ns\": %llu, \"p90_ns\": %llu, \"p99_ns\": %llu, \"max_ns\": %llu}",
+                i == 0 ? "" : ",", commandStats[i].name, latency->total, histogramMean(latency), latency->min,
+                histogramPercentile(latency, 50), histogramPercentile(latency, 90),
+                histogramPercentile(latency, 99), latency->max);
+    }
+    pthread_mutex_unlock(&commandLock);
+    fprintf(out, "\n  ],\n");
+    fprintf(out, "  \"allocations\": {\"inode_allocations\": %llu, \"inode_frees\": %llu, "
+                 "\"block_allocations\": %llu, \"block_frees\": %llu},\n",
+            fsCounters.inodeAllocations, fsCounters.inodeFrees, fsCounters.blockAllocations, fsCounters.blockFrees);
+    fprintf(out, "  \"lookup\": {\"count\": %llu, \"components\": %llu, \"max_depth\": %d, \"depths\": [",
+            fsCounters.lookups, fsCounters.lookupComponents, maxLookupDepth());
+    for (int depth = 0; depth <= maxLookupDepth(); depth++) {
+        fprintf(out, "%s%llu", depth == 0 ? "" : ", ", fsCounters.lookupDepths[depth]);
+    }
+    fprintf(out, "]},\n");
+    DcacheStats dcache = dcacheGetStats();
+    unsigned long long dcacheLookups = dcache.hits + dcache.negativeHits + dcache.misses;
+    fprintf(out, "  \"dcache\": {\"hits\": %lu, \"negative_hits\": %lu, \"misses\": %lu, \"evictions\": %lu, "
+                 "\"hit_rate\": %.4f},\n",
+            dcache.hits, dcache.negativeHits, dcache.misses, dcache.evictions,
+            ratio(dcache.hits + dcache.negativeHits, dcacheLookups));
+    JournalStats journal = journalGetStats();
+    fprintf(out, "  \"journal\": {\"records\": %lu, \"flushes\": %lu, \"bytes\": %lu, \"replayed\": %lu}\n}\n",
+            journal.records, journal.flushes, journal.bytes, journal.replayed);
+}
+
+// 한 줄에 값 하나: 구분,이름,항목,값
+static void writeCsv(FILE* out) {
+    fprintf(out, "section,name,metric,value\n");
+    pthread_mutex_lock(&commandLock);
+    for (int i = 0; i < commandCount; i++) {
+        const StatsHistogram* latency = &commandStats[i].latency;
+        const char* name = commandStats[i].name;
+        fprintf(out, "command,%s,count,%llu\n", name, latency->total);
+        fprintf(out, "command,%s,mean_ns,%.0f\n", name, histogramMean(latency));
+        fprintf(out, "command,%s,min_ns,%llu\n", name, latency->min);
+        fprintf(out, "command,%s,p50_ns,%llu\n", name, histogramPercentile(latency, 50));
+        fprintf(out, "command,%s,p90_ns,%llu\n", name, histogramPercentile(latency, 90));
+        fprintf(out, "command,%s,p99_ns,%llu\n", name, histogramPercentile(latency, 99));
+        fprintf(out, "command,%s,max_ns,%llu\n", name, latency->max);
+    }
+    pthread_mutex_unlock(&commandLock);
+    fprintf(out, "allocation,inode,allocations,%llu\n", fsCounters.inodeAllocations);
+    fprintf(out, "allocation,inode,frees,%llu\n", fsCounters.inodeFrees);
+    fprintf(out, "allocation,block,allocations,%llu\n", fsCounters.blockAllocations);
+    fprintf(out, "allocation,block,frees,%llu\n", fsCounters.blockFrees);
+    fprintf(out, "lookup,resolvePath,count,%llu\n", fsCounters.lookups);
+    fprintf(out, "lookup,resolvePath,components,%llu\n", fsCounters.lookupComponents);
+    for (int depth = 0; depth <= maxLookupDepth(); depth++) {
+        fprintf(out, "lookup,depth_%d,count,%llu\n", depth, fsCounters.lookupDepths[depth]);
+    }
+    DcacheStats dcache = dcacheGetStats();
+    fprintf(out, "cache,dcache,hits,%lu\n", dcache.hits);
+    fprintf(out, "cache,dcache,negative_hits,%lu\n", dcache.negativeHits);
+    fprintf(out, "cache,dcache,misses,%lu\n", dcache.misses);
+    fprintf(out, "cache,dcache,evictions,%lu\n", dcache.evictions);
+    JournalStats journal = journalGetStats();
+    fprintf(out, "journal,journal,records,%lu\n", journal.records);
+    fprintf(out, "journal,journal,flushes,%lu\n", journal.flushes);
+    fprintf(out, "journal,journal,bytes,%lu\n", journal.bytes);
+}
+
+bool statsDump(const char* path) {
+    FILE* out = fopen(path, "w");
+    if (out == NULL) {
+        printf("통계 파일 '%s'을(를) 만들 수 없습니다.\n", path);
+        return false;
+    }
+    size_t length = strlen(path);
+    if (length >= 4 && strcmp(path + length - 4, ".csv") == 0) {
+        writeCsv(out);
+    } else {
+        writeJson(out);
+    }
+    return fclose(out) == 0;
+}
+
+void statsDumpOnExit(void) {
+    const char* path = getenv("MINIOS_STATS_FILE");
+    if (path != NULL && path[0] != '\0') {
+        statsDump(path);
+    }
+}
+
+#endif
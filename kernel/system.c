@@ -1,7 +1,78 @@
-#include <stdio.h>
-#include <stdlib.h>
-
-void minisystem()
-{
-    printf("minisystem\n");
-}
\ No newline at end of file
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "system.h"
+
+#define DEMO_MAX_TASKS 10000 // 작업마다 스택을 잡으므로 데모는 이만큼까지만 만든다
+
+// 데모 작업: 맡은 틱만큼 CPU를 쓰고 끝난다
+static void busyTask(void* arg) {
+    long budget = *(long*)arg;
+    for (long i = 0; i < budget; i++) {
+        taskTick();
+    }
+}
+
+static bool parseCount(const char* text, long max, long* value) {
+    char* end;
+    long parsed = strtol(text, &end, 10);
+    if (*end != '\0' || parsed < 1 || parsed > max) {
+        return false;
+    }
+    *value = parsed;
+    return true;
+}
+
+// minisystem [o1|cfs] [작업 수] [틱 수]: nice가 -10부터 10까지 고르게 퍼진 작업들을 돌려
+// 스케줄러가 CPU를 어떻게 나누는지 보여 준다. 작업마다 (틱 수 * 1.5 / 작업 수)틱의 일을 맡기므로
+// 모두 끝나기 전에 틱이 바닥나고, 누가 먼저 끝나고 누가 얼마나 받았는지가 정책마다 달라진다.
+int minisystem(int argc, char** argv) {
+    SchedPolicy policy = SCHED_CFS;
+    long taskCount = 5;
+    long ticks = 1000;
+    int position = 1;
+    if (position < argc && parseSchedPolicy(argv[position], &policy)) {
+        position++;
+    }
+    if ((position < argc && !parseCount(argv[position++], DEMO_MAX_TASKS, &taskCount)) ||
+        (position < argc && !parseCount(argv[position++], 100000000, &ticks)) || position < argc) {
+        printf("사용법: minisystem [o1|cfs] [작업 수(최대 %d)] [틱 수]\n", DEMO_MAX_TASKS);
+        return 1;
+    }
+
+    Scheduler* scheduler = schedulerCreate(policy);
+    long budget = ticks * 3 / (2 * taskCount) > 0 ? ticks * 3 / (2 * taskCount) : 1;
+    for (long i = 0; i < taskCount; i++) {
+        char name[16];
+        snprintf(name, sizeof(name), "task%d", (int)i);
+        int nice = taskCount > 1 ? (int)(-10 + 20 * i / (taskCount - 1)) : 0;
+        taskCreate(scheduler, name, nice, busyTask, &budget);
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    unsigned long long elapsed = schedulerRun(scheduler, ticks);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double wallNs = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+
+    printf("정책 %s, 작업 %ld개, 작업마다 %ld틱 필요, %llu틱 실행, 문맥 전환 %llu번 (전환당 평균 %.0fns)\n",
+           schedPolicyName(policy), taskCount, budget, elapsed, scheduler->contextSwitches,
+           scheduler->contextSwitches > 0 ? wallNs / scheduler->contextSwitches : 0.0);
+    printf("%6s %-10s %5s %8s %7s %8s %10s %s\n", "PID", "NAME", "NICE", "TICKS", "SHARE", "SWITCHES",
+           policy == SCHED_CFS ? "VRUNTIME" : "SLICE", "FINISHED");
+    for (long i = 0; i < scheduler->allCount; i++) {
+        Task* task = scheduler->allTasks[i];
+        char finished[24] = "-";
+        if (task->finishTick >= 0) {
+            snprintf(finished, sizeof(finished), "%lld", task->finishTick);
+        }
+        printf("%6d %-10s %5d %8llu %6.1f%% %8llu %10llu %s\n", task->pid, task->name, task->nice, task->runTicks,
+               elapsed > 0 ? 100.0 * task->runTicks / elapsed : 0.0, task->switches,
+               policy == SCHED_CFS ? task->vruntime / 1000 : (unsigned long long)task->timeSlice, finished);
+    }
+    if (policy == SCHED_CFS) {
+        printf("(VRUNTIME은 마이크로초)\n");
+    }
+    schedulerDestroy(scheduler);
+    return 0;
+}
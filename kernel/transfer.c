@@ -0,0 +1,413 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "transfer.h"
+#include "walk.h"
+#include "workpool.h"
+
+#define NAME_LIMIT 100 // Directory/File의 name 배열 크기
+
+typedef struct HostDir {
+    Node* node;
+    char* path;
+} HostDir;
+
+typedef struct HostFile {
+    Node* parent; // 내보낼 때는 파일 노드 자신
+    char* path;
+    const char* name; // path 안의 마지막 구성 요소
+    Node* node; // 가져올 때 붙일 순서대로 미리 만들어 두고 내용을 읽어 들이는 (아직 붙이지 않은) 노드
+} HostFile;
+
+typedef struct DirList {
+    HostDir* items;
+    long count;
+    long capacity;
+} DirList;
+
+typedef struct FileList {
+    HostFile* items;
+    long count;
+    long capacity;
+} FileList;
+
+// 작업 스레드들이 원자적으로 더한다
+typedef struct TransferTotals {
+    long directories;
+    long files;
+    long long bytes;
+    long skipped;
+    long failed;
+} TransferTotals;
+
+static void pushDir(DirList* list, Node* node, char* path) {
+    if (list->count == list->capacity) {
+        list->capacity = list->capacity == 0 ? 16 : list->capacity * 2;
+        list->items = (HostDir*)realloc(list->items, list->capacity * sizeof(HostDir));
+    }
+    list->items[list->count++] = (HostDir){node, path};
+}
+
+static void pushFile(FileList* list, Node* parent, char* path, const char* name) {
+    if (list->count == list->capacity) {
+        list->capacity = list->capacity == 0 ? 64 : list->capacity * 2;
+        list->items = (HostFile*)realloc(list->items, list->capacity * sizeof(HostFile));
+    }
+    list->items[list->count++] = (HostFile){parent, path, name, NULL};
+}
+
+static char* joinPath(const char* dir, const char* name) {
+    size_t dirLength = strlen(dir);
+    while (dirLength > 1 && dir[dirLength - 1] == '/') {
+        dirLength--;
+    }
+    size_t nameLength = strlen(name);
+    char* path = (char*)malloc(dirLength + nameLength + 2);
+    memcpy(path, dir, dirLength);
+    path[dirLength] = '/';
+    memcpy(path + dirLength + 1, name, nameLength + 1);
+    return path;
+}
+
+static void countAdd(long* counter, long value) {
+    __atomic_add_fetch(counter, value, __ATOMIC_RELAXED);
+}
+
+static double secondsSince(const struct timespec* start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// ---- 가져오기 ----
+
+typedef struct HostEntry {
+    char* name;
+    bool isDirectory;
+} HostEntry;
+
+static int compareHostEntry(const void* left, const void* right) {
+    return strcmp(((const HostEntry*)left)->name, ((const HostEntry*)right)->name);
+}
+
+// 같은 깊이의 디렉터리 하나를 훑은 결과. 합칠 때 디렉터리 순서대로 이어 붙인다.
+typedef struct ScanResult {
+    DirList dirs;
+    FileList files;
+} ScanResult;
+
+typedef struct ScanJob {
+    const HostDir* level;
+    ScanResult* results;
+    TransferTotals* totals;
+} ScanJob;
+
+// 호스트 디렉터리 하나를 읽어 하위 디렉터리 노드를 만들고 파일은 목록에 모은다.
+// 어느 호스트에서나 같은 트리가 되도록 이름순으로 처리한다. 이미 있는 파일은 읽지 않고 건너뛴다.
+static void scanHostDirectory(void* context, long index) {
+    ScanJob* job = (ScanJob*)context;
+    const HostDir* dir = &job->level[index];
+    ScanResult* result = &job->results[index];
+    DIR* stream = opendir(dir->path);
+    if (stream == NULL) {
+        printf("'%s' 디렉터리를 열 수 없습니다: %s\n", dir->path, strerror(errno));
+        countAdd(&job->totals->failed, 1);
+        return;
+    }
+    HostEntry* entries = NULL;
+    long count = 0, capacity = 0;
+    struct dirent* entry;
+    while ((entry = readdir(stream)) != NULL) {
+        const char* name = entry->d_name;
+        if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) {
+            continue;
+        }
+        unsigned char type = entry->d_type;
+        if (type == DT_UNKNOWN) {
+            struct stat st;
+            if (fstatat(dirfd(stream), name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+                countAdd(&job->totals->failed, 1);
+                continue;
+            }
+            type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISREG(st.st_mode) ? DT_REG : DT_UNKNOWN;
+        }
+        if ((type != DT_DIR && type != DT_REG) || strlen(name) >= NAME_LIMIT) {
+            countAdd(&job->totals->skipped, 1);
+            continue;
+        }
+        if (count == capacity) {
+            capacity = capacity == 0 ? 64 : capacity * 2;
+            entries = (HostEntry*)realloc(entries, capacity * sizeof(HostEntry));
+        }
+        entries[count++] = (HostEntry){strdup(name), type == DT_DIR};
+    }
+    closedir(stream);
+    if (count > 1) {
+        qsort(entries, count, sizeof(HostEntry), compareHostEntry);
+    }
+
+    for (long i = 0; i < count; i++) {
+        const char* name = entries[i].name;
+        if (!entries[i].isDirectory) {
+            if (findChild(dir->node, name, FILE_TYPE) != NULL) {
+                countAdd(&job->totals->skipped, 1);
+            } else {
+                char* path = joinPath(dir->path, name);
+                pushFile(&result->files, dir->node, path, strrchr(path, '/') + 1);
+            }
+            continue;
+        }
+        Node* child = findChild(dir->node, name, DIR_TYPE);
+        if (child == NULL && (child = makeChild(dir->node, name, DIR_TYPE, NULL)) != NULL) {
+            countAdd(&job->totals->directories, 1);
+        }
+        if (child == NULL) {
+            child = findChild(dir->node, name, DIR_TYPE); // 다른 스레드가 먼저 만들었다
+        }
+        if (child == NULL) {
+            countAdd(&job->totals->failed, 1);
+            continue;
+        }
+        pushDir(&result->dirs, child, joinPath(dir->path, name));
+    }
+    for (long i = 0; i < count; i++) {
+        free(entries[i].name);
+    }
+    free(entries);
+}
+
+typedef struct ReadJob {
+    HostFile* files;
+    TransferTotals* totals;
+} ReadJob;
+
+// 파일 하나를 아직 붙이지 않은 노드에 읽어 들인다. 부모 잠금 없이 읽으므로 같은 디렉터리의 파일들도 함께 읽힌다.
+// 읽지 못하면 노드를 버리고 file->node를 NULL로 둔다.
+static void readHostFile(void* context, long index) {
+    ReadJob* job = (ReadJob*)context;
+    HostFile* file = &job->files[index];
+    Node* node = file->node;
+    if (node == NULL) {
+        return;
+    }
+    int fd = open(file->path, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        printf("'%s' 파일을 열 수 없습니다: %s\n", file->path, strerror(errno));
+        countAdd(&job->totals->failed, 1);
+        if (fd >= 0) {
+            close(fd);
+        }
+    } else if (!S_ISREG(st.st_mode)) { // 훑은 뒤에 바뀌었다
+        close(fd);
+        countAdd(&job->totals->skipped, 1);
+    } else if (!fileReadFd(getInode(node->inode), fd, (size_t)st.st_size)) {
+        printf("'%s' 파일을 읽을 수 없습니다: %s\n", file->path, strerror(errno));
+        close(fd);
+        countAdd(&job->totals->failed, 1);
+    } else {
+        close(fd);
+        INODE_MODIFIED(node->inode) = st.st_mtime;
+        return;
+    }
+    freeTree(node);
+    file->node = NULL;
+}
+
+bool importTree(Node* target, const char* hostDir) {
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    struct stat st;
+    if (stat(hostDir, &st) != 0 || !S_ISDIR(st.st_mode)) {
+        printf("'%s'은(는) 호스트 디렉터리가 아닙니다.\n", hostDir);
+        return false;
+    }
+    TransferTotals totals = {0, 0, 0, 0, 0};
+    FileList files = {NULL, 0, 0};
+
+    // 1단계: 깊이별로 디렉터리를 나눠 훑는다
+    DirList level = {NULL, 0, 0};
+    pushDir(&level, target, strdup(hostDir));
+    while (level.count > 0) {
+        ScanResult* results = (ScanResult*)calloc(level.count, sizeof(ScanResult));
+        ScanJob job = {level.items, results, &totals};
+        workPoolRun(level.count, scanHostDirectory, &job);
+        DirList next = {NULL, 0, 0};
+        for (long i = 0; i < level.count; i++) {
+            for (long d = 0; d < results[i].dirs.count; d++) {
+                pushDir(&next, results[i].dirs.items[d].node, results[i].dirs.items[d].path);
+            }
+            for (long f = 0; f < results[i].files.count; f++) {
+                HostFile* file = &results[i].files.items[f];
+                pushFile(&files, file->parent, file->path, file->name);
+            }
+            free(results[i].dirs.items);
+            free(results[i].files.items);
+            free(level.items[i].path);
+        }
+        free(results);
+        free(level.items);
+        level = next;
+    }
+
+    // 2단계: 노드는 붙일 순서대로 한 스레드에서 만들고, 내용만 나눠 읽는다.
+    // 형제 목록은 일련번호 오름차순이어야 하므로 (compareTreeOrder) 작업 스레드에서 노드를 만들지 않는다.
+    for (long i = 0; i < files.count; i++) {
+        files.items[i].node = createNode(files.items[i].name, FILE_TYPE, files.items[i].parent);
+        if (files.items[i].node == NULL) {
+            totals.failed++;
+        }
+    }
+    ReadJob job = {files.items, &totals};
+    workPoolRun(files.count, readHostFile, &job);
+
+    // 3단계: 훑은 순서대로 붙인다. 연결은 금방이므로 트리 순서가 실행마다 같도록 한 스레드에서 한다.
+    for (long i = 0; i < files.count; i++) {
+        HostFile* file = &files.items[i];
+        if (file->node != NULL) {
+            long size = INODE_SIZE(file->node->inode);
+            if (adoptChild(file->parent, file->node)) {
+                totals.files++;
+                totals.bytes += size;
+            } else {
+                freeTree(file->node); // 그 사이 같은 이름이 생겼다
+                totals.skipped++;
+            }
+        }
+        free(file->path);
+    }
+    free(files.items);
+    if (totals.files > 0) {
+        markContentIndexStale();
+        markMetaIndexStale();
+    }
+
+    double seconds = secondsSince(&start);
+    FS_NOTICE("가져오기: 디렉터리 %ld개, 파일 %ld개, %lld bytes, %.2f초 (%.1f MB/s)", totals.directories, totals.files,
+              totals.bytes, seconds, seconds > 0 ? totals.bytes / seconds / (1024 * 1024) : 0.0);
+    FS_NOTICE(", 건너뜀 %ld개, 실패 %ld개\n", totals.skipped, totals.failed);
+    return totals.directories > 0 || totals.files > 0;
+}
+
+// ---- 내보내기 ----
+
+typedef struct ExportState {
+    char** paths; // 깊이별로 지금 내려와 있는 디렉터리의 호스트 경로
+    int depthCapacity;
+    FileList files;
+    TransferTotals* totals;
+} ExportState;
+
+static bool makeHostDirectory(const char* path) {
+    if (mkdir(path, 0777) == 0) {
+        return true;
+    }
+    struct stat st;
+    if (errno == EEXIST && stat(path, &st) == 0 && S_ISDIR(st.st_mode)) {
+        return true;
+    }
+    printf("'%s' 디렉터리를 만들 수 없습니다: %s\n", path, strerror(errno));
+    return false;
+}
+
+// 디렉터리는 바로 만들고, 파일은 경로와 함께 모아 둔다. 시작 노드(depth 0)의 경로는 미리 채워 둔다.
+static WalkAction collectExport(Node* node, int depth, void* state) {
+    ExportState* export = (ExportState*)state;
+    if (depth == 0) {
+        return WALK_CONTINUE;
+    }
+    if (node->type == FILE_TYPE) {
+        char* path = joinPath(export->paths[depth - 1], node->name);
+        pushFile(&export->files, node, path, strrchr(path, '/') + 1);
+        return WALK_CONTINUE;
+    }
+    char* path = joinPath(export->paths[depth - 1], node->name);
+    if (!makeHostDirectory(path)) {
+        free(path);
+        export->totals->failed++;
+        return WALK_SKIP;
+    }
+    export->totals->directories++;
+    if (depth >= export->depthCapacity) {
+        int capacity = export->depthCapacity * 2;
+        export->paths = (char**)realloc(export->paths, capacity * sizeof(char*));
+        memset(export->paths + export->depthCapacity, 0, (capacity - export->depthCapacity) * sizeof(char*));
+        export->depthCapacity = capacity;
+    }
+    free(export->paths[depth]);
+    export->paths[depth] = path;
+    return WALK_CONTINUE;
+}
+
+typedef struct WriteJob {
+    HostFile* files;
+    TransferTotals* totals;
+} WriteJob;
+
+// 파일 내용은 그 파일이 든 디렉터리의 잠금이 보호하므로 쓰는 동안 읽기 잠금을 쥔다.
+static void writeHostFile(void* context, long index) {
+    WriteJob* job = (WriteJob*)context;
+    HostFile* file = &job->files[index];
+    Node* node = file->parent;
+    int fd = open(file->path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd < 0) {
+        printf("'%s' 파일을 만들 수 없습니다: %s\n", file->path, strerror(errno));
+        countAdd(&job->totals->failed, 1);
+        return;
+    }
+    dirReadLock(&node->parent->dir->lock);
+    Inode* inode = getInode(node->inode);
+    long size = INODE_SIZE(node->inode);
+    time_t modified = INODE_MODIFIED(node->inode);
+    bool written = fileWriteFd(inode, fd);
+    dirReadUnlock(&node->parent->dir->lock);
+    int error = errno;
+    struct timespec times[2] = {{0, UTIME_OMIT}, {modified, 0}};
+    futimens(fd, times);
+    if (close(fd) != 0 && written) {
+        written = false;
+        error = errno;
+    }
+    if (!written) {
+        printf("'%s' 파일에 쓸 수 없습니다: %s\n", file->path, strerror(error));
+        countAdd(&job->totals->failed, 1);
+        return;
+    }
+    countAdd(&job->totals->files, 1);
+    __atomic_add_fetch(&job->totals->bytes, size, __ATOMIC_RELAXED);
+}
+
+bool exportTree(Node* source, const char* hostDir) {
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (!makeHostDirectory(hostDir)) {
+        return false;
+    }
+    TransferTotals totals = {0, 0, 0, 0, 0};
+    ExportState state = {(char**)calloc(16, sizeof(char*)), 16, {NULL, 0, 0}, &totals};
+    state.paths[0] = strdup(hostDir);
+    walkTree(source, WALK_LOCKED, collectExport, NULL, &state);
+    for (int i = 0; i < state.depthCapacity; i++) {
+        free(state.paths[i]);
+    }
+    free(state.paths);
+
+    WriteJob job = {state.files.items, &totals};
+    workPoolRun(state.files.count, writeHostFile, &job);
+    for (long i = 0; i < state.files.count; i++) {
+        free(state.files.items[i].path);
+    }
+    free(state.files.items);
+
+    double seconds = secondsSince(&start);
+    FS_NOTICE("내보내기: 디렉터리 %ld개, 파일 %ld개, %lld bytes, %.2f초 (%.1f MB/s), 실패 %ld개\n", totals.directories,
+              totals.files, totals.bytes, seconds, seconds > 0 ? totals.bytes / seconds / (1024 * 1024) : 0.0,
+              totals.failed);
+    return totals.failed == 0;
+}
@@ -0,0 +1,268 @@
+#include <stdlib.h>
+#include <string.h>
+#include "walk.h"
+#include "workpool.h"
+
+#define INLINE_FRAMES 64 // 이보다 깊어지면 프레임 스택을 힙으로 옮긴다
+#define SEGMENTS_PER_THREAD 8 // 작업자마다 이만큼의 조각을 목표로 나눠 훔쳐 갈 여지를 남긴다
+#define MIN_SEGMENT_WEIGHT 512 // 조각 하나가 적어도 이만큼의 노드를 갖도록 한다
+#define MAX_SEGMENT_WEIGHT 65536 // 조각마다 모으는 출력이 너무 커지지 않도록 한다
+#define WINDOW_PER_THREAD 8 // 한 번에 실행하고 합치는 조각 수 (작업자당)
+
+typedef struct WalkFrame {
+    Node* dir;
+    Node* next; // 다음에 볼 자식
+} WalkFrame;
+
+typedef struct FrameStack {
+    WalkFrame* frames;
+    int count;
+    int capacity;
+    WalkFrame inlineFrames[INLINE_FRAMES];
+} FrameStack;
+
+static void stackInit(FrameStack* stack) {
+    stack->frames = stack->inlineFrames;
+    stack->count = 0;
+    stack->capacity = INLINE_FRAMES;
+}
+
+static void stackFree(FrameStack* stack) {
+    if (stack->frames != stack->inlineFrames) {
+        free(stack->frames);
+    }
+    stackInit(stack);
+}
+
+static void pushFrame(FrameStack* stack, Node* dir, int flags) {
+    if (stack->count == stack->capacity) {
+        int capacity = stack->capacity * 2;
+        WalkFrame* frames = (WalkFrame*)malloc(capacity * sizeof(WalkFrame));
+        memcpy(frames, stack->frames, stack->count * sizeof(WalkFrame));
+        if (stack->frames != stack->inlineFrames) {
+            free(stack->frames);
+        }
+        stack->frames = frames;
+        stack->capacity = capacity;
+    }
+    if (flags & WALK_LOCKED) {
+        dirReadLock(&dir->dir->lock);
+    }
+    stack->frames[stack->count++] = (WalkFrame){dir, dir->dir->firstChild};
+}
+
+// dir의 enter는 이미 불렸다. dir 아래를 모두 훑고 leave까지 부른다. 빈 스택으로 시작한다.
+static bool walkBelow(FrameStack* stack, Node* dir, int depth, int flags, WalkEnter enter, WalkLeave leave, void* state) {
+    pushFrame(stack, dir, flags);
+    while (stack->count > 0) {
+        WalkFrame* frame = &stack->frames[stack->count - 1];
+        Node* child = frame->next;
+        if (child == NULL) {
+            Node* done = frame->dir;
+            stack->count--;
+            if (flags & WALK_LOCKED) {
+                dirReadUnlock(&done->dir->lock);
+            }
+            if (leave != NULL) {
+                leave(done, depth + stack->count, state);
+            }
+            continue;
+        }
+        frame->next = child->nextSibling;
+        bool isDirectory = child->type == DIR_TYPE; // enter가 파일 노드를 해제할 수 있으므로 먼저 읽는다
+        WalkAction action = enter(child, depth + stack->count, state);
+        if (action == WALK_STOP) {
+            while (stack->count > 0) {
+                stack->count--;
+                if (flags & WALK_LOCKED) {
+                    dirReadUnlock(&stack->frames[stack->count].dir->dir->lock);
+                }
+            }
+            return false;
+        }
+        if (action == WALK_CONTINUE && isDirectory) {
+            pushFrame(stack, child, flags);
+        }
+    }
+    return true;
+}
+
+bool walkTree(Node* top, int flags, WalkEnter enter, WalkLeave leave, void* state) {
+    bool isDirectory = top->type == DIR_TYPE;
+    WalkAction action = enter(top, 0, state);
+    if (action == WALK_STOP) {
+        return false;
+    }
+    if (action != WALK_CONTINUE || !isDirectory) {
+        return true;
+    }
+    FrameStack stack;
+    stackInit(&stack);
+    bool finished = walkBelow(&stack, top, 0, flags, enter, leave, state);
+    stackFree(&stack);
+    return finished;
+}
+
+// 전위 순서상 연속된 구간 하나. descend가 false면 first 하나만 방문하고 (잘게 나눈 디렉터리 자신),
+// true면 first부터 last까지 형제들의 서브트리를 모두 훑는다. lockDir은 first의 부모다 (시작 노드면 NULL).
+typedef struct WalkSegment {
+    Node* lockDir;
+    Node* first;
+    Node* last;
+    int depth;
+    bool descend;
+} WalkSegment;
+
+typedef struct SegmentList {
+    WalkSegment* items;
+    long count;
+    long capacity;
+} SegmentList;
+
+static void addSegment(SegmentList* list, Node* lockDir, Node* first, Node* last, int depth, bool descend) {
+    if (list->count == list->capacity) {
+        list->capacity = list->capacity == 0 ? 64 : list->capacity * 2;
+        list->items = (WalkSegment*)realloc(list->items, list->capacity * sizeof(WalkSegment));
+    }
+    list->items[list->count++] = (WalkSegment){lockDir, first, last, depth, descend};
+}
+
+// 서브트리의 노드 수 어림값. 하위 디렉터리 수는 집계하지 않으므로 바로 아래 자식 수로 대신한다.
+static long nodeWeight(Node* node) {
+    if (node->type == FILE_TYPE) {
+        return 1;
+    }
+    return 1 + __atomic_load_n(&node->dir->childCount, __ATOMIC_RELAXED) +
+           __atomic_load_n(&node->dir->subtreeFiles, __ATOMIC_RELAXED);
+}
+
+typedef struct SplitFrame {
+    Node* dir;
+    Node* next;
+    Node* runFirst; // 아직 조각으로 내보내지 않은 가벼운 형제들
+    Node* runLast;
+    long runWeight;
+} SplitFrame;
+
+static void flushRun(SegmentList* list, SplitFrame* frame, int depth) {
+    if (frame->runFirst != NULL) {
+        addSegment(list, frame->dir, frame->runFirst, frame->runLast, depth, true);
+        frame->runFirst = frame->runLast = NULL;
+        frame->runWeight = 0;
+    }
+}
+
+// 무거운 디렉터리는 자신과 자식들로 쪼개고, 가벼운 형제들은 target만큼 모아 한 조각으로 만든다.
+// 조각은 전위 순서대로 나온다. 쪼개는 동안 내려간 디렉터리마다 읽기 잠금을 쥔다.
+static void splitTree(Node* top, long target, SegmentList* list) {
+    if (top->type != DIR_TYPE || nodeWeight(top) <= target) {
+        addSegment(list, NULL, top, top, 0, true);
+        return;
+    }
+    addSegment(list, NULL, top, top, 0, false);
+    int capacity = INLINE_FRAMES;
+    SplitFrame* frames = (SplitFrame*)malloc(capacity * sizeof(SplitFrame));
+    int count = 0;
+    dirReadLock(&top->dir->lock);
+    frames[count++] = (SplitFrame){top, top->dir->firstChild, NULL, NULL, 0};
+    while (count > 0) {
+        SplitFrame* frame = &frames[count - 1];
+        Node* child = frame->next;
+        if (child == NULL) {
+            flushRun(list, frame, count);
+            dirReadUnlock(&frame->dir->dir->lock);
+            count--;
+            continue;
+        }
+        frame->next = child->nextSibling;
+        long weight = nodeWeight(child);
+        if (child->type == DIR_TYPE && weight > target) {
+            flushRun(list, frame, count);
+            addSegment(list, frame->dir, child, child, count, false);
+            if (count == capacity) {
+                capacity *= 2;
+                frames = (SplitFrame*)realloc(frames, capacity * sizeof(SplitFrame));
+            }
+            dirReadLock(&child->dir->lock);
+            frames[count++] = (SplitFrame){child, child->dir->firstChild, NULL, NULL, 0};
+            continue;
+        }
+        if (frame->runFirst == NULL) {
+            frame->runFirst = child;
+        }
+        frame->runLast = child;
+        frame->runWeight += weight;
+        if (frame->runWeight >= target) {
+            flushRun(list, frame, count);
+        }
+    }
+    free(frames);
+}
+
+// 조각 사이에 새로 붙은 형제는 last 뒤에 오므로 first에서 last까지의 연결은 그대로다.
+static void runSegment(const WalkSegment* segment, const ParallelWalk* walk, void* state) {
+    if (segment->lockDir != NULL) {
+        dirReadLock(&segment->lockDir->dir->lock);
+    }
+    FrameStack stack;
+    stackInit(&stack);
+    for (Node* node = segment->first;; node = node->nextSibling) {
+        WalkAction action = walk->enter(node, segment->depth, state);
+        if (segment->descend && action == WALK_CONTINUE && node->type == DIR_TYPE) {
+            walkBelow(&stack, node, segment->depth, WALK_LOCKED, walk->enter, NULL, state);
+        }
+        if (!segment->descend || node == segment->last) {
+            break;
+        }
+    }
+    stackFree(&stack);
+    if (segment->lockDir != NULL) {
+        dirReadUnlock(&segment->lockDir->dir->lock);
+    }
+}
+
+typedef struct SegmentJob {
+    const ParallelWalk* walk;
+    const WalkSegment* segments;
+    char* states;
+    size_t stride;
+} SegmentJob;
+
+static void runSegmentTask(void* context, long index) {
+    SegmentJob* job = (SegmentJob*)context;
+    runSegment(&job->segments[index], job->walk, job->states + index * job->stride);
+}
+
+void walkTreeParallel(Node* top, const ParallelWalk* walk) {
+    int threads = workPoolThreads();
+    long target = nodeWeight(top) / ((long)threads * SEGMENTS_PER_THREAD);
+    if (target < MIN_SEGMENT_WEIGHT) {
+        target = MIN_SEGMENT_WEIGHT;
+    } else if (target > MAX_SEGMENT_WEIGHT) {
+        target = MAX_SEGMENT_WEIGHT;
+    }
+    SegmentList list = {NULL, 0, 0};
+    if (threads > 1) {
+        splitTree(top, target, &list);
+    } else {
+        addSegment(&list, NULL, top, top, 0, true);
+    }
+
+    // 조각 출력을 모두 쥐고 있지 않도록 몇 조각씩 실행하고 바로 합친다
+    long window = (long)threads * WINDOW_PER_THREAD;
+    size_t stride = (walk->stateSize + 63) & ~(size_t)63; // 조각 상태끼리 캐시 라인을 나눠 쓰지 않게 한다
+    SegmentJob job = {walk, NULL, (char*)malloc((window < list.count ? window : list.count) * stride), stride};
+    for (long start = 0; start < list.count; start += window) {
+        long count = list.count - start < window ? list.count - start : window;
+        job.segments = list.items + start;
+        for (long i = 0; i < count; i++) {
+            walk->initState(job.states + i * stride, walk->context);
+        }
+        workPoolRun(count, runSegmentTask, &job);
+        for (long i = 0; i < count; i++) {
+            walk->mergeState(job.states + i * stride, walk->context);
+        }
+    }
+    free(job.states);
+    free(list.items);
+}
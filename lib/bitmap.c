@@ -0,0 +1,87 @@
+#include <stdlib.h>
+#include <string.h>
+#include "bitmap.h"
+
+#define BITS_PER_WORD 64
+
+void bitmapInit(Bitmap* bitmap, size_t bitCount) {
+    bitmap->words = NULL;
+    bitmap->bitCount = 0;
+    bitmap->wordCount = 0;
+    bitmap->setCount = 0;
+    bitmap->hint = 0;
+    bitmapGrow(bitmap, bitCount);
+}
+
+void bitmapDestroy(Bitmap* bitmap) {
+    free(bitmap->words);
+    bitmap->words = NULL;
+    bitmap->bitCount = bitmap->wordCount = bitmap->setCount = bitmap->hint = 0;
+}
+
+void bitmapGrow(Bitmap* bitmap, size_t bitCount) {
+    if (bitCount <= bitmap->bitCount) {
+        return;
+    }
+    size_t wordCount = (bitCount + BITS_PER_WORD - 1) / BITS_PER_WORD;
+    if (wordCount > bitmap->wordCount) {
+        bitmap->words = (unsigned long long*)realloc(bitmap->words, wordCount * sizeof(unsigned long long));
+        memset(bitmap->words + bitmap->wordCount, 0, (wordCount - bitmap->wordCount) * sizeof(unsigned long long));
+        bitmap->wordCount = wordCount;
+    }
+    bitmap->bitCount = bitCount;
+}
+
+void bitmapClearAll(Bitmap* bitmap) {
+    memset(bitmap->words, 0, bitmap->wordCount * sizeof(unsigned long long));
+    bitmap->setCount = 0;
+    bitmap->hint = 0;
+}
+
+// 마지막 워드에서 bitCount를 넘는 비트는 사용 중인 것으로 취급한다.
+static unsigned long long freeBitsOf(const Bitmap* bitmap, size_t word) {
+    unsigned long long freeBits = ~bitmap->words[word];
+    if (word == bitmap->wordCount - 1 && bitmap->bitCount % BITS_PER_WORD != 0) {
+        freeBits &= (1ULL << (bitmap->bitCount % BITS_PER_WORD)) - 1;
+    }
+    return freeBits;
+}
+
+long bitmapAllocate(Bitmap* bitmap) {
+    for (size_t n = 0; n < bitmap->wordCount; n++) {
+        size_t word = bitmap->hint + n;
+        if (word >= bitmap->wordCount) {
+            word -= bitmap->wordCount;
+        }
+        unsigned long long freeBits = freeBitsOf(bitmap, word);
+        if (freeBits != 0) {
+            int bit = __builtin_ctzll(freeBits);
+            bitmap->words[word] |= 1ULL << bit;
+            bitmap->setCount++;
+            bitmap->hint = word;
+            return (long)(word * BITS_PER_WORD + bit);
+        }
+    }
+    return -1;
+}
+
+void bitmapSet(Bitmap* bitmap, size_t bit) {
+    if (!bitmapTest(bitmap, bit)) {
+        bitmap->words[bit / BITS_PER_WORD] |= 1ULL << (bit % BITS_PER_WORD);
+        bitmap->setCount++;
+    }
+}
+
+void bitmapClear(Bitmap* bitmap, size_t bit) {
+    if (bitmapTest(bitmap, bit)) {
+        bitmap->words[bit / BITS_PER_WORD] &= ~(1ULL << (bit % BITS_PER_WORD));
+        bitmap->setCount--;
+    }
+}
+
+bool bitmapTest(const Bitmap* bitmap, size_t bit) {
+    if (bit >= bitmap->bitCount) {
+        return false;
+    }
+    return (bitmap->words[bit / BITS_PER_WORD] >> (bit % BITS_PER_WORD)) & 1;
+}
@@ -0,0 +1,186 @@
+#include <string.h>
+#include "lz4.h"
+
+#define MIN_MATCH 4
+#define LAST_LITERALS 5 // 블록 끝 5바이트는 항상 리터럴로 둔다
+#define MATCH_LIMIT 12 // 마지막 일치는 블록 끝에서 12바이트 앞에서 시작해야 한다
+#define MAX_DISTANCE 65535
+#define SKIP_TRIGGER 6 // 일치를 못 찾을수록 건너뛰는 폭을 늘린다 (압축이 안 되는 데이터에서 빨리 지나간다)
+
+static unsigned int read32(const unsigned char* p) {
+    unsigned int value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static unsigned int hashSequence(unsigned int sequence) {
+    return (sequence * 2654435761u) >> (32 - LZ4_HASH_BITS);
+}
+
+// 255 단위로 이어지는 추가 길이를 쓴다
+static unsigned char* writeLength(unsigned char* op, int length) {
+    while (length >= 255) {
+        *op++ = 255;
+        length -= 255;
+    }
+    *op++ = (unsigned char)length;
+    return op;
+}
+
+// 리터럴 [anchor, anchor + literals)와 (거리, 길이) 일치 하나를 쓴다. matchLength가 0이면 마지막 리터럴만 쓴다.
+static unsigned char* writeSequence(unsigned char* op, const unsigned char* anchor, int literals, int distance,
+                                    int matchLength) {
+    unsigned char* token = op++;
+    *token = (unsigned char)((literals >= 15 ? 15 : literals) << 4);
+    if (literals >= 15) {
+        op = writeLength(op, literals - 15);
+    }
+    memcpy(op, anchor, literals);
+    op += literals;
+    if (matchLength == 0) {
+        return op;
+    }
+    *op++ = (unsigned char)distance;
+    *op++ = (unsigned char)(distance >> 8);
+    int extra = matchLength - MIN_MATCH;
+    *token |= (unsigned char)(extra >= 15 ? 15 : extra);
+    if (extra >= 15) {
+        op = writeLength(op, extra - 15);
+    }
+    return op;
+}
+
+// 리터럴 literals개와 일치 하나를 쓸 때 필요한 최대 바이트 수
+static int sequenceBound(int literals) {
+    return 1 + literals / 255 + 1 + literals + 2 + 1;
+}
+
+int lz4Compress(const char* src, int srcSize, char* dst, int dstCapacity) {
+    const unsigned char* base = (const unsigned char*)src;
+    const unsigned char* ip = base;
+    const unsigned char* anchor = base;
+    const unsigned char* end = base + srcSize;
+    unsigned char* op = (unsigned char*)dst;
+    unsigned char* outEnd = op + dstCapacity;
+    unsigned int table[1 << LZ4_HASH_BITS]; // 위치 + 1, 0이면 비어 있다
+    memset(table, 0, sizeof(table));
+
+    if (srcSize >= MATCH_LIMIT + 1) {
+        const unsigned char* matchStartLimit = end - MATCH_LIMIT;
+        const unsigned char* matchEndLimit = end - LAST_LITERALS;
+        unsigned int misses = 1 << SKIP_TRIGGER;
+        while (ip < matchStartLimit) {
+            unsigned int sequence = read32(ip);
+            unsigned int hash = hashSequence(sequence);
+            unsigned int candidate = table[hash];
+            table[hash] = (unsigned int)(ip - base) + 1;
+            const unsigned char* ref = base + candidate - 1;
+            if (candidate == 0 || ip - ref > MAX_DISTANCE || read32(ref) != sequence) {
+                ip += misses++ >> SKIP_TRIGGER;
+                continue;
+            }
+            misses = 1 << SKIP_TRIGGER;
+            // 앞쪽으로 늘릴 수 있으면 늘린다
+            while (ip > anchor && ref > base && ip[-1] == ref[-1]) {
+                ip--;
+                ref--;
+            }
+            const unsigned char* matchEnd = ip + MIN_MATCH;
+            const unsigned char* refEnd = ref + MIN_MATCH;
+            while (matchEnd < matchEndLimit && *matchEnd == *refEnd) {
+                matchEnd++;
+                refEnd++;
+            }
+            int literals = (int)(ip - anchor);
+            int matchLength = (int)(matchEnd - ip);
+            if (outEnd - op < sequenceBound(literals) + matchLength / 255) {
+                return 0;
+            }
+            op = writeSequence(op, anchor, literals, (int)(ip - ref), matchLength);
+            ip = matchEnd;
+            anchor = ip;
+            if (ip < matchStartLimit) {
+                table[hashSequence(read32(ip - 2))] = (unsigned int)(ip - 2 - base) + 1;
+            }
+        }
+    }
+
+    int literals = (int)(end - anchor);
+    if (outEnd - op < sequenceBound(literals)) {
+        return 0;
+    }
+    op = writeSequence(op, anchor, literals, 0, 0);
+    return (int)(op - (unsigned char*)dst);
+}
+
+// 255 단위 추가 길이를 읽는다. 입력이 끝나면 -1
+static int readLength(const unsigned char** ip, const unsigned char* end) {
+    int length = 0;
+    unsigned char byte;
+    do {
+        if (*ip >= end) {
+            return -1;
+        }
+        byte = *(*ip)++;
+        length += byte;
+    } while (byte == 255);
+    return length;
+}
+
+int lz4Decompress(const char* src, int srcSize, char* dst, int dstCapacity) {
+    const unsigned char* ip = (const unsigned char*)src;
+    const unsigned char* end = ip + srcSize;
+    unsigned char* start = (unsigned char*)dst;
+    unsigned char* op = start;
+    unsigned char* outEnd = op + dstCapacity;
+    while (ip < end) {
+        unsigned char token = *ip++;
+        int literals = token >> 4;
+        if (literals == 15) {
+            int extra = readLength(&ip, end);
+            if (extra < 0) {
+                return -1;
+            }
+            literals += extra;
+        }
+        if (end - ip < literals || outEnd - op < literals) {
+            return -1;
+        }
+        memcpy(op, ip, literals);
+        ip += literals;
+        op += literals;
+        if (ip == end) {
+            break; // 마지막 시퀀스는 리터럴만 있다
+        }
+        if (end - ip < 2) {
+            return -1;
+        }
+        int distance = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (distance == 0 || distance > op - start) {
+            return -1;
+        }
+        int matchLength = token & 15;
+        if (matchLength == 15) {
+            int extra = readLength(&ip, end);
+            if (extra < 0) {
+                return -1;
+            }
+            matchLength += extra;
+        }
+        matchLength += MIN_MATCH;
+        if (outEnd - op < matchLength) {
+            return -1;
+        }
+        const unsigned char* match = op - distance;
+        if (distance >= matchLength) {
+            memcpy(op, match, matchLength);
+            op += matchLength;
+        } else {
+            while (matchLength-- > 0) { // 겹치는 복사 (반복 패턴)
+                *op++ = *match++;
+            }
+        }
+    }
+    return (int)(op - start);
+}
@@ -0,0 +1,111 @@
+#include <sched.h>
+#include "rwlock.h"
+
+#define DIR_LOCK_WRITER 0x80000000u
+#define DIR_LOCK_PENDING 0x40000000u // 기다리는 writer가 있으면 새 reader는 들어오지 않는다
+#define SPINS_BEFORE_YIELD 64
+
+static void backoff(int* spins) {
+    if (++*spins < SPINS_BEFORE_YIELD) {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    } else {
+        *spins = 0;
+        sched_yield();
+    }
+}
+
+void dirLockInit(DirLock* lock) {
+    lock->state = 0;
+    lock->sequence = 0;
+}
+
+void dirReadLock(DirLock* lock) {
+    int spins = 0;
+    while (1) {
+        unsigned int state = __atomic_load_n(&lock->state, __ATOMIC_RELAXED);
+        if ((state & (DIR_LOCK_WRITER | DIR_LOCK_PENDING)) == 0 &&
+            __atomic_compare_exchange_n(&lock->state, &state, state + 1, true, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            return;
+        }
+        backoff(&spins);
+    }
+}
+
+void dirReadUnlock(DirLock* lock) {
+    __atomic_fetch_sub(&lock->state, 1, __ATOMIC_RELEASE);
+}
+
+void dirWriteLock(DirLock* lock) {
+    int spins = 0;
+    while (1) {
+        unsigned int state = __atomic_load_n(&lock->state, __ATOMIC_RELAXED);
+        if ((state & ~DIR_LOCK_PENDING) == 0) {
+            if (__atomic_compare_exchange_n(&lock->state, &state, DIR_LOCK_WRITER, true, __ATOMIC_ACQUIRE,
+                                            __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if ((state & DIR_LOCK_PENDING) == 0) {
+            __atomic_fetch_or(&lock->state, DIR_LOCK_PENDING, __ATOMIC_RELAXED);
+        }
+        backoff(&spins);
+    }
+    __atomic_store_n(&lock->sequence, lock->sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+void dirWriteUnlock(DirLock* lock) {
+    __atomic_store_n(&lock->sequence, lock->sequence + 1, __ATOMIC_RELEASE);
+    __atomic_fetch_and(&lock->state, ~DIR_LOCK_WRITER, __ATOMIC_RELEASE);
+}
+
+// 스레드마다 처음 잠글 때 슬롯을 하나 정해 둔다.
+static int readerSlot(void) {
+    static unsigned int nextSlot;
+    static __thread int slot = -1;
+    if (slot < 0) {
+        slot = (int)(__atomic_fetch_add(&nextSlot, 1, __ATOMIC_RELAXED) % BRLOCK_SLOTS);
+    }
+    return slot;
+}
+
+void brReadLock(BigReaderLock* lock) {
+    BrlockSlot* slot = &lock->slots[readerSlot()];
+    int spins = 0;
+    while (1) {
+        __atomic_fetch_add(&slot->readers, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&lock->writer, __ATOMIC_SEQ_CST) == 0) {
+            return;
+        }
+        // writer가 있으면 물러났다가 끝날 때까지 기다린다
+        __atomic_fetch_sub(&slot->readers, 1, __ATOMIC_RELEASE);
+        while (__atomic_load_n(&lock->writer, __ATOMIC_ACQUIRE) != 0) {
+            backoff(&spins);
+        }
+    }
+}
+
+void brReadUnlock(BigReaderLock* lock) {
+    __atomic_fetch_sub(&lock->slots[readerSlot()].readers, 1, __ATOMIC_RELEASE);
+}
+
+void brWriteLock(BigReaderLock* lock) {
+    int spins = 0;
+    unsigned int expected = 0;
+    while (!__atomic_compare_exchange_n(&lock->writerMutex, &expected, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        expected = 0;
+        backoff(&spins);
+    }
+    __atomic_store_n(&lock->writer, 1, __ATOMIC_SEQ_CST);
+    for (int i = 0; i < BRLOCK_SLOTS; i++) {
+        while (__atomic_load_n(&lock->slots[i].readers, __ATOMIC_SEQ_CST) != 0) {
+            backoff(&spins);
+        }
+    }
+}
+
+void brWriteUnlock(BigReaderLock* lock) {
+    __atomic_store_n(&lock->writer, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&lock->writerMutex, 0, __ATOMIC_RELEASE);
+}
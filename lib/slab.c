@@ -0,0 +1,109 @@
+#include <stdlib.h>
+#include "slab.h"
+
+#define SLAB_ALIGN 16
+
+typedef struct Slab {
+    struct Slab* next;
+    size_t padding; // 객체 영역을 16바이트 경계에 맞춘다
+} Slab;
+
+static char* slabObjects(Slab* slab) {
+    return (char*)slab + sizeof(Slab);
+}
+
+void slabCacheInit(SlabCache* cache, const char* name, size_t objectSize, size_t objectsPerSlab) {
+    if (objectSize < sizeof(void*)) {
+        objectSize = sizeof(void*);
+    }
+    pthread_mutex_init(&cache->lock, NULL);
+    cache->name = name;
+    cache->objectSize = (objectSize + SLAB_ALIGN - 1) & ~(size_t)(SLAB_ALIGN - 1);
+    cache->objectsPerSlab = objectsPerSlab;
+    cache->freeList = NULL;
+    cache->slabs = NULL;
+    cache->carved = 0;
+    cache->stats = (SlabStats){0};
+}
+
+static void noteAllocation(SlabCache* cache) {
+    cache->stats.allocations++;
+    cache->stats.inUse++;
+    if (cache->stats.inUse > cache->stats.peakInUse) {
+        cache->stats.peakInUse = cache->stats.inUse;
+    }
+}
+
+void* slabAlloc(SlabCache* cache) {
+    pthread_mutex_lock(&cache->lock);
+    if (cache->freeList != NULL) {
+        void* object = cache->freeList;
+        cache->freeList = *(void**)object;
+        noteAllocation(cache);
+        pthread_mutex_unlock(&cache->lock);
+        return object;
+    }
+    if (cache->slabs == NULL || cache->carved == cache->objectsPerSlab) {
+        size_t bytes = sizeof(Slab) + cache->objectSize * cache->objectsPerSlab;
+        Slab* slab = (Slab*)malloc(bytes);
+        if (slab == NULL) {
+            pthread_mutex_unlock(&cache->lock);
+            return NULL;
+        }
+        slab->next = cache->slabs;
+        cache->slabs = slab;
+        cache->carved = 0;
+        cache->stats.slabCount++;
+        cache->stats.bytesReserved += bytes;
+    }
+    void* object = slabObjects(cache->slabs) + cache->objectSize * cache->carved++;
+    noteAllocation(cache);
+    pthread_mutex_unlock(&cache->lock);
+    return object;
+}
+
+void slabFree(SlabCache* cache, void* object) {
+    pthread_mutex_lock(&cache->lock);
+    *(void**)object = cache->freeList;
+    cache->freeList = object;
+    cache->stats.frees++;
+    cache->stats.inUse--;
+    pthread_mutex_unlock(&cache->lock);
+}
+
+void slabFreeChain(SlabCache* cache, void* head, void* tail, unsigned long count) {
+    if (head == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&cache->lock);
+    *(void**)tail = cache->freeList;
+    cache->freeList = head;
+    cache->stats.frees += count;
+    cache->stats.inUse -= count;
+    cache->stats.bulkReleases++;
+    pthread_mutex_unlock(&cache->lock);
+}
+
+void slabReleaseAll(SlabCache* cache) {
+    Slab* slab = cache->slabs;
+    while (slab != NULL) {
+        Slab* next = slab->next;
+        free(slab);
+        slab = next;
+    }
+    cache->stats.frees += cache->stats.inUse;
+    cache->stats.inUse = 0;
+    cache->stats.slabCount = 0;
+    cache->stats.bytesReserved = 0;
+    cache->stats.bulkReleases++;
+    cache->slabs = NULL;
+    cache->freeList = NULL;
+    cache->carved = 0;
+}
+
+SlabStats slabGetStats(SlabCache* cache) {
+    pthread_mutex_lock(&cache->lock);
+    SlabStats stats = cache->stats;
+    pthread_mutex_unlock(&cache->lock);
+    return stats;
+}
@@ -0,0 +1,187 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "strpool.h"
+
+#define HEADER_BYTES 5 // 참조 수 + 길이
+
+static unsigned int* refsOf(const char* string) {
+    return (unsigned int*)(string - HEADER_BYTES);
+}
+
+// 칸 크기 (8바이트 단위)
+static size_t slotUnits(size_t length) {
+    return (HEADER_BYTES + length + 1 + 7) / 8;
+}
+
+static unsigned int hashString(const char* string, size_t length) {
+    unsigned int hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)string[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+void stringPoolInit(StringPool* pool) {
+    memset(pool, 0, sizeof(*pool));
+    pthread_mutex_init(&pool->lock, NULL);
+}
+
+static void tablePut(StringPool* pool, const char* string) {
+    size_t slot = hashString(string, stringPoolLength(string)) & pool->tableMask;
+    while (pool->table[slot] != NULL) {
+        slot = (slot + 1) & pool->tableMask;
+    }
+    pool->table[slot] = string;
+}
+
+// 부하율을 1/2 이하로 유지한다.
+static void tableGrow(StringPool* pool) {
+    const char** old = pool->table;
+    size_t oldSlots = old == NULL ? 0 : pool->tableMask + 1;
+    size_t slots = oldSlots == 0 ? 1024 : oldSlots * 2;
+    pool->table = (const char**)calloc(slots, sizeof(const char*));
+    pool->tableMask = slots - 1;
+    for (size_t i = 0; i < oldSlots; i++) {
+        if (old[i] != NULL) {
+            tablePut(pool, old[i]);
+        }
+    }
+    free(old);
+    pool->stats.bytesReserved += (slots - oldSlots) * sizeof(const char*);
+}
+
+static long tableFind(const StringPool* pool, const char* string, size_t length, unsigned int hash) {
+    if (pool->table == NULL) {
+        return -1;
+    }
+    for (size_t slot = hash & pool->tableMask; pool->table[slot] != NULL; slot = (slot + 1) & pool->tableMask) {
+        const char* candidate = pool->table[slot];
+        if (stringPoolLength(candidate) == length && memcmp(candidate, string, length) == 0) {
+            return (long)slot;
+        }
+    }
+    return -1;
+}
+
+// 툼스톤 없이 지운다: 뒤에 이어지는 항목 중 원래 자리로 보아 빈 칸 앞에 있어야 하는 항목을 당겨 온다.
+static void tableRemove(StringPool* pool, size_t hole) {
+    size_t slot = hole;
+    while (1) {
+        slot = (slot + 1) & pool->tableMask;
+        if (pool->table[slot] == NULL) {
+            break;
+        }
+        size_t home = hashString(pool->table[slot], stringPoolLength(pool->table[slot])) & pool->tableMask;
+        bool movable = hole <= slot ? (home <= hole || home > slot) : (home <= hole && home > slot);
+        if (movable) {
+            pool->table[hole] = pool->table[slot];
+            hole = slot;
+        }
+    }
+    pool->table[hole] = NULL;
+}
+
+// units * 8바이트 칸을 빈 칸 목록이나 마지막 청크에서 잘라 온다.
+static char* carveSlot(StringPool* pool, size_t units) {
+    char* slot = pool->freeLists[units];
+    if (slot != NULL) {
+        memcpy(&pool->freeLists[units], slot, sizeof(char*));
+        memset(slot, 0, units * 8);
+        return slot;
+    }
+    size_t bytes = units * 8;
+    if (pool->chunkCount == 0 || pool->carved + bytes > STRPOOL_CHUNK_BYTES - STRPOOL_SLACK) {
+        if (pool->chunkCount == pool->chunkCapacity) {
+            pool->chunkCapacity = pool->chunkCapacity == 0 ? 16 : pool->chunkCapacity * 2;
+            pool->chunks = (char**)realloc(pool->chunks, pool->chunkCapacity * sizeof(char*));
+        }
+        char* chunk = (char*)calloc(1, STRPOOL_CHUNK_BYTES);
+        if (chunk == NULL) {
+            return NULL;
+        }
+        pool->chunks[pool->chunkCount++] = chunk;
+        pool->carved = 0;
+        pool->stats.bytesReserved += STRPOOL_CHUNK_BYTES;
+    }
+    slot = pool->chunks[pool->chunkCount - 1] + pool->carved;
+    pool->carved += bytes;
+    return slot;
+}
+
+const char* stringPoolIntern(StringPool* pool, const char* string) {
+    size_t length = strlen(string);
+    if (length > STRPOOL_MAX_LENGTH) {
+        return NULL;
+    }
+    unsigned int hash = hashString(string, length);
+    pthread_mutex_lock(&pool->lock);
+    long found = tableFind(pool, string, length, hash);
+    if (found >= 0) {
+        const char* existing = pool->table[found];
+        (*refsOf(existing))++;
+        pool->stats.references++;
+        pool->stats.hits++;
+        pthread_mutex_unlock(&pool->lock);
+        return existing;
+    }
+    if (pool->table == NULL || (pool->stats.strings + 1) * 2 > pool->tableMask + 1) {
+        tableGrow(pool);
+    }
+    size_t units = slotUnits(length);
+    char* slot = carveSlot(pool, units);
+    if (slot == NULL) {
+        pthread_mutex_unlock(&pool->lock);
+        return NULL;
+    }
+    char* interned = slot + HEADER_BYTES;
+    *refsOf(interned) = 1;
+    interned[-1] = (char)length;
+    memcpy(interned, string, length);
+    interned[length] = '\0';
+    tablePut(pool, interned);
+    pool->stats.strings++;
+    pool->stats.references++;
+    pool->stats.bytesUsed += units * 8;
+    pthread_mutex_unlock(&pool->lock);
+    return interned;
+}
+
+void stringPoolRelease(StringPool* pool, const char* string) {
+    if (string == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&pool->lock);
+    pool->stats.references--;
+    if (--(*refsOf(string)) > 0) {
+        pthread_mutex_unlock(&pool->lock);
+        return;
+    }
+    size_t length = stringPoolLength(string);
+    tableRemove(pool, (size_t)tableFind(pool, string, length, hashString(string, length)));
+    size_t units = slotUnits(length);
+    char* slot = (char*)string - HEADER_BYTES;
+    memcpy(slot, &pool->freeLists[units], sizeof(char*));
+    pool->freeLists[units] = slot;
+    pool->stats.strings--;
+    pool->stats.bytesUsed -= units * 8;
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void stringPoolReset(StringPool* pool) {
+    for (int i = 0; i < pool->chunkCount; i++) {
+        free(pool->chunks[i]);
+    }
+    free(pool->chunks);
+    free(pool->table);
+    pthread_mutex_destroy(&pool->lock);
+    stringPoolInit(pool);
+}
+
+StringPoolStats stringPoolGetStats(StringPool* pool) {
+    pthread_mutex_lock(&pool->lock);
+    StringPoolStats stats = pool->stats;
+    pthread_mutex_unlock(&pool->lock);
+    return stats;
+}
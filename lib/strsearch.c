@@ -0,0 +1,188 @@
+#include <string.h>
+#include "strsearch.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define STRSEARCH_X86 1
+#include <immintrin.h>
+#endif
+
+typedef const char* (*SearchFunction)(const char*, size_t, const char*, size_t);
+
+// 첫 바이트를 memchr로 찾고 나머지를 비교한다.
+const char* memsearchScalar(const char* haystack, size_t haystackLength, const char* needle, size_t needleLength) {
+    if (needleLength == 0) {
+        return haystack;
+    }
+    if (needleLength > haystackLength) {
+        return NULL;
+    }
+    const char* end = haystack + haystackLength - needleLength + 1; // 후보 시작 위치의 끝
+    const char* p = haystack;
+    while (p < end) {
+        p = (const char*)memchr(p, needle[0], end - p);
+        if (p == NULL) {
+            return NULL;
+        }
+        if (memcmp(p + 1, needle + 1, needleLength - 1) == 0) {
+            return p;
+        }
+        p++;
+    }
+    return NULL;
+}
+
+#ifdef STRSEARCH_X86
+// 후보 비트마스크의 위치마다 가운데 부분을 비교한다. 벡터 루프 안에 함수 호출이 없어야
+// 레지스터에 둔 비교 벡터가 스택으로 밀려나지 않으므로 따로 떼어 둔다.
+__attribute__((noinline))
+static const char* verifyCandidates(const char* block, unsigned int mask, const char* needle, size_t needleLength) {
+    while (mask != 0) {
+        int bit = __builtin_ctz(mask);
+        if (memcmp(block + bit + 1, needle + 1, needleLength - 2) == 0) {
+            return block + bit;
+        }
+        mask &= mask - 1;
+    }
+    return NULL;
+}
+
+// 첫 바이트와 마지막 바이트를 벡터 전체에 복제해 두고, 후보 위치마다 두 바이트가
+// 모두 맞는 곳만 골라 가운데 부분을 memcmp로 확인한다.
+static const char* memsearchSse2(const char* haystack, size_t haystackLength, const char* needle, size_t needleLength) {
+    if (needleLength < 2 || needleLength > haystackLength) {
+        return memsearchScalar(haystack, haystackLength, needle, needleLength);
+    }
+    size_t candidates = haystackLength - needleLength + 1;
+    size_t i = 0;
+    while (i + 16 <= candidates) {
+        const __m128i first = _mm_set1_epi8(needle[0]);
+        const __m128i last = _mm_set1_epi8(needle[needleLength - 1]);
+        unsigned int mask = 0;
+        for (; i + 16 <= candidates; i += 16) {
+            __m128i blockFirst = _mm_loadu_si128((const __m128i*)(haystack + i));
+            __m128i blockLast = _mm_loadu_si128((const __m128i*)(haystack + i + needleLength - 1));
+            mask = (unsigned int)_mm_movemask_epi8(
+                _mm_and_si128(_mm_cmpeq_epi8(blockFirst, first), _mm_cmpeq_epi8(blockLast, last)));
+            if (mask != 0) {
+                break;
+            }
+        }
+        if (mask == 0) {
+            break;
+        }
+        const char* found = verifyCandidates(haystack + i, mask, needle, needleLength);
+        if (found != NULL) {
+            return found;
+        }
+        i += 16;
+    }
+    return memsearchScalar(haystack + i, haystackLength - i, needle, needleLength);
+}
+
+__attribute__((target("avx2")))
+static const char* memsearchAvx2(const char* haystack, size_t haystackLength, const char* needle, size_t needleLength) {
+    if (needleLength < 2 || needleLength > haystackLength) {
+        return memsearchScalar(haystack, haystackLength, needle, needleLength);
+    }
+    size_t candidates = haystackLength - needleLength + 1;
+    size_t i = 0;
+    while (i + 32 <= candidates) {
+        const __m256i first = _mm256_set1_epi8(needle[0]);
+        const __m256i last = _mm256_set1_epi8(needle[needleLength - 1]);
+        unsigned int mask = 0;
+        // 64바이트씩 두 벡터를 함께 비교하고, 둘 다 후보가 없으면 바로 넘어간다
+        for (; i + 64 <= candidates; i += 64) {
+            __m256i eq0 = _mm256_and_si256(
+                _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(haystack + i)), first),
+                _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(haystack + i + needleLength - 1)), last));
+            __m256i eq1 = _mm256_and_si256(
+                _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(haystack + i + 32)), first),
+                _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(haystack + i + 32 + needleLength - 1)), last));
+            if (!_mm256_testz_si256(_mm256_or_si256(eq0, eq1), _mm256_or_si256(eq0, eq1))) {
+                break;
+            }
+        }
+        for (; i + 32 <= candidates; i += 32) {
+            __m256i blockFirst = _mm256_loadu_si256((const __m256i*)(haystack + i));
+            __m256i blockLast = _mm256_loadu_si256((const __m256i*)(haystack + i + needleLength - 1));
+            mask = (unsigned int)_mm256_movemask_epi8(
+                _mm256_and_si256(_mm256_cmpeq_epi8(blockFirst, first), _mm256_cmpeq_epi8(blockLast, last)));
+            if (mask != 0) {
+                break;
+            }
+        }
+        if (mask == 0) {
+            break;
+        }
+        const char* found = verifyCandidates(haystack + i, mask, needle, needleLength);
+        if (found != NULL) {
+            return found;
+        }
+        i += 32;
+    }
+    return memsearchSse2(haystack + i, haystackLength - i, needle, needleLength);
+}
+#endif
+
+// 처음 고를 때 여러 스레드가 함께 들어올 수 있으므로 포인터 하나만 __atomic으로 읽고 쓴다.
+// 이름은 따로 두지 않고 선택된 함수에서 얻는다.
+static SearchFunction selected;
+
+static SearchFunction implementationByName(const char* name) {
+    if (strcmp(name, "scalar") == 0) {
+        return memsearchScalar;
+    }
+#ifdef STRSEARCH_X86
+    __builtin_cpu_init();
+    if (strcmp(name, "sse2") == 0 && __builtin_cpu_supports("sse2")) {
+        return memsearchSse2;
+    }
+    if (strcmp(name, "avx2") == 0 && __builtin_cpu_supports("avx2")) {
+        return memsearchAvx2;
+    }
+#endif
+    return NULL;
+}
+
+static SearchFunction selectImplementation(void) {
+    SearchFunction function = __atomic_load_n(&selected, __ATOMIC_ACQUIRE);
+    if (function != NULL) {
+        return function;
+    }
+    function = implementationByName("avx2");
+    if (function == NULL) {
+        function = implementationByName("sse2");
+    }
+    if (function == NULL) {
+        function = memsearchScalar;
+    }
+    // 모든 스레드가 같은 결과를 고르므로 누가 먼저 써도 상관없다
+    __atomic_store_n(&selected, function, __ATOMIC_RELEASE);
+    return function;
+}
+
+const char* memsearch(const char* haystack, size_t haystackLength, const char* needle, size_t needleLength) {
+    return selectImplementation()(haystack, haystackLength, needle, needleLength);
+}
+
+bool memsearchSelect(const char* name) {
+    SearchFunction function = implementationByName(name);
+    if (function == NULL) {
+        return false;
+    }
+    __atomic_store_n(&selected, function, __ATOMIC_RELEASE);
+    return true;
+}
+
+const char* memsearchImplementation(void) {
+    SearchFunction function = selectImplementation();
+#ifdef STRSEARCH_X86
+    if (function == memsearchAvx2) {
+        return "avx2";
+    }
+    if (function == memsearchSse2) {
+        return "sse2";
+    }
+#endif
+    return "scalar";
+}
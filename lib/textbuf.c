@@ -0,0 +1,61 @@
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include "textbuf.h"
+
+#define TEXT_INITIAL_CAPACITY 256
+
+void textInit(TextBuffer* text) {
+    text->data = NULL;
+    text->length = 0;
+    text->capacity = 0;
+}
+
+void textFree(TextBuffer* text) {
+    free(text->data);
+    textInit(text);
+}
+
+static void reserve(TextBuffer* text, size_t needed) {
+    if (needed <= text->capacity) {
+        return;
+    }
+    size_t capacity = text->capacity == 0 ? TEXT_INITIAL_CAPACITY : text->capacity;
+    while (capacity < needed) {
+        capacity *= 2;
+    }
+    text->data = (char*)realloc(text->data, capacity);
+    text->capacity = capacity;
+}
+
+void textAppend(TextBuffer* text, const char* data, size_t length) {
+    reserve(text, text->length + length);
+    memcpy(text->data + text->length, data, length);
+    text->length += length;
+}
+
+// 남은 자리에 바로 써 보고, 모자라면 늘려서 한 번 더 쓴다.
+void textPrintf(TextBuffer* text, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    size_t available = text->capacity - text->length;
+    int written = vsnprintf(available > 0 ? text->data + text->length : NULL, available, format, args);
+    va_end(args);
+    if (written < 0) {
+        return;
+    }
+    if ((size_t)written >= available) {
+        reserve(text, text->length + written + 1);
+        va_start(args, format);
+        vsnprintf(text->data + text->length, written + 1, format, args);
+        va_end(args);
+    }
+    text->length += written;
+}
+
+void textFlush(TextBuffer* text, FILE* out) {
+    if (text->length > 0) {
+        fwrite(text->data, 1, text->length, out);
+        text->length = 0;
+    }
+}
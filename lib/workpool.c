@@ -0,0 +1,241 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "workpool.h"
+
+// 작업자 하나의 덱. 실행 중에는 새 작업을 넣지 않으므로 내용을 배열에 담지 않고,
+// 위치 p의 작업 번호를 last - p로 계산한다. 주인은 bottom 쪽(작은 번호)부터 꺼내고
+// 훔치는 쪽은 top 쪽(큰 번호)부터 가져간다.
+typedef struct WorkDeque {
+    long top;
+    long bottom;
+    long last;
+} __attribute__((aligned(64))) WorkDeque;
+
+typedef enum { STEAL_EMPTY, STEAL_OK, STEAL_ABORT } StealResult;
+
+static struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t wake; // 작업 스레드: 새 실행이 시작됨
+    pthread_cond_t idle; // 부른 스레드: 실행에 들어온 작업 스레드가 모두 나감
+    pthread_t threads[WORKPOOL_MAX_THREADS];
+    int threadCount; // 부른 스레드를 포함한 작업자 수 (0이면 아직 만들기 전)
+    bool stopping;
+    bool active; // 실행 중이며 작업 스레드가 들어올 수 있음
+    unsigned long epoch; // 실행마다 1씩 오른다
+    int busy; // 이번 실행에 들어와 있는 작업 스레드 수
+    WorkFn fn;
+    void* context;
+    WorkDeque deques[WORKPOOL_MAX_THREADS];
+} pool = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER};
+
+// 한 번에 한 실행만 풀을 쓴다. 잡지 못하면 부른 스레드 혼자 실행한다.
+static pthread_mutex_t runLock = PTHREAD_MUTEX_INITIALIZER;
+static __thread bool insideRun; // 작업 스레드이거나 실행 중인 부른 스레드
+static void (*threadExit)(void); // 작업 스레드가 끝나기 직전에 부른다
+
+static bool takeOwn(WorkDeque* deque, long* index) {
+    long bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED) - 1;
+    __atomic_store_n(&deque->bottom, bottom, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    long top = __atomic_load_n(&deque->top, __ATOMIC_RELAXED);
+    if (top > bottom) {
+        __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+        return false;
+    }
+    *index = deque->last - bottom;
+    if (top < bottom) {
+        return true;
+    }
+    // 마지막 하나는 훔치는 쪽과 top을 두고 다툰다
+    bool won = __atomic_compare_exchange_n(&deque->top, &top, top + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+    __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+    return won;
+}
+
+static StealResult steal(WorkDeque* deque, long* index) {
+    long top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    long bottom = __atomic_load_n(&deque->bottom, __ATOMIC_ACQUIRE);
+    if (top >= bottom) {
+        return STEAL_EMPTY;
+    }
+    *index = deque->last - top;
+    if (!__atomic_compare_exchange_n(&deque->top, &top, top + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+        return STEAL_ABORT;
+    }
+    return STEAL_OK;
+}
+
+// 실행 중에는 덱에 작업이 늘지 않으므로 모든 덱이 비어 있으면 더 할 일이 없다.
+static bool stealAny(int self, unsigned int* seed, long* index) {
+    int count = pool.threadCount;
+    while (1) {
+        bool contended = false;
+        *seed = *seed * 1103515245u + 12345u;
+        int start = (int)((*seed >> 16) % (unsigned int)count);
+        for (int i = 0; i < count; i++) {
+            int victim = (start + i) % count;
+            if (victim == self) {
+                continue;
+            }
+            StealResult result = steal(&pool.deques[victim], index);
+            if (result == STEAL_OK) {
+                return true;
+            }
+            contended |= result == STEAL_ABORT;
+        }
+        if (!contended) {
+            return false;
+        }
+    }
+}
+
+static void runWorker(int self) {
+    unsigned int seed = (unsigned int)self * 2654435761u + 1;
+    long index;
+    while (takeOwn(&pool.deques[self], &index) || stealAny(self, &seed, &index)) {
+        pool.fn(pool.context, index);
+    }
+}
+
+static void* workerLoop(void* argument) {
+    int self = (int)(long)argument;
+    insideRun = true; // 작업 안에서 다시 부르면 혼자 실행한다
+    unsigned long seen = 0;
+    pthread_mutex_lock(&pool.mutex);
+    while (1) {
+        while (!pool.stopping && !(pool.active && pool.epoch != seen)) {
+            pthread_cond_wait(&pool.wake, &pool.mutex);
+        }
+        if (pool.stopping) {
+            break;
+        }
+        seen = pool.epoch;
+        pool.busy++;
+        pthread_mutex_unlock(&pool.mutex);
+
+        runWorker(self);
+
+        pthread_mutex_lock(&pool.mutex);
+        if (--pool.busy == 0) {
+            pthread_cond_signal(&pool.idle);
+        }
+    }
+    pthread_mutex_unlock(&pool.mutex);
+    if (threadExit != NULL) {
+        threadExit();
+    }
+    return NULL;
+}
+
+static int configuredThreads() {
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    const char* value = getenv("MINIOS_THREADS");
+    if (value != NULL && value[0] != '\0') {
+        char* end;
+        long parsed = strtol(value, &end, 10);
+        if (*end == '\0' && parsed > 0) {
+            threads = parsed;
+        }
+    }
+    if (threads < 1) {
+        threads = 1;
+    }
+    return threads > WORKPOOL_MAX_THREADS ? WORKPOOL_MAX_THREADS : (int)threads;
+}
+
+// runLock을 쥔 채로 부른다.
+static void startPool() {
+    int threads = configuredThreads();
+    int started = 1;
+    while (started < threads && pthread_create(&pool.threads[started], NULL, workerLoop, (void*)(long)started) == 0) {
+        started++;
+    }
+    if (started < threads) {
+        printf("작업 스레드를 만들 수 없습니다. %d개로 실행합니다.\n", started);
+    }
+    __atomic_store_n(&pool.threadCount, started, __ATOMIC_RELEASE);
+}
+
+static void runAlone(long count, WorkFn fn, void* context) {
+    for (long index = 0; index < count; index++) {
+        fn(context, index);
+    }
+}
+
+void workPoolRun(long count, WorkFn fn, void* context) {
+    if (count <= 0) {
+        return;
+    }
+    if (count == 1 || insideRun || pthread_mutex_trylock(&runLock) != 0) {
+        runAlone(count, fn, context);
+        return;
+    }
+    if (pool.threadCount == 0) {
+        startPool();
+    }
+    int workers = pool.threadCount;
+    if (workers == 1) {
+        pthread_mutex_unlock(&runLock);
+        runAlone(count, fn, context);
+        return;
+    }
+    // 작업 번호를 작업자 수만큼 연속 구간으로 나눈다
+    for (int w = 0; w < workers; w++) {
+        long low = count * w / workers;
+        long high = count * (w + 1) / workers;
+        pool.deques[w].top = 0;
+        pool.deques[w].bottom = high - low;
+        pool.deques[w].last = high - 1;
+    }
+    pthread_mutex_lock(&pool.mutex);
+    pool.fn = fn;
+    pool.context = context;
+    pool.active = true;
+    pool.epoch++;
+    pthread_cond_broadcast(&pool.wake);
+    pthread_mutex_unlock(&pool.mutex);
+
+    insideRun = true;
+    runWorker(0);
+    insideRun = false;
+
+    // 덱은 모두 비었지만 들어온 작업 스레드가 마지막 작업을 아직 하고 있을 수 있다.
+    // 늦게 깨어난 스레드는 active가 꺼진 것을 보고 다음 실행을 기다린다.
+    pthread_mutex_lock(&pool.mutex);
+    while (pool.busy > 0) {
+        pthread_cond_wait(&pool.idle, &pool.mutex);
+    }
+    pool.active = false;
+    pthread_mutex_unlock(&pool.mutex);
+    pthread_mutex_unlock(&runLock);
+}
+
+// 작업을 몇 조각으로 나눌지 정할 때 쓴다. 실행 중에도 부를 수 있도록 잠그지 않는다.
+int workPoolThreads() {
+    int threads = __atomic_load_n(&pool.threadCount, __ATOMIC_ACQUIRE);
+    return threads > 0 ? threads : configuredThreads();
+}
+
+void workPoolSetThreadExit(void (*hook)(void)) {
+    threadExit = hook;
+}
+
+void workPoolShutdown() {
+    pthread_mutex_lock(&runLock);
+    if (pool.threadCount > 1) {
+        pthread_mutex_lock(&pool.mutex);
+        pool.stopping = true;
+        pthread_cond_broadcast(&pool.wake);
+        pthread_mutex_unlock(&pool.mutex);
+        for (int i = 1; i < pool.threadCount; i++) {
+            pthread_join(pool.threads[i], NULL);
+        }
+        pool.stopping = false;
+    }
+    __atomic_store_n(&pool.threadCount, 0, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&runLock);
+}
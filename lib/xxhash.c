@@ -0,0 +1,123 @@
+#include <string.h>
+#include "xxhash.h"
+
+#define PRIME1 11400714785074694791ULL
+#define PRIME2 14029467366897019727ULL
+#define PRIME3 1609587929392839161ULL
+#define PRIME4 9650029242287828579ULL
+#define PRIME5 2870177450012600261ULL
+
+static unsigned long long rotateLeft(unsigned long long value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+// 리틀 엔디언 기준으로 읽는다 (x86/ARM 모두 memcpy 한 번으로 끝난다)
+static unsigned long long read64(const unsigned char* p) {
+    unsigned long long value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static unsigned int read32(const unsigned char* p) {
+    unsigned int value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static unsigned long long round64(unsigned long long accumulator, unsigned long long input) {
+    accumulator += input * PRIME2;
+    return rotateLeft(accumulator, 31) * PRIME1;
+}
+
+static unsigned long long mergeRound(unsigned long long hash, unsigned long long lane) {
+    hash ^= round64(0, lane);
+    return hash * PRIME1 + PRIME4;
+}
+
+void xxh64Init(Xxh64State* state, unsigned long long seed) {
+    memset(state, 0, sizeof(*state));
+    state->seed = seed;
+    state->lanes[0] = seed + PRIME1 + PRIME2;
+    state->lanes[1] = seed + PRIME2;
+    state->lanes[2] = seed;
+    state->lanes[3] = seed - PRIME1;
+}
+
+static void consumeStripe(Xxh64State* state, const unsigned char* p) {
+    for (int i = 0; i < 4; i++) {
+        state->lanes[i] = round64(state->lanes[i], read64(p + 8 * i));
+    }
+}
+
+void xxh64Update(Xxh64State* state, const void* data, size_t length) {
+    const unsigned char* p = (const unsigned char*)data;
+    state->total += length;
+    if (state->buffered + length < 32) {
+        memcpy(state->buffer + state->buffered, p, length);
+        state->buffered += length;
+        return;
+    }
+    if (state->buffered > 0) {
+        size_t fill = 32 - state->buffered;
+        memcpy(state->buffer + state->buffered, p, fill);
+        consumeStripe(state, state->buffer);
+        p += fill;
+        length -= fill;
+        state->buffered = 0;
+    }
+    while (length >= 32) {
+        consumeStripe(state, p);
+        p += 32;
+        length -= 32;
+    }
+    memcpy(state->buffer, p, length);
+    state->buffered = length;
+}
+
+unsigned long long xxh64Digest(const Xxh64State* state) {
+    unsigned long long hash;
+    if (state->total >= 32) {
+        const unsigned long long* v = state->lanes;
+        hash = rotateLeft(v[0], 1) + rotateLeft(v[1], 7) + rotateLeft(v[2], 12) + rotateLeft(v[3], 18);
+        for (int i = 0; i < 4; i++) {
+            hash = mergeRound(hash, v[i]);
+        }
+    } else {
+        hash = state->seed + PRIME5;
+    }
+    hash += state->total;
+
+    const unsigned char* p = state->buffer;
+    size_t length = state->buffered;
+    while (length >= 8) {
+        hash ^= round64(0, read64(p));
+        hash = rotateLeft(hash, 27) * PRIME1 + PRIME4;
+        p += 8;
+        length -= 8;
+    }
+    if (length >= 4) {
+        hash ^= (unsigned long long)read32(p) * PRIME1;
+        hash = rotateLeft(hash, 23) * PRIME2 + PRIME3;
+        p += 4;
+        length -= 4;
+    }
+    while (length > 0) {
+        hash ^= (*p++) * PRIME5;
+        hash = rotateLeft(hash, 11) * PRIME1;
+        length--;
+    }
+
+    hash ^= hash >> 33;
+    hash *= PRIME2;
+    hash ^= hash >> 29;
+    hash *= PRIME3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+unsigned long long xxh64(const void* data, size_t length, unsigned long long seed) {
+    Xxh64State state;
+    xxh64Init(&state, seed);
+    xxh64Update(&state, data, length);
+    return xxh64Digest(&state);
+}
@@ -0,0 +1,155 @@
+// memsearch 정확성 테스트 (make test).
+// 구현(scalar, sse2, avx2)을 하나씩 강제로 고르고 strstr과 결과를 비교한다. 이 CPU에서 쓸 수 없는 구현은 건너뛴다.
+// 버퍼 처음과 끝의 일치, 벡터 하나보다 짧은 haystack, 길이 0, 1, 2와 32보다 긴 needle을 따로 훑은 뒤
+// 작은 알파벳으로 만든 무작위 입력을 비교한다. haystack은 딱 맞는 크기로 잡아 끝을 넘는 읽기는 ASAN에 걸린다.
+//
+// 사용법: memsearch_test [--rounds N] [--seed N]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "strsearch.h"
+
+static unsigned long long rngState;
+static long failures;
+
+static unsigned long long nextRandom(void) {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 7;
+    rngState ^= rngState << 17;
+    return rngState;
+}
+
+static long randomBelow(long bound) {
+    return bound <= 0 ? 0 : (long)(nextRandom() % (unsigned long long)bound);
+}
+
+// haystack과 needle은 NUL로 끝나고 중간에 NUL이 없다
+static void check(const char* haystack, const char* needle) {
+    size_t haystackLength = strlen(haystack);
+    size_t needleLength = strlen(needle);
+    const char* expected = strstr(haystack, needle);
+    const char* found = memsearch(haystack, haystackLength, needle, needleLength);
+    if (found != expected) {
+        if (failures++ < 10) {
+            printf("  불일치: haystack(%zu) \"%s\" needle(%zu) \"%s\": 기대 %ld, 결과 %ld\n", haystackLength, haystack,
+                   needleLength, needle, expected != NULL ? (long)(expected - haystack) : -1L,
+                   found != NULL ? (long)(found - haystack) : -1L);
+        }
+    }
+}
+
+// 빈칸 문자로 채운 haystack의 처음, 끝, 가운데에 needle을 넣어 본다.
+static void checkPlacements(char filler, const char* needle) {
+    size_t needleLength = strlen(needle);
+    for (size_t length = 0; length <= 160; length++) {
+        char* haystack = (char*)malloc(length + 1);
+        memset(haystack, filler, length);
+        haystack[length] = '\0';
+        check(haystack, needle);
+        if (needleLength <= length) {
+            size_t positions[] = {0, length - needleLength, (length - needleLength) / 2};
+            for (int i = 0; i < 3; i++) {
+                memset(haystack, filler, length);
+                memcpy(haystack + positions[i], needle, needleLength);
+                check(haystack, needle);
+            }
+        }
+        free(haystack);
+    }
+}
+
+static void checkEdges(void) {
+    static const char* needles[] = {
+        "", "a", "b", "ab", "ba", "aa", "aba", "abcdefghijklmnop",
+        "abcdefghijklmnopqrstuvwxyz0123456", // 33바이트
+        "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaab", // 첫 바이트가 빈칸과 같다
+        "baaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa",
+    };
+    for (size_t i = 0; i < sizeof(needles) / sizeof(needles[0]); i++) {
+        checkPlacements('a', needles[i]);
+        checkPlacements('x', needles[i]);
+    }
+}
+
+static void randomText(char* out, long length, int alphabet) {
+    for (long i = 0; i < length; i++) {
+        out[i] = (char)('a' + randomBelow(alphabet));
+    }
+    out[length] = '\0';
+}
+
+static long randomNeedleLength(void) {
+    switch (randomBelow(4)) {
+    case 0:
+        return randomBelow(3); // 0, 1, 2
+    case 1:
+        return 3 + randomBelow(14);
+    case 2:
+        return 17 + randomBelow(16);
+    default:
+        return 33 + randomBelow(48); // 벡터 하나보다 길다
+    }
+}
+
+static void checkRandom(long rounds) {
+    char needle[128];
+    for (long round = 0; round < rounds; round++) {
+        int alphabet = 1 + (int)randomBelow(4);
+        long length = randomBelow(2) == 0 ? randomBelow(32) : randomBelow(400);
+        char* haystack = (char*)malloc(length + 1);
+        randomText(haystack, length, alphabet);
+        long needleLength = randomNeedleLength();
+        long source = randomBelow(4);
+        if (needleLength <= length && source < 3) {
+            // 처음, 끝, 아무 곳에서 잘라 오면 반드시 한 번은 나온다
+            long position = source == 0 ? 0 : source == 1 ? length - needleLength : randomBelow(length - needleLength + 1);
+            memcpy(needle, haystack + position, needleLength);
+            needle[needleLength] = '\0';
+            if (needleLength > 0 && randomBelow(4) == 0) {
+                needle[randomBelow(needleLength)] = (char)('a' + randomBelow(alphabet + 1)); // 한 바이트만 다르게
+            }
+        } else {
+            randomText(needle, needleLength, alphabet);
+        }
+        check(haystack, needle);
+        free(haystack);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    long rounds = 200000;
+    rngState = (unsigned long long)time(NULL) | 1;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--rounds") == 0) {
+            rounds = atol(argv[i + 1]);
+        } else if (strcmp(argv[i], "--seed") == 0) {
+            rngState = strtoull(argv[i + 1], NULL, 10) | 1;
+        }
+    }
+    unsigned long long seed = rngState;
+
+    static const char* implementations[] = {"scalar", "sse2", "avx2"};
+    for (int i = 0; i < 3; i++) {
+        if (!memsearchSelect(implementations[i])) {
+            printf("memsearch %s: 이 CPU에서 쓸 수 없어 건너뜀\n", implementations[i]);
+            continue;
+        }
+        if (strcmp(memsearchImplementation(), implementations[i]) != 0) {
+            printf("memsearch %s: 선택된 구현이 %s입니다\n", implementations[i], memsearchImplementation());
+            failures++;
+            continue;
+        }
+        long before = failures;
+        rngState = seed;
+        checkEdges();
+        checkRandom(rounds);
+        printf("memsearch %s: %s\n", implementations[i], failures == before ? "통과" : "실패");
+    }
+    if (failures > 0) {
+        printf("불일치 %ld건 (--seed %llu로 다시 돌릴 수 있다)\n", failures, seed);
+        return 1;
+    }
+    return 0;
+}